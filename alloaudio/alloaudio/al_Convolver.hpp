@@ -3,6 +3,8 @@
 
 #include <vector>
 #include "allocore/io/al_AudioIO.hpp"
+#include "allocore/system/al_Atomic.hpp"
+#include "allocore/system/al_Thread.hpp"
 
 #define MAXSIZE 0x00100000
 
@@ -31,12 +33,29 @@ class Convolver : public al::AudioCallback
 {
 
 public:
+
+	/**
+	 * @brief One entry of a convolution matrix: the IR that routes an input to an output.
+	 */
+	struct IREntry {
+		int input;		///< Input (or bus) channel
+		int output;		///< Output channel
+		float *IR;		///< Impulse response of IRlength samples
+
+		IREntry(int input_, int output_, float *IR_)
+		:	input(input_), output(output_), IR(IR_) {}
+	};
+
     Convolver();
 
+    ~Convolver();
+
 	/**
 	 * @brief Sets up convolver. Must be called prior to processing.
 	 *
 	 * Checks for valid parameters, initializes convolver and impulse responses. Output from disabled channels is set to 0.
+	 * Any previous convolver, including one being swapped in, is freed, so this must not be called while
+	 * onAudioCB may run, i.e. only with the audio stream stopped. Use swapMatrix to change IRs while running.
 	 *
 	 * @param[in, out] io The AudioIO object.
 	 * @param[in] IRs The deinterleaved IR channels.
@@ -53,6 +72,98 @@ public:
 				  bool inputsAreBuses = false,
 				  vector<int> disabledChannels = vector<int>(),
 				  unsigned int basePartitionSize=64, unsigned int options=0);
+
+	/**
+	 * @brief Sets up convolver as a sparse N input by M output matrix. Must be called prior to processing.
+	 *
+	 * Every output is the sum of its inputs convolved with the IR of their entry. Each input
+	 * is transformed once per partition and its spectra are shared by all of its outputs.
+	 * Entries that use the same IR pointer share their IR spectra. Outputs without entries
+	 * are not written.
+	 *
+	 * Partitions grow from basePartitionSize up to maxPartitionSize. All but the first partition
+	 * size are processed in worker threads (see setWorkerPriority), so long tails are computed
+	 * in the background with larger, cheaper FFTs.
+	 *
+	 * As for configure, this must only be called with the audio stream stopped.
+	 *
+	 * @param[in, out] io The AudioIO object.
+	 * @param[in] matrix The non-zero entries of the matrix. At most 64 distinct inputs and 64 distinct outputs.
+	 * @param[in] IRlength Length of all IRs in samples.
+	 * @param[in] inputsAreBuses Set to True if you wish to use AudioIO's busses as input.
+	 * @param[in] basePartitionSize Should be set to audio callback size to minimize latency. Cannot be less than 64 samples.
+	 * @param[in] options Options passed to zita convolver.
+	 * @param[in] maxPartitionSize Largest partition size, at most 8192. 0 selects the largest possible.
+	 * @return Returns 0 upon success
+	 */
+	int configureMatrix(al::AudioIO &io,
+						const vector<IREntry> &matrix,
+						int IRlength,
+						bool inputsAreBuses = false,
+						unsigned int basePartitionSize=64, unsigned int options=0,
+						unsigned int maxPartitionSize=0);
+
+	/**
+	 * @brief Replaces the IRs without interrupting audio.
+	 *
+	 * A new convolver is configured and the IRs are transformed on a background thread while
+	 * processing continues with the current IRs. Once ready, the audio callback switches to the
+	 * new IRs, crossfading from the old ones over fadeTime. The tails of the new IRs build up
+	 * from the start of the crossfade. The old convolver is torn down on the background thread,
+	 * so the audio callback never allocates or frees memory. Must be called after configure or
+	 * configureMatrix. The IRs must stay valid until swapping() returns false.
+	 *
+	 * If the new convolver cannot be configured, the current IRs are kept and swapError()
+	 * returns the error once swapping() returns false.
+	 *
+	 * Parameters are as for configureMatrix.
+	 *
+	 * @param[in] fadeTime Length of the crossfade in seconds.
+	 * @return Returns 0 if the swap was started, or -1 if a previous swap has not finished.
+	 */
+	int swapMatrix(al::AudioIO &io,
+				   const vector<IREntry> &matrix,
+				   int IRlength,
+				   bool inputsAreBuses = false,
+				   double fadeTime = 0.05,
+				   unsigned int basePartitionSize=64, unsigned int options=0,
+				   unsigned int maxPartitionSize=0);
+
+	/**
+	 * @brief Returns whether a swap started by swapMatrix has yet to finish.
+	 */
+	bool swapping() const;
+
+	/**
+	 * @brief Returns the result of configuring the IRs of the last swap.
+	 *
+	 * Only valid once swapping() returns false.
+	 *
+	 * @return Returns 0 if the swap succeeded or none was started, otherwise the error
+	 * configureMatrix would have returned.
+	 */
+	int swapError() const;
+
+	/**
+	 * @brief Sets scheduling of the worker threads that process the larger partitions.
+	 *
+	 * Takes effect at the next configure. Worker threads run at priority minus their partition level.
+	 *
+	 * @param[in] priority Absolute thread priority.
+	 * @param[in] policy Scheduling policy, e.g. SCHED_OTHER or SCHED_FIFO.
+	 */
+	void setWorkerPriority(int priority, int policy = 0);
+
+	/**
+	 * @brief Sets whether the audio callback waits for the worker threads.
+	 *
+	 * Takes effect at the next configure. When synchronous, every block waits for the larger
+	 * partitions due in it, so output does not depend on thread scheduling. This is meant for
+	 * offline rendering and testing, as the callback may block for a long time.
+	 *
+	 * @param[in] sync True to wait for the worker threads.
+	 */
+	void setSynchronous(bool sync);
 	/**
 	 * @brief Handles all io for the convolution
 	 * @param[in,out] io The AudioIO object from which audio data will be read from and written to.
@@ -61,16 +172,49 @@ public:
     
     /**
      * @brief Stops processing audio and tears down convolver object.
+     *
+     * This frees the convolvers used by onAudioCB, so it must only be called, like the destructor,
+     * with the audio stream stopped. A swap in progress is cancelled.
      * @return Returns 0 upon success.
      */
     int shutdown(void);
 
 private:
-	vector<int> m_activeChannels;
-	vector<int> m_disabledChannels;
-	int m_inputChannel;
-	bool m_inputsAreBuses;
-	Convproc *m_Convproc;
+	// A configured convolver and its routing
+	struct Engine;
+
+	// Everything needed to configure an engine
+	struct Setup {
+		vector<IREntry> matrix;
+		vector<int> disabledChannels;
+		int IRlength;
+		int bufferSize, channelsIn, channelsOut;
+		bool inputsAreBuses;
+		unsigned int basePartitionSize, options, maxPartitionSize;
+	};
+
+	Setup makeSetup(al::AudioIO &io, const vector<IREntry> &matrix, int IRlength,
+					bool inputsAreBuses, unsigned int basePartitionSize,
+					unsigned int options, unsigned int maxPartitionSize);
+	int build(Engine *&engine, const Setup &setup);
+	int install(const Setup &setup);
+	void joinSwap();
+	static void * swapMain(void * user);
+
+	Engine *m_engine;				// current IRs
+	Engine *m_next;					// IRs being faded in; audio thread only
+	Engine *m_retired;				// IRs faded out, freed by the swap thread
+	Atomic<Engine *> m_pending;		// IRs ready to be faded in
+	Atomic<int> m_swapping;			// swap thread has work outstanding
+	Atomic<int> m_cancel;			// swap thread should give up waiting
+	Atomic<int> m_swapError;		// result of configuring the last swap
+	Setup m_swapSetup;
+	Thread m_swapThread;
+	bool m_swapStarted;
+	int m_fadeFrames, m_fadePos;
+	int m_workerPriority;
+	int m_workerPolicy;
+	bool m_sync;
 };
 
 }
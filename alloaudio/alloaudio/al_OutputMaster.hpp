@@ -52,11 +52,10 @@
 #include "allocore/types/al_SingleRWRingBuffer.hpp"
 #include "allocore/types/al_MsgQueue.hpp"
 #include "allocore/protocol/al_OSC.hpp"
+#include "allocore/sound/al_Crossover.hpp"
 #include "allocore/system/al_Thread.hpp"
 
 
-typedef struct BUTTER_ BUTTER;
-
 namespace al {
 
 typedef enum {
@@ -138,8 +137,9 @@ class OutputMaster : public osc::Recv, public al::AudioCallback
     void setMeterUpdateFreq(double freq);
 
     /** Set bass management cross-over frequency. The signal from all channels will be run
-     * through a pair of linear-phase cross-over filters, and the signal from the low pass
-     * filters is sent to the subwoofers specified using setSwIndeces().
+     * through 4th-order Linkwitz-Riley cross-over filters, and the signal from the low pass
+     * filters is sent to the subwoofers specified using setSwIndeces(). Changes of
+     * frequency glide over 50 ms.
     */
     void setBassManagementFreq(double frequency);
 
@@ -230,11 +230,14 @@ private:
     pthread_mutex_t m_meterMutex;
     pthread_cond_t m_meterCond;
 
-    /* bass management filters */
-    std::vector<BUTTER *> m_lopass1, m_lopass2, m_hipass1, m_hipass2;
-
     double m_framesPerSec; // Sample rate
 
+    /* bass management filters */
+    CrossoverBank m_crossover;
+    std::vector<float> m_bassBuf; /* subwoofer signal */
+    std::vector<float> m_lowBuf; /* low band of each channel */
+    std::vector<float *> m_lowPtrs, m_chanPtrs;
+
     int chanIsSubwoofer(int index);
     void initializeData();
     void allocateChannels(int numChnls);
@@ -5,130 +5,375 @@
 #include <string.h>
 #include <assert.h>
 #include "alloaudio/al_Convolver.hpp"
+#include "allocore/system/al_Time.hpp"
 
 using namespace al;
 
+enum { SWAP_IDLE = 0, SWAP_BUSY, SWAP_DONE };
+
+struct Convolver::Engine {
+    Convproc proc;
+    vector<int> inputs;	// io channel of each convolver input
+    vector<int> outputs;	// io channel of each convolver output
+    vector<int> disabledChannels;
+    bool inputsAreBuses;
+    bool sync;
+
+    ~Engine() {
+        if(proc.state() == Convproc::ST_PROC) {
+            proc.stop_process();
+        }
+    }
+
+    void process(al::AudioIOData &io) {
+        int blockSize = io.framesPerBuffer();
+        //fill the input buffers
+        for(unsigned i = 0; i < inputs.size(); i++){
+            const float *inbuf;
+            if (inputsAreBuses){
+                inbuf = io.busBuffer(inputs[i]);
+            }
+            else{
+                inbuf = io.inBuffer(inputs[i]);
+            }
+            memcpy(proc.inpdata(i), inbuf, sizeof(float) * blockSize);
+        }
+        proc.process(sync);
+    }
+};
+
 Convolver::Convolver() :
-    m_Convproc(NULL)
+    m_engine(NULL), m_next(NULL), m_retired(NULL), m_pending(NULL),
+    m_swapping(SWAP_IDLE), m_cancel(0), m_swapError(0), m_swapStarted(false),
+    m_fadeFrames(0), m_fadePos(0), m_workerPriority(0), m_workerPolicy(0), m_sync(false)
 {
 }
 
+Convolver::~Convolver()
+{
+    shutdown();
+}
+
 int Convolver::configure(al::AudioIO &io, vector<float *> IRs, int IRlength,
                          int inputChannel, bool inputsAreBuses,
                          vector<int> disabledChannels, unsigned int basePartitionSize, unsigned int options)
 {
-    int bufferSize = io.framesPerBuffer(), nActiveOutputs = io.channels(true) - disabledChannels.size(),
-    nActiveInputs, configResult;
-    m_inputChannel = inputChannel;
-    m_inputsAreBuses = inputsAreBuses;
-    m_disabledChannels = disabledChannels;
+    vector<int> activeChannels;
     for(int i = 0; i < io.channels(true); i++) {
         if (std::find(disabledChannels.begin(), disabledChannels.end(), i)
             == disabledChannels.end()) {
-            m_activeChannels.push_back(i);
+            activeChannels.push_back(i);
         }
     }
-    assert(bufferSize >= Convproc::MINQUANT);
-    assert(bufferSize <= Convproc::MAXQUANT);
-    assert(IRlength <= MAXSIZE);
-    assert(IRlength >= Convproc::MINPART);
+    int nActiveOutputs = activeChannels.size();
     assert(nActiveOutputs > 0);
-    assert(nActiveOutputs <= Convproc::MAXOUT);
-    if(m_inputChannel < 0){//many to many
-        assert(io.channels(false) >= m_activeChannels.size());
-        nActiveInputs = nActiveOutputs;
+    assert(IRs.size() >= activeChannels.size());
+    if(inputChannel < 0){//many to many
+        assert(io.channels(false) >= activeChannels.size());
     }
     else{//one to many
         assert(io.channels(false) >= 1);
-        nActiveInputs = 1;
     }
-    assert(basePartitionSize >= Convproc::MINPART);
-    assert(basePartitionSize <= Convproc::MAXPART);
 
-    if(m_Convproc != NULL) {
-        delete m_Convproc;
+    vector<IREntry> matrix;
+    for(int i = 0; i < nActiveOutputs; i++){
+        int out = activeChannels[i];
+        matrix.push_back(IREntry(inputChannel < 0 ? out : inputChannel, out, IRs[i]));
     }
-    m_Convproc = new Convproc;
-    m_Convproc->set_options(options);
-    m_Convproc->set_density(0.0f);
-    configResult = m_Convproc->configure(nActiveInputs, nActiveOutputs,
-                                         IRlength, bufferSize, basePartitionSize, (IRlength/2 < Convproc::MAXPART)?IRlength/2:Convproc::MAXPART);
+    Setup setup = makeSetup(io, matrix, IRlength, inputsAreBuses, basePartitionSize, options, 0);
+    setup.disabledChannels = disabledChannels;
+    return install(setup);
+}
+
+int Convolver::configureMatrix(al::AudioIO &io, const vector<IREntry> &matrix, int IRlength,
+                               bool inputsAreBuses, unsigned int basePartitionSize,
+                               unsigned int options, unsigned int maxPartitionSize)
+{
+    return install(makeSetup(io, matrix, IRlength, inputsAreBuses,
+                             basePartitionSize, options, maxPartitionSize));
+}
+
+int Convolver::swapMatrix(al::AudioIO &io, const vector<IREntry> &matrix, int IRlength,
+                          bool inputsAreBuses, double fadeTime,
+                          unsigned int basePartitionSize, unsigned int options,
+                          unsigned int maxPartitionSize)
+{
+    if(swapping()){
+        return -1;
+    }
+    if(m_swapStarted){
+        m_swapThread.join();
+        m_swapStarted = false;
+    }
+    m_swapSetup = makeSetup(io, matrix, IRlength, inputsAreBuses,
+                            basePartitionSize, options, maxPartitionSize);
+    m_fadeFrames = fadeTime > 0 ? int(fadeTime * io.framesPerSecond()) : 0;
+    m_cancel = 0;
+    m_swapError = 0;
+    m_swapping = SWAP_BUSY;
+    m_swapStarted = m_swapThread.start(swapMain, this);
+    if(!m_swapStarted){
+        m_swapping = SWAP_IDLE;
+        return -1;
+    }
+    return 0;
+}
+
+bool Convolver::swapping() const
+{
+    return m_swapping.load() != SWAP_IDLE;
+}
+
+int Convolver::swapError() const
+{
+    return m_swapError.load();
+}
+
+void Convolver::setWorkerPriority(int priority, int policy)
+{
+    m_workerPriority = priority;
+    m_workerPolicy = policy;
+}
+
+void Convolver::setSynchronous(bool sync)
+{
+    m_sync = sync;
+}
+
+void * Convolver::swapMain(void * user)
+{
+    Convolver &c = *static_cast<Convolver *>(user);
+    Engine *engine;
+    int configResult = c.build(engine, c.m_swapSetup);
     if(configResult != 0){
-        std::cout << "Config failed" << std::endl;
+        // keep the current IRs
+        c.m_swapError = configResult;
+        c.m_swapping = SWAP_IDLE;
+        return NULL;
     }
-    //create IRs
-    if(m_inputChannel < 0){//many to many
-        for(int i = 0; i < nActiveOutputs; i++){
-            m_Convproc->impdata_create(i, i, 1, IRs[i], 0, IRlength);
+    c.m_pending.store(engine);
+
+    // Wait for the audio callback to fade over to the new IRs
+    while(c.m_swapping.load() != SWAP_DONE){
+        if(c.m_cancel.load()){
+            return NULL;
         }
+        al_sleep(0.01);
     }
-    else{//one to many
-        for(int i = 0; i < nActiveOutputs; i++){
-            m_Convproc->impdata_create(0, i, 1, IRs[i], 0, IRlength);
+    delete c.m_retired;
+    c.m_retired = NULL;
+    c.m_swapping = SWAP_IDLE;
+    return NULL;
+}
+
+// Cancels a swap and frees the engines it involves, including the one the
+// audio callback fades in, so the stream must be stopped
+void Convolver::joinSwap()
+{
+    if(m_swapStarted){
+        m_cancel = 1;
+        m_swapThread.join();
+        m_swapStarted = false;
+    }
+    delete m_pending.exchange(NULL);
+    delete m_next;
+    m_next = NULL;
+    delete m_retired;
+    m_retired = NULL;
+    m_swapping = SWAP_IDLE;
+}
+
+Convolver::Setup Convolver::makeSetup(al::AudioIO &io, const vector<IREntry> &matrix, int IRlength,
+                                      bool inputsAreBuses, unsigned int basePartitionSize,
+                                      unsigned int options, unsigned int maxPartitionSize)
+{
+    Setup setup;
+    setup.matrix = matrix;
+    setup.IRlength = IRlength;
+    setup.bufferSize = io.framesPerBuffer();
+    setup.channelsIn = io.channels(false);
+    setup.channelsOut = io.channels(true);
+    setup.inputsAreBuses = inputsAreBuses;
+    setup.basePartitionSize = basePartitionSize;
+    setup.options = options;
+    setup.maxPartitionSize = maxPartitionSize;
+    return setup;
+}
+
+int Convolver::install(const Setup &setup)
+{
+    Engine *engine;
+    int configResult = build(engine, setup);
+    if(configResult != 0){
+        return configResult;
+    }
+    // the stream is stopped, so the engines can be replaced directly
+    joinSwap();
+    delete m_engine;
+    m_engine = engine;
+    return 0;
+}
+
+int Convolver::build(Engine *&engine, const Setup &setup)
+{
+    const vector<IREntry> &matrix = setup.matrix;
+    int bufferSize = setup.bufferSize, IRlength = setup.IRlength, configResult;
+    unsigned int basePartitionSize = setup.basePartitionSize;
+
+    engine = new Engine;
+    engine->disabledChannels = setup.disabledChannels;
+    engine->inputsAreBuses = setup.inputsAreBuses;
+    engine->sync = m_sync;
+
+    // Distinct channels, in ascending order, become the convolver's inputs and outputs
+    vector<int> &inputs = engine->inputs, &outputs = engine->outputs;
+    for(unsigned i = 0; i < matrix.size(); i++){
+        inputs.push_back(matrix[i].input);
+        outputs.push_back(matrix[i].output);
+    }
+    sort(inputs.begin(), inputs.end());
+    inputs.erase(unique(inputs.begin(), inputs.end()), inputs.end());
+    sort(outputs.begin(), outputs.end());
+    outputs.erase(unique(outputs.begin(), outputs.end()), outputs.end());
+
+    int nInputs = inputs.size(), nOutputs = outputs.size();
+    assert(bufferSize >= Convproc::MINQUANT);
+    assert(bufferSize <= Convproc::MAXQUANT);
+    assert(IRlength <= MAXSIZE);
+    assert(IRlength >= Convproc::MINPART);
+    assert(nOutputs > 0);
+    assert(nOutputs <= Convproc::MAXOUT);
+    assert(nInputs <= Convproc::MAXINP);
+    assert(inputs.front() >= 0);
+    assert(outputs.front() >= 0);
+    assert(outputs.back() < setup.channelsOut);
+    assert(inputs.back() < setup.channelsIn);
+    assert(basePartitionSize >= Convproc::MINPART);
+    assert(basePartitionSize <= Convproc::MAXPART);
+
+    // Largest partition must be a power of two no longer than half the IR
+    unsigned int maxLimit = setup.maxPartitionSize ? setup.maxPartitionSize : Convproc::MAXPART;
+    if(maxLimit > Convproc::MAXPART) maxLimit = Convproc::MAXPART;
+    if(maxLimit > (unsigned)IRlength/2) maxLimit = IRlength/2;
+    unsigned int maxPart = basePartitionSize;
+    while(maxPart*2 <= maxLimit) maxPart *= 2;
+
+    Convproc &proc = engine->proc;
+    proc.set_options(setup.options);
+    // Sparse matrices need fewer multiply-adds per FFT, which favours more partitions
+    proc.set_density(float(matrix.size()) / (nInputs * nOutputs));
+    configResult = proc.configure(nInputs, nOutputs,
+                                  IRlength, bufferSize, basePartitionSize, maxPart);
+    if(configResult != 0){
+        cout << "Warning: convolver configuration failed" << endl;
+        delete engine;
+        engine = NULL;
+        return configResult;
+    }
+    //create IRs, sharing the spectra of IRs used more than once
+    for(unsigned i = 0; i < matrix.size(); i++){
+        int inp = lower_bound(inputs.begin(), inputs.end(), matrix[i].input) - inputs.begin();
+        int out = lower_bound(outputs.begin(), outputs.end(), matrix[i].output) - outputs.begin();
+        unsigned j = 0;
+        while(j < i && matrix[j].IR != matrix[i].IR) j++;
+        if(j < i){
+            int inp1 = lower_bound(inputs.begin(), inputs.end(), matrix[j].input) - inputs.begin();
+            int out1 = lower_bound(outputs.begin(), outputs.end(), matrix[j].output) - outputs.begin();
+            proc.impdata_copy(inp1, out1, inp, out);
+        }
+        else{
+            proc.impdata_create(inp, out, 1, matrix[i].IR, 0, IRlength);
         }
     }
-    m_Convproc->start_process(0, 0);
+    proc.start_process(m_workerPriority, m_workerPolicy);
     return 0;
 }
 
 void Convolver::onAudioCB(al::AudioIOData &io)
 {
     int blockSize = io.framesPerBuffer();
-    
-    //fill the input buffers
-    if(m_inputChannel < 0){
-        // many to many
-        int i = 0;
-        for(vector<int>::iterator it = m_activeChannels.begin();
-            it != m_activeChannels.end(); ++it, ++i){
-            const float *inbuf;
-            float *dest = m_Convproc->inpdata(i);
-            if (m_inputsAreBuses){
-                inbuf = io.busBuffer(*it);
-            }
-            else{
-                inbuf = io.inBuffer(*it);
-            }
-            memcpy(dest, inbuf, sizeof(float) * blockSize);
+
+    // Pick up IRs prepared by the swap thread
+    if(m_next == NULL && m_pending.load() != NULL){
+        m_next = m_pending.exchange(NULL);
+        m_fadePos = 0;
+    }
+    if(m_engine == NULL){
+        if(m_next == NULL) return;
+        // nothing to fade from
+        m_engine = m_next;
+        m_next = NULL;
+        m_swapping = SWAP_DONE;
+    }
+
+    Engine &cur = *m_engine;
+    cur.process(io);
+
+	//clear output for disabled channels
+    for(vector<int>::iterator it = cur.disabledChannels.begin();
+        it != cur.disabledChannels.end(); ++it) {
+        memset(io.outBuffer(*it), 0, sizeof(float) * blockSize);
+    }
+
+    if(m_next == NULL){
+        //fill the output buffers
+        for(unsigned i = 0; i < cur.outputs.size(); i++) {
+            memcpy(io.outBuffer(cur.outputs[i]), cur.proc.outdata(i), sizeof(float) * blockSize);
         }
+        return;
+    }
+
+    // Crossfade from the current to the next IRs
+    Engine &next = *m_next;
+    next.process(io);
+    for(vector<int>::iterator it = next.disabledChannels.begin();
+        it != next.disabledChannels.end(); ++it) {
+        memset(io.outBuffer(*it), 0, sizeof(float) * blockSize);
     }
-    else{
-        //one to many
-        const float *inbuf;
-        if (m_inputsAreBuses){
-            inbuf = io.busBuffer(m_inputChannel);
+
+    float gain0 = m_fadeFrames ? float(m_fadePos) / m_fadeFrames : 1.0f;
+    float gainInc = m_fadeFrames ? 1.0f / m_fadeFrames : 0.0f;
+    for(unsigned c = 0; c < cur.outputs.size(); c++) {
+        float *outbuf = io.outBuffer(cur.outputs[c]);
+        const float *src = cur.proc.outdata(c);
+        float g = gain0;
+        for(int i = 0; i < blockSize; i++, g += gainInc) {
+            outbuf[i] = src[i] * (g < 1.0f ? 1.0f - g : 0.0f);
         }
-        else{
-            inbuf = io.inBuffer(m_inputChannel);
+    }
+    for(unsigned c = 0; c < next.outputs.size(); c++) {
+        float *outbuf = io.outBuffer(next.outputs[c]);
+        const float *src = next.proc.outdata(c);
+        bool mix = binary_search(cur.outputs.begin(), cur.outputs.end(), next.outputs[c]);
+        float g = gain0;
+        for(int i = 0; i < blockSize; i++, g += gainInc) {
+            float y = src[i] * (g < 1.0f ? g : 1.0f);
+            outbuf[i] = mix ? outbuf[i] + y : y;
         }
-        memcpy(m_Convproc->inpdata(0), inbuf, sizeof(float) * blockSize);
-    }
-    
-    //process
-    int ret = m_Convproc->process(false);
-    
-    //fill the output buffers
-    int i = 0;
-    for(vector<int>::iterator it = m_activeChannels.begin();
-        it != m_activeChannels.end(); ++it, ++i) {
-        float *outbuf = io.outBuffer(*it);
-        memcpy(outbuf, m_Convproc->outdata(i), sizeof(float) * blockSize);
-    }
-        
-	//clear output for disabled channels
-    for(vector<int>::iterator it = m_disabledChannels.begin();
-        it != m_disabledChannels.end(); ++it) {
-        memset(io.outBuffer(*it), 0, sizeof(float) * blockSize);
+    }
+
+    m_fadePos += blockSize;
+    if(m_fadePos >= m_fadeFrames){
+        // hand the old IRs to the swap thread to free
+        m_retired = m_engine;
+        m_engine = m_next;
+        m_next = NULL;
+        m_swapping = SWAP_DONE;
     }
 }
 
 int Convolver::shutdown(void){
-    if(m_Convproc->stop_process()){
+    joinSwap();
+    if(m_engine == NULL){
+        return 0;
+    }
+    if(m_engine->proc.stop_process()){
         cout << "Warning: could not stop process" << endl;
     }
-    if(m_Convproc->cleanup()){
+    if(m_engine->proc.cleanup()){
         cout << "Warning: cleanup failed" << endl;
     }
+    delete m_engine;
+    m_engine = NULL;
     return 0;
 }
-
@@ -5,8 +5,6 @@
 #include "alloaudio/al_OutputMaster.hpp"
 #include "allocore/system/al_Time.hpp"
 
-#include "alloaudio/butter.h"
-
 //#include "firfilter.h"
 
 using namespace al;
@@ -44,12 +42,6 @@ OutputMaster::OutputMaster(int num_chnls, double sampleRate, const char *address
 
 OutputMaster::~OutputMaster()
 {
-	for (int i = 0; i < m_numChnls; i++) {
-		butter_free(m_lopass1[i]);
-		butter_free(m_lopass2[i]);
-		butter_free(m_hipass1[i]);
-		butter_free(m_hipass2[i]);
-	}
 	stop(); /* Stops OSC listener */
 	m_runMeterThread = 0;
 	pthread_cond_signal(&m_meterCond);
@@ -88,14 +80,8 @@ void OutputMaster::setMeterUpdateFreq(double freq)
 
 void OutputMaster::setBassManagementFreq(double frequency)
 {
-	int i;
 	if (frequency > 0) {
-		for (i = 0; i < m_numChnls; i++) {
-			butter_set_fc(m_lopass1[i], frequency);
-			butter_set_fc(m_lopass2[i], frequency);
-			butter_set_fc(m_hipass1[i], frequency);
-			butter_set_fc(m_hipass2[i], frequency);
-		}
+		m_crossover.freq(frequency, m_framesPerSec);
 	}
 }
 
@@ -133,79 +119,62 @@ void OutputMaster::onAudioCB(AudioIOData &io)
 {
 	int i, chan = 0;
 	int nframes = io.framesPerBuffer();
-	double bass_buf[nframes];
-	double filt_out[nframes];
-	double filt_low[nframes];
-	double in_buf[nframes];
 	double master_gain;
 
 	m_parameterQueue.update(0);
 	master_gain = m_masterGain * (m_muteAll ? 0.0 : 1.0);
-	memset(bass_buf, 0, nframes * sizeof(double));
-	for (chan = 0; chan < m_numChnls; chan++) {
-		double gain = master_gain * m_gains[chan];
-		const float *in = io.outBuffer(chan);  // Yes, the input here is the output from previous runs for the io object
-		float *out = io.outBuffer(chan);
-		double filt_temp[nframes];
-		double *buf = bass_buf;
 
-		for (i = 0; i < nframes; i++) {
-			in_buf[i] = *in++;
+	bass_mgmt_mode_t mode = m_BassManagementMode;
+	if (mode != BASSMODE_NONE) {
+		bool lowpass = (mode == BASSMODE_LOWPASS || mode == BASSMODE_FULL);
+		bool highpass = (mode == BASSMODE_HIGHPASS || mode == BASSMODE_FULL);
+		if ((int) m_bassBuf.size() < nframes) { /* only when the block size grows */
+			m_bassBuf.resize(nframes);
+			m_lowBuf.resize(nframes * m_numChnls);
 		}
-		switch (m_BassManagementMode) {
-		case BASSMODE_NONE:
-			break;
-		case BASSMODE_MIX:
-			for (i = 0; i < nframes; i++) {
-				filt_low[i] = in_buf[i];
-			}
-			break;
-		case BASSMODE_LOWPASS:
-			butter_next(m_lopass1[chan], in_buf, filt_temp, nframes);
-			butter_next(m_lopass2[chan], filt_temp, filt_low, nframes);
-			break;
-		case BASSMODE_HIGHPASS:
-			for (i = 0; i < nframes; i++) {
-				filt_low[i] = in_buf[i];
-			}
-			butter_next(m_hipass1[chan], in_buf, filt_temp, nframes);
-			butter_next(m_hipass2[chan], filt_temp, filt_out, nframes);
-			for (i = 0; i < nframes; i++) {
-				in_buf[i] = filt_out[i];
-			}
-			break;
-		case BASSMODE_FULL:
-			butter_next(m_lopass1[chan], in_buf, filt_temp, nframes);
-			butter_next(m_lopass2[chan], filt_temp, filt_low, nframes);
-			butter_next(m_hipass1[chan], in_buf, filt_temp, nframes);
-			butter_next(m_hipass2[chan], filt_temp, filt_out, nframes);
-			for (i = 0; i < nframes; i++) {
-				in_buf[i] = filt_out[i]; /* a bit inefficient to copy here, but makes code simpler below */
+		float *bass_buf = m_bassBuf.data();
+		memset(bass_buf, 0, nframes * sizeof(float));
+		for (chan = 0; chan < m_numChnls; chan++) {
+			// Yes, the input here is the output from previous runs for the io object
+			m_chanPtrs[chan] = io.outBuffer(chan);
+			m_lowPtrs[chan] = m_lowBuf.data() + chan * nframes;
+		}
+		if (!lowpass) { /* full band signals go to the subwoofers */
+			for (chan = 0; chan < m_numChnls; chan++) {
+				const float *in = m_chanPtrs[chan];
+				for (i = 0; i < nframes; i++) {
+					bass_buf[i] += in[i];
+				}
 			}
-			break;
-		default:
-			break;
 		}
-		for (i = 0; i < nframes; i++) { /* accumulate SW signal */
-			*buf++ += filt_low[i];
+		/* high bands replace the channel signals in place */
+		m_crossover.process(lowpass ? m_lowPtrs.data() : NULL,
+							highpass ? m_chanPtrs.data() : NULL,
+							m_chanPtrs.data(), nframes);
+		if (lowpass) {
+			for (chan = 0; chan < m_numChnls; chan++) {
+				const float *low = m_lowPtrs[chan];
+				for (i = 0; i < nframes; i++) {
+					bass_buf[i] += low[i];
+				}
+			}
 		}
+	}
+	for (chan = 0; chan < m_numChnls; chan++) {
+		double gain = master_gain * m_gains[chan];
+		float *out = io.outBuffer(chan);
 		for (i = 0; i < nframes; i++) {
-			*out = in_buf[i] * gain;
-			if (m_clipperOn && *out > master_gain) {
-				*out = master_gain;
+			out[i] = out[i] * gain;
+			if (m_clipperOn && out[i] > master_gain) {
+				out[i] = master_gain;
 			}
-			out++;
 		}
 	}
-	if (m_BassManagementMode != BASSMODE_NONE) {
+	if (mode != BASSMODE_NONE) {
 		int sw;
 		for(sw = 0; sw < 4; sw++) {
 			if (swIndex[sw] < 0) continue;
-			float *out = io.outBuffer(swIndex[sw]);
-			memset(out, 0, nframes * sizeof(float));
-			for (i = 0; i < nframes; i++) {
-				*out++ = bass_buf[i];
-			}
+			memcpy(io.outBuffer(swIndex[sw]), m_bassBuf.data(), nframes * sizeof(float));
 		}
 	}
 	if (m_meterOn) {
@@ -309,6 +278,8 @@ void OutputMaster::initializeData()
 
 	setBassManagementMode(BASSMODE_NONE);
 	setBassManagementFreq(150);
+	m_crossover.clear(); /* start at 150 Hz instead of gliding there */
+	m_crossover.smooth(m_framesPerSec * 0.05);
 	setMeterUpdateFreq(10.0);
 }
 
@@ -316,20 +287,15 @@ void OutputMaster::allocateChannels(int numChnls)
 {
 	m_gains.resize(numChnls);
 	m_meters.resize(numChnls);
-	m_lopass1.resize(numChnls);
-	m_lopass2.resize(numChnls);
-	m_hipass1.resize(numChnls);
-	m_hipass2.resize(numChnls);
+	m_lowPtrs.resize(numChnls);
+	m_chanPtrs.resize(numChnls);
+	m_crossover.resize(numChnls);
 	swIndex[0] = numChnls - 1;
 	swIndex[1] =  swIndex[2] = swIndex[3] = -1;
 
 	for (int i = 0; i < numChnls; i++) {
 		m_gains[i] = 1.0;
 		m_meters[i] = 0;
-		m_lopass1[i] = butter_create(m_framesPerSec, BUTTER_LP);
-		m_lopass2[i] = butter_create(m_framesPerSec, BUTTER_LP);
-		m_hipass1[i] = butter_create(m_framesPerSec, BUTTER_HP);
-		m_hipass2[i] = butter_create(m_framesPerSec, BUTTER_HP);
 	}
 }
 
@@ -3,9 +3,11 @@
 #include <string>
 #include <sstream>
 #include <cassert>
+#include <cmath>
 //#include <iostream>
 
 #include "alloaudio/al_OutputMaster.hpp"
+#include "alloaudio/butter.h"
 #include "allocore/system/al_Time.hpp"
 
 
@@ -185,6 +187,74 @@ void ut_osc_gain(void)
 	}
 }
 
+/* Compare bass management against cascaded double precision butter filters */
+static void bass_management(al::bass_mgmt_mode_t mode)
+{
+	const int nchnls = 11, nframes = 100, nblocks = 5;
+	const int sw = nchnls - 1; /* default subwoofer */
+	al::AudioIO io(nframes, 44100.0, NULL, NULL, nchnls, 0, al::AudioIO::DUMMY);
+	al::OutputMaster outmaster(io.channelsOut(), io.framesPerSecond(), "", -1);
+	io.append(outmaster);
+	outmaster.setMasterGain(1.0);
+	outmaster.setClipperOn(false);
+	outmaster.setBassManagementMode(mode);
+
+	BUTTER *lp[nchnls][2], *hp[nchnls][2];
+	for (int c = 0; c < nchnls; c++) {
+		for (int k = 0; k < 2; k++) {
+			lp[c][k] = butter_create(44100, BUTTER_LP);
+			hp[c][k] = butter_create(44100, BUTTER_HP);
+		}
+	}
+	bool lowpass = (mode == al::BASSMODE_LOWPASS || mode == al::BASSMODE_FULL);
+	bool highpass = (mode == al::BASSMODE_HIGHPASS || mode == al::BASSMODE_FULL);
+
+	double max_err = 0;
+	for (int b = 0; b < nblocks; b++) {
+		double in[nframes], tmp[nframes], low[nframes], high[nframes];
+		double bass[nframes] = {0};
+		double expect[nchnls][nframes];
+		for (int c = 0; c < nchnls; c++) {
+			float *out = io.outBuffer(c);
+			for (int i = 0; i < nframes; i++) {
+				in[i] = out[i] = 0.3 * sin((b * nframes + i) * 0.005 * (c + 1)) + 0.1 * sin(i * 0.7);
+			}
+			butter_next(lp[c][0], in, tmp, nframes);
+			butter_next(lp[c][1], tmp, low, nframes);
+			butter_next(hp[c][0], in, tmp, nframes);
+			butter_next(hp[c][1], tmp, high, nframes);
+			for (int i = 0; i < nframes; i++) {
+				bass[i] += lowpass ? low[i] : in[i];
+				expect[c][i] = highpass ? high[i] : in[i];
+			}
+		}
+		io.processAudio();
+		for (int c = 0; c < nchnls; c++) {
+			float *out = io.outBuffer(c);
+			for (int i = 0; i < nframes; i++) {
+				double e = fabs(out[i] - (c == sw ? bass[i] : expect[c][i]));
+				if (e > max_err) max_err = e;
+			}
+		}
+	}
+	assert(max_err < 1e-3); /* filters run in single precision */
+
+	for (int c = 0; c < nchnls; c++) {
+		for (int k = 0; k < 2; k++) {
+			butter_free(lp[c][k]);
+			butter_free(hp[c][k]);
+		}
+	}
+}
+
+void ut_bass_management(void)
+{
+	bass_management(al::BASSMODE_MIX);
+	bass_management(al::BASSMODE_LOWPASS);
+	bass_management(al::BASSMODE_HIGHPASS);
+	bass_management(al::BASSMODE_FULL);
+}
+
 float meterValues[2] = {1.0f, 1.0f};
 float meterValues2[2] = {1.0f, 1.0f};
 struct OSCHandler : public al::osc::PacketHandler{
@@ -283,6 +353,7 @@ int main()
 	RUNTEST(gains);
 	RUNTEST(meter_values);
 	RUNTEST(clipper);
+	RUNTEST(bass_management);
 	RUNTEST(osc_gain);
 	RUNTEST(osc_meters);
 
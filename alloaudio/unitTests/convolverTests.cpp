@@ -9,6 +9,7 @@
 
 #include "alloaudio/al_Convolver.hpp"
 #include "allocore/io/al_AudioIO.hpp"
+#include "allocore/system/al_Time.hpp"
 
 #define IR_SIZE 1024
 #define BLOCK_SIZE 64 //min 64, max 8192
@@ -209,6 +210,147 @@ void ut_vector_mode(void)
     conv.shutdown();
 }
 
+void ut_matrix(void)
+{
+    const int nIn = 3, nOut = 5, IRlength = 1000, nBlocks = 40;
+	al::Convolver conv;
+	al::AudioIO io(BLOCK_SIZE, 44100.0, NULL, NULL, nOut, nIn, al::AudioIO::DUMMY);
+	io.append(conv);
+    io.channelsBus(nIn);
+    //wait for the worker threads, so every block is complete
+    conv.setSynchronous(true);
+
+    //IRs with taps spread over the whole length, one of them shared
+    vector<vector<float> > IRs(3, vector<float>(IRlength, 0.0f));
+    IRs[0][0] = 1.0f; IRs[0][700] = -0.5f;
+    IRs[1][5] = 0.5f; IRs[1][130] = 0.25f; IRs[1][999] = 1.0f;
+    IRs[2][300] = 0.75f;
+
+    //sparse matrix: output 2 has two inputs, output 3 has none
+    vector<al::Convolver::IREntry> matrix;
+    matrix.push_back(al::Convolver::IREntry(0, 0, &IRs[0][0]));
+    matrix.push_back(al::Convolver::IREntry(0, 2, &IRs[1][0]));
+    matrix.push_back(al::Convolver::IREntry(2, 2, &IRs[2][0]));
+    matrix.push_back(al::Convolver::IREntry(1, 1, &IRs[1][0]));
+    matrix.push_back(al::Convolver::IREntry(2, 4, &IRs[0][0]));
+
+    int ret = conv.configureMatrix(io, matrix, IRlength, true, BLOCK_SIZE);
+    assert(ret == 0);
+
+    //direct convolution of the same inputs
+    int nFrames = nBlocks * BLOCK_SIZE;
+    vector<vector<float> > x(nIn, vector<float>(nFrames));
+    vector<vector<double> > y(nOut, vector<double>(nFrames, 0.0));
+    for(int c = 0; c < nIn; c++) {
+        for(int i = 0; i < nFrames; i++) {
+            x[c][i] = sin(i * 0.05 * (c + 1)) + ((i * (c + 3)) % 17) * 0.02f;
+        }
+    }
+    for(unsigned e = 0; e < matrix.size(); e++) {
+        const al::Convolver::IREntry &m = matrix[e];
+        for(int i = 0; i < nFrames; i++) {
+            for(int k = 0; k < IRlength && k <= i; k++) {
+                y[m.output][i] += x[m.input][i - k] * m.IR[k];
+            }
+        }
+    }
+
+    double maxErr = 0;
+    for(int b = 0; b < nBlocks; b++) {
+        for(int c = 0; c < nIn; c++) {
+            memcpy(io.busBuffer(c), &x[c][b * BLOCK_SIZE], sizeof(float) * BLOCK_SIZE);
+        }
+        for(int i = 0; i < BLOCK_SIZE; i++) io.out(3, i) = 7.0f;
+        io.processAudio();
+        for(int i = 0; i < BLOCK_SIZE; i++) {
+            assert(io.out(3, i) == 7.0f);
+            for(int c = 0; c < nOut; c++) {
+                if(c == 3) continue;
+                double err = fabs(io.out(c, i) - y[c][b * BLOCK_SIZE + i]);
+                if(err > maxErr) maxErr = err;
+            }
+        }
+    }
+    assert(maxErr < 1e-4);
+    conv.shutdown();
+}
+
+void ut_swap(void)
+{
+	al::Convolver conv;
+	al::AudioIO io(BLOCK_SIZE, 44100.0, NULL, NULL, 2, 1, al::AudioIO::DUMMY);
+	io.append(conv);
+    io.channelsBus(1);
+
+    vector<float> pass(IR_SIZE, 0.0f), half(IR_SIZE, 0.0f);
+    pass[0] = 1.0f;
+    half[0] = 0.5f;
+
+    vector<al::Convolver::IREntry> matrixA, matrixB;
+    matrixA.push_back(al::Convolver::IREntry(0, 0, &pass[0]));
+    matrixB.push_back(al::Convolver::IREntry(0, 0, &half[0]));
+    matrixB.push_back(al::Convolver::IREntry(0, 1, &pass[0]));
+
+    int ret = conv.configureMatrix(io, matrixA, IR_SIZE, true, BLOCK_SIZE);
+    assert(ret == 0);
+    assert(!conv.swapping());
+
+    //DC input, so the outputs glide from one routing to the other
+    float *busBuffer = io.busBuffer(0);
+    for(int i = 0; i < BLOCK_SIZE; i++) busBuffer[i] = 1.0f;
+    io.zeroOut();
+    io.processAudio();
+    assert(io.out(0, BLOCK_SIZE - 1) == 1.0f);
+
+    double fadeTime = 0.01;
+    ret = conv.swapMatrix(io, matrixB, IR_SIZE, true, fadeTime, BLOCK_SIZE);
+    assert(ret == 0);
+    assert(conv.swapping());
+    assert(conv.swapMatrix(io, matrixA, IR_SIZE, true, fadeTime, BLOCK_SIZE) == -1);
+
+    float maxStep = 1.0f / (fadeTime * io.framesPerSecond()) + 1e-6f;
+    float prev0 = 1.0f, prev1 = 0.0f;
+    int fadeBlocks = 0;
+    for(int b = 0; b < 500 && conv.swapping(); b++) {
+        io.zeroOut();
+        io.processAudio();
+        for(int i = 0; i < BLOCK_SIZE; i++) {
+            assert(fabs(io.out(0, i) - prev0) <= maxStep);
+            assert(fabs(io.out(1, i) - prev1) <= maxStep);
+            prev0 = io.out(0, i);
+            prev1 = io.out(1, i);
+        }
+        if(io.out(1, 0) != 0.0f && io.out(1, 0) != 1.0f) fadeBlocks++;
+        al_sleep(0.002);
+    }
+    assert(!conv.swapping());
+    assert(fadeBlocks >= 6 && fadeBlocks <= 7);
+
+    io.zeroOut();
+    io.processAudio();
+    for(int i = 0; i < BLOCK_SIZE; i++) {
+        assert(io.out(0, i) == 0.5f);
+        assert(io.out(1, i) == 1.0f);
+    }
+    assert(conv.swapError() == 0);
+
+    //a partition size that is not a power of two fails, keeping the current IRs
+    ret = conv.swapMatrix(io, matrixA, IR_SIZE, true, fadeTime, 96);
+    assert(ret == 0);
+    for(int b = 0; b < 500 && conv.swapping(); b++) {
+        al_sleep(0.002);
+    }
+    assert(!conv.swapping());
+    assert(conv.swapError() != 0);
+    io.zeroOut();
+    io.processAudio();
+    for(int i = 0; i < BLOCK_SIZE; i++) {
+        assert(io.out(0, i) == 0.5f);
+        assert(io.out(1, i) == 1.0f);
+    }
+    conv.shutdown();
+}
+
 #define RUNTEST(Name)\
 	printf("%s ", #Name);\
 	ut_##Name();\
@@ -222,5 +364,7 @@ int main()
 	RUNTEST(one_to_many);
 	RUNTEST(disabled_channels);
 	RUNTEST(vector_mode);
+	RUNTEST(matrix);
+	RUNTEST(swap);
 	return 0;
 }
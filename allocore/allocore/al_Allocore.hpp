@@ -47,10 +47,12 @@
 //#include "allocore/graphics/al_Isosurface.hpp"
 #include "allocore/graphics/al_Lens.hpp"
 #include "allocore/graphics/al_Light.hpp"
+#include "allocore/graphics/al_MeshCache.hpp"
 #include "allocore/graphics/al_Shader.hpp"
 #include "allocore/graphics/al_Shapes.hpp"
 #include "allocore/graphics/al_Stereographic.hpp"
 #include "allocore/graphics/al_Texture.hpp"
+#include "allocore/graphics/al_VertexPacker.hpp"
 #include "allocore/io/al_App.hpp"
 #include "allocore/io/al_AudioIO.hpp"
 #include "allocore/io/al_ControlNav.hpp"
@@ -72,11 +74,14 @@
 #include "allocore/math/al_Spherical.hpp"
 #include "allocore/math/al_Vec.hpp"
 #include "allocore/protocol/al_OSC.hpp"
+#include "allocore/protocol/al_PointCloud.hpp"
 #include "allocore/protocol/al_Serialize.hpp"
 #include "allocore/sound/al_Reverb.hpp"
 #include "allocore/sound/al_Speaker.hpp"
 #include "allocore/sound/al_AudioScene.hpp"
 #include "allocore/sound/al_Ambisonics.hpp"
+#include "allocore/sound/al_BiquadBank.hpp"
+#include "allocore/sound/al_Crossover.hpp"
 #include "allocore/sound/al_Dbap.hpp"
 #include "allocore/sound/al_Vbap.hpp"
 #include "allocore/spatial/al_Curve.hpp"
@@ -85,9 +90,12 @@
 #include "allocore/system/al_Info.hpp"
 #include "allocore/system/al_MainLoop.hpp"
 #include "allocore/system/al_Printing.hpp"
+#include "allocore/system/al_TaskPool.hpp"
 #include "allocore/system/al_Thread.hpp"
 #include "allocore/system/al_Time.hpp"
+#include "allocore/system/al_Trace.hpp"
 #include "allocore/types/al_Buffer.hpp"
 #include "allocore/types/al_Conversion.hpp"
 #include "allocore/types/al_Array.hpp"
 #include "allocore/types/al_SingleRWRingBuffer.hpp"
+#include "allocore/types/al_TripleBuffer.hpp"
@@ -100,6 +100,8 @@ struct Viewport {
 };
 
 
+class MeshCache;
+
 /// Interface for setting graphics state and rendering Mesh
 
 ///	It also owns a Mesh, to simulate immediate mode (where it draws its own data)
@@ -499,6 +501,15 @@ public:
 	/// Draw internal vertex data
 	void draw(){ draw(mMesh); }
 
+	/// Set cache of GPU copies of meshes to draw from
+
+	/// Meshes added to the cache are drawn from its buffers; all others are
+	/// drawn from client memory. Pass 0 to draw everything from client memory.
+	void meshCache(MeshCache * v){ mMeshCache = v; }
+
+	/// Get cache of GPU copies of meshes, or 0 if none
+	MeshCache * meshCache() const { return mMeshCache; }
+
 
 	// Utility functions: converting, reporting, etc.
 
@@ -537,6 +548,7 @@ public:
 protected:
 	Mesh mMesh;				// used for immediate mode style rendering
 	bool mInImmediateMode;	// flag for whether or not in immediate mode
+	MeshCache * mMeshCache;	// GPU copies of meshes, if any
 };
 
 
@@ -0,0 +1,163 @@
+#ifndef INCLUDE_AL_GRAPHICS_MESH_CACHE_HPP
+#define INCLUDE_AL_GRAPHICS_MESH_CACHE_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+
+	File description:
+	Cache of GPU-resident copies of meshes for drawing
+*/
+
+#include <map>
+#include "allocore/graphics/al_BufferObject.hpp"
+#include "allocore/graphics/al_VertexPacker.hpp"
+
+namespace al{
+
+/// Keeps copies of meshes in GPU buffers between draws
+
+/// Graphics::draw sends every buffer of a mesh from client memory on each
+/// call. Meshes added to a cache are instead packed into one interleaved
+/// vertex buffer, plus an element buffer for indices, and sent again only
+/// when they change. Attach a cache with Graphics::meshCache(); meshes that
+/// were not added are drawn from client memory as before.
+///
+/// Meshes are identified by address and carry a version that modified()
+/// advances. Nothing is uploaded while the version is unchanged, so any edit
+/// to a cached mesh must be followed by a call to modified(). Changes in the
+/// number of vertices or indices are noticed without it.
+///
+/// With STATIC_DRAW or DYNAMIC_DRAW usage, only the vertices named in
+/// modified() are sent again. With STREAM_DRAW usage, meant for meshes that
+/// change every frame, the buffer storage is orphaned and refilled so that
+/// the driver need not wait on draws still reading the previous contents.
+///
+/// The vertex layout can trade precision for bandwidth (see VertexLayout).
+/// Formats the fixed-function pipeline cannot read are replaced by 32-bit
+/// floats. Normalized positions are drawn by scaling the modelview matrix by
+/// the same factor along all axes. GL_RESCALE_NORMAL is enabled while such a
+/// mesh with normals is drawn, so lit normals keep their length.
+class MeshCache : public GPUObject {
+public:
+
+	typedef BufferObject::BufferUsage Usage;
+
+	/// @param[in] layout	layout of cached vertices
+	MeshCache(const VertexLayout& layout = VertexLayout());
+
+	virtual ~MeshCache();
+
+
+	/// Add a mesh to the cache; it is uploaded on its first draw
+	MeshCache& add(const Mesh& m, Usage usage = BufferObject::STATIC_DRAW);
+
+	/// Remove a mesh from the cache and free its buffers
+	MeshCache& remove(const Mesh& m);
+
+	/// Remove all meshes from the cache
+	MeshCache& clear();
+
+	/// Whether a mesh is in the cache
+	bool contains(const Mesh& m) const { return mEntries.count(&m) != 0; }
+
+	/// Get number of meshes in the cache
+	int size() const { return mEntries.size(); }
+
+	/// Mark vertices of a cached mesh as modified
+
+	/// The next draw uploads the given range of vertices. With the default
+	/// arguments, all buffers, including indices, are uploaded again.
+	/// @param[in] m		cached mesh
+	/// @param[in] begin	index of first modified vertex
+	/// @param[in] end		one past index of last modified vertex;
+	///						negative values count back from one past the end
+	MeshCache& modified(const Mesh& m, int begin=0, int end=-1);
+
+	/// Get version of a cached mesh, or 0 if it is not cached
+	unsigned version(const Mesh& m) const;
+
+
+	/// Draw a mesh from the cache, uploading what changed since the last draw
+
+	/// Arguments are as for Graphics::draw.
+	/// \returns false, drawing nothing, if the mesh is not in the cache
+	bool draw(const Mesh& m, int count=-1, int begin=0);
+
+
+	/// Get layout of cached vertices
+	const VertexLayout& layout() const { return mLayout; }
+
+	/// Get number of uploads made to buffers
+	unsigned long uploads() const { return mUploads; }
+
+	/// Get number of bytes uploaded to buffers
+	unsigned long long bytesUploaded() const { return mBytesUploaded; }
+
+	/// Reset upload counters
+	void resetStats(){ mUploads = 0; mBytesUploaded = 0; }
+
+	/// Whether a format can be drawn for an attribute
+	static bool supported(VertexLayout::Attribute a, VertexLayout::Format f);
+
+protected:
+	struct Entry{
+		VertexPacker packer;
+		Usage usage;
+		unsigned vbo, ebo;	// buffer names, 0 if not made
+		int vboSize, eboSize;	// allocated bytes
+		int numIndices;
+		unsigned version, uploaded;
+		int begin, end;		// vertex range to upload
+		bool all;			// upload everything
+
+		Entry(const VertexLayout& l = VertexLayout(), Usage u = BufferObject::STATIC_DRAW);
+	};
+
+	typedef std::map<const Mesh *, Entry> Entries;
+
+	VertexLayout mLayout;
+	Entries mEntries;
+	unsigned long mUploads;
+	unsigned long long mBytesUploaded;
+
+	void update(const Mesh& m, Entry& e);
+	void release(Entry& e);
+
+	virtual void onCreate();
+	virtual void onDestroy();
+};
+
+} // al::
+
+#endif
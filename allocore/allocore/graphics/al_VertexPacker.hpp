@@ -0,0 +1,265 @@
+#ifndef INCLUDE_AL_GRAPHICS_VERTEX_PACKER_HPP
+#define INCLUDE_AL_GRAPHICS_VERTEX_PACKER_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+
+	File description:
+	Packing of mesh attributes into a single interleaved vertex stream
+*/
+
+#include <vector>
+#include "allocore/graphics/al_Mesh.hpp"
+#include "allocore/system/pstdint.h"
+
+namespace al{
+
+/// Describes how the attributes of a vertex are interleaved in memory
+
+/// Each attribute is stored in one of several formats, from 32-bit floats
+/// down to 8-bit normalized integers. Attributes are placed in the order of
+/// the Attribute enum, each starting on a 4-byte boundary.
+///
+/// Normalized integers map [0, 1] (unsigned) or [-1, 1] (signed) onto the
+/// integer range, as OpenGL's normalized vertex attributes do. Normals and
+/// colors fit these ranges as they are. Positions are first mapped from a
+/// bounding box, which either is set explicitly or is the bounding box of the
+/// mesh; positionOffset() and positionScale() undo the mapping. The mapping
+/// scales all axes by the largest extent of the box, so that undoing it with
+/// a transform does not change the directions of normals.
+class VertexLayout {
+public:
+
+	enum Attribute{
+		POSITION=0,	///< From Mesh::vertices
+		NORMAL,		///< From Mesh::normals
+		COLOR,		///< From Mesh::colors or else Mesh::coloris
+		TEXCOORD,	///< From Mesh::texCoord3s or else Mesh::texCoord2s
+		NUM_ATTRIBUTES
+	};
+
+	enum Format{
+		NONE=0,		///< Attribute is not stored
+		FLOAT32,	///< 32-bit float
+		FLOAT16,	///< 16-bit (half precision) float
+		SNORM16,	///< 16-bit signed normalized integer
+		UNORM16,	///< 16-bit unsigned normalized integer
+		SNORM8,		///< 8-bit signed normalized integer
+		UNORM8		///< 8-bit unsigned normalized integer
+	};
+
+
+	/// Layout storing every attribute as 32-bit floats
+	VertexLayout();
+
+	/// Compact layout
+
+	/// Positions are 16-bit normalized within their bounds, normals and colors
+	/// are 8-bit normalized and texture coordinates are half floats.
+	static VertexLayout compact();
+
+
+	/// Set the format of an attribute; NONE leaves it out
+	VertexLayout& format(Attribute a, Format f);
+
+	/// Map normalized positions from a fixed bounding box
+	VertexLayout& bounds(const Vec3f& lo, const Vec3f& hi);
+
+	/// Map normalized positions from the bounding box of the mesh (default)
+	VertexLayout& autoBounds();
+
+
+	/// Get format of an attribute
+	Format format(Attribute a) const { return mFormats[a]; }
+
+	/// Get number of components of an attribute, 0 if it is not stored
+
+	/// This is known once the layout has been resolved against a mesh by a
+	/// VertexPacker.
+	int components(Attribute a) const { return mComponents[a]; }
+
+	/// Whether an attribute is stored
+	bool has(Attribute a) const { return mComponents[a] > 0; }
+
+	/// Whether an attribute is stored as normalized integers
+	bool normalized(Attribute a) const { return isNormalized(mFormats[a]); }
+
+	/// Get byte offset of an attribute from the start of a vertex
+	int offset(Attribute a) const { return mOffsets[a]; }
+
+	/// Get number of bytes between consecutive vertices
+	int stride() const { return mStride; }
+
+	/// Lower corner of position bounds
+	const Vec3f& boundsLo() const { return mLo; }
+
+	/// Upper corner of position bounds
+	const Vec3f& boundsHi() const { return mHi; }
+
+	/// Whether position bounds come from the mesh
+	bool autoBounding() const { return mAutoBounds; }
+
+	/// Get offset to add to scaled stored positions to get mesh positions
+	Vec3f positionOffset() const;
+
+	/// Get scale of stored positions to get mesh positions
+
+	/// A mesh position is positionOffset() + positionScale() * p, where p is
+	/// the stored position as read by the GPU (normalized or float). The
+	/// scale is the same for all components.
+	Vec3f positionScale() const;
+
+	/// Hash of the layout, including position bounds if they are used
+	uint64_t key() const;
+
+	bool operator==(const VertexLayout& v) const;
+	bool operator!=(const VertexLayout& v) const { return !(*this == v); }
+
+
+	/// Get size, in bytes, of one component in a format
+	static int formatSize(Format f);
+
+	/// Whether a format is a normalized integer format
+	static bool isNormalized(Format f){ return f >= SNORM16; }
+
+	/// Whether a format is signed normalized
+	static bool isSigned(Format f){ return f == SNORM16 || f == SNORM8; }
+
+private:
+	friend class VertexPacker;
+
+	Format mFormats[NUM_ATTRIBUTES];
+	int mComponents[NUM_ATTRIBUTES];
+	int mOffsets[NUM_ATTRIBUTES];
+	int mStride;
+	Vec3f mLo, mHi;
+	bool mAutoBounds;
+
+	// Set components and compute offsets and stride
+	void place(const int * components);
+};
+
+
+
+/// Packs the buffers of a Mesh into one interleaved vertex stream
+
+/// The packed vertices are a single contiguous block, ready to upload as one
+/// vertex buffer or to serialize. Multi-byte values are in host byte order
+/// and padding bytes are zero.
+///
+/// After a full pack, ranges of vertices that change can be repacked alone.
+/// The packer tracks the byte range changed since the last call to clean(),
+/// so an upload need only move that range.
+///
+/// An attribute is packed if its buffer has at least as many elements as
+/// there are vertices. A mesh with fewer colors than vertices is packed
+/// with its first color throughout, which is how Graphics::draw treats it.
+class VertexPacker {
+public:
+
+	/// @param[in] request	requested layout; attributes the mesh does not
+	///						have are left out
+	VertexPacker(const VertexLayout& request = VertexLayout());
+
+	/// Set requested layout; takes effect on the next pack
+	VertexPacker& request(const VertexLayout& v){ mRequest = v; return *this; }
+
+	/// Get requested layout
+	const VertexLayout& request() const { return mRequest; }
+
+	/// Get layout of the packed vertices
+	const VertexLayout& layout() const { return mLayout; }
+
+
+	/// Pack all vertices of a mesh
+	void pack(const Mesh& m);
+
+	/// Repack a range of vertices of a mesh
+
+	/// This falls back to a full pack if the number of vertices or the
+	/// attributes present have changed, or if a repacked position lies
+	/// outside automatic position bounds. Bounds are not shrunk to fit here;
+	/// a full pack does that.
+	/// @param[in] m		mesh, previously packed
+	/// @param[in] begin	index of first vertex to repack
+	/// @param[in] end		one past index of last vertex to repack;
+	///						negative values count back from one past the end
+	void repack(const Mesh& m, int begin, int end=-1);
+
+
+	/// Get packed vertices
+	const char * data() const { return mData.empty() ? 0 : &mData[0]; }
+
+	/// Get size of packed vertices, in bytes
+	int size() const { return mData.size(); }
+
+	/// Get number of packed vertices
+	int numVertices() const { return mNumVertices; }
+
+	/// Whether any bytes changed since the last call to clean()
+	bool dirty() const { return mDirtyEnd > mDirtyBegin; }
+
+	/// Get byte offset of first changed byte
+	int dirtyBegin() const { return mDirtyBegin; }
+
+	/// Get byte offset one past the last changed byte
+	int dirtyEnd() const { return mDirtyEnd; }
+
+	/// Mark all bytes as unchanged, e.g. after uploading them
+	void clean(){ mDirtyBegin = mDirtyEnd = 0; }
+
+	/// Hash of the layout and packed bytes
+
+	/// Equal keys mean identical packed vertices, so this can key caches of
+	/// uploaded or serialized vertex data. It is computed when first asked for
+	/// after a change, in time linear in size().
+	uint64_t key() const;
+
+private:
+	VertexLayout mRequest, mLayout;
+	std::vector<char> mData;
+	int mNumVertices;
+	int mDirtyBegin, mDirtyEnd;
+	mutable uint64_t mKey;
+	mutable bool mKeyValid;
+
+	// Resolve requested layout against a mesh
+	VertexLayout resolve(const Mesh& m) const;
+	void packRange(const Mesh& m, int begin, int end);
+	void touch(int begin, int end);
+};
+
+} // al::
+
+#endif
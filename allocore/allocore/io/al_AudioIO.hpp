@@ -43,13 +43,20 @@
 */
 
 
+#include <map>
 #include <string>
 #include <vector>
 
 #include "allocore/io/al_AudioIOData.hpp"
+#include "allocore/system/al_Atomic.hpp"
+#include "allocore/system/pstdint.h"
 
 namespace al{
 
+class Clock;
+class MsgQueue;
+class TaskPool;
+
 /// Audio callback type
 typedef void (* audioCallback)(AudioIOData& io);
 
@@ -82,6 +89,56 @@ protected:
 	const void * mImpl;
 };
 
+/// Channels of an audio stream that a callback reads and writes
+
+/// An AudioCallback that declares its access can run in parallel with other
+/// callbacks it does not conflict with (see AudioIO::parallel). Two accesses
+/// conflict if one writes a channel of a buffer the other reads or writes.
+/// Adding to an output is writing it.
+class AudioAccess{
+public:
+
+	enum Buffer{
+		INPUT=0,	/**< Input channels */
+		OUTPUT,		/**< Output channels */
+		BUS			/**< Bus channels */
+	};
+
+	/// Access to no channels
+	AudioAccess(){}
+
+	/// Access to all channels of all buffers
+	static AudioAccess all();
+
+	/// Add channels read
+
+	/// @param[in] b		buffer
+	/// @param[in] begin	first channel
+	/// @param[in] end		one past the last channel; -1 for all that remain
+	AudioAccess& read(Buffer b, int begin=0, int end=-1);
+
+	/// Add channels written
+
+	/// @param[in] b		buffer
+	/// @param[in] begin	first channel
+	/// @param[in] end		one past the last channel; -1 for all that remain
+	AudioAccess& write(Buffer b, int begin=0, int end=-1);
+
+	/// Whether this and another access conflict
+	bool conflicts(const AudioAccess& v) const;
+
+private:
+	struct Range{
+		Buffer buffer;
+		int begin, end;
+		bool write;
+	};
+	std::vector<Range> mRanges;
+
+	AudioAccess& add(Buffer b, int begin, int end, bool write);
+};
+
+
 /// Audio input/output streaming
 class AudioIO : public AudioIOData {
 public:
@@ -98,6 +155,10 @@ public:
 	/// @param[in] backend			Audio backend to use
 	/// If the number of input or output channels is greater than the device
 	/// supports, virtual buffers will be created.
+	///
+	/// The OFFLINE backend opens no device. Once started, it calls the
+	/// callback in a loop on its own thread as fast as it can, reading inputs
+	/// from inputFile()s and writing outputs to outputFile().
 	AudioIO(int framesPerBuf=64, double framesPerSec=44100.0,
 			void (* callback)(AudioIOData &) = 0, void * userData = 0,
 			int outChans = 2, int inChans = 0,
@@ -119,9 +180,43 @@ public:
 	AudioIO& insertBefore(AudioCallback& v);
 	AudioIO& insertAfter(AudioCallback& v);
 
+	/// Add an AudioCallback handler that declares the channels it accesses
+	AudioIO& append(AudioCallback& v, const AudioAccess& a){ append(v); return access(v,a); }
+
 	/// Remove all input event handlers matching argument
 	AudioIO& remove(AudioCallback& v);
 
+	/// Declare the channels an added handler reads and writes
+
+	/// Handlers without a declaration are taken to access all channels.
+	///
+	AudioIO& access(AudioCallback& v, const AudioAccess& a);
+
+	/// Run handlers in parallel on a pool of worker threads
+
+	/// The handlers form a graph in which each waits for the earlier handlers
+	/// it conflicts with, so the result is the same as running them in order.
+	/// Independent handlers run at the same time on the workers and on the
+	/// audio thread, which returns once all have finished. Each handler is
+	/// passed its own AudioIOData sharing the stream's buffers, so its frame
+	/// counter and temporary buffer are private. The main callback always
+	/// runs first, on its own.
+	///
+	/// Handlers can be added, removed or declared while the stream is
+	/// running. The audio thread switches to the new graph at the start of
+	/// the next block and hands the old one back to be deleted by the next
+	/// change or by the destructor. For real-time use, give the workers a
+	/// real-time priority with TaskPool::priority.
+	/// @param[in] pool		pool to run on; 0 runs handlers in order on the
+	///						audio thread (the default)
+	AudioIO& parallel(TaskPool * pool);
+
+	/// Get mean time a handler takes per block, in seconds
+	double cpuTime(const AudioCallback& v) const;
+
+	/// Get mean time a handler takes per block as a fraction of the block duration
+	double cpu(const AudioCallback& v) const { return cpuTime(v) / secondsPerBuffer(); }
+
 	bool autoZeroOut() const { return mAutoZeroOut; }
 	int channels(bool forOutput) const;
 	bool clipOut() const { return mClipOut; }	///< Returns clipOut setting
@@ -159,6 +254,60 @@ public:
 
 	void print();								///< Prints info about current i/o devices to stdout.
 
+
+	/// Set message queue to advance in sample time
+
+	/// Before each block is processed, the messages due by the start time of
+	/// the block are executed. The time is the number of frames processed
+	/// since the stream was started divided by the frame rate, so it does not
+	/// depend on how fast blocks are actually computed. Messages must be sent
+	/// from the audio thread or while the stream is stopped. Pass 0 to detach.
+	AudioIO& timebase(MsgQueue * v){ mMsgQueue=v; return *this; }
+
+	/// Set clock to advance in sample time
+
+	/// The clock is put in non-real-time mode and advanced by one block after
+	/// each block is processed, so within a callback its time is that of the
+	/// start of the block. Pass 0 to detach.
+	AudioIO& timebase(Clock * v);
+
+	/// Get number of frames processed since the stream was started
+
+	/// This may be polled from any thread while the stream is running.
+	///
+	uint64_t framesProcessed() const { return mFramesProcessed.load(); }
+
+
+	/// Add a sound file to read input channels from (OFFLINE backend)
+
+	/// Files are assigned consecutive input channels in the order they are
+	/// added. Channels not covered by a file, or past the end of its file,
+	/// are silent. WAV and AU files of 16, 24 or 32-bit integers or 32-bit
+	/// floats can be read; they should have the stream's frame rate as there
+	/// is no resampling.
+	AudioIO& inputFile(const std::string& path);
+
+	/// Set sound file to write output channels to (OFFLINE backend)
+
+	/// Samples are written as 32-bit floats by a background thread. The
+	/// format is WAV if the path ends in ".wav", otherwise AU.
+	AudioIO& outputFile(const std::string& path){ mOutputFile=path; return *this; }
+
+	/// Set length, in seconds, of an offline render
+
+	/// If the length is negative (the default), the render lasts as long as
+	/// the longest input file or, without input files, until stop() is called.
+	AudioIO& renderLength(double sec){ mRenderLength=sec; return *this; }
+
+	/// Block until an offline render has finished
+
+	/// This returns at once for other backends or if the stream is stopped.
+	void waitForRender();
+
+	const std::vector<std::string>& inputFiles() const { return mInputFiles; }
+	const std::string& outputFile() const { return mOutputFile; }
+	double renderLength() const { return mRenderLength; }
+
 	static const char * errorText(int errNum);		// Returns error string.
 
 private:
@@ -167,10 +316,25 @@ private:
 	bool mClipOut;			// whether to clip output between -1 and 1
 	bool mAutoZeroOut;		// whether to automatically zero output buffers each block
 	std::vector<AudioCallback *> mAudioCallbacks;
+	std::map<const AudioCallback *, AudioAccess> mAccess;
+	TaskPool * mPool;
+	class Graph;
+	Atomic<Graph *> mGraph;			// graph run by the audio thread
+	Atomic<Graph *> mNextGraph;		// rebuilt graph not yet taken by the audio thread
+	Atomic<Graph *> mRetiredGraphs;	// graphs handed back by the audio thread
+	Backend mBackend;
+	MsgQueue * mMsgQueue;
+	Clock * mClock;
+	Atomic<uint64_t> mFramesProcessed;	// written by audio thread only
+	std::vector<std::string> mInputFiles;
+	std::string mOutputFile;
+	double mRenderLength;
 
 	void init(int outChannels, int inChannels);			//
 	void reopen();			// reopen stream (restarts stream if needed)
 	void resizeBuffer(bool forOutput);
+	void rebuildGraph();
+	void freeRetiredGraphs();
 };
 
 } // al::
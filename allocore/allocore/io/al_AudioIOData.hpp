@@ -199,7 +199,8 @@ public:
 
 	typedef enum {
 		PORTAUDIO,
-		DUMMY
+		DUMMY,
+		OFFLINE		/**< Render to and from sound files as fast as possible */
 	} Backend;
 
 	/// Iterate frame counter, returning true while more frames
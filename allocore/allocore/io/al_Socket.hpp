@@ -104,6 +104,12 @@ public:
 	/// Get timeout duration, in seconds
 	al_sec timeout() const;
 
+	/// Get native file descriptor, or -1 if not opened
+
+	/// This can be used to register the socket as an event source with Main.
+	///
+	int fileDescriptor() const;
+
 
 	/// Open socket (reopening if currently open)
 	bool open(uint16_t port, const char * address, al_sec timeout, int type);
@@ -0,0 +1,156 @@
+#ifndef INCLUDE_AL_SOUNDFILE_HPP
+#define INCLUDE_AL_SOUNDFILE_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+
+	File description:
+	Reading and writing of uncompressed WAV and AU sound files
+
+	Only uncompressed files are handled, so there is no dependency on a sound
+	file library. These are used by the offline backend of AudioIO.
+*/
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "allocore/system/al_Atomic.hpp"
+#include "allocore/system/al_Thread.hpp"
+#include "allocore/system/pstdint.h"
+
+namespace al{
+
+class SingleRWRingBuffer;
+
+
+/// Reads interleaved samples from a WAV or AU file
+
+/// 16, 24 and 32-bit integer and 32-bit float samples are read and
+/// converted to floats.
+class SoundFileIn{
+public:
+
+	SoundFileIn();
+	~SoundFileIn();
+
+	/// Open a file; returns false if it cannot be read
+	bool open(const std::string& path);
+
+	/// Close the file
+	void close();
+
+	/// Get number of channels
+	int channels() const { return mChannels; }
+
+	/// Get frame rate, in Hz
+	double frameRate() const { return mFrameRate; }
+
+	/// Get number of frames left to read; 0 if unknown
+	uint64_t frames() const { return mUnknownLength ? 0 : mFramesLeft; }
+
+	/// Read up to n interleaved frames and return the number read
+	int read(float * dst, int n);
+
+private:
+	FILE * mFile;
+	int mChannels;
+	double mFrameRate;
+	uint64_t mFramesLeft;
+	bool mUnknownLength;
+	int mBytes;				// bytes per sample
+	bool mFloat;
+	bool mBigEndian;
+	std::vector<char> mBuf;
+
+	bool setFormat(int bits, bool isFloat);
+	bool openWAV();
+	bool openAU(const unsigned char * hdr);
+
+	SoundFileIn(const SoundFileIn&);
+	SoundFileIn& operator= (const SoundFileIn&);
+};
+
+
+/// Writes interleaved float samples to a WAV or AU file
+
+/// Samples pass through a ring buffer to a thread that converts them to the
+/// byte order of the file and writes them out, so the thread producing them
+/// does not wait on the disk unless the ring fills. Files whose name ends in
+/// ".wav" are written as WAV, others as AU.
+class SoundFileOut{
+public:
+
+	SoundFileOut();
+	~SoundFileOut();
+
+	/// Open a file and start the writer thread
+
+	/// @param[in] path				file path
+	/// @param[in] channels			number of channels
+	/// @param[in] frameRate		frame rate, in Hz
+	/// @param[in] framesPerBuffer	typical number of frames per write, used
+	///								to size the ring buffer
+	bool open(const std::string& path, int channels, double frameRate, int framesPerBuffer);
+
+	/// Whether a file is open
+	bool isOpen() const { return 0 != mFile; }
+
+	/// Write n interleaved frames, waiting while the ring is full
+	void write(const float * src, int n);
+
+	/// Write out remaining samples, finish header and close file
+	void close();
+
+private:
+	FILE * mFile;
+	bool mWAV;
+	int mChannels;
+	double mFrameRate;
+	uint64_t mBytes;			// sample bytes written
+	SingleRWRingBuffer * mRing;
+	Thread mThread;
+	Atomic<int> mDone;
+
+	static void * writerFunc(void * user);
+
+	// Write header for the samples written so far
+	void writeHeader();
+
+	SoundFileOut(const SoundFileOut&);
+	SoundFileOut& operator= (const SoundFileOut&);
+};
+
+} // al::
+
+#endif
@@ -144,6 +144,55 @@ template <class Tf, class Tv>
 Tv nearest(Tf frac, const Tv& x, const Tv& y);
 
 
+/// Read-only view of a ring buffer, for reading a delay-line a block at a time
+
+/// Elements are addressed by their delay, the number of elements they are
+/// older than the newest one, as in RingBuffer::read().
+template <class T>
+struct RingView{
+	const T * data;		///< Elements of the ring buffer
+	int size;			///< Number of elements
+	int pos;			///< Index of newest element
+
+	RingView(const T * data_, int size_, int pos_)
+	:	data(data_), size(size_), pos(pos_){}
+
+	/// Get element 'delay' elements older than the newest, delay in [0, size)
+	const T& read(int delay) const {
+		int i = pos - delay;
+		return data[i<0 ? i+size : i];
+	}
+};
+
+/// Read a block of fractional delays from a ring buffer using linear interpolation
+
+/// @param[out] dst		'len' interpolated values
+/// @param[in] ring		ring buffer to read from
+/// @param[in] delays	'len' fractional delays, each in [0, ring.size-2]
+/// @param[in] len		number of values to read
+///
+/// The result is the same as calling linear(frac, x[d], x[d+1]) for each delay,
+/// where d is the integer part of the delay. When no read of the block wraps
+/// around the end of the ring, which is the common case, the reads are done
+/// from a single pointer without any wrapping so that the loop vectorizes.
+template <class Tv, class Tf>
+void linear(Tv * dst, const RingView<Tv>& ring, const Tf * delays, int len);
+
+/// Read a block of fractional delays from a ring buffer using cubic interpolation
+
+/// Same as linear(dst, ring, delays, len), but interpolating with
+/// cubic(frac, x[d-1], x[d], x[d+1], x[d+2]). Delays must be in [1, ring.size-3].
+template <class Tv, class Tf>
+void cubic(Tv * dst, const RingView<Tv>& ring, const Tf * delays, int len);
+
+/// Read a block of fractional delays from a ring buffer using 3rd order Lagrange interpolation
+
+/// Same as linear(dst, ring, delays, len), but filtering x[d-1] ... x[d+2] with
+/// the coefficients of lagrange3(h, 1 + frac). Delays must be in [1, ring.size-3].
+template <class Tv, class Tf>
+void lagrange3(Tv * dst, const RingView<Tv>& ring, const Tf * delays, int len);
+
+
 /// Bilinear interpolation between values on corners of quadrilateral
 template <class Tf, class Tv>
 inline Tv bilinear(
@@ -429,6 +478,102 @@ inline Tv nearest(Tf f, const Tv& x, const Tv& y){
 	return (f < Tf(0.5)) ? x : y;
 }
 
+
+// Block reads from rings are done in segments of this many delays. Within a
+// segment, reads that do not wrap around the end of the ring are done with
+// plain array indexing, so that only segments straddling the end pay for
+// wrapping each index.
+enum{ RING_SEGMENT = 32 };
+
+// Returns index that the delays of a segment, extended by 'before' newer and
+// 'after' older elements, can be subtracted from without wrapping, or -1 if
+// the reads straddle the end of the ring.
+template <class Tv, class Tf>
+int ringSegmentBase(const RingView<Tv>& r, const Tf * delays, int len, int before, int after){
+	Tf dmin = delays[0], dmax = delays[0];
+	for(int i=1; i<len; ++i){
+		if(delays[i] < dmin) dmin = delays[i];
+		if(delays[i] > dmax) dmax = delays[i];
+	}
+	int newest = r.pos - int(dmin) + before;
+	int oldest = r.pos - int(dmax) - after;
+	if(oldest >= 0) return r.pos;
+	if(newest < 0) return r.pos + r.size;
+	return -1;
+}
+
+template <class Tv, class Tf>
+void linear(Tv * dst, const RingView<Tv>& r, const Tf * delays, int len){
+	for(int i0=0; i0<len; i0+=RING_SEGMENT){
+		const int n = len-i0 < RING_SEGMENT ? len-i0 : RING_SEGMENT;
+		const Tf * del = delays + i0;
+		Tv * out = dst + i0;
+		int base = ringSegmentBase(r, del, n, 0, 1);
+		if(base >= 0){
+			for(int i=0; i<n; ++i){
+				int d = int(del[i]);
+				const Tv * x = r.data + (base - d);
+				out[i] = linear(Tv(del[i] - Tf(d)), x[0], x[-1]);
+			}
+		}
+		else{
+			for(int i=0; i<n; ++i){
+				int d = int(del[i]);
+				out[i] = linear(Tv(del[i] - Tf(d)), r.read(d), r.read(d+1));
+			}
+		}
+	}
+}
+
+template <class Tv, class Tf>
+void cubic(Tv * dst, const RingView<Tv>& r, const Tf * delays, int len){
+	for(int i0=0; i0<len; i0+=RING_SEGMENT){
+		const int n = len-i0 < RING_SEGMENT ? len-i0 : RING_SEGMENT;
+		const Tf * del = delays + i0;
+		Tv * out = dst + i0;
+		int base = ringSegmentBase(r, del, n, 1, 2);
+		if(base >= 0){
+			for(int i=0; i<n; ++i){
+				int d = int(del[i]);
+				const Tv * x = r.data + (base - d);
+				out[i] = cubic(Tv(del[i] - Tf(d)), x[1], x[0], x[-1], x[-2]);
+			}
+		}
+		else{
+			for(int i=0; i<n; ++i){
+				int d = int(del[i]);
+				out[i] = cubic(Tv(del[i] - Tf(d)), r.read(d-1), r.read(d), r.read(d+1), r.read(d+2));
+			}
+		}
+	}
+}
+
+template <class Tv, class Tf>
+void lagrange3(Tv * dst, const RingView<Tv>& r, const Tf * delays, int len){
+	Tv h[4];
+	for(int i0=0; i0<len; i0+=RING_SEGMENT){
+		const int n = len-i0 < RING_SEGMENT ? len-i0 : RING_SEGMENT;
+		const Tf * del = delays + i0;
+		Tv * out = dst + i0;
+		int base = ringSegmentBase(r, del, n, 1, 2);
+		if(base >= 0){
+			for(int i=0; i<n; ++i){
+				int d = int(del[i]);
+				const Tv * x = r.data + (base - d);
+				lagrange3(h, Tv(1) + Tv(del[i] - Tf(d)));
+				out[i] = h[0]*x[1] + h[1]*x[0] + h[2]*x[-1] + h[3]*x[-2];
+			}
+		}
+		else{
+			for(int i=0; i<n; ++i){
+				int d = int(del[i]);
+				lagrange3(h, Tv(1) + Tv(del[i] - Tf(d)));
+				out[i] = h[0]*r.read(d-1) + h[1]*r.read(d) + h[2]*r.read(d+1) + h[3]*r.read(d+2);
+			}
+		}
+	}
+}
+
 } // al::ipl
 } // al::
 
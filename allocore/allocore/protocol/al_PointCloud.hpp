@@ -0,0 +1,258 @@
+#ifndef INCLUDE_AL_POINTCLOUD_HPP
+#define INCLUDE_AL_POINTCLOUD_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+
+	File description:
+	Streaming of point clouds over UDP in compact, self-contained datagrams
+
+	Positions are quantized to 16-bit fixed point within a bounding box and
+	colors to 8 bits per component. Every datagram carries the frame id, the
+	bounding box and the index of its first point, so datagrams can be
+	decoded in any order. A frame is only shown once all of its datagrams
+	have arrived; a frame that lost any datagram is dropped.
+*/
+
+#include <vector>
+#include "allocore/graphics/al_Mesh.hpp"
+#include "allocore/io/al_Socket.hpp"
+#include "allocore/math/al_Vec.hpp"
+#include "allocore/types/al_Array.hpp"
+#include "allocore/types/al_Color.hpp"
+
+namespace al{
+
+/// Packs point clouds into datagrams
+class PointCloudEncoder{
+public:
+
+	/// Size of datagram header, in bytes
+	static const int HEADER_SIZE = 52;
+
+	/// Maximum number of datagrams per frame
+	static const int MAX_PACKETS = 65535;
+
+	/// @param[in] maxPacketSize	maximum datagram size, in bytes; the default
+	///								fits an Ethernet MTU including IP/UDP headers
+	PointCloudEncoder(int maxPacketSize = 1400);
+
+
+	/// Set maximum datagram size, in bytes
+	PointCloudEncoder& maxPacketSize(int bytes);
+
+	/// Set fixed quantization bounds
+
+	/// Positions outside the bounds are clamped. Fixed bounds give a constant
+	/// resolution across frames, e.g. the extent of a capture volume.
+	PointCloudEncoder& bounds(const Vec3f& lo, const Vec3f& hi);
+
+	/// Compute quantization bounds from each frame's points (the default)
+	PointCloudEncoder& autoBounds();
+
+	/// Get number of points that fit in one datagram
+	int pointsPerPacket(bool withColors) const;
+
+
+	/// Encode a frame of points
+
+	/// Points that would need more than MAX_PACKETS datagrams are not sent.
+	/// @param[in] positions	point positions
+	/// @param[in] colors		point colors or 0 for none
+	/// @param[in] num			number of points
+	/// \returns number of datagrams
+	int encode(const Vec3f * positions, const Colori * colors, int num);
+
+	/// Encode a frame of points with float colors
+	int encode(const Vec3f * positions, const Color * colors, int num);
+
+	/// Encode vertices and, if there is one per vertex, colors of a mesh
+	int encode(const Mesh& m);
+
+
+	/// Get id of last encoded frame
+	uint32_t frameId() const { return mFrameId; }
+
+	/// Get number of datagrams of last encoded frame
+	int numPackets() const { return mSizes.size(); }
+
+	/// Get datagram of last encoded frame
+	const char * packet(int i) const { return &mData[0] + i*mMaxPacketSize; }
+
+	/// Get size of datagram of last encoded frame, in bytes
+	int packetSize(int i) const { return mSizes[i]; }
+
+private:
+	std::vector<char> mData;
+	std::vector<int> mSizes;
+	std::vector<Colori> mColors;
+	Vec3f mLo, mHi;
+	int mMaxPacketSize;
+	uint32_t mFrameId;
+	bool mAutoBounds;
+};
+
+
+/// Reassembles point clouds from datagrams
+
+/// Points of the frame being received are written in place as datagrams
+/// arrive. A frame is complete once all of its datagrams have been decoded;
+/// a frame that is still incomplete when a datagram of a newer frame
+/// arrives is dropped, and datagrams of older frames are ignored.
+class PointCloudDecoder{
+public:
+
+	/// @param[in] maxPoints	maximum number of points per frame; datagrams of
+	///							larger frames are rejected as invalid
+	PointCloudDecoder(int maxPoints = 1<<20);
+
+
+	/// Set maximum number of points per frame
+
+	/// This bounds the memory allocated for frames, whatever the datagrams
+	/// claim their size to be.
+	PointCloudDecoder& maxPoints(int n);
+
+	/// Get maximum number of points per frame
+	int maxPoints() const { return mMaxPoints; }
+
+
+	/// Decode a datagram
+
+	/// \returns whether this completed a new frame
+	///
+	bool decode(const char * packet, int size);
+
+
+	/// Get id of last completed frame
+	uint32_t frameId() const { return mFrameId; }
+
+	/// Get number of points of last completed frame
+	int size() const { return mPositions.size(); }
+
+	/// Whether the last completed frame has colors
+	bool hasColors() const { return mHasColors; }
+
+	/// Get positions of last completed frame
+	const std::vector<Vec3f>& positions() const { return mPositions; }
+
+	/// Get colors of last completed frame; empty if it had none
+	const std::vector<Colori>& colors() const { return mColors; }
+
+	/// Copy last completed frame into mesh vertices and colors
+
+	/// The vertex count is set to the number of points. Colors are only
+	/// written if the frame has them.
+	void copyTo(Mesh& m) const;
+
+	/// Copy positions of last completed frame into a 3-component float array
+	void copyTo(Array& positions) const;
+
+
+	int framesCompleted() const { return mFramesCompleted; }	///< Number of frames completed
+	int framesDropped() const { return mFramesDropped; }		///< Number of incomplete frames dropped
+	int packetsDecoded() const { return mPacketsDecoded; }		///< Number of datagrams decoded
+	int packetsInvalid() const { return mPacketsInvalid; }		///< Number of malformed or stale datagrams
+
+private:
+	// last completed frame
+	std::vector<Vec3f> mPositions;
+	std::vector<Colori> mColors;
+	uint32_t mFrameId;
+	bool mHasColors;
+
+	// frame being assembled
+	std::vector<Vec3f> mNextPositions;
+	std::vector<Colori> mNextColors;
+	std::vector<char> mReceived;
+	uint32_t mNextId;
+	int mNextRemaining;
+	bool mNextHasColors;
+	bool mAssembling;
+	bool mAnyFrame;
+	int mMaxPoints;
+
+	int mFramesCompleted, mFramesDropped;
+	int mPacketsDecoded, mPacketsInvalid;
+};
+
+
+/// Socket for sending point clouds
+class PointCloudSend : public SocketClient, public PointCloudEncoder{
+public:
+
+	/// @param[in] port		Remote port number (valid range is 0-65535)
+	/// @param[in] address	Remote IP address
+	PointCloudSend(uint16_t port, const char * address = "localhost")
+	:	SocketClient(port, address)
+	{}
+
+	/// Encode and send frame of points; returns number of datagrams sent
+	int send(const Vec3f * positions, const Colori * colors, int num);
+
+	/// Encode and send mesh vertices and colors; returns number of datagrams sent
+	int send(const Mesh& m);
+
+private:
+	int sendPackets();
+};
+
+
+/// Socket for receiving point clouds
+class PointCloudRecv : public SocketServer, public PointCloudDecoder{
+public:
+
+	/// @param[in] port		Local port number (valid range is 0-65535)
+	/// @param[in] address	Local IP address. If empty, will bind all network interfaces to socket.
+	/// @param[in] timeout	< 0: block forever; = 0: no blocking; > 0 block with timeout
+	PointCloudRecv(uint16_t port, const char * address = "", al_sec timeout = 0)
+	:	SocketServer(port, address, timeout), mBuffer(65536)
+	{}
+
+	/// Read pending datagrams
+
+	/// A non-blocking socket (zero timeout) reads all pending datagrams. A
+	/// blocking socket waits for and reads a single datagram, since it would
+	/// otherwise wait for the next one after the last has been read.
+	/// \returns whether a new frame was completed
+	///
+	bool recv();
+
+private:
+	std::vector<char> mBuffer;
+};
+
+} // al::
+
+#endif
@@ -49,6 +49,7 @@
 #include <vector>
 #include <list>
 #include "allocore/types/al_Buffer.hpp"
+#include "allocore/types/al_Conversion.hpp"
 #include "allocore/math/al_Interpolation.hpp"
 #include "allocore/math/al_Vec.hpp"
 #include "allocore/spatial/al_DistAtten.hpp"
@@ -82,8 +83,10 @@ namespace al{
 		 ambi_z =  gl_y;
 */
 
+class DelayPool;
 class Listener;
 class SoundSource;
+class TaskPool;
 
 
 /// Abstract class for all spatializers: Ambisonics, DBAP, VBAP, etc.
@@ -98,6 +101,19 @@ public:
 	//
 	virtual void numFrames(int v){};
 
+	/// Called when the number of source slots in the scene changes
+
+	/// Slots are numbered from 0 to v-1. Spatializers keeping state per
+	/// source should allocate it here, indexed by SoundSource::slot(), so
+	/// that rendering does not allocate.
+	virtual void numSources(int v){};
+
+	/// Called when a source slot is taken or released, to reset its state
+
+	/// This is also called from the audio thread for sources culled from a
+	/// block, so it must not allocate or block.
+	virtual void resetSource(int slot){};
+
 	/// Perform any necessary updates when the listener or speaker layout changes, ex. new speaker triplets for VBAP
 	virtual void compile(Listener& l){};
 
@@ -132,6 +148,9 @@ public:
 	/// Get number of speakers
 	int numSpeakers() const { return mSpeakers.size(); }
 
+	/// Get speakers
+	const Speakers& speakers() const { return mSpeakers; }
+
 protected:
 	Speakers mSpeakers;
 };
@@ -217,6 +236,12 @@ public:
 		double farBias=0, int delaySize=15000
 	);
 
+	SoundSource(const SoundSource& other);
+
+	~SoundSource();
+
+	SoundSource& operator=(const SoundSource& other);
+
 	/// Returns whether distance-based attenuation is enabled
     bool useAttenuation() const { return mUseAtten; }
 
@@ -229,7 +254,16 @@ public:
 	}
 
 	/// Get size of delay in samples
-	int delaySize() const { return mSound.size(); }
+	int delaySize() const { return mSize; }
+
+	/// Returns whether the delay-line is stored at half precision
+	bool halfPrecision() const { return 0 != mHalves; }
+
+	/// Get index of source in the scene it was added to, or -1 if in none
+
+	/// Slots of removed sources are reused by sources added later. A source
+	/// should be in at most one scene at a time.
+	int slot() const { return mSlot; }
 
 	/// Convert delay, in seconds, to an index
 	double delayToIndex(double delay, double sampleRate) const {
@@ -250,12 +284,42 @@ public:
 	/// the buffer. The index must be less than or equal to bufferSize()-2.
 	float readSample(double index) const {
 		int index0 = index;
-		float a = mSound.read(index0);
-		float b = mSound.read(index0+1);
+		float a = read(index0);
+		float b = read(index0+1);
 		float frac = index - index0;
         return ipl::linear(frac, a, b);
 	}
 
+	/// Read block of samples from delay-line using linear interpolation
+
+	/// This gives the same results as calling readSample() for each index,
+	/// but reads the whole block with a single pass over the delay-line.
+	void readSamples(float * dst, const double * indices, int n) const {
+		if(mSamples){
+			ipl::RingView<float> ring(mSamples, mSize, mPos);
+			ipl::linear(dst, ring, indices, n);
+		}
+		else{
+			for(int i=0; i<n; ++i) dst[i] = readSample(indices[i]);
+		}
+	}
+
+	/// Read block of consecutive samples from delay-line
+
+	/// This reads the samples delayed by whole samples, without
+	/// interpolation, so that dst[i] = read(index + n - i).
+	void readSamples(float * dst, int index, int n) const;
+
+	/// Get peak absolute value of samples written between two delays
+
+	/// The peak is tracked in segments of PEAK_SEGMENT samples as they are
+	/// written, so this is cheap but may include up to a segment of samples
+	/// on either side. Ranges reaching the oldest PEAK_SEGMENT samples in the
+	/// delay-line are not tracked and give FLT_MAX.
+	/// @param[in] from		smallest delay, in samples ago
+	/// @param[in] to		largest delay, in samples ago
+	float peak(int from, int to) const;
+
     /// Enable/disable distance-based gain attenuation
     void useAttenuation(bool enable){ mUseAtten = enable; }
 
@@ -263,16 +327,47 @@ public:
     void useDoppler(bool enable){ mUseDoppler = enable; }
 
 	/// Write sample to internal delay-line
-	void writeSample(float v){ mSound.write(v); }
+	void writeSample(float v){
+		if(++mPos == mSize) mPos = 0;
+		if(mSamples)	mSamples[mPos] = v;
+		else			mHalves[mPos] = floatToHalf(v);
+		float a = v < 0.f ? -v : v;
+		float& p = mPeaks[mPos / PEAK_SEGMENT];
+		if(mPos % PEAK_SEGMENT == 0 || a > p) p = a;
+	}
 
 
 	// calculate the buffersize needed for given samplerate, speed of sound & distance traveled (e.g. nearClip+clipRange).
 	// probably want to add io.samplesPerBuffer() to this for safety.
 	static int bufferSize(double samplerate, double speedOfSound, double distance);
 
+	enum{
+		PEAK_SEGMENT = 64	///< Number of samples each tracked peak covers
+	};
+
 protected:
-	RingBuffer<float> mSound;		// spherical wave around position
+	friend class AudioScene;
+
+	std::vector<float> mSound;		// spherical wave around position, unless pooled
+	float * mSamples;				// delay-line at full precision, or 0
+	uint16_t * mHalves;				// delay-line at half precision, or 0
+	DelayPool * mPool;				// pool holding delay-line, or 0
+	int mSize;						// number of samples in delay-line
+	int mPos;						// index of newest sample
+	std::vector<float> mPeaks;		// peak of each segment of delay-line
+	int mSlot;						// index in scene, or -1
 	bool mUseAtten, mUseDoppler;
+
+	// Get sample 'delay' samples older than the newest
+	float read(int delay) const {
+		int i = mPos - delay;
+		if(i < 0) i += mSize;
+		return mSamples ? mSamples[i] : halfToFloat(mHalves[i]);
+	}
+
+	// Move delay-line into storage of given size from a pool, keeping the
+	// newest samples. Without a pool, the source gets a delay-line of its own.
+	void storage(int size, DelayPool * pool=0, unsigned offset=0);
 };
 
 
@@ -314,11 +409,98 @@ public:
 	void addSource(SoundSource& src);
 
 	/// Remove a sound source from scene
+
+	/// Sources must be added and removed while the scene is not rendering.
+	///
 	void removeSource(SoundSource& src);
 
 	/// Perform rendering
+
+	/// With per buffer processing, the work that does not depend on the
+	/// spatializer is done once per source and block: the delay-line read,
+	/// including Doppler, and the distance attenuation are computed once for
+	/// each distinct listener position and shared by all listeners at that
+	/// position. Each listener then only runs its spatializer.
     void render(AudioIOData& io);
 
+	/// Render listeners in parallel on a pool of worker threads
+
+	/// Listeners are only rendered in parallel if they have different
+	/// spatializers writing to disjoint sets of device channels, e.g. one
+	/// for the speakers and one for headphones; otherwise they are rendered
+	/// one after another. Per sample processing is always serial.
+	/// @param[in] pool		pool to render on or 0 to render serially
+	AudioScene& parallel(TaskPool * pool);
+
+	/// Move the delay-lines of all sources into one contiguous block of memory
+
+	/// Each source's delay-line is resized to hold the Doppler delay of its
+	/// far clip plus a block, instead of the size it was constructed with,
+	/// keeping its newest samples; sources not using Doppler only keep a
+	/// block. Sources beyond their far clip are then culled. Keeping all
+	/// delay-lines together, and optionally at half precision (11
+	/// significant bits), makes scenes with many sources much smaller in
+	/// memory and cache.
+	///
+	/// Sources added later keep their own delay-lines until this is called
+	/// again. The memory is freed once the scene and all sources using it
+	/// are destroyed or have moved to newer memory. This must not be called
+	/// while rendering.
+	/// @param[in] sampleRate		sample rate the scene is rendered at
+	/// @param[in] halfPrecision	whether to store samples as 16-bit floats
+	void compactDelays(double sampleRate, bool halfPrecision=false);
+
+
+	/// Set level at or below which sources are culled
+
+	/// Before a source is read for a block, the peak of the part of its
+	/// delay-line the block comes from is scaled by its distance attenuation.
+	/// Sources at or below this level are not rendered. The default of 0
+	/// culls only sources that are silent or fully attenuated. Sources whose
+	/// Doppler delay does not fit in their delay-line are also culled.
+	/// Culling and level of detail only apply to per buffer processing.
+	AudioScene& cullLevel(float v){ mCullLevel=v; return *this; }
+
+	/// Set distance beyond which sources are rendered at a lower level of detail
+
+	/// Demoted sources are read at their propagation delay rounded down to
+	/// a whole sample, without interpolation, and are panned from their
+	/// direction snapped to a grid of lodAngle() degrees, so that
+	/// spatializers caching gains, like Dbap, only update them when a source
+	/// crosses into a new direction. Their Doppler shift is thus coarser,
+	/// so this is best kept to where sources are faint. The default is to
+	/// never demote.
+	AudioScene& lodDistance(double v){ mLodDistance=v; return *this; }
+
+	/// Set attenuated level below which sources are rendered at a lower level of detail
+
+	/// The level is measured as for cullLevel(). The default of 0 never
+	/// demotes.
+	AudioScene& lodLevel(float v){ mLodLevel=v; return *this; }
+
+	/// Set margin by which demoted sources must pass the thresholds to be promoted
+
+	/// A demoted source is only promoted again once it is nearer than
+	/// lodDistance() * (1 - v) and its level is above lodLevel() * (1 + v),
+	/// so that sources near a threshold do not switch detail every block.
+	/// The default is 0.1.
+	AudioScene& lodHysteresis(double v){ mLodHysteresis=v; return *this; }
+
+	/// Set angular resolution, in degrees, of demoted sources' directions
+	AudioScene& lodAngle(double degrees);
+
+	/// Get number of sources culled in the last block
+
+	/// Sources are counted once for each distinct listener position.
+	///
+	int numCulled() const { return mNumCulled; }
+
+	/// Get number of sources rendered at a lower level of detail in the last block
+
+	/// Sources are counted once for each distinct listener position.
+	///
+	int numDemoted() const { return mNumDemoted; }
+
 
     /// Set per sample processing (off by default)
 
@@ -332,9 +514,32 @@ protected:
 	Listeners mListeners;
 	Sources mSources;
 	int mNumFrames;				// audio frames per block
-	std::vector<float> mBuffer;	// temporary frame buffer
+	std::vector<double> mIndices;	// temporary delay-line read indices
+	std::vector<float> mBlocks;	// attenuated source blocks, per source and listener position
+	std::vector<int> mPositions;	// listener position index of each listener
+	std::vector<char> mChannelUsed;	// device channels written by a listener
+	std::vector<char> mDetail;	// level of detail, per source and listener position
+	std::vector<char> mDemoted;	// whether demoted, per source slot and listener
+	std::vector<int> mFreeSlots;	// slots of removed sources
+	int mNumSlots;				// number of source slots ever taken
+	int mNumPositions;			// number of distinct listener positions
 	double mSpeedOfSound;		// distance per second
+	TaskPool * mPool;
+	DelayPool * mDelayPool;		// memory of compacted source delay-lines
+	float mCullLevel, mLodLevel;
+	double mLodDistance;
+	double mLodHysteresis;
+	double mLodSteps;			// grid steps per unit of demoted directions
+	int mNumCulled, mNumDemoted;
     bool mPerSampleProcessing;
+
+	enum{ DETAIL_FULL, DETAIL_LOW, DETAIL_CULLED };
+
+	struct ListenerRender;
+	void resizeBlocks();
+	bool listenersIndependent();
+	void renderListener(AudioIOData& io, int index);
+	void renderPerSample(AudioIOData& io);
 };
 
 } // al::
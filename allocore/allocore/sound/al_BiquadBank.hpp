@@ -0,0 +1,151 @@
+#ifndef INCLUDE_AL_BIQUADBANK_HPP
+#define INCLUDE_AL_BIQUADBANK_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+
+	File description:
+	Cascades of biquad filters applied to many channels at once
+*/
+
+#include <vector>
+
+namespace al{
+
+/// Cascades of biquad filters applied to many channels at once
+
+/// Channels are filtered in groups of LANES. The samples, coefficients and
+/// histories of a group are stored side by side so that the innermost loops
+/// run across channels; with optimization on they compile to SIMD
+/// instructions without depending on any particular instruction set.
+/// Each channel runs its own cascade of sections() biquads in transposed
+/// direct form II, in single precision.
+///
+/// Coefficient changes glide linearly to their new values over smooth()
+/// frames to avoid zipper noise.
+class BiquadBank{
+public:
+
+	enum{
+		LANES = 8,		///< Number of channels filtered together
+		BLOCK = 64		///< Frames filtered per pass over a group
+	};
+
+	/// Biquad coefficients, normalized so that a0 = 1
+	struct Coefs{
+		float b0, b1, b2;	///< Feedforward coefficients
+		float a1, a2;		///< Feedback coefficients
+
+		/// Default is a pass-through
+		Coefs(float b0_=1, float b1_=0, float b2_=0, float a1_=0, float a2_=0)
+		:	b0(b0_), b1(b1_), b2(b2_), a1(a1_), a2(a2_){}
+
+		/// 2nd-order Butterworth low-pass
+		static Coefs lowPass(double freq, double fs);
+
+		/// 2nd-order Butterworth high-pass
+		static Coefs highPass(double freq, double fs);
+	};
+
+
+	/// @param[in] channels		number of channels
+	/// @param[in] sections		number of biquads in each channel's cascade
+	BiquadBank(int channels=0, int sections=1);
+
+	/// Get number of channels
+	int channels() const { return mChannels; }
+
+	/// Get number of biquads per channel
+	int sections() const { return mSections; }
+
+	/// Get number of frames coefficient changes are spread over
+	int smooth() const { return mSmooth; }
+
+	/// Get coefficients of a section that a channel is gliding towards
+	Coefs coefs(int section, int chan) const;
+
+
+	/// Set number of channels and sections
+
+	/// All histories are cleared and all coefficients reset to pass-through.
+	///
+	BiquadBank& resize(int channels, int sections);
+
+	/// Set coefficients of one section of one channel
+	BiquadBank& coefs(const Coefs& c, int section, int chan);
+
+	/// Set coefficients of one section of all channels
+	BiquadBank& coefs(const Coefs& c, int section);
+
+	/// Set number of frames coefficient changes are spread over
+
+	/// With 0, changes take effect at the start of the next block.
+	///
+	BiquadBank& smooth(int frames);
+
+	/// Zero filter histories and finish any coefficient glides
+	void clear();
+
+	/// Filter a block of non-interleaved channels
+
+	/// Channel c is read from in[c] and written to out[c], which may be the
+	/// same buffer. A null input is taken as silence and a null output is
+	/// not computed. Groups of LANES channels without any outputs are skipped
+	/// entirely and keep their histories. Groups are filtered in order over
+	/// the whole block, so a group may write over buffers that only earlier
+	/// groups read from.
+	void process(float * const * out, const float * const * in, int frames);
+
+private:
+	// Per group and section: current, target and per-frame increment of
+	// coefficients, then histories, each as LANES consecutive values
+	enum{ COEFS=0, TARGET=5*LANES, DELTA=10*LANES, STATE=15*LANES, STRIDE=17*LANES };
+
+	std::vector<float> mData;
+	float mBuf[BLOCK*LANES];
+	int mChannels, mSections, mGroups;
+	int mSmooth;
+	int mRamp;		// frames left in current glide
+	bool mDirty;	// coefficients set since last block
+
+	float * section(int group, int sec){ return &mData[(group*mSections + sec)*STRIDE]; }
+	const float * section(int group, int sec) const { return &mData[(group*mSections + sec)*STRIDE]; }
+	void setTarget(const Coefs& c, int section, int chan);
+	void startGlide();
+	void endGlide();
+};
+
+} // al::
+
+#endif
@@ -38,6 +38,7 @@
 	File description:
 	CrossOver: a cross-over shelf filter that sums to an allpass
 	(Useful for mixing different Ambisonic encoding flavors)
+	CrossoverBank: Linkwitz-Riley cross-overs on many channels at once
 
 	File author(s):
 	Graham Wakefield, 2010, grrrwaaa@gmail.com
@@ -46,8 +47,11 @@
 /*
 
 */
+#include <math.h>
 #include <stdio.h>
 #include <float.h>
+#include <vector>
+#include "allocore/sound/al_BiquadBank.hpp"
 
 namespace al {
 
@@ -73,11 +77,11 @@ protected:
 
 
 template<>
-void Crossover<double> :: freq(double f, double fs) {
+inline void Crossover<double> :: freq(double f, double fs) {
 	double rad = M_PI * 2. * f / fs;
 	double cosine = cos(rad);
 	double sine = sin(rad);
-	if (abs(c) > 0.0001) {
+	if (fabs(cosine) > 0.0001) {
 		mC0 = (sine - 1.)/cosine;
 	} else {
 		mC0 = cosine * 0.5;
@@ -107,7 +111,7 @@ inline void Crossover<double> :: next(const double in, double * lo, double * hi)
 }
 
 template<>
-void Crossover<float> :: freq(float f, float fs) {
+inline void Crossover<float> :: freq(float f, float fs) {
 	float rad = M_PI * 2.f * f / fs;
 	float cosine = cosf(rad);
 	float sine = sinf(rad);
@@ -116,7 +120,7 @@ void Crossover<float> :: freq(float f, float fs) {
 	} else {
 		mC0 = cosine * 0.5f;
 	}
-	mC1 = (1f + mC0) * 0.5f;
+	mC1 = (1.f + mC0) * 0.5f;
 }
 
 template<>
@@ -140,5 +144,88 @@ inline void Crossover<float> :: next(const float in, float * lo, float * hi) {
 	*hi = x0 - x2;
 }
 
+
+
+/// Linkwitz-Riley cross-overs on many channels at once
+
+/// Each channel is split into a low band, through two 2nd-order Butterworth
+/// low-pass filters, and a high band, through two high-pass ones. The bands
+/// fall off at 24 dB per octave and sum to an allpass. Both bands of all
+/// channels are filtered by a single BiquadBank, the low bands of all
+/// channels before the high bands.
+class CrossoverBank {
+public:
+
+	/// @param[in] channels	number of channels
+	/// @param[in] f		cross-over frequency
+	/// @param[in] fs		sampling frequency
+	CrossoverBank(int channels=0, float f=150, float fs=44100)
+	:	mF(f), mFS(fs)
+	{	resize(channels); }
+
+	/// Get number of channels
+	int channels() const { return mChannels; }
+
+	/// Set number of channels; clears filter histories
+	void resize(int channels){
+		mChannels = channels > 0 ? channels : 0;
+		mHiOffset = (mChannels + BiquadBank::LANES-1) / BiquadBank::LANES * BiquadBank::LANES;
+		mBank.resize(mHiOffset + mChannels, 2);
+		mIn.assign(mBank.channels(), (const float *)0);
+		mOut.assign(mBank.channels(), (float *)0);
+		freq(mF, mFS);
+	}
+
+	/// Set the cross-over frequency
+
+	/// If smooth() is non-zero, filters glide to the new frequency.
+	///
+	CrossoverBank& freq(float f, float fs){
+		mF = f; mFS = fs;
+		BiquadBank::Coefs lo = BiquadBank::Coefs::lowPass(f, fs);
+		BiquadBank::Coefs hi = BiquadBank::Coefs::highPass(f, fs);
+		for(int s=0; s<2; ++s){
+			for(int c=0; c<mChannels; ++c){
+				mBank.coefs(lo, s, c);
+				mBank.coefs(hi, s, mHiOffset + c);
+			}
+		}
+		return *this;
+	}
+
+	/// Get the cross-over frequency
+	float freq() const { return mF; }
+
+	/// Set number of frames frequency changes are spread over
+	CrossoverBank& smooth(int frames){ mBank.smooth(frames); return *this; }
+
+	/// Zero filter histories
+	void clear(){ mBank.clear(); }
+
+	/// Split a block of non-interleaved channels into bands
+
+	/// @param[out] lo		low band buffers; may be null, as may any channel
+	/// @param[out] hi		high band buffers; may be null, as may any channel.
+	///						They may be the same as the input buffers.
+	/// @param[in]  in		input buffers; a null channel is silence
+	/// @param[in]  frames	number of frames to filter
+	void process(float * const * lo, float * const * hi, const float * const * in, int frames){
+		if(!mChannels) return;
+		for(int c=0; c<mChannels; ++c){
+			mIn[c] = mIn[mHiOffset + c] = in[c];
+			mOut[c] = lo ? lo[c] : 0;
+			mOut[mHiOffset + c] = hi ? hi[c] : 0;
+		}
+		mBank.process(&mOut[0], &mIn[0], frames);
+	}
+
+protected:
+	BiquadBank mBank;
+	std::vector<const float *> mIn;
+	std::vector<float *> mOut;
+	float mF, mFS;
+	int mChannels, mHiOffset;	// high bands start at a group boundary
+};
+
 } // al::
 #endif
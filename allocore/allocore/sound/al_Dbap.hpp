@@ -50,6 +50,15 @@ namespace al{
 #define DBAP_MAX_DIST 100
 
 /// Distance-based amplitude panner
+
+/// In per buffer processing, the gains of all speakers are computed once per
+/// block and kept for each source until the position of the source relative
+/// to the listener changes. When they do change, gains ramp linearly from
+/// the previous block's values over the block to avoid zipper noise.
+/// Speakers whose gain stays below a threshold are skipped. Gains are kept
+/// in the slot of each source in the scene (see SoundSource::slot()), so a
+/// Dbap should only be used by one scene; sources not in a scene are panned
+/// without ramps. Sources culled by the scene start again without a ramp.
 class Dbap : public Spatializer{
 public:
 
@@ -57,6 +66,12 @@ public:
 	/// @param[in] spread	Amplitude spread to nearby speakers
 	Dbap(const SpeakerLayout &sl, float spread = 5.f);
 
+	void numFrames(int v);
+
+	void numSources(int v);
+
+	void resetSource(int slot);
+
 	void compile(Listener& listener);
 
 	///Per Sample Processing
@@ -69,31 +84,74 @@ public:
 
 	/// Values below 1.0 will widen the sound field to more speakers.
 	/// Values greater than 1 will focus the sound field to fewer speakers.
-	void setSpread(float spread) { mSpread = spread; }
+	void setSpread(float spread) { mSpread = spread; ++mGeneration; }
+
+	/// Set gain below which a speaker is not rendered to in per buffer processing
+
+	/// The gain of the most distant speaker is 1/(1+DBAP_MAX_DIST), so
+	/// thresholds above this drop the quietest speakers. The default of 0
+	/// renders to all speakers.
+	void setGainThreshold(float v){ mGainThreshold = v; ++mGeneration; }
+
+	/// Get gain threshold
+	float gainThreshold() const { return mGainThreshold; }
+
+	/// Compute the gain of each speaker for a source position
+
+	/// @param[out] gains	gain of each speaker; must hold numSpeakers() values
+	/// @param[in] relpos	source position relative to the listener
+	void gains(float * gains, const Vec3d& relpos) const;
+
+	/// Forget the cached gains of a source, so that its next block starts without a ramp
+
+	/// The cache is used from the audio thread, so this must not be called
+	/// while rendering. Sources are forgotten when added to or removed from
+	/// a scene.
+	void forget(const SoundSource& src){ resetSource(src.slot()); }
+
+	/// Forget the cached gains of all sources
+	void clearCache();
 
 	void print();
 
 private:
+	// Gains of a source from its latest block
+	struct SourceGains{
+		std::vector<float> prev;	// gains at start of block
+		std::vector<float> curr;	// gains at end of block
+		std::vector<int> active;	// speakers at or above threshold
+		Vec3d relpos;				// position gains were computed for
+		unsigned generation;		// of panner settings gains were computed for
+		bool ramp;					// whether prev and curr differ
+		bool valid;					// whether gains were computed since reset
+	};
+
 	Listener * mListener;
-	Vec3f mSpeakerVecs[DBAP_MAX_NUM_SPEAKERS];
+	float mSpeakerX[DBAP_MAX_NUM_SPEAKERS];	// unit speaker vectors, by component
+	float mSpeakerY[DBAP_MAX_NUM_SPEAKERS];
+	float mSpeakerZ[DBAP_MAX_NUM_SPEAKERS];
 	int mDeviceChannels[DBAP_MAX_NUM_SPEAKERS];
 	int mNumSpeakers;
-    float mSpread;
+	float mSpread;
+	float mGainThreshold;
+	unsigned mGeneration;
+	std::vector<SourceGains> mCache;	// gains of each source slot
+	SourceGains mUncached;			// gains of sources not in a scene
+	std::vector<float> mRamped;	// samples scaled by gain ramp
+
+	void resize(SourceGains& c);
+	SourceGains& update(const SoundSource& src, const Vec3d& relpos);
 };
 
 
 
 inline void Dbap::perform(AudioIOData& io, SoundSource& src, Vec3d& relpos, const int& numFrames, int& frameIndex, float& sample)
 {
+	float g[DBAP_MAX_NUM_SPEAKERS];
+	gains(g, relpos);
 	for (int i = 0; i < mNumSpeakers; ++i)
 	{
-		Vec3d vec = relpos.normalized();
-		vec -= mSpeakerVecs[i];
-		float dist = vec.mag() / 2.f; // [0, 1]
-		dist = powf(dist, mSpread);
-		float gain = 1.f / (1.f + DBAP_MAX_DIST*dist);
-
-		io.out(mDeviceChannels[i], frameIndex) += gain*sample;
+		io.out(mDeviceChannels[i], frameIndex) += g[i]*sample;
 	}
 }
 
@@ -0,0 +1,179 @@
+#ifndef INCLUDE_AL_ATOMIC_HPP
+#define INCLUDE_AL_ATOMIC_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+
+	File description:
+	Atomic integers and pointers for lock-free communication between threads
+*/
+
+#include "allocore/system/al_Config.h"
+
+#ifdef AL_WINDOWS
+	#include <windows.h>
+	#include <intrin.h>
+#endif
+
+namespace al{
+
+/// Atomic variable of integral or pointer type
+
+/// Loads have acquire and stores have release semantics, so a store to an
+/// Atomic publishes all writes made before it to any thread that loads the
+/// stored value. Read-modify-write operations are sequentially consistent.
+/// T must be 32 or 64 bits in size.
+template <class T>
+class Atomic{
+public:
+
+	Atomic(T v=T(0)): mVal(v){}
+
+	/// Get value
+	T load() const;
+
+	/// Get value without ordering constraints
+	T loadRelaxed() const { return mVal; }
+
+	/// Set value
+	void store(T v);
+
+	/// Set value and return previous value
+	T exchange(T v);
+
+	/// Set value if current value is 'expected'
+
+	/// @param[in,out] expected	value to compare against; set to current
+	///							value on failure
+	/// @param[in] desired		new value
+	/// \returns whether the value was set
+	bool compareExchange(T& expected, T desired);
+
+	/// Add to value and return previous value (integral types only)
+	T fetchAdd(T v);
+
+	/// Subtract from value and return previous value
+	T fetchSub(T v){ return fetchAdd(T(0) - v); }
+
+	operator T() const { return load(); }
+	Atomic& operator= (T v){ store(v); return *this; }
+	T operator++(){ return fetchAdd(T(1)) + T(1); }
+	T operator--(){ return fetchSub(T(1)) - T(1); }
+
+private:
+	volatile T mVal;
+
+	Atomic(const Atomic&);
+	Atomic& operator= (const Atomic&);
+};
+
+
+/// Issue a full memory fence
+inline void atomicFence();
+
+/// Hint to the processor that the caller is busy-waiting
+inline void cpuRelax();
+
+
+
+// -----------------------------------------------------------------------------
+// Inline implementation
+
+#if defined(__GNUC__) || defined(__clang__)
+
+template <class T>
+inline T Atomic<T>::load() const { return __atomic_load_n(&mVal, __ATOMIC_ACQUIRE); }
+
+template <class T>
+inline void Atomic<T>::store(T v){ __atomic_store_n(&mVal, v, __ATOMIC_RELEASE); }
+
+template <class T>
+inline T Atomic<T>::exchange(T v){ return __atomic_exchange_n(&mVal, v, __ATOMIC_SEQ_CST); }
+
+template <class T>
+inline bool Atomic<T>::compareExchange(T& expected, T desired){
+	return __atomic_compare_exchange_n(&mVal, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+template <class T>
+inline T Atomic<T>::fetchAdd(T v){ return __atomic_fetch_add(&mVal, v, __ATOMIC_SEQ_CST); }
+
+inline void atomicFence(){ __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+
+inline void cpuRelax(){
+	#if defined(__i386__) || defined(__x86_64__)
+		__builtin_ia32_pause();
+	#endif
+}
+
+#elif defined(AL_WINDOWS)
+
+// On x86, volatile accesses compiled by MSVC have acquire/release semantics
+template <class T>
+inline T Atomic<T>::load() const { return mVal; }
+
+template <class T>
+inline void Atomic<T>::store(T v){ mVal = v; MemoryBarrier(); }
+
+template <class T>
+inline T Atomic<T>::exchange(T v){
+	if(sizeof(T) == 8) return (T)InterlockedExchange64((volatile LONGLONG *)&mVal, (LONGLONG)v);
+	return (T)InterlockedExchange((volatile LONG *)&mVal, (LONG)v);
+}
+
+template <class T>
+inline bool Atomic<T>::compareExchange(T& expected, T desired){
+	T prev;
+	if(sizeof(T) == 8) prev = (T)InterlockedCompareExchange64((volatile LONGLONG *)&mVal, (LONGLONG)desired, (LONGLONG)expected);
+	else prev = (T)InterlockedCompareExchange((volatile LONG *)&mVal, (LONG)desired, (LONG)expected);
+	if(prev == expected) return true;
+	expected = prev;
+	return false;
+}
+
+template <class T>
+inline T Atomic<T>::fetchAdd(T v){
+	if(sizeof(T) == 8) return (T)InterlockedExchangeAdd64((volatile LONGLONG *)&mVal, (LONGLONG)v);
+	return (T)InterlockedExchangeAdd((volatile LONG *)&mVal, (LONG)v);
+}
+
+inline void atomicFence(){ MemoryBarrier(); }
+
+inline void cpuRelax(){ YieldProcessor(); }
+
+#endif
+
+} // al::
+
+#endif
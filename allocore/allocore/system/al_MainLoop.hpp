@@ -42,7 +42,7 @@
 	Graham Wakefield, 2010, grrrwaaa@gmail.com
 */
 
-#include "allocore/system/al_Time.h"
+#include "allocore/system/al_Time.hpp"
 #include "allocore/types/al_MsgQueue.hpp"
 #include <vector>
 
@@ -60,10 +60,22 @@ public:
 		virtual void onExit() {}
 	};
 
+	// interface for handlers of file descriptor events
+	// (e.g. sockets, see Socket::fileDescriptor()):
+	class FDHandler {
+	public:
+		virtual ~FDHandler();
+		/// called when the descriptor can be read without blocking
+		/// (or has been closed by the other end)
+		virtual void onReadable(int fd) = 0;
+		/// called when the descriptor can be written without blocking
+		virtual void onWritable(int fd) {}
+	};
+
 	enum Driver {
 		SLEEP = 0,
 		GLUT,
-		NATIVE,
+		NATIVE,		///< epoll-based on Linux; wakes immediately on FD events
 		NUM_DRIVERS
 	};
 
@@ -108,6 +120,15 @@ public:
 	/// percentage of interval time used in processing
 	double cpu() const { return mCPU; }
 
+	/// scheduler used by the SLEEP driver
+
+	/// Ticks are scheduled on absolute deadlines, so handler run time does
+	/// not cause drift. Use this to set busy-waiting and the overrun policy
+	/// (SKIP by default) or to read jitter and overrun statistics. The
+	/// NATIVE driver also follows the overrun policy.
+	DeadlineTimer& timer() { return mTimer; }
+	const DeadlineTimer& timer() const { return mTimer; }
+
 	/// use this to schedule timed functions in this mainloop
 	/// (the mainloop itself will take care of updating this queue)
 	MsgQueue& queue() { return mQueue; }
@@ -116,6 +137,19 @@ public:
 	Main& add(Main::Handler& v);
 	Main& remove(Main::Handler& v);
 
+	/// register a file descriptor event source
+
+	/// With the NATIVE driver on Linux, the handler is called as soon as the
+	/// descriptor becomes ready; with other drivers, descriptors are polled
+	/// once per tick. Descriptors are level-triggered, so handlers should
+	/// consume the available data and remove descriptors once they close.
+	/// @param[in] fd		file descriptor
+	/// @param[in] v		handler to call when the descriptor is ready
+	/// @param[in] write	whether to also report when writing won't block
+	Main& add(int fd, Main::FDHandler& v, bool write=false);
+	Main& remove(int fd);
+	Main& remove(Main::FDHandler& v);
+
 	// INTERNAL USE:
 
 	/// trigger a mainloop step (typically for implementation use only)
@@ -124,6 +158,9 @@ public:
 	/// calls any registerd Handlers' onExit() methods
 	void exit();
 
+	/// call the handler registered for a file descriptor
+	void dispatch(int fd, bool readable, bool writable);
+
 	// used to switch the driver
 	// typically not called by user code
 	// but e.g. creating a GLUT window will switch to GLUT mode
@@ -143,11 +180,24 @@ private:
 	/// timing driver; initially SLEEP
 	Driver mDriver;
 
+	/// deadline scheduler for SLEEP driver
+	DeadlineTimer mTimer;
+
 	/// functor scheduler attached to the main loop
 	MsgQueue mQueue;
 
 	std::vector<Handler *> mHandlers;
 
+	struct Source {
+		int fd;
+		FDHandler * handler;
+		bool write;
+	};
+	std::vector<Source> mSources;
+
+	Source * findSource(int fd);
+	void pollSources();
+
 	bool mActive;
 	bool mInited[NUM_DRIVERS];
 };
@@ -49,9 +49,10 @@ namespace al{
 
 /// Thread that calls a function periodically
 
-/// The sleep time is dynamically adjusted based on the time taken by the
-/// user-supplied thread function. This prevents drift that would occur in a
-/// more simplistic implementation using a fixed sleep interval.
+/// Calls are scheduled on absolute deadlines of a monotonic clock (see
+/// DeadlineTimer), so the time taken by the user-supplied thread function
+/// does not accumulate as drift, as it would in a more simplistic
+/// implementation using a fixed sleep interval.
 class PeriodicThread : public Thread{
 public:
 
@@ -74,12 +75,24 @@ public:
 	///						make up each iteration if behind on timing.
 	PeriodicThread& autocorrect(float factor);
 
+	/// Set overrun policy used when an iteration misses its deadline
+	PeriodicThread& overrun(DeadlineTimer::Overrun v);
+
+	/// Set time before each deadline to busy-wait instead of sleep, in seconds
+
+	/// Use this to get sub-millisecond timing accuracy at the cost of CPU use.
+	///
+	PeriodicThread& spin(double sec);
+
 	/// Set period, in seconds
 	PeriodicThread& period(double sec);
 
 	/// Get period, in seconds
 	double period() const;
 
+	/// Get scheduler; use this to read jitter and overrun statistics
+	const DeadlineTimer& timer() const { return mTimer; }
+
 	/// Start calling the supplied function periodically
 	void start(ThreadFunction& func);
 
@@ -95,11 +108,7 @@ private:
 	static void * sPeriodicFunc(void * userData);
 	void go();
 
-	al_nsec mPeriod;
-	al_nsec mTimeCurr, mTimePrev;	// time measurements between frames
-	al_nsec mWait;					// actual time to sleep between frames
-	al_nsec mTimeBehind;
-	float mAutocorrect;
+	DeadlineTimer mTimer;
 	ThreadFunction * mUserFunc;
 	bool mRun;
 };
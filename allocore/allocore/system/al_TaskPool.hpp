@@ -0,0 +1,252 @@
+#ifndef INCLUDE_AL_TASK_POOL_HPP
+#define INCLUDE_AL_TASK_POOL_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+
+	File description:
+	Work-stealing pool of threads for executing tasks in parallel
+*/
+
+#include <vector>
+#include "allocore/system/al_Atomic.hpp"
+#include "allocore/system/al_Thread.hpp"
+
+namespace al{
+
+class TaskPool;
+
+
+/// Tracks completion of a set of tasks submitted to a TaskPool
+class TaskGroup{
+public:
+	TaskGroup(): mCount(0){}
+
+	/// Returns number of submitted tasks that have not yet completed
+	int pending() const { return mCount.load(); }
+
+	/// Returns whether all submitted tasks have completed
+	bool done() const { return 0 == pending(); }
+
+private:
+	friend class TaskPool;
+	Atomic<int> mCount;
+};
+
+
+/// Unit of work executed by a TaskPool
+
+/// Tasks can be linked into a graph using precede(). A task is only executed
+/// once all tasks preceding it have completed. Only the roots of a graph
+/// (tasks without predecessors) should be submitted; the others are submitted
+/// automatically. Graphs can be resubmitted once they have completed.
+class Task{
+public:
+
+	Task(): mDeps(0), mPending(0), mGroup(0){}
+
+	virtual ~Task(){}
+
+	/// Routine called when the task is executed
+	virtual void operator()() = 0;
+
+	/// Make another task wait until this task has completed
+
+	/// This should not be called while the task is submitted.
+	///
+	Task& precede(Task& next){
+		mSuccessors.push_back(&next);
+		++next.mDeps;
+		next.mPending.store(next.mDeps);
+		return *this;
+	}
+
+	/// Returns number of tasks that must complete before this one is executed
+	int numPredecessors() const { return mDeps; }
+
+private:
+	friend class TaskPool;
+	std::vector<Task *> mSuccessors;
+	int mDeps;
+	Atomic<int> mPending;
+	TaskGroup * mGroup;
+
+	Task(const Task&);
+	Task& operator= (const Task&);
+};
+
+
+/// Pool of worker threads executing tasks with work stealing
+
+/// Each worker has its own queue of tasks. Tasks submitted from within a
+/// worker go to its queue, others go to a shared queue. Idle workers take
+/// tasks from the shared queue or steal from other workers' queues. All
+/// queues are lock-free and have a fixed capacity, so submit() never blocks
+/// or allocates and can be called from an audio callback.
+///
+/// Threads waiting for a TaskGroup execute tasks while they wait, so wait()
+/// and parallelFor() can be called from within tasks.
+class TaskPool{
+public:
+
+	/// @param[in] numWorkers	number of worker threads; if negative, one
+	///							less than the number of processors, but at
+	///							least one
+	/// @param[in] firstCore	if non-negative, pin worker i to processor
+	///							(firstCore + i) modulo the number of processors
+	/// @param[in] queueSize	capacity of each task queue
+	TaskPool(int numWorkers=-1, int firstCore=-1, int queueSize=4096);
+
+	/// Stops and joins all worker threads; submitted tasks are not executed
+	~TaskPool();
+
+	/// Get shared pool, created on first call
+	static TaskPool& get();
+
+
+	/// Returns number of worker threads
+	int size() const { return int(mWorkers.size()); }
+
+	/// Submit a task for execution
+
+	/// @param[in] task		task to execute; must stay alive until completed
+	/// @param[in] group	optional group to track completion of the task
+	///						and all tasks it precedes
+	/// \returns false if the task could not be queued because the queue
+	///			was full. Tasks submitted from a worker whose queue is full
+	///			are executed immediately instead.
+	bool submit(Task& task, TaskGroup * group = 0);
+
+	/// Set priority and scheduling policy of all worker threads
+
+	/// Give workers a real-time priority when tasks are waited on by a
+	/// real-time thread, such as an audio callback. See Thread::priority.
+	TaskPool& priority(int v, Thread::Policy p);
+
+	/// Block until all tasks in a group have completed
+
+	/// The calling thread executes tasks until the group completes, spinning
+	/// or yielding while the remaining tasks run on other threads.
+	void wait(TaskGroup& group);
+
+	/// Call func(i) for each i in [begin, end) in parallel
+
+	/// The range is processed in chunks of 'grain' indices by the calling
+	/// thread and all workers. This returns once all indices are processed.
+	template <class Func>
+	void parallelFor(int begin, int end, Func& func, int grain=1){
+		runFor<Func>(begin, end, func, grain);
+	}
+
+	/// Call func(i) for each i in [begin, end) in parallel
+
+	/// This accepts temporary function objects, which must have a const
+	/// call operator.
+	template <class Func>
+	void parallelFor(int begin, int end, const Func& func, int grain=1){
+		runFor<const Func>(begin, end, func, grain);
+	}
+
+	/// Execute one pending task, if any, on the calling thread
+
+	/// \returns whether a task was executed
+	bool runPending();
+
+	class Worker;
+	class Queue;
+
+private:
+	class SharedQueue;
+	std::vector<Worker *> mWorkers;
+	SharedQueue * mShared;
+	struct Signal;
+	Signal * mSignal;
+	Atomic<int> mSleepers;
+	Atomic<int> mRunning;
+
+	Worker * currentWorker();
+	Task * findTask(Worker * w);
+	void execute(Task * t, Worker * w);
+	void notify();
+	static void * sWorkerFunc(void * user);
+	void workerLoop(Worker& w);
+
+	template <class Func>
+	void runFor(int begin, int end, Func& func, int grain);
+
+	template <class Func>
+	struct ForTask : public Task{
+		Func& func;
+		Atomic<int> next;
+		int end, grain;
+		ForTask(Func& f, int b, int e, int g): func(f), next(b), end(e), grain(g){}
+		void operator()(){
+			for(;;){
+				int i = next.fetchAdd(grain);
+				if(i >= end) break;
+				int iend = i + grain < end ? i + grain : end;
+				for(; i<iend; ++i) func(i);
+			}
+		}
+	};
+
+	TaskPool(const TaskPool&);
+	TaskPool& operator= (const TaskPool&);
+};
+
+
+
+// -----------------------------------------------------------------------------
+// Inline implementation
+
+template <class Func>
+void TaskPool::runFor(int begin, int end, Func& func, int grain){
+	if(grain < 1) grain = 1;
+	if(end <= begin) return;
+	int chunks = (end - begin + grain - 1) / grain;
+	ForTask<Func> task(func, begin, end, grain);
+	TaskGroup group;
+	// The same task is submitted once per helping worker; each execution
+	// takes chunks from a shared counter until the range is exhausted.
+	int helpers = chunks - 1 < size() ? chunks - 1 : size();
+	for(int i=0; i<helpers; ++i){
+		if(!submit(task, &group)) break;
+	}
+	task();
+	wait(group);
+}
+
+} // al::
+
+#endif
@@ -43,6 +43,9 @@
 	Graham Wakefield, 2010, grrrwaaa@gmail.com
 */
 
+#include <stddef.h>
+#include <vector>
+
 
 namespace al{
 
@@ -98,12 +101,50 @@ public:
 	/// Set whether thread will automatically join upon destruction
 	Thread& joinOnDestroy(bool v){ mJoinOnDestroy=v; return *this; }
 
+	/// Scheduling policy
+	enum Policy{
+		NORMAL,			/**< Time-sharing (non-real-time) */
+		FIFO,			/**< Real-time, runs until it blocks or yields */
+		ROUND_ROBIN		/**< Real-time, time-sliced among equal priorities */
+	};
+
 	/// Set thread priority
 
 	/// @param[in] v	priority of thread in [0, 99]. A value greater than 0
-	///					makes the thread "real-time".
+	///					makes the thread "real-time" using the FIFO policy.
 	Thread& priority(int v);
 
+	/// Set thread priority and scheduling policy
+
+	/// Real-time policies usually require elevated privileges (e.g.,
+	/// CAP_SYS_NICE or an rtprio entry in /etc/security/limits.conf on Linux).
+	/// If they cannot be granted, a warning is printed and the thread runs
+	/// with normal scheduling. This can be called before or after start().
+	/// Currently only supported on POSIX systems; elsewhere a warning is
+	/// printed.
+	/// @param[in] v	priority of thread in [1, 99] for real-time policies
+	/// @param[in] p	scheduling policy
+	Thread& priority(int v, Policy p);
+
+	/// Restrict thread to run on a single processor
+	Thread& affinity(int cpu);
+
+	/// Restrict thread to run on a set of processors
+
+	/// This can be called before or after start(). Currently only supported
+	/// on Linux and Windows.
+	/// @param[in] cpus		processor indices; an empty set removes restrictions
+	Thread& affinity(const std::vector<int>& cpus);
+
+	/// Set amount of stack to pre-fault and lock into physical memory
+
+	/// This is applied when the thread starts and prevents page faults, which
+	/// can cause glitches in real-time threads, when the stack grows. The
+	/// amount is limited to the thread's stack size less a margin for the
+	/// thread function, with a warning if that is less than requested.
+	/// @param[in] bytes	amount of stack to lock; 0 disables locking
+	Thread& lockStack(size_t bytes);
+
 
 	/// Start executing thread function
 	bool start(ThreadFunction& func);
@@ -226,6 +267,17 @@ protected:
 
 
 
+/// Lock all current and future pages of the process into physical memory
+
+/// This prevents page faults, which can cause glitches in real-time threads,
+/// at the cost of physical memory. It should be called at startup, before
+/// real-time threads are started. Requires sufficient privileges or a large
+/// enough memlock limit.
+/// \returns whether memory was successfully locked
+bool lockProcessMemory();
+
+
+
 // -----------------------------------------------------------------------------
 // Inline implementation
 
@@ -78,6 +78,17 @@ extern void al_sleep_nsec(al_nsec dt);
 /**! convenience function to sleep until a target wall-clock time */
 extern void al_sleep_until(al_sec target);
 
+/**! Get time from a monotonic clock, in nsec
+
+	Unlike al_time_nsec, this clock is unaffected by adjustments of the system
+	wall-clock and is thus suitable for scheduling. Its epoch is unspecified.
+	On platforms without a known monotonic clock, this is the wall-clock.
+*/
+extern al_nsec al_steady_time_nsec();
+
+/**! Suspend calling thread until the monotonic clock reaches target nsec */
+extern void al_steady_sleep_until_nsec(al_nsec target);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -59,14 +59,17 @@ inline al_sec walltime(){ return al_time(); }
 inline al_sec timeNow(){ return al_time(); }
 
 /// Timer with stopwatch-like functionality for benchmarking, etc.
+
+/// Times are taken from the monotonic clock, so measurements are unaffected
+/// by adjustments of the system clock.
 class Timer {
 public:
 	Timer(): mStart(0), mStop(0){}
 
 	al_nsec elapsed(){ return mStop - mStart; }					///< Returns nsec between start() and stop() calls
 	al_sec elapsedSec(){ return al_time_ns2s * elapsed(); }		///< Returns  sec between start() and stop() calls
-	void start(){ mStart=al_time_nsec(); }							///< Set start time as current time
-	void stop(){ mStop=al_time_nsec(); }								///< Set stop time as current time
+	void start(){ mStart=al_steady_time_nsec(); }							///< Set start time as current time
+	void stop(){ mStop=al_steady_time_nsec(); }								///< Set stop time as current time
 
 private:
 	al_nsec mStart, mStop;	// start and stop times
@@ -74,6 +77,108 @@ private:
 
 
 
+/// Scheduler for periodic events on absolute deadlines
+
+/// Deadlines are computed on a monotonic clock as multiples of the period
+/// from the start time, so time spent handling events does not accumulate
+/// as drift, as it would when sleeping a fixed interval after each event.
+/// For sub-millisecond accuracy, the last part of each wait can be spent
+/// busy-waiting (see spin()) rather than relying on the OS to wake on time.
+class DeadlineTimer {
+public:
+
+	/// What to do when an event is started after its deadline
+	enum Overrun {
+		CATCH_UP,	///< Keep schedule; run late events early until caught up
+		SKIP,		///< Drop missed deadlines and wait for the next one on schedule
+		RESYNC		///< Restart schedule from the time of the late event
+	};
+
+	/// @param[in] period	period between deadlines, in seconds
+	DeadlineTimer(al_sec period=1);
+
+
+	/// Set period, in seconds
+	DeadlineTimer& period(al_sec v);
+
+	/// Set period, in nanoseconds
+	DeadlineTimer& periodNsec(al_nsec v);
+
+	/// Get period, in seconds
+	al_sec period() const { return al_time_ns2s * mPeriod; }
+
+	/// Get period, in nanoseconds
+	al_nsec periodNsec() const { return mPeriod; }
+
+	/// Set time before each deadline to busy-wait instead of sleep, in seconds
+
+	/// A value of 0 (the default) never busy-waits. Values somewhat larger
+	/// than the OS scheduler's wake-up latency (typically 50-100 us on Linux)
+	/// give the most accurate timing at the cost of CPU use.
+	DeadlineTimer& spin(al_sec v);
+
+	/// Get busy-wait time before each deadline, in seconds
+	al_sec spin() const { return al_time_ns2s * mSpin; }
+
+	/// Set overrun policy
+	DeadlineTimer& overrun(Overrun v){ mOverrun=v; return *this; }
+
+	/// Get overrun policy
+	Overrun overrun() const { return mOverrun; }
+
+	/// Set how quickly lost time is made up in CATCH_UP mode
+
+	/// @param[in] v	Maximum fraction of one period, in [0,1], to make up
+	///					each event when behind schedule. A value of 1 runs
+	///					late events back-to-back.
+	DeadlineTimer& catchUpRate(float v);
+
+
+	/// Start schedule; the first deadline is one period from now
+	void start();
+
+	/// Block until the next deadline
+
+	/// @return number of deadlines dropped by the overrun policy
+	///
+	int wait();
+
+	/// Get next deadline on the monotonic clock, in nanoseconds
+	al_nsec deadline() const { return mDeadline; }
+
+
+	/// Get number of calls to wait()
+	unsigned long long ticks() const { return mTicks; }
+
+	/// Get number of calls to wait() made after the deadline had passed
+	unsigned long long overruns() const { return mOverruns; }
+
+	/// Get total number of deadlines dropped by the overrun policy
+	unsigned long long missed() const { return mMissed; }
+
+	/// Get mean wake-up latency past deadline, in seconds
+	al_sec jitterMean() const { return mWaits ? al_time_ns2s * mJitterSum / mWaits : 0; }
+
+	/// Get maximum wake-up latency past deadline, in seconds
+	al_sec jitterMax() const { return al_time_ns2s * mJitterMax; }
+
+	/// Reset timing statistics
+	void resetStats();
+
+private:
+	void sleepUntil(al_nsec target);
+
+	al_nsec mPeriod, mSpin;
+	al_nsec mDeadline;				// next deadline
+	al_nsec mPrev;					// time of previous event
+	float mCatchUpRate;
+	Overrun mOverrun;
+	unsigned long long mTicks, mOverruns, mMissed, mWaits;
+	al_nsec mJitterSum, mJitterMax;
+};
+
+
+
 /// Self-correcting timer
 
 ///	Helper object for events intended to run at a particular rate/period,
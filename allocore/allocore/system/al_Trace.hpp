@@ -0,0 +1,163 @@
+#ifndef INCLUDE_AL_TRACE_HPP
+#define INCLUDE_AL_TRACE_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+
+	File description:
+	Scoped timing zones recorded to per-thread buffers and exported as a
+	Chrome trace (viewable in chrome://tracing or Perfetto)
+*/
+
+#include <string>
+#include "allocore/system/al_Time.h"
+
+/*	Trace zones are compiled in only if AL_TRACE is defined (CMake option
+	ALLOCORE_TRACE), otherwise the macros expand to nothing. Zone names must
+	be string literals (or otherwise outlive the trace) as only the pointer
+	is stored.
+
+	void onAudio(AudioIOData& io){
+		AL_TRACE_ZONE_RT("onAudio");
+		...
+	}
+
+	Trace::start();
+	...
+	Trace::writeChrome("trace.json");
+*/
+#ifdef AL_TRACE
+	#define AL_TRACE_CONCAT_(a,b) a##b
+	#define AL_TRACE_CONCAT(a,b) AL_TRACE_CONCAT_(a,b)
+
+	/// Time the enclosing scope
+	#define AL_TRACE_ZONE(name)\
+		::al::TraceZone AL_TRACE_CONCAT(alTraceZone, __LINE__)(name)
+
+	/// Time the enclosing scope; never allocates or blocks
+	#define AL_TRACE_ZONE_RT(name)\
+		::al::TraceZone AL_TRACE_CONCAT(alTraceZone, __LINE__)(name, true)
+
+	/// Name the calling thread in exported traces
+	#define AL_TRACE_THREAD_NAME(name) ::al::Trace::threadName(name)
+#else
+	#define AL_TRACE_ZONE(name)
+	#define AL_TRACE_ZONE_RT(name)
+	#define AL_TRACE_THREAD_NAME(name)
+#endif
+
+namespace al{
+
+/// Global recorder of trace zones
+
+/// Each thread records into its own fixed-size ring buffer, so recording
+/// takes no locks and, once a thread's buffer is full, the oldest events are
+/// overwritten. Buffers for the first few threads to record are allocated
+/// by start(); other threads allocate theirs on their first record, except
+/// from realtime zones, which drop events instead. A thread's buffer is
+/// passed on to the next thread to record once it exits, keeping its events.
+class Trace{
+public:
+
+	enum{
+		MAX_THREADS = 64	///< Maximum number of threads that can record at once
+	};
+
+	/// Start recording
+
+	/// @param[in] eventsPerThread	capacity of each thread's ring buffer
+	/// @param[in] preallocThreads	number of thread buffers to allocate now
+	static void start(int eventsPerThread = 1<<16, int preallocThreads = 4);
+
+	/// Stop recording; recorded events are kept until clear()
+	static void stop();
+
+	/// Returns whether recording
+	static bool active();
+
+	/// Discard all recorded events
+
+	/// This should not be called while other threads may be recording.
+	///
+	static void clear();
+
+	/// Set name of calling thread shown in exported traces
+	static void threadName(const std::string& name);
+
+	/// Get number of events currently held in all buffers
+	static int numEvents();
+
+	/// Get number of events dropped since last clear()
+	static int numDropped();
+
+	/// Write recorded events in Chrome trace event format
+
+	/// This can be called while recording; events being overwritten while
+	/// they are read are left out.
+	/// \returns true on success
+	static bool writeChrome(const std::string& path);
+
+	/// Record a completed zone for the calling thread
+	static void record(const char * name, al_nsec begin, al_nsec end, bool realtime=false);
+};
+
+
+/// Records the time from construction to destruction as a trace zone
+class TraceZone{
+public:
+
+	/// @param[in] name			name of zone; must outlive trace
+	/// @param[in] realtime		if true, never allocate or block
+	TraceZone(const char * name, bool realtime=false)
+	:	mName(Trace::active() ? name : 0), mRealtime(realtime)
+	{
+		if(mName) mBegin = al_steady_time_nsec();
+	}
+
+	~TraceZone(){
+		if(mName) Trace::record(mName, mBegin, al_steady_time_nsec(), mRealtime);
+	}
+
+private:
+	const char * mName;
+	al_nsec mBegin;
+	bool mRealtime;
+
+	TraceZone(const TraceZone&);
+	TraceZone& operator= (const TraceZone&);
+};
+
+} // al::
+
+#endif
@@ -122,12 +122,21 @@ uint32_t floatExponent(float v);
 /// Returns mantissa field as float between [0, 1).
 float floatMantissa(float v);
 
+/// Convert 32-bit float to 16-bit (half precision) float bits
+
+/// Rounds to nearest even. Values too large for a half become infinity and
+/// NaNs stay NaNs.
+uint16_t floatToHalf(float v);
+
 /// Converts linear integer phase to fraction
 
 ///	2^bits is the effective size of the lookup table. \n
 ///	Note: the fraction only has 24-bits of precision.
 float fraction(uint32_t bits, uint32_t phase);
 
+/// Convert 16-bit (half precision) float bits to 32-bit float
+float halfToFloat(uint16_t h);
+
 /// Convert 16-bit signed integer to floating point in [-1, 1)
 float intToUnit(int16_t v);
 
@@ -266,11 +275,52 @@ inline float floatMantissa(float v){
 	return punUF(frac) - 1.f;
 }
 
+inline uint16_t floatToHalf(float v){
+	uint32_t f = punFU(v);
+	uint32_t sign = (f >> 16) & 0x8000;
+	uint32_t mag = f & 0x7fffffff;
+
+	if(mag >= 0x7f800000){						// infinity or NaN
+		return sign | 0x7c00 | (mag > 0x7f800000 ? 0x200 : 0);
+	}
+	if(mag >= 0x477ff000){						// rounds to 65520 or more
+		return sign | 0x7c00;
+	}
+	if(mag < 0x38800000){						// below 2^-14; subnormal half
+		if(mag <= 0x33000000) return sign;		// 2^-25 or less rounds to zero
+		uint32_t shift = 126 - (mag >> 23);
+		uint32_t frac = (mag & 0x7fffff) | 0x800000;
+		uint32_t h = frac >> shift;
+		uint32_t rem = frac & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if(rem > halfway || (rem == halfway && (h & 1))) ++h;
+		return sign | h;
+	}
+	// rebias exponent from 127 to 15; a carry out of the fraction correctly
+	// increments the exponent
+	uint32_t h = (mag - 0x38000000) >> 13;
+	uint32_t rem = mag & 0x1fff;
+	if(rem > 0x1000 || (rem == 0x1000 && (h & 1))) ++h;
+	return sign | h;
+}
+
 inline float fraction(uint32_t bits, uint32_t phase){
 	phase = phase << bits >> 9 | Expo1<float>();
 	return punUF(phase) - 1.f;
 }
 
+inline float halfToFloat(uint16_t h){
+	uint32_t sign = uint32_t(h & 0x8000) << 16;
+	uint32_t expo = (h >> 10) & 0x1f;
+	uint32_t frac = h & 0x3ff;
+	if(expo == 0x1f) return punUF(sign | 0x7f800000 | (frac << 13));
+	if(expo == 0){								// zero or subnormal
+		float v = frac * (1.f/16777216.f);		// frac * 2^-24
+		return sign ? -v : v;
+	}
+	return punUF(sign | ((expo + 112) << 23) | (frac << 13));
+}
+
 inline float intToUnit(int16_t v){
 	uint32_t vu = (((uint32_t)v) + 0x808000) << 7; // set fraction in float [2, 4)
 	return punUF(vu) - 3.f;
@@ -0,0 +1,150 @@
+#ifndef INCLUDE_AL_TRIPLE_BUFFER_HPP
+#define INCLUDE_AL_TRIPLE_BUFFER_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+
+	File description:
+	Passing the latest value of an object between a pair of threads without locking
+*/
+
+#include "allocore/system/al_Atomic.hpp"
+
+namespace al {
+
+/** Lock free single-reader-single-writer "latest value" container.
+ * Holds three copies of an object: one owned by the writer, one owned by
+ * the reader and one in between. Publishing swaps the writer's copy with
+ * the middle one and updating swaps the middle one with the reader's copy.
+ * The writer never waits for the reader and the reader always sees the
+ * newest complete object without copying it. Intermediate values published
+ * between reader updates are dropped.
+ *
+ * This is intended for sharing state, such as a Pose, Nav or a user POD
+ * struct, between e.g. a simulation thread and a render thread.
+ *
+ * Writer:
+ * \code
+ *	buf.write().pos(x,y,z);
+ *	buf.publish();
+ * \endcode
+ *
+ * Reader:
+ * \code
+ *	buf.update();
+ *	draw(buf.read());
+ * \endcode
+ */
+template <class T>
+class TripleBuffer {
+public:
+
+	/** Initialize all copies to a default-constructed object */
+	TripleBuffer();
+
+	/** Initialize all copies to a value */
+	explicit TripleBuffer(const T& init);
+
+
+	/** Get writer's copy to modify before calling publish()
+
+		The contents are those from the last time the copy was the reader's,
+		so objects must be fully rewritten rather than incrementally updated.
+	*/
+	T& write(){ return mSlots[mBack].value; }
+
+	/** Make the writer's copy available to the reader (writer only) */
+	void publish();
+
+	/** Copy a value into the writer's copy and publish it (writer only) */
+	void publish(const T& v){ write() = v; publish(); }
+
+
+	/** Switch to the most recently published object, if any (reader only)
+
+		Returns true if a new object is available in read().
+	*/
+	bool update();
+
+	/** Get reader's copy (reader only) */
+	const T& read() const { return mSlots[mFront].value; }
+
+	/** Whether a new object has been published since the last update() */
+	bool fresh() const { return (mMiddle.load() & FRESH) != 0; }
+
+private:
+	enum { FRESH = 4, INDEX = 3 };
+
+	// Pad slots to keep the reader's and writer's copies on separate cache lines
+	struct Slot {
+		T value;
+		char pad[64];
+	};
+
+	Slot mSlots[3];
+	Atomic<int> mMiddle;	// index of middle copy | FRESH
+	int mBack;				// writer's copy
+	char mPad[64];
+	int mFront;				// reader's copy
+};
+
+
+
+template <class T>
+inline TripleBuffer<T> :: TripleBuffer()
+:	mMiddle(1), mBack(0), mFront(2)
+{}
+
+template <class T>
+inline TripleBuffer<T> :: TripleBuffer(const T& init)
+:	mMiddle(1), mBack(0), mFront(2)
+{
+	for(int i=0; i<3; ++i) mSlots[i].value = init;
+}
+
+template <class T>
+inline void TripleBuffer<T> :: publish(){
+	mBack = mMiddle.exchange(mBack | FRESH) & INDEX;
+}
+
+template <class T>
+inline bool TripleBuffer<T> :: update(){
+	if(!fresh()) return false;
+	mFront = mMiddle.exchange(mFront) & INDEX;
+	return true;
+}
+
+} // al::
+
+#endif /* include guard */
@@ -0,0 +1,200 @@
+/*
+	allocore_bench -- microbenchmarks of allocore hot paths
+
+	Usage:
+	allocore_bench [options]
+
+	--filter <str>		only run benchmarks whose name contains <str>
+	--reps <n>			number of timed repetitions (default 50)
+	--warmup <n>		number of untimed warmup repetitions (default 5)
+	--json <file>		write results as JSON to <file> ("-" for stdout)
+	--baseline <file>	compare medians against results of a previous --json run
+	--tolerance <frac>	allowed slowdown relative to baseline (default 0.05)
+
+	When a baseline is given, the program returns a non-zero exit status if
+	any benchmark's median is slower than its baseline by more than the
+	tolerance, so it can be used to gate changes.
+*/
+
+#include <algorithm>
+#include <map>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bmAllocore.h"
+
+Bench::Bench()
+:	reps(50), warmup(5), minRepTime(200000), log(stdout), mSink(0)
+{}
+
+bool Bench::enabled(const std::string& name) const {
+	return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+void Bench::add(const std::string& name, std::vector<double>& samples, int iters){
+	BenchResult r;
+	r.name = name;
+	r.reps = samples.size();
+	r.iters = iters;
+	r.min = r.median = r.mean = r.p99 = 0;
+
+	if(!samples.empty()){
+		std::sort(samples.begin(), samples.end());
+		int n = samples.size();
+		double sum = 0;
+		for(int i=0; i<n; ++i) sum += samples[i];
+		r.min = samples[0];
+		r.mean = sum / n;
+		r.median = (n&1) ? samples[n/2] : 0.5*(samples[n/2-1] + samples[n/2]);
+		// nearest-rank percentile
+		int i99 = int(ceil(0.99 * n)) - 1;
+		r.p99 = samples[i99 < 0 ? 0 : i99];
+	}
+
+	fprintf(log, "%-40s %12.1f %12.1f %12.1f %10d\n",
+		name.c_str(), r.median, r.p99, r.min, r.iters);
+	fflush(log);
+
+	mResults.push_back(r);
+}
+
+
+static std::string escape(const std::string& s){
+	std::string r;
+	for(unsigned i=0; i<s.size(); ++i){
+		if(s[i] == '"' || s[i] == '\\') r += '\\';
+		r += s[i];
+	}
+	return r;
+}
+
+static bool writeJSON(const std::vector<BenchResult>& results, const char * path){
+	FILE * fp = strcmp(path, "-") ? fopen(path, "w") : stdout;
+	if(!fp){
+		fprintf(stderr, "Could not open %s for writing\n", path);
+		return false;
+	}
+	// One benchmark per line so results are easy to diff and to read back
+	fprintf(fp, "{\"benchmarks\": [\n");
+	for(unsigned i=0; i<results.size(); ++i){
+		const BenchResult& r = results[i];
+		fprintf(fp,
+			"{\"name\": \"%s\", \"reps\": %d, \"iters\": %d, "
+			"\"min_ns\": %.3f, \"median_ns\": %.3f, \"mean_ns\": %.3f, \"p99_ns\": %.3f}%s\n",
+			escape(r.name).c_str(), r.reps, r.iters,
+			r.min, r.median, r.mean, r.p99,
+			i+1 < results.size() ? "," : ""
+		);
+	}
+	fprintf(fp, "]}\n");
+	if(fp != stdout) fclose(fp);
+	return true;
+}
+
+// Reads the name and median of each benchmark from a file written by writeJSON
+static bool readBaseline(std::map<std::string, double>& medians, const char * path){
+	FILE * fp = fopen(path, "r");
+	if(!fp){
+		fprintf(stderr, "Could not open baseline %s\n", path);
+		return false;
+	}
+	char line[1024];
+	while(fgets(line, sizeof(line), fp)){
+		const char * n = strstr(line, "\"name\": \"");
+		const char * m = strstr(line, "\"median_ns\": ");
+		if(!n || !m) continue;
+		n += 9;
+		std::string name;
+		for(; *n && *n != '"'; ++n){
+			if(*n == '\\' && n[1]) ++n;
+			name += *n;
+		}
+		medians[name] = atof(m + 13);
+	}
+	fclose(fp);
+	return true;
+}
+
+// Returns number of regressions
+static int compare(FILE * log, const std::vector<BenchResult>& results, const std::map<std::string, double>& baseline, double tolerance){
+	int regressions = 0;
+	fprintf(log, "\n%-40s %12s %12s %8s\n", "benchmark", "baseline", "current", "change");
+	for(unsigned i=0; i<results.size(); ++i){
+		const BenchResult& r = results[i];
+		std::map<std::string, double>::const_iterator it = baseline.find(r.name);
+		if(it == baseline.end()){
+			fprintf(log, "%-40s %12s %12.1f %8s\n", r.name.c_str(), "-", r.median, "new");
+			continue;
+		}
+		double base = it->second;
+		double change = base > 0 ? r.median/base - 1 : 0;
+		bool regressed = change > tolerance;
+		if(regressed) ++regressions;
+		fprintf(log, "%-40s %12.1f %12.1f %+7.1f%%%s\n",
+			r.name.c_str(), base, r.median, change*100, regressed ? "  REGRESSION" : "");
+	}
+	return regressions;
+}
+
+
+int main(int argc, char * argv[]){
+
+	Bench bench;
+	const char * jsonPath = 0;
+	const char * baselinePath = 0;
+	double tolerance = 0.05;
+
+	for(int i=1; i<argc; ++i){
+		std::string arg = argv[i];
+		const char * val = i+1 < argc ? argv[i+1] : 0;
+		if(val && arg == "--filter"){			bench.filter = val; ++i; }
+		else if(val && arg == "--reps"){		bench.reps = atoi(val); ++i; }
+		else if(val && arg == "--warmup"){		bench.warmup = atoi(val); ++i; }
+		else if(val && arg == "--json"){		jsonPath = val; ++i; }
+		else if(val && arg == "--baseline"){	baselinePath = val; ++i; }
+		else if(val && arg == "--tolerance"){	tolerance = atof(val); ++i; }
+		else{
+			fprintf(stderr,
+				"usage: %s [--filter str] [--reps n] [--warmup n] [--json file] "
+				"[--baseline file] [--tolerance frac]\n", argv[0]);
+			return 2;
+		}
+	}
+	if(bench.reps < 1) bench.reps = 1;
+	if(bench.warmup < 0) bench.warmup = 0;
+
+	// When writing JSON to stdout, keep the table out of the way
+	if(jsonPath && !strcmp(jsonPath, "-")) bench.log = stderr;
+
+	fprintf(bench.log, "%-40s %12s %12s %12s %10s\n", "benchmark (ns/iter)", "median", "p99", "min", "iters");
+
+	bmMathInterpolation(bench);
+	bmProtocolOSC(bench);
+	bmSpatial(bench);
+	bmTypes(bench);
+	#ifdef ALLOCORE_BENCH_GL
+	bmGraphicsMesh(bench);
+	#endif
+	#ifdef ALLOCORE_BENCH_AUDIO
+	bmSoundAudioScene(bench);
+	bmSoundBiquadBank(bench);
+	#endif
+
+	int status = 0;
+
+	if(jsonPath){
+		if(!writeJSON(bench.results(), jsonPath)) status = 2;
+	}
+
+	if(baselinePath){
+		std::map<std::string, double> baseline;
+		if(!readBaseline(baseline, baselinePath)) return 2;
+		int regressions = compare(bench.log, bench.results(), baseline, tolerance);
+		if(regressions){
+			fprintf(bench.log, "\n%d benchmark(s) regressed by more than %g%%\n", regressions, tolerance*100);
+			status = 1;
+		}
+	}
+
+	return status;
+}
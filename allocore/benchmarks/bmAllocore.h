@@ -0,0 +1,114 @@
+#ifndef INCLUDE_BM_ALLOCORE_H
+#define INCLUDE_BM_ALLOCORE_H
+
+/*
+	Microbenchmark harness for allocore
+
+	Each benchmark is a functor whose operator() performs one iteration of the
+	operation being measured. The harness first calibrates the number of
+	iterations per repetition so that a repetition lasts long enough to be
+	timed reliably, runs a number of untimed warmup repetitions and then times
+	each of the remaining repetitions with al::Timer. Statistics are computed
+	over the per-iteration times of all timed repetitions.
+*/
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "allocore/system/al_Time.hpp"
+
+using namespace al;
+
+/// Statistics of a single benchmark, in nanoseconds per iteration
+struct BenchResult{
+	std::string name;
+	int reps;				///< Number of timed repetitions
+	int iters;				///< Iterations per repetition
+	double min, median, mean, p99;
+};
+
+
+/// Runs benchmarks and collects their results
+class Bench{
+public:
+
+	Bench();
+
+	int reps;				///< Number of timed repetitions
+	int warmup;				///< Number of untimed repetitions before timing
+	al_nsec minRepTime;		///< Minimum duration of a repetition when calibrating
+	std::string filter;		///< Only run benchmarks whose name contains this
+	FILE * log;				///< Stream to print results to as they complete
+
+	/// Returns whether a benchmark with the given name will be run
+	bool enabled(const std::string& name) const;
+
+	/// Run benchmark
+
+	/// @param[in] name		unique name of benchmark, e.g. "spatial/HashSpace/query"
+	/// @param[in] func		functor performing one iteration
+	/// @param[in] iters	iterations per repetition; if 0, determine automatically
+	template <class Func>
+	void run(const std::string& name, Func& func, int iters=0);
+
+	/// Consume a value so that the computation of it is not optimized away
+	void sink(double v){ mSink += v; }
+
+	const std::vector<BenchResult>& results() const { return mResults; }
+
+private:
+	std::vector<BenchResult> mResults;
+	volatile double mSink;
+
+	void add(const std::string& name, std::vector<double>& samples, int iters);
+};
+
+
+template <class Func>
+void Bench::run(const std::string& name, Func& func, int iters){
+	if(!enabled(name)) return;
+
+	Timer timer;
+
+	// Calibrate (also serves as initial warmup)
+	if(iters <= 0){
+		iters = 1;
+		for(;;){
+			timer.start();
+			for(int i=0; i<iters; ++i) func();
+			timer.stop();
+			if(timer.elapsed() >= minRepTime || iters >= (1<<24)) break;
+			iters <<= 1;
+		}
+	}
+
+	for(int r=0; r<warmup; ++r){
+		for(int i=0; i<iters; ++i) func();
+	}
+
+	std::vector<double> samples(reps);
+	for(int r=0; r<reps; ++r){
+		timer.start();
+		for(int i=0; i<iters; ++i) func();
+		timer.stop();
+		samples[r] = double(timer.elapsed()) / iters;
+	}
+
+	add(name, samples, iters);
+}
+
+
+// Benchmark groups; each runs all its benchmarks through the Bench
+void bmMathInterpolation(Bench& b);
+void bmProtocolOSC(Bench& b);
+void bmSpatial(Bench& b);
+void bmTypes(Bench& b);
+#ifdef ALLOCORE_BENCH_GL
+void bmGraphicsMesh(Bench& b);
+#endif
+#ifdef ALLOCORE_BENCH_AUDIO
+void bmSoundAudioScene(Bench& b);
+void bmSoundBiquadBank(Bench& b);
+#endif
+
+#endif
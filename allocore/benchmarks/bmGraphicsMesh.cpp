@@ -0,0 +1,51 @@
+#include "bmAllocore.h"
+#include "allocore/graphics/al_Isosurface.hpp"
+#include "allocore/graphics/al_Mesh.hpp"
+#include "allocore/graphics/al_Shapes.hpp"
+
+namespace{
+
+struct SphereNormals{
+	Mesh m;
+	Bench& b;
+	SphereNormals(Bench& b_): b(b_){}
+	void operator()(){
+		m.reset();
+		addSphere(m, 1, 64, 64);
+		m.generateNormals();
+		b.sink(m.normals().size());
+	}
+};
+
+struct IsosurfaceGen{
+	enum{ N=32 };
+	Isosurface iso;
+	std::vector<float> field;
+	float phase;
+	Bench& b;
+	IsosurfaceGen(Bench& b_): field(N*N*N), phase(0), b(b_){
+		iso.level(0);
+	}
+	void operator()(){
+		// A sphere with a rippled surface that changes every iteration
+		for(int k=0; k<N; ++k){
+		for(int j=0; j<N; ++j){
+		for(int i=0; i<N; ++i){
+			float x = float(i)/N*2-1, y = float(j)/N*2-1, z = float(k)/N*2-1;
+			field[(k*N + j)*N + i] = x*x + y*y + z*z - 0.5f + 0.05f*sin(x*10 + phase);
+		}}}
+		phase += 0.1f;
+		iso.generate(&field[0], N, 2./N);
+		b.sink(iso.vertices().size());
+	}
+};
+
+}
+
+void bmGraphicsMesh(Bench& b){
+	SphereNormals sn(b);
+	b.run("graphics/Mesh/sphereNormals64", sn);
+
+	IsosurfaceGen ig(b);
+	b.run("graphics/Isosurface/generate32", ig);
+}
@@ -0,0 +1,89 @@
+#include <math.h>
+#include <vector>
+#include "bmAllocore.h"
+#include "allocore/math/al_Interpolation.hpp"
+#include "allocore/types/al_Buffer.hpp"
+
+namespace{
+
+enum{ SOURCES=100, BLOCK=256, DELAY=8192 };
+
+// Reads a block from each of many Doppler delay-lines, with delays sweeping
+// as if the sources were moving
+struct Read{
+	enum Kind{ LINEAR, CUBIC, LAGRANGE3 };
+
+	std::vector<RingBuffer<float> > lines;
+	std::vector<double> delays;
+	std::vector<float> out;
+	Kind kind;
+	bool block;
+	int count;
+	Bench& b;
+
+	Read(Kind k, bool block_, Bench& b_)
+	:	lines(SOURCES, RingBuffer<float>(DELAY)), delays(BLOCK), out(BLOCK),
+		kind(k), block(block_), count(0), b(b_)
+	{
+		for(int s=0; s<SOURCES; ++s){
+			// stagger write positions so that some blocks wrap
+			for(int i=0; i<DELAY + s*37; ++i) lines[s].write(sin(0.01f * i * (s+1)));
+		}
+	}
+
+	void scalar(const RingBuffer<float>& r){
+		for(int i=0; i<BLOCK; ++i){
+			double d = delays[i];
+			int k = int(d);
+			float f = d - k;
+			switch(kind){
+			case LINEAR:
+				out[i] = ipl::linear(f, r.read(k), r.read(k+1)); break;
+			case CUBIC:
+				out[i] = ipl::cubic(f, r.read(k-1), r.read(k), r.read(k+1), r.read(k+2)); break;
+			case LAGRANGE3:{
+				float h[4];
+				ipl::lagrange3(h, 1.f + f);
+				out[i] = h[0]*r.read(k-1) + h[1]*r.read(k) + h[2]*r.read(k+1) + h[3]*r.read(k+2);
+			}	break;
+			}
+		}
+	}
+
+	void operator()(){
+		++count;
+		for(int s=0; s<SOURCES; ++s){
+			const RingBuffer<float>& r = lines[s];
+			double d0 = 2000 + 1000*sin(0.01*count + s);
+			for(int i=0; i<BLOCK; ++i) delays[i] = d0 + (BLOCK-i) * 1.001;
+			if(block){
+				ipl::RingView<float> v(&r[0], r.size(), r.pos());
+				switch(kind){
+				case LINEAR:	ipl::linear(&out[0], v, &delays[0], BLOCK); break;
+				case CUBIC:		ipl::cubic(&out[0], v, &delays[0], BLOCK); break;
+				case LAGRANGE3:	ipl::lagrange3(&out[0], v, &delays[0], BLOCK); break;
+				}
+			}
+			else{
+				scalar(r);
+			}
+			b.sink(out[0]);
+		}
+	}
+};
+
+}
+
+void bmMathInterpolation(Bench& b){
+	const char * names[] = {"linear", "cubic", "lagrange3"};
+	for(int k=0; k<3; ++k){
+		{
+			Read r(Read::Kind(k), false, b);
+			b.run(std::string("math/ipl/") + names[k] + "100x256scalar", r);
+		}
+		{
+			Read r(Read::Kind(k), true, b);
+			b.run(std::string("math/ipl/") + names[k] + "100x256", r);
+		}
+	}
+}
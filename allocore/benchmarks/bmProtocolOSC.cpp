@@ -0,0 +1,51 @@
+#include "bmAllocore.h"
+#include "allocore/protocol/al_OSC.hpp"
+
+namespace{
+
+struct Encode{
+	osc::Packet p;
+	Bench& b;
+	Encode(Bench& b_): p(1024), b(b_){}
+	void operator()(){
+		p.clear();
+		p.beginBundle(1);
+		for(int i=0; i<8; ++i){
+			p.addMessage("/source/pos", i, 0.5f, -0.25f, 1.f);
+		}
+		p.endBundle();
+		b.sink(p.size());
+	}
+};
+
+struct Handler : public osc::PacketHandler{
+	float sum;
+	Handler(): sum(0){}
+	virtual void onMessage(osc::Message& m){
+		int i; float x,y,z;
+		m >> i >> x >> y >> z;
+		sum += x+y+z;
+	}
+};
+
+struct Parse{
+	const osc::Packet& p;
+	Handler h;
+	Bench& b;
+	Parse(const osc::Packet& p_, Bench& b_): p(p_), b(b_){}
+	void operator()(){
+		h.parse(p.data(), p.size());
+		b.sink(h.sum);
+	}
+};
+
+}
+
+void bmProtocolOSC(Bench& b){
+	Encode enc(b);
+	b.run("osc/Packet/encodeBundle8", enc);
+
+	enc();
+	Parse parse(enc.p, b);
+	b.run("osc/PacketHandler/parseBundle8", parse);
+}
@@ -0,0 +1,245 @@
+#include "bmAllocore.h"
+#include "allocore/io/al_AudioIO.hpp"
+#include "allocore/sound/al_AudioScene.hpp"
+#include "allocore/sound/al_Dbap.hpp"
+#include "allocore/system/al_TaskPool.hpp"
+
+namespace{
+
+// Renders a scene of moving sources to octophonic rings, one per listener
+struct Render{
+	enum{ BLOCK=256 };
+	AudioIO io;
+	AudioScene scene;
+	std::vector<SpeakerLayout> layouts;
+	std::vector<Dbap *> panners;
+	std::vector<SoundSource *> sources;
+	int frame;
+	Bench& b;
+
+	Render(int numSources, Bench& b_, int numListeners=1)
+	:	io(BLOCK, 44100, 0, 0, 8*numListeners, 0, AudioIO::DUMMY),
+		scene(BLOCK), layouts(numListeners),
+		frame(0), b(b_)
+	{
+		for(int i=0; i<numListeners; ++i){
+			layouts[i] = SpeakerRingLayout<8>(8*i);
+			panners.push_back(new Dbap(layouts[i]));
+			Listener * l = scene.createListener(panners[i]);
+			l->compile();
+			l->pos(i, 0, 0);
+		}
+		for(int i=0; i<numSources; ++i){
+			SoundSource * s = new SoundSource;
+			scene.addSource(*s);
+			sources.push_back(s);
+		}
+	}
+
+	~Render(){
+		for(unsigned i=0; i<sources.size(); ++i) delete sources[i];
+		for(unsigned i=0; i<panners.size(); ++i) delete panners[i];
+	}
+
+	void operator()(){
+		for(unsigned s=0; s<sources.size(); ++s){
+			SoundSource& src = *sources[s];
+			for(int i=0; i<BLOCK; ++i){
+				src.writeSample(sin(0.01f * (frame+i) * (s+1)));
+			}
+			// Orbit listener so distances stay bounded
+			double a = 1e-5 * frame * (s+1) + s;
+			double r = 2 + s%4;
+			src.pos(r*cos(a), r*sin(a), 0);
+		}
+		frame += BLOCK;
+		io.zeroOut();
+		scene.render(io);
+		b.sink(io.out(0,0));
+	}
+};
+
+// Renders many ambient sources drifting up to 80 m away, of which only one
+// in ten is sounding
+struct Ambient{
+	enum{ BLOCK=256 };
+	AudioIO io;
+	AudioScene scene;
+	SpeakerLayout layout;
+	Dbap panner;
+	std::vector<SoundSource *> sources;
+	int frame;
+	Bench& b;
+
+	Ambient(int numSources, Bench& b_)
+	:	io(BLOCK, 44100, 0, 0, 8, 0, AudioIO::DUMMY),
+		scene(BLOCK), layout(OctalSpeakerLayout()), panner(layout),
+		frame(0), b(b_)
+	{
+		scene.createListener(&panner);
+		for(int i=0; i<numSources; ++i){
+			SoundSource * s = new SoundSource(1, 100, ATTEN_INVERSE, 0, 32768);
+			scene.addSource(*s);
+			sources.push_back(s);
+		}
+	}
+
+	~Ambient(){
+		for(unsigned i=0; i<sources.size(); ++i) delete sources[i];
+	}
+
+	void operator()(){
+		for(unsigned s=0; s<sources.size(); ++s){
+			SoundSource& src = *sources[s];
+			float amp = s%10 ? 0 : 0.1;
+			for(int i=0; i<BLOCK; ++i){
+				src.writeSample(amp * sin(0.01f * (frame+i) * (s%7+1)));
+			}
+			// Drift slowly around the listener
+			double a = s*2.4 + 1e-6 * frame, r = 5 + (s*37)%76;
+			src.pos(r*cos(a), r*sin(a), 0);
+		}
+		frame += BLOCK;
+		io.zeroOut();
+		scene.render(io);
+		b.sink(io.out(0,0));
+	}
+};
+
+// Three rings of 12, 30 and 12 speakers, as in the AlloSphere
+struct SphereLayout : SpeakerLayout{
+	SphereLayout(){
+		int chan = 0;
+		for(int i=0; i<12; ++i) addSpeaker(Speaker(chan++, 30*i, 41));
+		for(int i=0; i<30; ++i) addSpeaker(Speaker(chan++, 12*i, 0));
+		for(int i=0; i<12; ++i) addSpeaker(Speaker(chan++, 30*i, -32));
+	}
+};
+
+// Pans many sources to 54 speakers, one block per iteration
+struct Pan{
+	enum{ BLOCK=256 };
+	AudioIO io;
+	AudioScene scene;
+	SphereLayout layout;
+	Dbap panner;
+	std::vector<SoundSource> sources;
+	std::vector<Vec3d> relpos;
+	std::vector<Vec3f> speakerVecs;
+	std::vector<float> samples;
+	bool move;
+	bool uncached;
+	Bench& b;
+
+	Pan(int numSources, bool move_, Bench& b_)
+	:	io(BLOCK, 44100, 0, 0, 54, 0, AudioIO::DUMMY),
+		scene(BLOCK), panner(layout), sources(numSources), relpos(numSources),
+		samples(BLOCK), move(move_), uncached(false), b(b_)
+	{
+		scene.createListener(&panner);
+		for(int i=0; i<numSources; ++i){
+			scene.addSource(sources[i]);
+			double a = i*2.4, e = sin(i*0.7);
+			relpos[i] = Vec3d(cos(a), e, sin(a)) * (2 + i%5);
+		}
+		for(int i=0; i<BLOCK; ++i) samples[i] = sin(0.01f * i);
+		for(int k=0; k<layout.numSpeakers(); ++k){
+			speakerVecs.push_back(layout.speakers()[k].vec().normalized());
+		}
+	}
+
+	// Per buffer DBAP as it was before gains were cached
+	void performUncached(const Vec3d& rel){
+		for(int k=0; k<layout.numSpeakers(); ++k){
+			Vec3d vec = rel.normalized();
+			vec -= speakerVecs[k];
+			float dist = vec.mag() / 2.f;
+			dist = powf(dist, 5.f);
+			float gain = 1.f / (1.f + DBAP_MAX_DIST*dist);
+			float * out = io.outBuffer(k);
+			for(int i=0; i<BLOCK; ++i) out[i] += gain * samples[i];
+		}
+	}
+
+	void operator()(){
+		io.zeroOut();
+		for(unsigned s=0; s<sources.size(); ++s){
+			if(move){
+				double a = 1e-4 * (s+1);
+				double c = cos(a), d = sin(a);
+				Vec3d& p = relpos[s];
+				p = Vec3d(c*p.x - d*p.z, p.y, d*p.x + c*p.z);
+			}
+			if(uncached)	performUncached(relpos[s]);
+			else			panner.perform(io, sources[s], relpos[s], BLOCK, &samples[0]);
+		}
+		b.sink(io.out(0,0));
+	}
+};
+
+}
+
+void bmSoundAudioScene(Bench& b){
+	{
+		Pan p(500, false, b);
+		p.uncached = true;
+		b.run("sound/Dbap/54x500uncached", p);
+	}
+	{
+		Pan p(500, false, b);
+		b.run("sound/Dbap/54x500static", p);
+	}
+	{
+		Pan p(500, true, b);
+		b.run("sound/Dbap/54x500moving", p);
+	}
+	{
+		Pan p(500, false, b);
+		p.panner.setGainThreshold(0.05);
+		b.run("sound/Dbap/54x500threshold", p);
+	}
+
+	{
+		Render r(16, b);
+		b.run("sound/AudioScene/render16", r);
+	}
+	{
+		Render r(16, b);
+		r.scene.usePerSampleProcessing(true);
+		b.run("sound/AudioScene/render16PerSample", r);
+	}
+	{
+		Ambient a(1000, b);
+		a.scene.cullLevel(-1);
+		b.run("sound/AudioScene/render1000ambientNoCull", a);
+	}
+	{
+		Ambient a(1000, b);
+		b.run("sound/AudioScene/render1000ambient", a);
+	}
+	{
+		Ambient a(1000, b);
+		a.scene.lodDistance(40);
+		b.run("sound/AudioScene/render1000ambientLod", a);
+	}
+	{
+		Ambient a(1000, b);
+		a.scene.compactDelays(44100);
+		b.run("sound/AudioScene/render1000ambientCompact", a);
+	}
+	{
+		Ambient a(1000, b);
+		a.scene.compactDelays(44100, true);
+		b.run("sound/AudioScene/render1000ambientHalf", a);
+	}
+	{
+		Render r(16, b, 2);
+		b.run("sound/AudioScene/render16x2", r);
+	}
+	{
+		TaskPool pool(2);
+		Render r(16, b, 2);
+		r.scene.parallel(&pool);
+		b.run("sound/AudioScene/render16x2parallel", r);
+	}
+}
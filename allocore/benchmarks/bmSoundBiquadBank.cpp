@@ -0,0 +1,98 @@
+#include <math.h>
+#include <vector>
+#include "bmAllocore.h"
+#include "allocore/sound/al_Crossover.hpp"
+
+namespace{
+
+enum{ CHANS=60, BLOCK=256 };
+
+// Double precision biquad in direct form I, one channel at a time, as bass
+// management was done before the bank
+struct Scalar{
+	double a0,a1,a2,b1,b2, x1,x2,y1,y2;
+	Scalar(const BiquadBank::Coefs& c)
+	:	a0(c.b0), a1(c.b1), a2(c.b2), b1(c.a1), b2(c.a2), x1(0),x2(0),y1(0),y2(0){}
+	void operator()(const double * in, double * out, int n){
+		for(int i=0; i<n; ++i){
+			out[i] = a0*in[i] + a1*x1 + a2*x2 - b1*y1 - b2*y2;
+			x2 = x1; x1 = in[i];
+			y2 = y1; y1 = out[i];
+		}
+	}
+};
+
+// Splits 60 channels into Linkwitz-Riley low and high bands
+struct Split{
+	std::vector<float> buf, low;
+	std::vector<float *> pbuf, plow;
+	Bench& b;
+
+	Split(Bench& b_): buf(CHANS*BLOCK), low(CHANS*BLOCK), pbuf(CHANS), plow(CHANS), b(b_){
+		for(int c=0; c<CHANS; ++c){
+			pbuf[c] = &buf[c*BLOCK];
+			plow[c] = &low[c*BLOCK];
+			for(int i=0; i<BLOCK; ++i) buf[c*BLOCK+i] = sin(0.01f * i * (c+1));
+		}
+	}
+};
+
+struct SplitScalar : Split{
+	std::vector<Scalar> filters;
+	std::vector<double> in, tmp, out;
+
+	SplitScalar(Bench& b_): Split(b_), in(BLOCK), tmp(BLOCK), out(BLOCK){
+		for(int c=0; c<CHANS; ++c){
+			for(int k=0; k<2; ++k) filters.push_back(Scalar(BiquadBank::Coefs::lowPass(150, 44100)));
+			for(int k=0; k<2; ++k) filters.push_back(Scalar(BiquadBank::Coefs::highPass(150, 44100)));
+		}
+	}
+
+	void operator()(){
+		for(int c=0; c<CHANS; ++c){
+			Scalar * f = &filters[c*4];
+			for(int i=0; i<BLOCK; ++i) in[i] = pbuf[c][i];
+			f[0](&in[0], &tmp[0], BLOCK);
+			f[1](&tmp[0], &out[0], BLOCK);
+			for(int i=0; i<BLOCK; ++i) plow[c][i] = out[i];
+			f[2](&in[0], &tmp[0], BLOCK);
+			f[3](&tmp[0], &out[0], BLOCK);
+			for(int i=0; i<BLOCK; ++i) pbuf[c][i] = out[i];
+		}
+		b.sink(buf[0]);
+	}
+};
+
+struct SplitBank : Split{
+	CrossoverBank xo;
+	bool glide;
+	int count;
+
+	SplitBank(Bench& b_, bool glide_): Split(b_), xo(CHANS, 150, 44100), glide(glide_), count(0){
+		xo.smooth(BLOCK*4);
+	}
+
+	void operator()(){
+		// keep the filters gliding between two frequencies
+		if(glide && (++count & 3) == 0) xo.freq(count & 4 ? 100 : 150, 44100);
+		xo.process(&plow[0], &pbuf[0], &pbuf[0], BLOCK);
+		b.sink(buf[0]);
+	}
+};
+
+}
+
+void bmSoundBiquadBank(Bench& b){
+	{
+		SplitScalar s(b);
+		b.run("sound/BiquadBank/crossover60scalar", s);
+	}
+	{
+		SplitBank s(b, false);
+		b.run("sound/BiquadBank/crossover60", s);
+	}
+	{
+		SplitBank s(b, true);
+		b.run("sound/BiquadBank/crossover60gliding", s);
+	}
+}
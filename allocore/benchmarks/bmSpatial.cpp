@@ -0,0 +1,56 @@
+#include "bmAllocore.h"
+#include "allocore/math/al_Random.hpp"
+#include "allocore/spatial/al_HashSpace.hpp"
+
+namespace{
+
+const int numObjects = 1000;
+
+struct Move{
+	HashSpace& space;
+	std::vector<Vec3d> pos;
+	int i;
+	Move(HashSpace& s): space(s), pos(numObjects), i(0){
+		rnd::Random<> rng(1);
+		for(int k=0; k<numObjects; ++k){
+			pos[k] = Vec3d(rng.uniform(), rng.uniform(), rng.uniform()) * space.dim();
+		}
+	}
+	void operator()(){
+		// Move every object, as done when updating a simulation step
+		for(int k=0; k<numObjects; ++k){
+			int j = (k+i) % numObjects;
+			space.move(k, pos[j]);
+		}
+		++i;
+	}
+};
+
+struct Query{
+	HashSpace& space;
+	HashSpace::Query qmany;
+	double radius;
+	int i;
+	Bench& b;
+	Query(HashSpace& s, double r, Bench& b_): space(s), qmany(500), radius(r), i(0), b(b_){}
+	void operator()(){
+		qmany.clear();
+		const HashSpace::Object * o = &space.object(i);
+		b.sink(qmany(space, o->pos, radius));
+		i = (i+1) % numObjects;
+	}
+};
+
+}
+
+void bmSpatial(Bench& b){
+	HashSpace space(6, numObjects);
+	Move move(space);
+	b.run("spatial/HashSpace/move1000", move);
+
+	move();
+	Query qnear(space, space.maxRadius()*0.1, b);
+	b.run("spatial/HashSpace/queryNear", qnear);
+	Query qfar(space, space.maxRadius()*0.5, b);
+	b.run("spatial/HashSpace/queryFar", qfar);
+}
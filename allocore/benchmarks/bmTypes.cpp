@@ -0,0 +1,30 @@
+#include "bmAllocore.h"
+#include "allocore/types/al_MsgQueue.hpp"
+
+namespace{
+
+float gAccum = 0;
+void msgFunc(al_sec t, float v){ gAccum += v; }
+
+struct SendUpdate{
+	MsgQueue q;
+	al_sec now;
+	Bench& b;
+	SendUpdate(Bench& b_): q(256), now(0), b(b_){}
+	void operator()(){
+		// Schedule a block of out-of-order messages, then dispatch them
+		for(int i=0; i<64; ++i){
+			q.send(now + ((i*37)&63)*0.001, msgFunc, float(i));
+		}
+		now += 0.064;
+		q.update(now);
+		b.sink(gAccum);
+	}
+};
+
+}
+
+void bmTypes(Bench& b){
+	SendUpdate su(b);
+	b.run("types/MsgQueue/sendUpdate64", su);
+}
@@ -0,0 +1,104 @@
+/*
+Allocore Example: Mesh Cache
+
+Description:
+This draws a large static mesh and a smaller mesh that changes every frame
+from GPU buffers kept by a MeshCache. The static mesh is uploaded once; the
+changing mesh is added with streaming usage so its storage is orphaned and
+refilled each frame.
+
+Press 'c' to toggle between drawing from the cache and from client memory.
+The number of bytes sent per frame is printed every second.
+*/
+
+#include <stdio.h>
+#include "allocore/al_Allocore.hpp"
+using namespace al;
+
+
+// Bytes Graphics::draw sends from client memory for a mesh
+int clientBytes(const Mesh& m){
+	return	m.vertices().size()*sizeof(Mesh::Vertex)
+		+	m.normals().size()*sizeof(Mesh::Normal)
+		+	m.colors().size()*sizeof(Color)
+		+	m.indices().size()*sizeof(Mesh::Index);
+}
+
+
+class MyApp : public App {
+public:
+
+	Mesh shapes;
+	Mesh wave;
+	MeshCache cache;
+	Light light;
+	Material material;
+	double phase;
+	int frames;
+	double clientBytesSent;
+	bool useCache;
+
+	MyApp(): phase(0), frames(0), clientBytesSent(0), useCache(true){
+
+		for(int i=0; i<4000; ++i){
+			int Nv = rnd::prob(0.5) ? addCube(shapes) : addIcosahedron(shapes);
+			Mat4f xfm;
+			xfm.setIdentity();
+			xfm.scale(Vec3f(rnd::uniform(0.5,0.1)));
+			xfm.translate(Vec3f(rnd::uniformS(8.), rnd::uniformS(8.), rnd::uniformS(8.)));
+			shapes.transform(xfm, shapes.vertices().size()-Nv);
+			for(int i=0; i<Nv; ++i) shapes.color(HSV(float(i)/Nv*0.1+0.5,1,1));
+		}
+		shapes.decompress();
+		shapes.generateNormals();
+
+		wave.primitive(Graphics::LINE_STRIP);
+		for(int i=0; i<2000; ++i){
+			wave.vertex(0,0,0);
+			wave.color(1,1,1);
+		}
+
+		cache.add(shapes);
+		cache.add(wave, BufferObject::STREAM_DRAW);
+
+		nav().pos(0,0,24);
+		initWindow();
+	}
+
+	void onAnimate(double dt){
+		phase += dt;
+		for(int i=0; i<wave.vertices().size(); ++i){
+			float t = float(i)/wave.vertices().size();
+			wave.vertices()[i].set(16*t - 8, sin(t*40 + phase*4), 9);
+		}
+		cache.modified(wave);
+
+		if(++frames == 40){
+			double bytes = useCache ? cache.bytesUploaded() : clientBytesSent;
+			printf("%s: %.1f kB sent per frame\n",
+				useCache ? "cache" : "client", bytes/1024./frames);
+			cache.resetStats();
+			clientBytesSent = 0;
+			frames = 0;
+		}
+	}
+
+	void onDraw(Graphics& g){
+		g.meshCache(useCache ? &cache : 0);
+		material();
+		light();
+		g.draw(shapes);
+		g.lighting(false);
+		g.draw(wave);
+		g.meshCache(0);
+		if(!useCache) clientBytesSent += clientBytes(shapes) + clientBytes(wave);
+	}
+
+	void onKeyDown(const ViewpointWindow& w, const Keyboard& k){
+		if(k.key() == 'c') useCache ^= true;
+	}
+};
+
+int main(){
+	MyApp().start();
+}
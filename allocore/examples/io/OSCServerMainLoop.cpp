@@ -0,0 +1,54 @@
+/*
+Allocore Example: OSC Server in the main loop
+
+Description:
+This is an OSC server that handles packets from the main loop rather than
+from a background thread. The main loop uses the native driver, which on
+Linux waits on the socket together with its tick timer, so packets are
+handled as soon as they arrive instead of at the next tick or socket timeout.
+
+You should run the OSC client example AFTER running this program.
+*/
+
+#include <iostream>
+#include <string>
+#include "allocore/protocol/al_OSC.hpp"
+#include "allocore/system/al_MainLoop.hpp"
+using namespace al;
+
+class MyServer : public osc::PacketHandler, public Main::FDHandler{
+public:
+
+	osc::Recv server;
+
+	MyServer()
+		// The socket never blocks, since we only read once data is available
+	:	server(16447, "", 0)
+	{
+		server.handler(*this);
+
+		// Register the socket with the main loop so onReadable gets called
+		Main::get().add(server.fileDescriptor(), *this);
+	}
+
+	// This gets called whenever the socket has data
+	void onReadable(int fd){
+		while(server.recv()){}
+	}
+
+	// This gets called whenever we receive a packet
+	void onMessage(osc::Message& m){
+		if(m.addressPattern() == "/test" && m.typeTags() == "si"){
+			std::string str;
+			int val;
+			m >> str >> val;
+			std::cout << "SERVER: recv " << str << " " << val << "\n";
+		}
+	}
+};
+
+
+int main(){
+	MyServer server;
+	Main::get().driver(Main::NATIVE).interval(1./60).start();
+}
@@ -0,0 +1,59 @@
+/*
+Allocore Example: Offline Render
+
+Description:
+Renders ten minutes of a sequence of notes to "offlineRender.wav" as fast as
+the processor allows. The notes are scheduled on a message queue that the
+audio stream advances in sample time, so every render of the sequence is
+identical no matter how long it takes.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include "allocore/al_Allocore.hpp"
+using namespace al;
+
+struct Synth{
+	MsgQueue queue;
+	double phase, freq;
+	float amp;
+	Synth(int notes): queue(notes), phase(0), freq(220), amp(0){}
+
+	static void note(al_sec t, Synth * s, double freq){
+		s->freq = freq;
+		s->amp = 0.2;
+	}
+};
+
+void audioCB(AudioIOData& io){
+	Synth& s = io.user<Synth>();
+	while(io()){
+		s.phase += s.freq / io.fps();
+		if(s.phase >= 1) s.phase -= 1;
+		float v = sin(s.phase * M_2PI) * s.amp;
+		s.amp *= 0.99995;
+		io.out(0) = io.out(1) = v;
+	}
+}
+
+int main(){
+	const double length = 600;
+	const int notes = length*4;
+
+	Synth synth(notes);
+	for(int i=0; i<notes; ++i){
+		synth.queue.send(i*0.25, Synth::note, &synth, 220. * pow(2., (i*7 % 12)/12.));
+	}
+
+	AudioIO io(256, 48000, audioCB, &synth, 2, 0, AudioIO::OFFLINE);
+	io.timebase(&synth.queue);
+	io.outputFile("offlineRender.wav").renderLength(length);
+
+	Timer timer;
+	timer.start();
+	io.start();
+	io.waitForRender();
+	timer.stop();
+
+	printf("Rendered %g s of audio in %g s\n", io.time(), timer.elapsedSec());
+}
@@ -4,10 +4,12 @@ find_package(APR QUIET)
 set(APR_HEADERS
     allocore/io/al_File.hpp
     allocore/io/al_Socket.hpp
+    allocore/protocol/al_PointCloud.hpp
     allocore/protocol/al_XML.hpp
     allocore/system/al_Memory.hpp
     allocore/system/al_Time.h
     allocore/system/al_Time.hpp
+    allocore/system/al_Trace.hpp
 )
 
 if(APR_LIBRARY AND APR_INCLUDE_DIR)
@@ -17,9 +19,15 @@ list(APPEND ALLOCORE_SRC
     src/io/al_File.cpp
     src/io/al_FileAPR.cpp
     src/io/al_SocketAPR.cpp
+    src/protocol/al_PointCloud.cpp
     src/protocol/al_XML.cpp
     src/system/al_Memory.cpp
-    src/system/al_Time.cpp)
+    src/system/al_Time.cpp
+    src/system/al_Trace.cpp)
+
+if(ALLOCORE_TRACE)
+  add_definitions(-DAL_TRACE)
+endif()
 
 list(APPEND ALLOCORE_HEADERS ${APR_HEADERS})
 
@@ -33,6 +41,9 @@ list(APPEND ALLOCORE_LINK_LIBRARIES
 
 else()
     message("NOT Building APR module.")
+    if(ALLOCORE_TRACE)
+      message("NOT compiling trace zones (requires APR module).")
+    endif()
     foreach(header ${APR_HEADERS})
         list(APPEND APR_DUMMY_HEADER_INFO "${header}::::APR")
     endforeach()
@@ -11,6 +11,7 @@ set(GL_HEADERS
     allocore/graphics/al_Isosurface.hpp
     allocore/graphics/al_Lens.hpp
     allocore/graphics/al_Light.hpp
+    allocore/graphics/al_MeshCache.hpp
     allocore/graphics/al_OpenGL.hpp
     allocore/graphics/al_Shader.hpp
     allocore/graphics/al_Slab.hpp
@@ -33,6 +34,7 @@ list(APPEND ALLOCORE_SRC
   src/graphics/al_Lens.cpp
   src/graphics/al_Light.cpp
   src/graphics/al_Mesh.cpp
+  src/graphics/al_MeshCache.cpp
   src/graphics/al_Shader.cpp
   src/graphics/al_Shapes.cpp
   src/graphics/al_Stereographic.cpp
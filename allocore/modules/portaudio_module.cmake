@@ -3,8 +3,10 @@ find_package(Portaudio QUIET)
 
 set(PORTAUDIO_HEADERS
     allocore/io/al_AudioIO.hpp
+    allocore/io/al_SoundFile.hpp
     allocore/sound/al_Ambisonics.hpp
     allocore/sound/al_AudioScene.hpp
+    allocore/sound/al_BiquadBank.hpp
     allocore/sound/al_Crossover.hpp
     allocore/sound/al_Dbap.hpp
     allocore/sound/al_Reverb.hpp
@@ -34,8 +36,10 @@ endif()
 
 list(APPEND ALLOCORE_SRC
     src/io/al_AudioIO.cpp
+    src/io/al_SoundFile.cpp
 	src/sound/al_AudioScene.cpp
     src/sound/al_Ambisonics.cpp
+    src/sound/al_BiquadBank.cpp
     src/sound/al_Dbap.cpp
     src/sound/al_Vbap.cpp
 )
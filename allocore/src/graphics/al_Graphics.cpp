@@ -6,10 +6,11 @@
 #include "allocore/system/al_Printing.hpp"
 #include "allocore/types/al_Array.hpp"
 #include "allocore/graphics/al_Graphics.hpp"
+#include "allocore/graphics/al_MeshCache.hpp"
 
 namespace al{
 
-Graphics::Graphics() : mInImmediateMode(false) {}
+Graphics::Graphics() : mInImmediateMode(false), mMeshCache(0) {}
 Graphics::~Graphics() {}
 
 
@@ -212,6 +213,8 @@ void Graphics::draw(int num_vertices, const Mesh& m){
 
 void Graphics::draw(const Mesh& v, int count, int begin){
 
+	if(mMeshCache && mMeshCache->draw(v, count, begin)) return;
+
 	const int Nv = v.vertices().size();
 	if(0 == Nv) return; // nothing to draw, so just return...
 
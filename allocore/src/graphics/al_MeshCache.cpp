@@ -0,0 +1,296 @@
+#include "allocore/graphics/al_MeshCache.hpp"
+
+namespace al{
+
+namespace{
+
+// GL type of a vertex format
+GLenum glType(VertexLayout::Format f){
+	switch(f){
+#ifdef GL_HALF_FLOAT
+	case VertexLayout::FLOAT16:	return GL_HALF_FLOAT;
+#endif
+	case VertexLayout::SNORM16:	return GL_SHORT;
+	case VertexLayout::UNORM16:	return GL_UNSIGNED_SHORT;
+	case VertexLayout::SNORM8:	return GL_BYTE;
+	case VertexLayout::UNORM8:	return GL_UNSIGNED_BYTE;
+	default:					return GL_FLOAT;
+	}
+}
+
+// Byte offset into the bound buffer, as a pointer
+const GLvoid * at(int offset){ return (const char *)0 + offset; }
+
+} // anonymous
+
+
+
+MeshCache::Entry::Entry(const VertexLayout& l, Usage u)
+:	packer(l), usage(u), vbo(0), ebo(0), vboSize(0), eboSize(0), numIndices(0),
+	version(1), uploaded(0), begin(0), end(0), all(true)
+{}
+
+
+
+MeshCache::MeshCache(const VertexLayout& layout)
+:	mLayout(layout), mUploads(0), mBytesUploaded(0)
+{
+	for(int a=0; a<VertexLayout::NUM_ATTRIBUTES; ++a){
+		VertexLayout::Attribute attr = VertexLayout::Attribute(a);
+		if(!supported(attr, mLayout.format(attr))){
+			mLayout.format(attr, VertexLayout::FLOAT32);
+		}
+	}
+}
+
+MeshCache::~MeshCache(){
+	destroy();
+}
+
+bool MeshCache::supported(VertexLayout::Attribute a, VertexLayout::Format f){
+	typedef VertexLayout VL;
+	#ifndef GL_HALF_FLOAT
+	if(VL::FLOAT16 == f) return false;
+	#endif
+	switch(a){
+	// Positions must be stored. glVertexPointer does not normalize, so
+	// only signed shorts can be rescaled by the modelview matrix.
+	case VL::POSITION:	return VL::FLOAT32 == f || VL::FLOAT16 == f || VL::SNORM16 == f;
+	case VL::NORMAL:	return f != VL::UNORM16 && f != VL::UNORM8;
+	case VL::TEXCOORD:	return f <= VL::FLOAT16;
+	default:			return true;
+	}
+}
+
+MeshCache& MeshCache::add(const Mesh& m, Usage usage){
+	Entries::iterator it = mEntries.find(&m);
+	if(it == mEntries.end()){
+		mEntries.insert(std::make_pair(&m, Entry(mLayout, usage)));
+	}
+	else if(it->second.usage != usage){
+		it->second.usage = usage;
+		it->second.all = true;
+		++it->second.version;
+	}
+	return *this;
+}
+
+MeshCache& MeshCache::remove(const Mesh& m){
+	Entries::iterator it = mEntries.find(&m);
+	if(it != mEntries.end()){
+		release(it->second);
+		mEntries.erase(it);
+	}
+	return *this;
+}
+
+MeshCache& MeshCache::clear(){
+	for(Entries::iterator it = mEntries.begin(); it != mEntries.end(); ++it){
+		release(it->second);
+	}
+	mEntries.clear();
+	return *this;
+}
+
+MeshCache& MeshCache::modified(const Mesh& m, int begin, int end){
+	Entries::iterator it = mEntries.find(&m);
+	if(it == mEntries.end()) return *this;
+	Entry& e = it->second;
+	++e.version;
+
+	if(0 == begin && -1 == end){
+		e.all = true;
+		return *this;
+	}
+
+	const int Nv = m.vertices().size();
+	if(end < 0) end += Nv+1;
+	if(begin < 0) begin = 0;
+	if(begin >= end) return *this;
+
+	if(e.end <= e.begin){
+		e.begin = begin;
+		e.end = end;
+	}
+	else{
+		if(begin < e.begin) e.begin = begin;
+		if(end > e.end) e.end = end;
+	}
+	return *this;
+}
+
+unsigned MeshCache::version(const Mesh& m) const {
+	Entries::const_iterator it = mEntries.find(&m);
+	return it != mEntries.end() ? it->second.version : 0;
+}
+
+void MeshCache::update(const Mesh& m, Entry& e){
+	const int Nv = m.vertices().size();
+	const int Ni = m.indices().size();
+
+	if(!e.vbo || Nv != e.packer.numVertices() || Ni != e.numIndices){
+		e.all = true;
+	}
+	else if(e.uploaded == e.version){
+		return;
+	}
+
+	// Vertices
+	if(e.all)					e.packer.pack(m);
+	else if(e.end > e.begin)	e.packer.repack(m, e.begin, e.end);
+
+	if(!e.vbo) glGenBuffers(1, (GLuint *)&e.vbo);
+
+	if(e.packer.dirty()){
+		const int size = e.packer.size();
+		glBindBuffer(GL_ARRAY_BUFFER, e.vbo);
+
+		// Orphan the old storage when all of it changes, so the driver can
+		// hand out fresh memory rather than wait for pending draws
+		if(	size != e.vboSize || BufferObject::STREAM_DRAW == e.usage
+			|| (0 == e.packer.dirtyBegin() && size == e.packer.dirtyEnd())
+		){
+			glBufferData(GL_ARRAY_BUFFER, size, 0, e.usage);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, size, e.packer.data());
+			e.vboSize = size;
+			mBytesUploaded += size;
+		}
+		else{
+			const int b = e.packer.dirtyBegin();
+			const int n = e.packer.dirtyEnd() - b;
+			glBufferSubData(GL_ARRAY_BUFFER, b, n, e.packer.data() + b);
+			mBytesUploaded += n;
+		}
+		++mUploads;
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		e.packer.clean();
+	}
+
+	// Indices
+	if(e.all && Ni){
+		const int size = Ni * sizeof(Mesh::Index);
+		if(!e.ebo) glGenBuffers(1, (GLuint *)&e.ebo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, e.ebo);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, 0, e.usage);
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, size, &m.indices()[0]);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		e.eboSize = size;
+		mBytesUploaded += size;
+		++mUploads;
+	}
+
+	e.numIndices = Ni;
+	e.all = false;
+	e.begin = e.end = 0;
+	e.uploaded = e.version;
+}
+
+bool MeshCache::draw(const Mesh& m, int count, int begin){
+	typedef VertexLayout VL;
+
+	Entries::iterator it = mEntries.find(&m);
+	if(it == mEntries.end()) return false;
+	Entry& e = it->second;
+
+	const int Nv = m.vertices().size();
+	if(0 == Nv) return true;
+
+	const int Ni = m.indices().size();
+	const int Nmax = Ni ? Ni : Nv;
+
+	// Same range handling as Graphics::draw
+	if(count < 0) count += Nmax+1;
+	if(begin < 0) begin += Nmax+1;
+	if(begin >= Nmax) return true;
+	if(begin + count > Nmax) count = Nmax - begin;
+
+	validate();
+	update(m, e);
+
+	const VL& l = e.packer.layout();
+	const int stride = l.stride();
+
+	glBindBuffer(GL_ARRAY_BUFFER, e.vbo);
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(3, glType(l.format(VL::POSITION)), stride, at(l.offset(VL::POSITION)));
+
+	if(l.has(VL::NORMAL)){
+		glEnableClientState(GL_NORMAL_ARRAY);
+		glNormalPointer(glType(l.format(VL::NORMAL)), stride, at(l.offset(VL::NORMAL)));
+	}
+
+	if(l.has(VL::COLOR)){
+		glEnableClientState(GL_COLOR_ARRAY);
+		glColorPointer(4, glType(l.format(VL::COLOR)), stride, at(l.offset(VL::COLOR)));
+	}
+
+	if(l.has(VL::TEXCOORD)){
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glTexCoordPointer(l.components(VL::TEXCOORD), glType(l.format(VL::TEXCOORD)), stride, at(l.offset(VL::TEXCOORD)));
+	}
+
+	// Normalized positions are mapped back to mesh space. The scale is
+	// uniform, so normals only need their length restored.
+	const bool mapped = l.normalized(VL::POSITION);
+	GLint matrixMode = GL_MODELVIEW;
+	GLboolean rescale = GL_TRUE;
+	if(mapped){
+		if(l.has(VL::NORMAL)){
+			rescale = glIsEnabled(GL_RESCALE_NORMAL);
+			if(!rescale) glEnable(GL_RESCALE_NORMAL);
+		}
+		Vec3f offset = l.positionOffset();
+		Vec3f scale = l.positionScale() / 32767.f;
+		glGetIntegerv(GL_MATRIX_MODE, &matrixMode);
+		glMatrixMode(GL_MODELVIEW);
+		glPushMatrix();
+		glTranslatef(offset[0], offset[1], offset[2]);
+		glScalef(scale[0], scale[1], scale[2]);
+	}
+
+	if(Ni){
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, e.ebo);
+		glDrawElements(m.primitive(), count, GL_UNSIGNED_INT, at(begin * sizeof(Mesh::Index)));
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+	else{
+		glDrawArrays(m.primitive(), begin, count);
+	}
+
+	if(mapped){
+		glPopMatrix();
+		glMatrixMode(matrixMode);
+		if(!rescale) glDisable(GL_RESCALE_NORMAL);
+	}
+
+								glDisableClientState(GL_VERTEX_ARRAY);
+	if(l.has(VL::NORMAL))		glDisableClientState(GL_NORMAL_ARRAY);
+	if(l.has(VL::COLOR))		glDisableClientState(GL_COLOR_ARRAY);
+	if(l.has(VL::TEXCOORD))		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	return true;
+}
+
+void MeshCache::release(Entry& e){
+	if(e.vbo) glDeleteBuffers(1, (GLuint *)&e.vbo);
+	if(e.ebo) glDeleteBuffers(1, (GLuint *)&e.ebo);
+	e.vbo = e.ebo = 0;
+	e.vboSize = e.eboSize = 0;
+	e.all = true;
+	++e.version;
+}
+
+void MeshCache::onCreate(){
+	// Buffers are made per mesh as needed; the ID only marks the cache live
+	mID = 1;
+}
+
+void MeshCache::onDestroy(){
+	for(Entries::iterator it = mEntries.begin(); it != mEntries.end(); ++it){
+		release(it->second);
+	}
+}
+
+} // al::
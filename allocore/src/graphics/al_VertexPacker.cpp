@@ -0,0 +1,339 @@
+#include <string.h>
+#include "allocore/graphics/al_VertexPacker.hpp"
+#include "allocore/types/al_Conversion.hpp"
+
+namespace al{
+
+namespace{
+
+// Default number of components of each attribute
+const int kDefaultComponents[VertexLayout::NUM_ATTRIBUTES] = {3, 3, 4, 2};
+
+// 64-bit FNV-1a
+const uint64_t kHashBasis = 14695981039346656037ULL;
+
+uint64_t hash(uint64_t h, const void * data, size_t size){
+	const unsigned char * p = (const unsigned char *)data;
+	for(size_t i=0; i<size; ++i){
+		h ^= p[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+template <class T>
+uint64_t hash(uint64_t h, const T& v){ return hash(h, &v, sizeof v); }
+
+// Round to nearest integer, halfway cases away from zero
+int roundInt(float v){ return int(v < 0.f ? v - 0.5f : v + 0.5f); }
+
+float clip(float v, float lo, float hi){ return v < lo ? lo : (v > hi ? hi : v); }
+
+// Write component i of an attribute in format f
+void put(char * dst, VertexLayout::Format f, int i, float v){
+	switch(f){
+	case VertexLayout::FLOAT32: memcpy(dst + 4*i, &v, 4); break;
+	case VertexLayout::FLOAT16:{
+		uint16_t h = floatToHalf(v);
+		memcpy(dst + 2*i, &h, 2);
+		} break;
+	case VertexLayout::SNORM16:{
+		int16_t s = roundInt(clip(v, -1.f, 1.f) * 32767.f);
+		memcpy(dst + 2*i, &s, 2);
+		} break;
+	case VertexLayout::UNORM16:{
+		uint16_t u = roundInt(clip(v, 0.f, 1.f) * 65535.f);
+		memcpy(dst + 2*i, &u, 2);
+		} break;
+	case VertexLayout::SNORM8: ((int8_t *)dst)[i] = roundInt(clip(v, -1.f, 1.f) * 127.f); break;
+	case VertexLayout::UNORM8: ((uint8_t *)dst)[i] = roundInt(clip(v, 0.f, 1.f) * 255.f); break;
+	default:;
+	}
+}
+
+} // anonymous
+
+
+
+VertexLayout::VertexLayout()
+:	mStride(0), mLo(-1), mHi(1), mAutoBounds(true)
+{
+	for(int a=0; a<NUM_ATTRIBUTES; ++a) mFormats[a] = FLOAT32;
+	place(kDefaultComponents);
+}
+
+VertexLayout VertexLayout::compact(){
+	VertexLayout v;
+	v.format(POSITION, SNORM16);
+	v.format(NORMAL, SNORM8);
+	v.format(COLOR, UNORM8);
+	v.format(TEXCOORD, FLOAT16);
+	return v;
+}
+
+VertexLayout& VertexLayout::format(Attribute a, Format f){
+	mFormats[a] = f;
+	int comps[NUM_ATTRIBUTES];
+	for(int i=0; i<NUM_ATTRIBUTES; ++i){
+		comps[i] = mComponents[i] ? mComponents[i] : kDefaultComponents[i];
+	}
+	place(comps);
+	return *this;
+}
+
+VertexLayout& VertexLayout::bounds(const Vec3f& lo, const Vec3f& hi){
+	mLo = lo;
+	mHi = hi;
+	mAutoBounds = false;
+	return *this;
+}
+
+VertexLayout& VertexLayout::autoBounds(){
+	mAutoBounds = true;
+	return *this;
+}
+
+void VertexLayout::place(const int * components){
+	int offset = 0;
+	for(int a=0; a<NUM_ATTRIBUTES; ++a){
+		if(NONE != mFormats[a] && components[a] > 0){
+			mComponents[a] = components[a];
+			mOffsets[a] = offset;
+			offset += (components[a] * formatSize(mFormats[a]) + 3) & ~3;
+		}
+		else{
+			mComponents[a] = 0;
+			mOffsets[a] = 0;
+		}
+	}
+	mStride = offset;
+}
+
+Vec3f VertexLayout::positionOffset() const {
+	switch(mFormats[POSITION]){
+	case SNORM16: case SNORM8:	return (mLo + mHi) * 0.5f;
+	case UNORM16: case UNORM8:	return mLo;
+	default:					return Vec3f(0);
+	}
+}
+
+Vec3f VertexLayout::positionScale() const {
+	// Same along all axes, so that mapping back does not bend normals
+	Vec3f d = mHi - mLo;
+	float s = d[0] > d[1] ? d[0] : d[1];
+	if(d[2] > s) s = d[2];
+	switch(mFormats[POSITION]){
+	case SNORM16: case SNORM8:	return Vec3f(s * 0.5f);
+	case UNORM16: case UNORM8:	return Vec3f(s);
+	default:					return Vec3f(1);
+	}
+}
+
+int VertexLayout::formatSize(Format f){
+	switch(f){
+	case FLOAT32:					return 4;
+	case FLOAT16: case SNORM16:
+	case UNORM16:					return 2;
+	case SNORM8: case UNORM8:		return 1;
+	default:						return 0;
+	}
+}
+
+uint64_t VertexLayout::key() const {
+	uint64_t h = kHashBasis;
+	for(int a=0; a<NUM_ATTRIBUTES; ++a){
+		h = hash(h, int32_t(mFormats[a]));
+		h = hash(h, int32_t(mComponents[a]));
+		h = hash(h, int32_t(mOffsets[a]));
+	}
+	h = hash(h, int32_t(mStride));
+	if(normalized(POSITION)){
+		for(int i=0; i<3; ++i){
+			h = hash(h, mLo[i]);
+			h = hash(h, mHi[i]);
+		}
+		h = hash(h, int32_t(mAutoBounds));
+	}
+	return h;
+}
+
+bool VertexLayout::operator==(const VertexLayout& v) const {
+	for(int a=0; a<NUM_ATTRIBUTES; ++a){
+		if(	mFormats[a] != v.mFormats[a]
+			|| mComponents[a] != v.mComponents[a]
+			|| mOffsets[a] != v.mOffsets[a]
+		) return false;
+	}
+	if(mStride != v.mStride) return false;
+	if(normalized(POSITION)){
+		return mLo == v.mLo && mHi == v.mHi && mAutoBounds == v.mAutoBounds;
+	}
+	return true;
+}
+
+
+
+VertexPacker::VertexPacker(const VertexLayout& request)
+:	mRequest(request), mLayout(request), mNumVertices(0),
+	mDirtyBegin(0), mDirtyEnd(0), mKey(0), mKeyValid(false)
+{}
+
+VertexLayout VertexPacker::resolve(const Mesh& m) const {
+	typedef VertexLayout VL;
+	VertexLayout l = mRequest;
+	const int Nv = m.vertices().size();
+	int comps[VL::NUM_ATTRIBUTES] = {0};
+
+	comps[VL::POSITION] = 3;
+	if(Nv){
+		if(m.normals().size() >= Nv) comps[VL::NORMAL] = 3;
+		if(m.colors().size() || m.coloris().size()) comps[VL::COLOR] = 4;
+		if(m.texCoord3s().size() >= Nv) comps[VL::TEXCOORD] = 3;
+		else if(m.texCoord2s().size() >= Nv) comps[VL::TEXCOORD] = 2;
+	}
+	l.place(comps);
+	return l;
+}
+
+void VertexPacker::pack(const Mesh& m){
+	mLayout = resolve(m);
+	mNumVertices = m.vertices().size();
+
+	if(mLayout.normalized(VertexLayout::POSITION) && mLayout.mAutoBounds && mNumVertices){
+		Vec3f& lo = mLayout.mLo;
+		Vec3f& hi = mLayout.mHi;
+		lo = hi = m.vertices()[0];
+		for(int i=1; i<mNumVertices; ++i){
+			const Vec3f& p = m.vertices()[i];
+			for(int k=0; k<3; ++k){
+				if(p[k] < lo[k]) lo[k] = p[k];
+				else if(p[k] > hi[k]) hi[k] = p[k];
+			}
+		}
+	}
+
+	mData.assign(mNumVertices * mLayout.stride(), 0);
+	packRange(m, 0, mNumVertices);
+
+	// everything may have moved
+	mDirtyBegin = 0;
+	mDirtyEnd = size();
+	mKeyValid = false;
+}
+
+void VertexPacker::repack(const Mesh& m, int begin, int end){
+	const int Nv = m.vertices().size();
+	if(end < 0) end += Nv+1;
+	if(begin < 0) begin = 0;
+	if(end > Nv) end = Nv;
+
+	// Must the layout change?
+	VertexLayout l = resolve(m);
+	if(l.mAutoBounds){
+		l.mLo = mLayout.mLo;
+		l.mHi = mLayout.mHi;
+	}
+	bool full = Nv != mNumVertices || l != mLayout;
+
+	if(!full && mLayout.normalized(VertexLayout::POSITION) && mLayout.mAutoBounds){
+		const Vec3f& lo = mLayout.mLo;
+		const Vec3f& hi = mLayout.mHi;
+		for(int i=begin; i<end && !full; ++i){
+			const Vec3f& p = m.vertices()[i];
+			full =	p[0] < lo[0] || p[1] < lo[1] || p[2] < lo[2] ||
+					p[0] > hi[0] || p[1] > hi[1] || p[2] > hi[2];
+		}
+	}
+
+	if(full){
+		pack(m);
+		return;
+	}
+
+	if(begin >= end) return;
+	packRange(m, begin, end);
+	touch(begin * mLayout.stride(), end * mLayout.stride());
+	mKeyValid = false;
+}
+
+void VertexPacker::packRange(const Mesh& m, int begin, int end){
+	typedef VertexLayout VL;
+	const VL& l = mLayout;
+	const int stride = l.stride();
+	char * base = mData.empty() ? 0 : &mData[0];
+
+	// Positions, mapped from bounds if normalized
+	{
+		VL::Format f = l.format(VL::POSITION);
+		Vec3f offset = l.positionOffset();
+		Vec3f scale = l.positionScale();
+		Vec3f invScale;
+		for(int k=0; k<3; ++k) invScale[k] = scale[k] != 0.f ? 1.f/scale[k] : 0.f;
+		char * dst = base + begin*stride + l.offset(VL::POSITION);
+		for(int i=begin; i<end; ++i, dst+=stride){
+			const Vec3f& p = m.vertices()[i];
+			for(int k=0; k<3; ++k) put(dst, f, k, (p[k] - offset[k]) * invScale[k]);
+		}
+	}
+
+	if(l.has(VL::NORMAL)){
+		VL::Format f = l.format(VL::NORMAL);
+		char * dst = base + begin*stride + l.offset(VL::NORMAL);
+		for(int i=begin; i<end; ++i, dst+=stride){
+			const Vec3f& n = m.normals()[i];
+			for(int k=0; k<3; ++k) put(dst, f, k, n[k]);
+		}
+	}
+
+	if(l.has(VL::COLOR)){
+		VL::Format f = l.format(VL::COLOR);
+		const int Nv = m.vertices().size();
+		const int Nc = m.colors().size();
+		const int Nci = m.coloris().size();
+		char * dst = base + begin*stride + l.offset(VL::COLOR);
+		for(int i=begin; i<end; ++i, dst+=stride){
+			// Without enough colors for all vertices, the first is used
+			if(Nc >= Nv || (Nc && Nci < Nv)){
+				const Color& c = m.colors()[Nc >= Nv ? i : 0];
+				for(int k=0; k<4; ++k) put(dst, f, k, c[k]);
+			}
+			else{
+				const Colori& c = m.coloris()[Nci >= Nv ? i : 0];
+				for(int k=0; k<4; ++k) put(dst, f, k, c.components[k] * (1.f/255));
+			}
+		}
+	}
+
+	if(l.has(VL::TEXCOORD)){
+		VL::Format f = l.format(VL::TEXCOORD);
+		const int nc = l.components(VL::TEXCOORD);
+		char * dst = base + begin*stride + l.offset(VL::TEXCOORD);
+		for(int i=begin; i<end; ++i, dst+=stride){
+			const float * t = 3 == nc ? &m.texCoord3s()[i][0] : &m.texCoord2s()[i][0];
+			for(int k=0; k<nc; ++k) put(dst, f, k, t[k]);
+		}
+	}
+}
+
+void VertexPacker::touch(int begin, int end){
+	if(!dirty()){
+		mDirtyBegin = begin;
+		mDirtyEnd = end;
+	}
+	else{
+		if(begin < mDirtyBegin) mDirtyBegin = begin;
+		if(end > mDirtyEnd) mDirtyEnd = end;
+	}
+}
+
+uint64_t VertexPacker::key() const {
+	if(!mKeyValid){
+		uint64_t h = hash(kHashBasis, mLayout.key());
+		h = hash(h, int32_t(mNumVertices));
+		mKey = hash(h, data(), mData.size());
+		mKeyValid = true;
+	}
+	return mKey;
+}
+
+} // al::
@@ -4,12 +4,62 @@
 #include <cstring>		/* memset() */
 #include <cmath>
 #include <cassert>
+#include <climits>
 
 #include "portaudio.h"
 #include "allocore/io/al_AudioIO.hpp"
+#include "allocore/io/al_SoundFile.hpp"
+#include "allocore/system/al_TaskPool.hpp"
+#include "allocore/system/al_Thread.hpp"
+#include "allocore/system/al_Time.hpp"
+#include "allocore/types/al_MsgQueue.hpp"
 
 namespace al{
 
+namespace{
+
+// Gain, NaN zeroing and clipping of output after the callback
+void finishOutput(AudioIO& io, int numChans){
+
+	// apply smoothly-ramped gain to all output channels
+	if(io.usingGain()){
+
+		float dgain = (io.mGain-io.mGainPrev) / io.framesPerBuffer();
+
+		for(int j=0; j<numChans; ++j){
+			float * out = io.outBuffer(j);
+			float gain = io.mGainPrev;
+
+			for(int i=0; i<io.framesPerBuffer(); ++i){
+				out[i] *= gain;
+				gain += dgain;
+			}
+		}
+
+		io.mGainPrev = io.mGain;
+	}
+
+	// kill pesky nans so we don't hurt anyone's ears
+	if(io.zeroNANs()){
+		for(int i=0; i<io.framesPerBuffer()*numChans; ++i){
+			float& s = (&io.out(0,0))[i];
+			//if(isnan(s)) s = 0.f;
+			if(s != s) s = 0.f; // portable isnan; only nans do not equal themselves
+		}
+	}
+
+	if(io.clipOut()){
+		for(int i=0; i<io.framesPerBuffer()*numChans; ++i){
+			float& s = (&io.out(0,0))[i];
+			if		(s<-1.f) s =-1.f;
+			else if	(s> 1.f) s = 1.f;
+		}
+	}
+}
+
+} // anonymous
+
+
 class DummyAudioBackend : public AudioBackend{
 public:
 	DummyAudioBackend(): AudioBackend(), mNumOutChans(64), mNumInChans(64){}
@@ -266,53 +316,241 @@ protected:
 		io.processAudio();	// call callback
 
 
-		// apply smoothly-ramped gain to all output channels
-		if(io.usingGain()){
+		finishOutput(io, io.channelsOutDevice());
 
-			float dgain = (io.mGain-io.mGainPrev) / io.framesPerBuffer();
+		if(bDeinterleave){
+			interleave(paO, &io.out(0,0), io.framesPerBuffer(), io.channelsOutDevice());
+		}
 
-			for(int j=0; j<io.channelsOutDevice(); ++j){
-				float * out = io.outBuffer(j);
-				float gain = io.mGainPrev;
+		return 0;
+	}
 
-				for(int i=0; i<io.framesPerBuffer(); ++i){
-					out[i] *= gain;
-					gain += dgain;
-				}
-			}
+private:
+
+	PaStreamParameters mInParams, mOutParams;	// Input and output stream parameters
+	PaStream * mStream;					// i/o stream
+	mutable PaError mErrNum;			// Most recent error number
+};
+
+//==============================================================================
+
+class OfflineAudioBackend : public AudioBackend{
+public:
+	OfflineAudioBackend()
+	:	AudioBackend(), mNumOutChans(0), mNumInChans(0), mIO(0), mFramesPerSecond(1),
+		mFrames(0), mEndFrame(0), mStartTime(0), mCPU(0),
+		mOpen(0), mRunning(0), mStopRequest(0), mThreadActive(false)
+	{}
+
+	virtual ~OfflineAudioBackend(){ close(); }
+
+	virtual bool isOpen() const {return mOpen.load();}
+	virtual bool isRunning() const {return mRunning.load();}
+	virtual bool error() const {return !mError.empty();}
+
+	virtual void printError(const char * text = "") const {
+		if(error()){
+			fprintf(stderr, "%s: %s\n", text, mError.c_str());
+		}
+	}
+	virtual void printInfo() const {
+		printf("Using offline backend, rendering to %s\n",
+			mOut.isOpen() ? mIO->outputFile().c_str() : "nothing");
+	}
+
+	virtual bool supportsFPS(double fps) const {return true;}
+
+	virtual void inDevice(int index) {return;}
+	virtual void outDevice(int index) {return;}
 
-			io.mGainPrev = io.mGain;
+	virtual int channels(int num, bool forOutput) {
+		if(isOpen()){
+			warn("the number of channels cannnot be set with the stream open", "AudioIO");
+			return -1;
 		}
+		if (forOutput) {
+			setOutDeviceChans(num);
+		} else {
+			setInDeviceChans(num);
+		}
+		return num;
+	}
 
-		// kill pesky nans so we don't hurt anyone's ears
-		if(io.zeroNANs()){
-			for(int i=0; i<io.framesPerBuffer()*io.channelsOutDevice(); ++i){
-				float& s = (&io.out(0,0))[i];
-				//if(isnan(s)) s = 0.f;
-				if(s != s) s = 0.f; // portable isnan; only nans do not equal themselves
+	virtual int inDeviceChans() {return mNumInChans;}
+	virtual int outDeviceChans() {return mNumOutChans;}
+	virtual void setInDeviceChans(int num) { mNumInChans = num; }
+	virtual void setOutDeviceChans(int num) { mNumOutChans = num; }
+
+	virtual double time() {return mFrames.load() / mFramesPerSecond;}
+
+	virtual bool open(int framesPerSecond, int framesPerBuffer, void *userdata) {
+		assert(framesPerBuffer != 0 && framesPerSecond != 0 && userdata != NULL);
+		if(isOpen()) return true;
+
+		mError.clear();
+		mIO = (AudioIO *)userdata;
+		mFramesPerSecond = framesPerSecond;
+
+		// Open input files; the render lasts as long as the longest by default
+		uint64_t longest = 0;
+		const std::vector<std::string>& paths = mIO->inputFiles();
+		for(unsigned i=0; i<paths.size(); ++i){
+			SoundFileIn * f = new SoundFileIn;
+			mIns.push_back(f);
+			if(!f->open(paths[i])){
+				mError = "could not read sound file " + paths[i];
+				break;
+			}
+			if(f->frameRate() != framesPerSecond){
+				warn(("frame rate of " + paths[i] + " differs from stream").c_str(), "AudioIO");
 			}
+			if(f->frames() > longest) longest = f->frames();
 		}
 
-		if(io.clipOut()){
-			for(int i=0; i<io.framesPerBuffer()*io.channelsOutDevice(); ++i){
-				float& s = (&io.out(0,0))[i];
-				if		(s<-1.f) s =-1.f;
-				else if	(s> 1.f) s = 1.f;
+		double length = mIO->renderLength();
+		mEndFrame = length >= 0 ? uint64_t(length * framesPerSecond + 0.5) : longest;
+
+		if(!error() && !mIO->outputFile().empty()){
+			if(!mOut.open(mIO->outputFile(), mIO->channelsOut(), framesPerSecond, framesPerBuffer)){
+				mError = "could not write sound file " + mIO->outputFile();
 			}
 		}
 
-		if(bDeinterleave){
-			interleave(paO, &io.out(0,0), io.framesPerBuffer(), io.channelsOutDevice());
+		if(error()){
+			closeFiles();
+			printError("Error in al::AudioIO::open()");
+			return false;
 		}
 
-		return 0;
+		mOpen.store(1);
+		return true;
 	}
 
-private:
+	virtual bool close() {
+		stop();
+		closeFiles();
+		mOpen.store(0);
+		return true;
+	}
 
-	PaStreamParameters mInParams, mOutParams;	// Input and output stream parameters
-	PaStream * mStream;					// i/o stream
-	mutable PaError mErrNum;			// Most recent error number
+	virtual bool start(int framesPerSecond, int framesPerBuffer, void *userdata) {
+		if(isRunning()) return true;
+		wait(); // a render that ended by itself still needs joining
+		if(!isOpen() && !open(framesPerSecond, framesPerBuffer, userdata)) return false;
+		mFrames.store(0);
+		mStopRequest.store(0);
+		mStartTime = al_steady_time_nsec();
+		mRunning.store(1);
+		mThreadActive = mThread.start(renderFunc, this);
+		if(!mThreadActive) mRunning.store(0);
+		return mThreadActive;
+	}
+
+	virtual bool stop() {
+		mStopRequest.store(1);
+		wait();
+		return true;
+	}
+
+	// Ratio of time taken to time rendered, so far if still running
+	virtual double cpu() {
+		// mCPU is written before the render thread clears mRunning
+		if(!mRunning.load()) return mCPU;
+		uint64_t frames = mFrames.load();
+		if(!frames) return 0;
+		return (al_steady_time_nsec() - mStartTime) * al_time_ns2s * mFramesPerSecond / frames;
+	}
+
+	// Wait for render thread to finish
+	void wait(){
+		if(mThreadActive){
+			mThread.join();
+			mThreadActive = false;
+		}
+	}
+
+protected:
+	int mNumOutChans;
+	int mNumInChans;
+	AudioIO * mIO;
+	double mFramesPerSecond;
+	Atomic<uint64_t> mFrames;	// frames rendered; written by render thread only
+	uint64_t mEndFrame;			// frame to stop at; 0 to run until stopped
+	al_nsec mStartTime;			// time the render started
+	double mCPU;				// of the last render; valid once it has ended
+	Atomic<int> mOpen;			// used instead of mIsOpen and mIsRunning
+	Atomic<int> mRunning;		// since the render thread clears them
+	Atomic<int> mStopRequest;
+	bool mThreadActive;
+	std::string mError;
+	std::vector<SoundFileIn *> mIns;
+	SoundFileOut mOut;
+	std::vector<float> mInterleaved;
+	Thread mThread;
+
+	void closeFiles(){
+		for(unsigned i=0; i<mIns.size(); ++i) delete mIns[i];
+		mIns.clear();
+		mOut.close();
+	}
+
+	// Fill input buffers from files
+	void readInputs(){
+		AudioIO& io = *mIO;
+		const int frames = io.framesPerBuffer();
+		int chan = 0;
+		for(unsigned k=0; k<mIns.size() && chan < io.channelsIn(); ++k){
+			SoundFileIn& f = *mIns[k];
+			const int nc = f.channels();
+			mInterleaved.resize(frames * nc);
+			int n = f.read(&mInterleaved[0], frames);
+			for(int c=0; c<nc && chan < io.channelsIn(); ++c, ++chan){
+				float * dst = const_cast<float *>(io.inBuffer(chan));
+				for(int i=0; i<n; ++i) dst[i] = mInterleaved[i*nc + c];
+				for(int i=n; i<frames; ++i) dst[i] = 0.f;
+			}
+		}
+		for(; chan < io.channelsIn(); ++chan){
+			zero(const_cast<float *>(io.inBuffer(chan)), frames);
+		}
+	}
+
+	static void * renderFunc(void * user){
+		OfflineAudioBackend& b = *(OfflineAudioBackend *)user;
+		AudioIO& io = *b.mIO;
+		const int frames = io.framesPerBuffer();
+		const int chans = io.channelsOut();
+		uint64_t done = 0;
+
+		while(!b.mStopRequest.load() && (0 == b.mEndFrame || done < b.mEndFrame)){
+			b.readInputs();
+			if(io.autoZeroOut()) io.zeroOut();
+
+			io.processAudio();
+			finishOutput(io, chans);
+
+			if(b.mOut.isOpen() && chans > 0){
+				// the last block is cut to the length of the render
+				int n = frames;
+				if(b.mEndFrame && b.mEndFrame - done < uint64_t(n)) n = int(b.mEndFrame - done);
+				b.mInterleaved.resize(frames * chans);
+				interleave(&b.mInterleaved[0], &io.out(0,0), frames, chans);
+				b.mOut.write(&b.mInterleaved[0], n);
+			}
+			done += frames;
+			b.mFrames.store(done);
+		}
+
+		// ratio of time taken to time rendered
+		double elapsed = (al_steady_time_nsec() - b.mStartTime) * al_time_ns2s;
+		b.mCPU = done ? elapsed * b.mFramesPerSecond / done : 0;
+
+		// a render that reached its end closes its files
+		b.closeFiles();
+		b.mOpen.store(0);
+		b.mRunning.store(0);
+		return NULL;
+	}
 };
 
 //==============================================================================
@@ -321,7 +559,9 @@ AudioDevice::AudioDevice(int deviceNum)
 :    AudioDeviceInfo(deviceNum), mImpl(0)
 {
 	if (deviceNum < 0) {
-		deviceNum = defaultOutput().id();
+		// ask directly, as defaultOutput() would recurse with no devices
+		initDevices();
+		deviceNum = Pa_GetDefaultOutputDevice();
 	}
 	setImpl(deviceNum);
 }
@@ -419,11 +659,219 @@ void AudioDevice::printAll(){
 
 //==============================================================================
 
+AudioAccess AudioAccess::all(){
+	return AudioAccess().write(INPUT).write(OUTPUT).write(BUS);
+}
+
+AudioAccess& AudioAccess::read(Buffer b, int begin, int end){
+	return add(b, begin, end, false);
+}
+
+AudioAccess& AudioAccess::write(Buffer b, int begin, int end){
+	return add(b, begin, end, true);
+}
+
+AudioAccess& AudioAccess::add(Buffer b, int begin, int end, bool write){
+	Range r;
+	r.buffer = b;
+	r.begin = begin;
+	r.end = end < 0 ? INT_MAX : end;
+	r.write = write;
+	if(r.begin < r.end) mRanges.push_back(r);
+	return *this;
+}
+
+bool AudioAccess::conflicts(const AudioAccess& v) const {
+	for(unsigned i=0; i<mRanges.size(); ++i){
+		const Range& a = mRanges[i];
+		for(unsigned j=0; j<v.mRanges.size(); ++j){
+			const Range& b = v.mRanges[j];
+			if(	a.buffer == b.buffer && (a.write || b.write)
+				&& a.begin < b.end && b.begin < a.end
+			) return true;
+		}
+	}
+	return false;
+}
+
+
+// Buffers of an AudioIOData with a separate frame counter and temporary
+// buffer, so that callbacks can iterate over frames at the same time
+class AudioIOView : public AudioIOData{
+public:
+	AudioIOView(): AudioIOData(0), mTempSize(0){}
+
+	// only the temporary buffer is ours
+	~AudioIOView(){ mBufI = mBufO = mBufB = 0; }
+
+	void sync(const AudioIOData& io){
+		float * temp = mBufT;
+		AudioIOData::operator=(io);
+		mBufT = temp;
+		if(mTempSize != mFramesPerBuffer){
+			mTempSize = resize(mBufT, mFramesPerBuffer);
+		}
+		frame(0);
+	}
+
+private:
+	int mTempSize;
+};
+
+
+// Graph of the handlers of an AudioIO
+class AudioIO::Graph{
+public:
+
+	struct Node : public Task{
+		AudioCallback * callback;
+		AudioIOView view;
+		double meanTime;			// accessed by the running thread only
+		Atomic<uint64_t> meanNsec;	// meanTime published to other threads
+
+		Node(AudioCallback * cb): callback(cb), meanTime(0){}
+
+		void operator()(){ run(view); }
+
+		void run(AudioIOData& io){
+			al_nsec t0 = al_steady_time_nsec();
+			callback->onAudioCB(io);
+			double dt = (al_steady_time_nsec() - t0) * al_time_ns2s;
+			meanTime = meanTime ? meanTime + (dt - meanTime) * 0.05 : dt;
+			meanNsec.store(meanTime * 1e9);
+		}
+	};
+
+	// Releases the roots of the graph
+	struct Entry : public Task{
+		void operator()(){}
+	};
+
+	std::vector<Node *> nodes;
+	Entry entry;
+	TaskGroup group;
+	bool serial;		// whether every node depends on the one before it
+	Graph * retired;	// next graph handed back by the audio thread
+
+	Graph(): serial(true), retired(0){}
+
+	~Graph(){
+		for(unsigned i=0; i<nodes.size(); ++i) delete nodes[i];
+	}
+
+	const Node * find(const AudioCallback * cb) const {
+		for(unsigned i=0; i<nodes.size(); ++i){
+			if(nodes[i]->callback == cb) return nodes[i];
+		}
+		return 0;
+	}
+
+	void runSerial(AudioIO& io){
+		for(unsigned i=0; i<nodes.size(); ++i){
+			io.frame(0);
+			nodes[i]->run(io);
+		}
+	}
+
+	void runParallel(AudioIO& io, TaskPool& pool){
+		for(unsigned i=0; i<nodes.size(); ++i) nodes[i]->view.sync(io);
+
+		// One submission, so a full queue leaves the graph untouched
+		if(pool.submit(entry, &group)){
+			pool.wait(group);
+		}
+		else{
+			for(unsigned i=0; i<nodes.size(); ++i) (*nodes[i])();
+		}
+	}
+};
+
+
+void AudioIO::freeRetiredGraphs(){
+	Graph * g = mRetiredGraphs.exchange(0);
+	while(g){
+		Graph * next = g->retired;
+		delete g;
+		g = next;
+	}
+}
+
+void AudioIO::rebuildGraph(){
+	freeRetiredGraphs();
+
+	// Only this thread deletes graphs, so the latest one stays valid even if
+	// the audio thread switches to it meanwhile
+	const Graph * latest = mNextGraph.load();
+	if(!latest) latest = mGraph.load();
+
+	Graph * g = new Graph;
+	const int N = mAudioCallbacks.size();
+
+	std::vector<AudioAccess> access(N);
+	for(int i=0; i<N; ++i){
+		AudioCallback * cb = mAudioCallbacks[i];
+		Graph::Node * node = new Graph::Node(cb);
+		// keep timing of handlers already in the graph
+		if(latest){
+			const Graph::Node * old = latest->find(cb);
+			if(old){
+				node->meanNsec.store(old->meanNsec.load());
+				node->meanTime = node->meanNsec.loadRelaxed() * al_time_ns2s;
+			}
+		}
+		g->nodes.push_back(node);
+		std::map<const AudioCallback *, AudioAccess>::const_iterator it = mAccess.find(cb);
+		access[i] = it != mAccess.end() ? it->second : AudioAccess::all();
+	}
+
+	// Each node waits for the earlier nodes it conflicts with. Nearer nodes
+	// are linked first so that dependencies already implied through them are
+	// not linked again.
+	g->serial = true;
+	std::vector<std::vector<bool> > before(N, std::vector<bool>(N, false));
+	for(int j=0; j<N; ++j){
+		bool hasPred = false;
+		for(int i=j-1; i>=0; --i){
+			if(before[j][i] || !access[i].conflicts(access[j])) continue;
+			g->nodes[i]->precede(*g->nodes[j]);
+			hasPred = true;
+			before[j][i] = true;
+			for(int k=0; k<i; ++k) if(before[i][k]) before[j][k] = true;
+		}
+		if(!hasPred) g->entry.precede(*g->nodes[j]);
+		if(j > 0 && !before[j][j-1]) g->serial = false;
+	}
+
+	// Publish to the audio thread; a graph it has not taken yet was never run
+	delete mNextGraph.exchange(g);
+}
+
+AudioIO& AudioIO::access(AudioCallback& v, const AudioAccess& a){
+	mAccess[&v] = a;
+	rebuildGraph();
+	return *this;
+}
+
+AudioIO& AudioIO::parallel(TaskPool * pool){
+	mPool = pool;
+	return *this;
+}
+
+double AudioIO::cpuTime(const AudioCallback& v) const {
+	const Graph * g = mNextGraph.load();
+	if(!g) g = mGraph.load();
+	const Graph::Node * node = g ? g->find(&v) : 0;
+	return node ? node->meanNsec.load() * al_time_ns2s : 0;
+}
+
+//==============================================================================
+
 AudioIO::AudioIO(int framesPerBuf, double framesPerSec, void (* callbackA)(AudioIOData &), void * userData,
 	int outChansA, int inChansA, AudioIO::Backend backend)
 :	AudioIOData(userData),
 	callback(callbackA),
-	mZeroNANs(true), mClipOut(true), mAutoZeroOut(true)
+	mZeroNANs(true), mClipOut(true), mAutoZeroOut(true),
+	mPool(0), mBackend(backend), mMsgQueue(0), mClock(0), mFramesProcessed(0), mRenderLength(-1)
 {
 	switch(backend) {
 	case PORTAUDIO:
@@ -434,6 +882,9 @@ AudioIO::AudioIO(int framesPerBuf, double framesPerSec, void (* callbackA)(Audio
 	case DUMMY:
 		mImpl = new DummyAudioBackend;
 		break;
+	case OFFLINE:
+		mImpl = new OfflineAudioBackend;
+		break;
 	}
 	init(outChansA, inChansA);
 	this->framesPerBuffer(framesPerBuf);
@@ -446,13 +897,19 @@ AudioIO::AudioIO(int framesPerBuf, double framesPerSec, void (* callbackA)(Audio
 AudioIO::~AudioIO(){
 	close();
 	delete mImpl;
+	freeRetiredGraphs();
+	delete mNextGraph.load();
+	delete mGraph.load();
 }
 
 
 void AudioIO::init(int outChannels, int inChannels){
 	// Choose default devices for now...
-	deviceIn(AudioDevice::defaultInput());
-	deviceOut(AudioDevice::defaultOutput());
+	// (offline rendering must work without any audio devices)
+	if(OFFLINE != mBackend){
+		deviceIn(AudioDevice::defaultInput());
+		deviceOut(AudioDevice::defaultOutput());
+	}
 
 	//	// Setup input stream parameters
 //	const PaDeviceInfo * dInfo = Pa_GetDeviceInfo(mInParams.device);
@@ -473,11 +930,13 @@ void AudioIO::init(int outChannels, int inChannels){
 
 AudioIO& AudioIO::append(AudioCallback& v){
 	mAudioCallbacks.push_back(&v);
+	rebuildGraph();
 	return *this;
 }
 
 AudioIO& AudioIO::prepend(AudioCallback& v){
 	mAudioCallbacks.insert(mAudioCallbacks.begin(), &v);
+	rebuildGraph();
 	return *this;
 }
 
@@ -488,6 +947,7 @@ AudioIO& AudioIO::insertBefore(AudioCallback& v){
 		prepend(v);
 	} else {
 		mAudioCallbacks.insert(--pos, 1, &v);
+		rebuildGraph();
 	}
 	return *this;
 }
@@ -499,6 +959,7 @@ AudioIO& AudioIO::insertAfter(AudioCallback& v){
 		append(v);
 	} else {
 		mAudioCallbacks.insert(pos, 1, &v);
+		rebuildGraph();
 	}
 	return *this;
 }
@@ -506,6 +967,8 @@ AudioIO& AudioIO::insertAfter(AudioCallback& v){
 AudioIO& AudioIO::remove(AudioCallback& v){
 	// the proper way to do it:
 	mAudioCallbacks.erase(std::remove(mAudioCallbacks.begin(), mAudioCallbacks.end(), &v), mAudioCallbacks.end());
+	mAccess.erase(&v);
+	rebuildGraph();
 	return *this;
 }
 
@@ -612,7 +1075,10 @@ void AudioIO::framesPerBuffer(int n){
 }
 
 
-bool AudioIO::start(){ return mImpl->start(mFramesPerSecond, mFramesPerBuffer, this); }
+bool AudioIO::start(){
+	if(!mImpl->isRunning()) mFramesProcessed.store(0);
+	return mImpl->start(mFramesPerSecond, mFramesPerBuffer, this);
+}
 
 bool AudioIO::stop(){ return mImpl->stop(); }
 
@@ -637,14 +1103,53 @@ void AudioIO::print(){
 
 //void AudioIO::processAudio(){ frame(0); if(callback) callback(*this); }
 void AudioIO::processAudio(){
+	// Only this thread writes the frame count, so it need not be loaded
+	// with ordering or incremented atomically
+	const uint64_t processed = mFramesProcessed.loadRelaxed();
+	if(mMsgQueue) mMsgQueue->update(processed / mFramesPerSecond);
+
 	frame(0);
 	if(callback) callback(*this);
 
-	std::vector<AudioCallback *>::iterator iter = mAudioCallbacks.begin();
-	while(iter != mAudioCallbacks.end()){
-		frame(0);
-		(*iter++)->onAudioCB(*this);
+	// Switch to a rebuilt graph and hand the old one back. Graphs are
+	// pushed on a list so none is lost if several are handed back before
+	// the list is freed.
+	Graph * graph = mGraph.loadRelaxed();
+	if(mNextGraph.load()){
+		Graph * next = mNextGraph.exchange(0);
+		if(next){
+			if(graph){
+				Graph * head = mRetiredGraphs.load();
+				do graph->retired = head;
+				while(!mRetiredGraphs.compareExchange(head, graph));
+			}
+			graph = next;
+			mGraph.store(graph);
+		}
+	}
+
+	if(graph){
+		if(mPool && mPool->size() && !graph->serial) graph->runParallel(*this, *mPool);
+		else graph->runSerial(*this);
 	}
+
+	mFramesProcessed.store(processed + mFramesPerBuffer);
+	if(mClock) mClock->update(secondsPerBuffer());
+}
+
+AudioIO& AudioIO::timebase(Clock * v){
+	mClock = v;
+	if(mClock) mClock->useNRT(secondsPerBuffer());
+	return *this;
+}
+
+AudioIO& AudioIO::inputFile(const std::string& path){
+	mInputFiles.push_back(path);
+	return *this;
+}
+
+void AudioIO::waitForRender(){
+	if(OFFLINE == mBackend) static_cast<OfflineAudioBackend *>(mImpl)->wait();
 }
 
 int AudioIO::channels(bool forOutput) const { return forOutput ? channelsOut() : channelsIn(); }
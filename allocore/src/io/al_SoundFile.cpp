@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include "allocore/io/al_SoundFile.hpp"
+#include "allocore/system/al_Time.hpp"
+#include "allocore/types/al_SingleRWRingBuffer.hpp"
+
+namespace al{
+
+namespace{
+
+bool hostIsBigEndian(){
+	const uint16_t v = 1;
+	return 0 == *(const char *)&v;
+}
+
+bool endsWith(const std::string& s, const std::string& end){
+	if(s.size() < end.size()) return false;
+	std::string t = s.substr(s.size() - end.size());
+	for(unsigned i=0; i<t.size(); ++i) t[i] = tolower(t[i]);
+	return t == end;
+}
+
+uint32_t readU32(const unsigned char * b, bool bigEndian){
+	return bigEndian
+		? (uint32_t(b[0])<<24) | (uint32_t(b[1])<<16) | (uint32_t(b[2])<<8) | b[3]
+		: (uint32_t(b[3])<<24) | (uint32_t(b[2])<<16) | (uint32_t(b[1])<<8) | b[0];
+}
+
+uint16_t readU16(const unsigned char * b, bool bigEndian){
+	return bigEndian ? (b[0]<<8) | b[1] : (b[1]<<8) | b[0];
+}
+
+void putU32(char * b, uint32_t v, bool bigEndian){
+	for(int i=0; i<4; ++i) b[bigEndian ? 3-i : i] = char(v >> (8*i));
+}
+
+void putU16(char * b, uint16_t v, bool bigEndian){
+	for(int i=0; i<2; ++i) b[bigEndian ? 1-i : i] = char(v >> (8*i));
+}
+
+// Reverse the bytes of each of n words of 4 bytes
+void swap4(char * b, size_t n){
+	for(size_t i=0; i<n; ++i, b+=4){
+		std::swap(b[0], b[3]);
+		std::swap(b[1], b[2]);
+	}
+}
+
+} // anonymous
+
+
+
+SoundFileIn::SoundFileIn()
+:	mFile(0), mChannels(0), mFrameRate(0), mFramesLeft(0), mUnknownLength(false),
+	mBytes(0), mFloat(false), mBigEndian(false)
+{}
+
+SoundFileIn::~SoundFileIn(){ close(); }
+
+bool SoundFileIn::open(const std::string& path){
+	close();
+	mFile = fopen(path.c_str(), "rb");
+	if(!mFile) return false;
+	unsigned char hdr[12];
+	bool ok = false;
+	if(fread(hdr, 1, 12, mFile) == 12){
+		if(0 == memcmp(hdr, "RIFF", 4) && 0 == memcmp(hdr+8, "WAVE", 4)) ok = openWAV();
+		else if(0 == memcmp(hdr, ".snd", 4)) ok = openAU(hdr);
+	}
+	if(!ok) close();
+	return ok;
+}
+
+void SoundFileIn::close(){
+	if(mFile){ fclose(mFile); mFile = 0; }
+	mFramesLeft = 0;
+}
+
+int SoundFileIn::read(float * dst, int n){
+	if(!mFile) return 0;
+	if(!mUnknownLength && uint64_t(n) > mFramesLeft) n = int(mFramesLeft);
+	const int frameBytes = mBytes * mChannels;
+	mBuf.resize(n * frameBytes);
+	if(n) n = fread(&mBuf[0], frameBytes, n, mFile);
+	mFramesLeft -= n;
+
+	const unsigned char * b = (const unsigned char *)(n ? &mBuf[0] : 0);
+	const int N = n * mChannels;
+	for(int i=0; i<N; ++i, b+=mBytes){
+		switch(mBytes){
+		case 2:	dst[i] = int16_t(readU16(b, mBigEndian)) / 32768.f; break;
+		case 3:{
+			uint32_t v = mBigEndian
+				? (uint32_t(b[0])<<24) | (b[1]<<16) | (b[2]<<8)
+				: (uint32_t(b[2])<<24) | (b[1]<<16) | (b[0]<<8);
+			dst[i] = int32_t(v) / 2147483648.f;
+			} break;
+		default:{
+			uint32_t v = readU32(b, mBigEndian);
+			if(mFloat) memcpy(dst + i, &v, 4);
+			else dst[i] = int32_t(v) / 2147483648.f;
+			}
+		}
+	}
+	return n;
+}
+
+bool SoundFileIn::setFormat(int bits, bool isFloat){
+	mBytes = bits/8;
+	mFloat = isFloat;
+	if(isFloat) return 32 == bits;
+	return 16 == bits || 24 == bits || 32 == bits;
+}
+
+bool SoundFileIn::openWAV(){
+	mBigEndian = false;
+	bool haveFormat = false;
+	unsigned char ck[8];
+	while(fread(ck, 1, 8, mFile) == 8){
+		uint32_t size = readU32(ck+4, false);
+		if(0 == memcmp(ck, "fmt ", 4)){
+			unsigned char f[40] = {0};
+			if(size < 16 || fread(f, 1, size < 40 ? size : 40, mFile) != (size < 40 ? size : 40)) return false;
+			if(size > 40) fseek(mFile, size - 40, SEEK_CUR);
+			int tag = readU16(f, false);
+			if(0xFFFE == tag && size >= 26) tag = readU16(f+24, false); // extensible
+			mChannels = readU16(f+2, false);
+			mFrameRate = readU32(f+4, false);
+			if(!(1 == tag || 3 == tag) || !setFormat(readU16(f+14, false), 3 == tag)) return false;
+			haveFormat = true;
+		}
+		else if(0 == memcmp(ck, "data", 4)){
+			if(!haveFormat || mChannels <= 0) return false;
+			mUnknownLength = false;
+			mFramesLeft = size / (mBytes * mChannels);
+			return true;
+		}
+		else{
+			fseek(mFile, size + (size & 1), SEEK_CUR);
+		}
+	}
+	return false;
+}
+
+bool SoundFileIn::openAU(const unsigned char * hdr){
+	mBigEndian = true;
+	unsigned char h[12];
+	if(fread(h, 1, 12, mFile) != 12) return false;
+	uint32_t offset = readU32(hdr+4, true);
+	uint32_t size = readU32(hdr+8, true);
+	int enc = readU32(h, true);
+	mFrameRate = readU32(h+4, true);
+	mChannels = readU32(h+8, true);
+	bool ok = mChannels > 0 && offset >= 24;
+	switch(enc){
+	case 3: ok &= setFormat(16, false); break;
+	case 4: ok &= setFormat(24, false); break;
+	case 5: ok &= setFormat(32, false); break;
+	case 6: ok &= setFormat(32, true); break;
+	default: ok = false;
+	}
+	if(!ok) return false;
+	fseek(mFile, offset, SEEK_SET);
+	mUnknownLength = 0xffffffff == size;
+	mFramesLeft = mUnknownLength ? uint64_t(-1) : size / (mBytes * mChannels);
+	return true;
+}
+
+
+
+SoundFileOut::SoundFileOut()
+:	mFile(0), mWAV(false), mChannels(0), mFrameRate(0), mBytes(0), mRing(0), mDone(0)
+{}
+
+SoundFileOut::~SoundFileOut(){ close(); delete mRing; }
+
+bool SoundFileOut::open(const std::string& path, int channels, double frameRate, int framesPerBuffer){
+	close();
+	mFile = fopen(path.c_str(), "wb");
+	if(!mFile) return false;
+	mWAV = endsWith(path, ".wav");
+	mChannels = channels;
+	mFrameRate = frameRate;
+	mBytes = 0;
+	writeHeader();
+
+	// hold at least a few dozen blocks or a megabyte
+	size_t blockBytes = size_t(framesPerBuffer) * channels * sizeof(float);
+	size_t ringBytes = blockBytes * 32;
+	if(ringBytes < (1<<20)) ringBytes = 1<<20;
+	delete mRing;
+	mRing = new SingleRWRingBuffer(ringBytes);
+
+	mDone.store(0);
+	mThread.start(writerFunc, this);
+	return true;
+}
+
+void SoundFileOut::write(const float * src, int n){
+	const char * b = (const char *)src;
+	size_t left = size_t(n) * mChannels * sizeof(float);
+	while(left){
+		size_t w = mRing->write(b, left);
+		b += w;
+		left -= w;
+		if(left) al_sleep(0.0005);
+	}
+}
+
+void SoundFileOut::close(){
+	if(!mFile) return;
+	mDone.store(1);
+	mThread.join();
+	writeHeader();
+	fclose(mFile);
+	mFile = 0;
+}
+
+void * SoundFileOut::writerFunc(void * user){
+	SoundFileOut& s = *(SoundFileOut *)user;
+	const bool swap = s.mWAV == hostIsBigEndian();
+	std::vector<char> buf(1<<16);
+	while(true){
+		size_t n = s.mRing->readSpace() & ~size_t(3);
+		if(n){
+			if(n > buf.size()) n = buf.size();
+			s.mRing->read(&buf[0], n);
+			if(swap) swap4(&buf[0], n/4);
+			fwrite(&buf[0], 1, n, s.mFile);
+			s.mBytes += n;
+		}
+		else if(s.mDone.load()){
+			// the last samples were written before mDone was set
+			if(0 == s.mRing->readSpace()) break;
+		}
+		else{
+			al_sleep(0.001);
+		}
+	}
+	return NULL;
+}
+
+void SoundFileOut::writeHeader(){
+	// sizes that do not fit are left as unknown
+	uint32_t dataSize = mBytes > 0xffffff00 ? 0xffffffff : uint32_t(mBytes);
+	char h[68] = {0};
+	int len;
+	if(mWAV){
+		// IEEE float, in an extensible format chunk if multichannel
+		bool ext = mChannels > 2;
+		int fmtSize = ext ? 40 : 16;
+		len = 20 + fmtSize + 8;
+		memcpy(h, "RIFF", 4);
+		putU32(h+4, dataSize == 0xffffffff ? dataSize : dataSize + len - 8, false);
+		memcpy(h+8, "WAVEfmt ", 8);
+		putU32(h+16, fmtSize, false);
+		char * f = h+20;
+		putU16(f, ext ? 0xFFFE : 3, false);
+		putU16(f+2, mChannels, false);
+		putU32(f+4, uint32_t(mFrameRate), false);
+		putU32(f+8, uint32_t(mFrameRate) * mChannels * 4, false);
+		putU16(f+12, mChannels * 4, false);
+		putU16(f+14, 32, false);
+		if(ext){
+			static const char floatGUID[16] = {
+				3,0,0,0, 0,0, 0x10,0, char(0x80),0, 0,char(0xaa),0,0x38,char(0x9b),0x71
+			};
+			putU16(f+16, 22, false);
+			putU16(f+18, 32, false);
+			putU32(f+20, 0, false);	// no speaker positions
+			memcpy(f+24, floatGUID, 16);
+		}
+		memcpy(h + len - 8, "data", 4);
+		putU32(h + len - 4, dataSize, false);
+	}
+	else{
+		len = 24;
+		memcpy(h, ".snd", 4);
+		putU32(h+4, 24, true);
+		putU32(h+8, dataSize, true);
+		putU32(h+12, 6, true);		// 32-bit float
+		putU32(h+16, uint32_t(mFrameRate), true);
+		putU32(h+20, mChannels, true);
+	}
+	fseek(mFile, 0, SEEK_SET);
+	fwrite(h, 1, len, mFile);
+	fseek(mFile, 0, SEEK_END);
+}
+
+} // al::
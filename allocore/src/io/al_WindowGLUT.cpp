@@ -5,6 +5,7 @@
 #include "allocore/system/al_Config.h"		// system defines
 #include "allocore/system/al_MainLoop.hpp"	// start/stop loop, rendering
 #include "allocore/system/al_Printing.hpp"	// warnings
+#include "allocore/system/al_Trace.hpp"		// trace zones
 #include "allocore/graphics/al_OpenGL.hpp"	// OpenGL headers
 
 #ifdef AL_OSX
@@ -441,7 +442,10 @@ private:
 		const int winID = id();
 		const int current = glutGetWindow();
 		if(winID != current) glutSetWindow(winID);
-		mWindow->callHandlersOnFrame();
+		{
+			AL_TRACE_ZONE("Window::onFrame");
+			mWindow->callHandlersOnFrame();
+		}
 		const char * err = errorString(true);
 		if(err[0]){
 			AL_WARN_ONCE("Error after rendering frame in window (id=%d): %s", winID, err);
@@ -3,6 +3,7 @@
 #include <string.h>
 #include "allocore/system/al_Printing.hpp"
 #include "allocore/protocol/al_OSC.hpp"
+#include "allocore/system/al_Trace.hpp"
 
 #include "oscpack/osc/OscOutboundPacketStream.h"
 #include "oscpack/osc/OscPacketListener.h"
@@ -403,6 +404,7 @@ int Recv::recv(){
 	OSCTRY("Packet::endMessage",
 		r = Socket::recv(&mBuffer[0], mBuffer.size());
 		if(r && mHandler){
+			AL_TRACE_ZONE("osc::Recv::parse");
 #ifdef VERBOSE
 		  printf("Recv:recv() Received %d bytes; parsing...\n", r);
 #endif
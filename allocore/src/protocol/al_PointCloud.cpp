@@ -0,0 +1,354 @@
+#include <string.h>
+#include "allocore/protocol/al_PointCloud.hpp"
+
+/*
+Datagram layout, all fields little-endian:
+
+offset	size	field
+0		2		magic, 'P' 'C'
+2		1		version
+3		1		flags; bit 0 set if points have colors
+4		2		number of points in datagram
+6		2		reserved
+8		4		frame id
+12		4		datagram index within frame
+16		4		number of datagrams in frame
+20		4		number of points in frame
+24		4		index of first point in datagram
+28		12		lower corner of quantization bounds, 3 x float32
+40		12		quantization step, 3 x float32
+52		6n		positions, 3 x uint16 per point
+52+6n	4n		colors, RGBA x uint8 per point (if flagged)
+*/
+
+namespace al{
+
+namespace{
+
+const uint8_t kMagic0 = 'P';
+const uint8_t kMagic1 = 'C';
+const uint8_t kVersion = 1;
+const uint8_t kFlagColors = 1;
+const int kPositionSize = 6;
+const int kColorSize = 4;
+
+// Most points a datagram can hold within the maximum UDP payload
+const int kMaxPacketPoints = (65507 - PointCloudEncoder::HEADER_SIZE) / kPositionSize;
+
+void put16(char * p, uint16_t v){
+	p[0] = v; p[1] = v>>8;
+}
+
+void put32(char * p, uint32_t v){
+	p[0] = v; p[1] = v>>8; p[2] = v>>16; p[3] = v>>24;
+}
+
+void putf(char * p, float v){
+	uint32_t u; memcpy(&u, &v, 4); put32(p, u);
+}
+
+uint16_t get16(const char * p){
+	const uint8_t * u = (const uint8_t *)p;
+	return u[0] | (u[1]<<8);
+}
+
+uint32_t get32(const char * p){
+	const uint8_t * u = (const uint8_t *)p;
+	return u[0] | (u[1]<<8) | (u[2]<<16) | (uint32_t(u[3])<<24);
+}
+
+float getf(const char * p){
+	uint32_t u = get32(p);
+	float v; memcpy(&v, &u, 4); return v;
+}
+
+uint16_t quantize(float v, float lo, float invStep){
+	float q = (v - lo) * invStep + 0.5f;
+	if(!(q > 0.f)) return 0; // also catches NaN
+	if(q >= 65535.f) return 65535;
+	return uint16_t(q);
+}
+
+} // anonymous
+
+
+PointCloudEncoder::PointCloudEncoder(int maxSize)
+:	mLo(0), mHi(1), mMaxPacketSize(0), mFrameId(0), mAutoBounds(true)
+{
+	maxPacketSize(maxSize);
+}
+
+PointCloudEncoder& PointCloudEncoder::maxPacketSize(int bytes){
+	// at least one colored point per datagram
+	int minSize = HEADER_SIZE + kPositionSize + kColorSize;
+	mMaxPacketSize = bytes < minSize ? minSize : bytes;
+	return *this;
+}
+
+PointCloudEncoder& PointCloudEncoder::bounds(const Vec3f& lo, const Vec3f& hi){
+	mLo = lo;
+	mHi = hi;
+	mAutoBounds = false;
+	return *this;
+}
+
+PointCloudEncoder& PointCloudEncoder::autoBounds(){
+	mAutoBounds = true;
+	return *this;
+}
+
+int PointCloudEncoder::pointsPerPacket(bool withColors) const {
+	int pointSize = kPositionSize + (withColors ? kColorSize : 0);
+	int n = (mMaxPacketSize - HEADER_SIZE) / pointSize;
+	return n < kMaxPacketPoints ? n : kMaxPacketPoints;
+}
+
+int PointCloudEncoder::encode(const Vec3f * positions, const Colori * colors, int num){
+	if(num < 0) num = 0;
+	++mFrameId;
+
+	Vec3f lo = mLo, hi = mHi;
+	if(mAutoBounds && num){
+		lo = hi = positions[0];
+		for(int i=1; i<num; ++i){
+			const Vec3f& p = positions[i];
+			for(int k=0; k<3; ++k){
+				if(p[k] < lo[k]) lo[k] = p[k];
+				else if(p[k] > hi[k]) hi[k] = p[k];
+			}
+		}
+	}
+	Vec3f step, invStep;
+	for(int k=0; k<3; ++k){
+		step[k] = hi[k] > lo[k] ? (hi[k] - lo[k]) / 65535.f : 0.f;
+		invStep[k] = step[k] > 0.f ? 1.f / step[k] : 0.f;
+	}
+
+	const bool withColors = colors != 0;
+	const int perPacket = pointsPerPacket(withColors);
+	if(num > MAX_PACKETS * perPacket) num = MAX_PACKETS * perPacket;
+	// Always send at least one datagram so that empty frames get through
+	const int numPackets = num ? (num + perPacket-1) / perPacket : 1;
+
+	mSizes.resize(numPackets);
+	mData.resize(numPackets * mMaxPacketSize);
+
+	for(int j=0; j<numPackets; ++j){
+		char * pkt = &mData[0] + j*mMaxPacketSize;
+		int first = j*perPacket;
+		int count = num - first < perPacket ? num - first : perPacket;
+
+		pkt[0] = kMagic0;
+		pkt[1] = kMagic1;
+		pkt[2] = kVersion;
+		pkt[3] = withColors ? kFlagColors : 0;
+		put16(pkt+ 4, count);
+		put16(pkt+ 6, 0);
+		put32(pkt+ 8, mFrameId);
+		put32(pkt+12, j);
+		put32(pkt+16, numPackets);
+		put32(pkt+20, num);
+		put32(pkt+24, first);
+		for(int k=0; k<3; ++k){
+			putf(pkt+28+4*k, lo[k]);
+			putf(pkt+40+4*k, step[k]);
+		}
+
+		char * dst = pkt + HEADER_SIZE;
+		const Vec3f * src = positions + first;
+		for(int i=0; i<count; ++i){
+			put16(dst  , quantize(src[i][0], lo[0], invStep[0]));
+			put16(dst+2, quantize(src[i][1], lo[1], invStep[1]));
+			put16(dst+4, quantize(src[i][2], lo[2], invStep[2]));
+			dst += kPositionSize;
+		}
+		if(withColors){
+			memcpy(dst, colors + first, count*kColorSize);
+			dst += count*kColorSize;
+		}
+
+		mSizes[j] = dst - pkt;
+	}
+
+	return numPackets;
+}
+
+int PointCloudEncoder::encode(const Vec3f * positions, const Color * colors, int num){
+	if(!colors) return encode(positions, (const Colori *)0, num);
+	mColors.resize(num > 0 ? num : 1);
+	for(int i=0; i<num; ++i) mColors[i] = colors[i];
+	return encode(positions, &mColors[0], num);
+}
+
+int PointCloudEncoder::encode(const Mesh& m){
+	int n = m.vertices().size();
+	const Vec3f * pos = n ? &m.vertices()[0] : 0;
+	if(n && m.coloris().size() == n) return encode(pos, &m.coloris()[0], n);
+	if(n && m.colors().size() == n) return encode(pos, &m.colors()[0], n);
+	return encode(pos, (const Colori *)0, n);
+}
+
+
+
+PointCloudDecoder::PointCloudDecoder(int maxPts)
+:	mFrameId(0), mHasColors(false),
+	mNextId(0), mNextRemaining(0), mNextHasColors(false),
+	mAssembling(false), mAnyFrame(false), mMaxPoints(0),
+	mFramesCompleted(0), mFramesDropped(0),
+	mPacketsDecoded(0), mPacketsInvalid(0)
+{
+	maxPoints(maxPts);
+}
+
+PointCloudDecoder& PointCloudDecoder::maxPoints(int n){
+	mMaxPoints = n > 0 ? n : 0;
+	return *this;
+}
+
+bool PointCloudDecoder::decode(const char * pkt, int size){
+
+	if(size < PointCloudEncoder::HEADER_SIZE
+		|| uint8_t(pkt[0]) != kMagic0 || uint8_t(pkt[1]) != kMagic1
+		|| uint8_t(pkt[2]) != kVersion
+	){
+		++mPacketsInvalid;
+		return false;
+	}
+
+	const bool withColors = pkt[3] & kFlagColors;
+	const uint32_t count	= get16(pkt+ 4);
+	const uint32_t id		= get32(pkt+ 8);
+	const uint32_t index	= get32(pkt+12);
+	const uint32_t numPackets = get32(pkt+16);
+	const uint32_t num		= get32(pkt+20);
+	const uint32_t first	= get32(pkt+24);
+
+	// Reject anything inconsistent, in particular sizes that would make us
+	// allocate more memory than allowed or than the datagrams could ever
+	// fill. Every datagram but that of an empty frame has at least one point.
+	const int pointSize = kPositionSize + (withColors ? kColorSize : 0);
+	if(	index >= numPackets || numPackets > uint32_t(PointCloudEncoder::MAX_PACKETS)
+		|| num > uint32_t(mMaxPoints)
+		|| numPackets > (num ? num : 1)
+		|| uint64_t(num) > uint64_t(numPackets) * kMaxPacketPoints
+		|| first > num || count > num - first
+		|| PointCloudEncoder::HEADER_SIZE + int(count)*pointSize > size
+	){
+		++mPacketsInvalid;
+		return false;
+	}
+
+	if(!(mAssembling && id == mNextId)){
+		// Serial number arithmetic so that ids may wrap around
+		uint32_t ref = mAssembling ? mNextId : mFrameId;
+		bool newer = !(mAssembling || mAnyFrame) || int32_t(id - ref) > 0;
+		if(!newer){
+			++mPacketsInvalid;
+			return false;
+		}
+		if(mAssembling) ++mFramesDropped;
+		mAssembling = true;
+		mNextId = id;
+		mNextRemaining = numPackets;
+		mNextHasColors = withColors;
+		mNextPositions.resize(num);
+		mNextColors.resize(withColors ? num : 0);
+		mReceived.assign(numPackets, 0);
+	}
+	else if(mReceived.size() != numPackets || mNextPositions.size() != num
+		|| mNextHasColors != withColors || mReceived[index]
+	){
+		// inconsistent with the frame's earlier datagrams, or a duplicate
+		++mPacketsInvalid;
+		return false;
+	}
+
+	mReceived[index] = 1;
+	++mPacketsDecoded;
+
+	Vec3f lo, step;
+	for(int k=0; k<3; ++k){
+		lo[k] = getf(pkt+28+4*k);
+		step[k] = getf(pkt+40+4*k);
+	}
+
+	const char * src = pkt + PointCloudEncoder::HEADER_SIZE;
+	Vec3f * dst = count ? &mNextPositions[first] : 0;
+	for(uint32_t i=0; i<count; ++i){
+		dst[i].set(
+			lo[0] + step[0] * get16(src  ),
+			lo[1] + step[1] * get16(src+2),
+			lo[2] + step[2] * get16(src+4)
+		);
+		src += kPositionSize;
+	}
+	if(withColors && count){
+		memcpy(&mNextColors[first], src, count*kColorSize);
+	}
+
+	if(--mNextRemaining == 0){
+		mPositions.swap(mNextPositions);
+		mColors.swap(mNextColors);
+		mHasColors = mNextHasColors;
+		mFrameId = mNextId;
+		mAssembling = false;
+		mAnyFrame = true;
+		++mFramesCompleted;
+		return true;
+	}
+	return false;
+}
+
+void PointCloudDecoder::copyTo(Mesh& m) const {
+	int n = size();
+	m.vertices().size(n);
+	for(int i=0; i<n; ++i) m.vertices()[i] = mPositions[i];
+	if(mHasColors){
+		m.colors().size(n);
+		for(int i=0; i<n; ++i) m.colors()[i] = mColors[i];
+	}
+}
+
+void PointCloudDecoder::copyTo(Array& positions) const {
+	int n = size();
+	positions.format(3, AlloFloat32Ty, n);
+	float * dst = (float *)positions.data.ptr;
+	for(int i=0; i<n; ++i){
+		dst[3*i  ] = mPositions[i][0];
+		dst[3*i+1] = mPositions[i][1];
+		dst[3*i+2] = mPositions[i][2];
+	}
+}
+
+
+
+int PointCloudSend::send(const Vec3f * positions, const Colori * colors, int num){
+	encode(positions, colors, num);
+	return sendPackets();
+}
+
+int PointCloudSend::send(const Mesh& m){
+	encode(m);
+	return sendPackets();
+}
+
+int PointCloudSend::sendPackets(){
+	int sent = 0;
+	for(int i=0; i<numPackets(); ++i){
+		if(Socket::send(packet(i), packetSize(i)) == size_t(packetSize(i))) ++sent;
+	}
+	return sent;
+}
+
+bool PointCloudRecv::recv(){
+	bool completed = false;
+	const bool blocking = timeout() != 0;
+	size_t n;
+	while((n = Socket::recv(&mBuffer[0], mBuffer.size())) > 0){
+		if(decode(&mBuffer[0], n)) completed = true;
+		if(blocking) break;
+	}
+	return completed;
+}
+
+} // al::
@@ -1,7 +1,26 @@
+#include <algorithm>
+#include <float.h>
 #include "allocore/sound/al_AudioScene.hpp"
+#include "allocore/system/al_TaskPool.hpp"
+#include "allocore/system/al_Trace.hpp"
 
 namespace al{
 
+// Memory holding the delay-lines of many sources. It is freed by its last
+// user, the scene or a source.
+class DelayPool{
+public:
+	std::vector<float> samples;
+	std::vector<uint16_t> halves;
+
+	DelayPool(): mUsers(1){}
+	void retain(){ ++mUsers; }
+	void release(){ if(0 == --mUsers) delete this; }
+
+private:
+	int mUsers;
+};
+
 Spatializer::Spatializer(const SpeakerLayout& sl){
 	unsigned numSpeakers = sl.speakers().size();
 	for(unsigned i=0;i<numSpeakers;++i){
@@ -50,7 +69,10 @@ SoundSource::SoundSource(
 	double farBias, int delaySize
 )
 :	DistAtten<double>(nearClip, farClip, law, farBias),
-	mSound(delaySize), mUseAtten(true), mUseDoppler(true)
+	mSound(delaySize), mSamples(&mSound[0]), mHalves(0), mPool(0),
+	mSize(delaySize), mPos(delaySize-1),
+	mPeaks((delaySize + PEAK_SEGMENT-1) / PEAK_SEGMENT, 0.f), mSlot(-1),
+	mUseAtten(true), mUseDoppler(true)
 {
 	// initialize the position history to be VERY FAR AWAY so that we don't deafen ourselves...
 	for(int i=0; i<mPosHistory.size(); ++i){
@@ -58,6 +80,116 @@ SoundSource::SoundSource(
 	}
 }
 
+SoundSource::SoundSource(const SoundSource& other)
+:	AudioSceneObject(other), DistAtten<double>(other),
+	mSamples(0), mHalves(0), mPool(0), mSize(0), mPos(0), mSlot(-1)
+{
+	*this = other;
+}
+
+SoundSource::~SoundSource(){
+	if(mPool) mPool->release();
+}
+
+SoundSource& SoundSource::operator=(const SoundSource& other){
+	if(this != &other){
+		AudioSceneObject::operator=(other);
+		DistAtten<double>::operator=(other);
+		mUseAtten = other.mUseAtten;
+		mUseDoppler = other.mUseDoppler;
+
+		// A copy always gets a delay-line of its own, and keeps its slot
+		mSound.resize(other.mSize);
+		for(int i=0; i<other.mSize; ++i){
+			mSound[i] = other.mSamples ? other.mSamples[i] : halfToFloat(other.mHalves[i]);
+		}
+		mSamples = &mSound[0];
+		mHalves = 0;
+		if(mPool) mPool->release();
+		mPool = 0;
+		mSize = other.mSize;
+		mPos = other.mPos;
+		mPeaks = other.mPeaks;
+	}
+	return *this;
+}
+
+void SoundSource::storage(int size, DelayPool * pool, unsigned offset){
+	// Copy newest samples, oldest first, so that the newest ends at size-1
+	std::vector<float> hist(size < mSize ? size : mSize);
+	const int n = hist.size();
+	for(int i=0; i<n; ++i) hist[i] = read(n-1-i);
+
+	if(pool){
+		pool->retain();
+		std::vector<float>().swap(mSound);
+		mSamples = pool->samples.empty() ? 0 : &pool->samples[offset];
+		mHalves = pool->halves.empty() ? 0 : &pool->halves[offset];
+	}
+	else{
+		mSound.resize(size);
+		mSamples = &mSound[0];
+		mHalves = 0;
+	}
+	if(mPool) mPool->release();
+	mPool = pool;
+	mSize = size;
+	mPos = size-1;
+
+	for(int i=0; i<size; ++i){
+		float v = i < size-n ? 0.f : hist[i-(size-n)];
+		if(mSamples)	mSamples[i] = v;
+		else			mHalves[i] = floatToHalf(v);
+	}
+
+	// Segments may now hold older samples than before, so their peaks are
+	// taken over their whole contents
+	mPeaks.assign((size + PEAK_SEGMENT-1) / PEAK_SEGMENT, 0.f);
+	for(int i=size-n; i<size; ++i){
+		float a = fabs(hist[i-(size-n)]);
+		float& p = mPeaks[i / PEAK_SEGMENT];
+		if(a > p) p = a;
+	}
+}
+
+void SoundSource::readSamples(float * dst, int index, int n) const {
+	if(mHalves){
+		for(int i=0; i<n; ++i) dst[i] = read(index + n - i);
+		return;
+	}
+	int a = mPos - (index + n);
+	if(a < 0) a += mSize;
+	const int n1 = n < mSize - a ? n : mSize - a;
+	memcpy(dst, mSamples + a, n1 * sizeof(float));
+	memcpy(dst + n1, mSamples, (n - n1) * sizeof(float));
+}
+
+float SoundSource::peak(int from, int to) const {
+	const int size = mSize;
+
+	// The segment being written still holds the oldest samples, whose peak
+	// was reset when writing into the segment began
+	if(to > size - PEAK_SEGMENT) return FLT_MAX;
+	if(from < 0) from = 0;
+
+	int a0 = mPos - to;
+	int a1 = mPos - from;
+	if(a0 < 0) a0 += size;
+	if(a1 < 0) a1 += size;
+	const int s0 = a0 / PEAK_SEGMENT;
+	const int s1 = a1 / PEAK_SEGMENT;
+
+	float p = 0;
+	if(a0 <= a1){
+		for(int k=s0; k<=s1; ++k) if(mPeaks[k] > p) p = mPeaks[k];
+	}
+	else{
+		for(int k=s0; k<int(mPeaks.size()); ++k) if(mPeaks[k] > p) p = mPeaks[k];
+		for(int k=0; k<=s1; ++k) if(mPeaks[k] > p) p = mPeaks[k];
+	}
+	return p;
+}
+
 /*static*/
 int SoundSource::bufferSize(double samplerate, double speedOfSound, double distance){
 	return (int)ceil(samplerate * distance / speedOfSound);
@@ -66,12 +198,16 @@ int SoundSource::bufferSize(double samplerate, double speedOfSound, double dista
 
 
 AudioScene::AudioScene(int numFrames_)
-:   mNumFrames(0), mSpeedOfSound(344), mPerSampleProcessing(false)
+:   mNumFrames(0), mNumSlots(0), mNumPositions(0), mSpeedOfSound(344), mPool(0), mDelayPool(0),
+	mCullLevel(0), mLodLevel(0), mLodDistance(HUGE_VAL), mLodHysteresis(0.1),
+	mNumCulled(0), mNumDemoted(0), mPerSampleProcessing(false)
 {
 	numFrames(numFrames_);
+	lodAngle(10);
 }
 
 AudioScene::~AudioScene(){
+	if(mDelayPool) mDelayPool->release();
 	for(
 		Listeners::iterator it = mListeners.begin();
 		it != mListeners.end();
@@ -82,16 +218,81 @@ AudioScene::~AudioScene(){
 }
 
 void AudioScene::addSource(SoundSource& src){
+	if(std::find(mSources.begin(), mSources.end(), &src) != mSources.end()) return;
+	if(mFreeSlots.empty()){
+		src.mSlot = mNumSlots++;
+		for(unsigned i=0; i<mListeners.size(); ++i){
+			mListeners[i]->mSpatializer->numSources(mNumSlots);
+		}
+	}
+	else{
+		src.mSlot = mFreeSlots.back();
+		mFreeSlots.pop_back();
+	}
+	for(unsigned i=0; i<mListeners.size(); ++i){
+		mListeners[i]->mSpatializer->resetSource(src.mSlot);
+	}
 	mSources.push_back(&src);
+	resizeBlocks();
+	for(unsigned i=0; i<mListeners.size(); ++i){
+		mDemoted[src.mSlot * mListeners.size() + i] = 0;
+	}
 }
 
 void AudioScene::removeSource(SoundSource& src){
+	if(std::find(mSources.begin(), mSources.end(), &src) == mSources.end()) return;
 	mSources.remove(&src);
+	for(unsigned i=0; i<mListeners.size(); ++i){
+		mListeners[i]->mSpatializer->resetSource(src.mSlot);
+	}
+	mFreeSlots.push_back(src.mSlot);
+	src.mSlot = -1;
+}
+
+void AudioScene::compactDelays(double sampleRate, bool halfPrecision){
+	// Size delay-lines for their far clip, a block and the segment that
+	// peaks are not tracked for, and start each on a 64 byte cache line
+	const unsigned elemSize = halfPrecision ? sizeof(uint16_t) : sizeof(float);
+	const unsigned line = 64 / elemSize;	// elements per cache line
+	std::vector<int> sizes;
+	unsigned total = 0;
+	for(Sources::iterator it = mSources.begin(); it != mSources.end(); ++it){
+		SoundSource& src = *(*it);
+		int size = mNumFrames + 2 + SoundSource::PEAK_SEGMENT;
+		if(src.useDoppler()){
+			size += SoundSource::bufferSize(sampleRate, mSpeedOfSound, src.farClip());
+		}
+		sizes.push_back(size);
+		total += (size + line-1) & ~(line-1);
+	}
+
+	// Move sources out of the old pool into the new one. Vectors are only
+	// aligned to their elements, so a line is added to align the first.
+	DelayPool * pool = new DelayPool;
+	const char * base;
+	if(halfPrecision){
+		pool->halves.resize(total + line);
+		base = (const char *)&pool->halves[0];
+	}
+	else{
+		pool->samples.resize(total + line);
+		base = (const char *)&pool->samples[0];
+	}
+
+	unsigned offset = ((64 - size_t(base) % 64) % 64) / elemSize;
+	int is = 0;
+	for(Sources::iterator it = mSources.begin(); it != mSources.end(); ++it, ++is){
+		(*it)->storage(sizes[is], pool, offset);
+		offset += (sizes[is] + line-1) & ~(line-1);
+	}
+
+	if(mDelayPool) mDelayPool->release();
+	mDelayPool = pool;
 }
 
 void AudioScene::numFrames(int v){
 	if(mNumFrames != v){
-		mBuffer.resize(v);
+		mIndices.resize(v);
 
 		Listeners::iterator it = mListeners.begin();
 		while(it != mListeners.end()){
@@ -99,16 +300,69 @@ void AudioScene::numFrames(int v){
 			++it;
 		}
 		mNumFrames = v;
+		resizeBlocks();
 	}
 }
 
 Listener * AudioScene::createListener(Spatializer* spatializer){
 	Listener * l = new Listener(mNumFrames, spatializer);
+	spatializer->numSources(mNumSlots);
     l->compile();
 	mListeners.push_back(l);
+	mPositions.resize(mListeners.size());
+	mDemoted.assign(mNumSlots * mListeners.size(), 0);
+	resizeBlocks();
 	return l;
 }
 
+AudioScene& AudioScene::parallel(TaskPool * pool){
+	mPool = pool;
+	return *this;
+}
+
+AudioScene& AudioScene::lodAngle(double degrees){
+	// Snapping direction components to steps of 1/n moves directions by at
+	// most about 1/n radians
+	mLodSteps = degrees > 0 ? ceil(180. / (M_PI * degrees)) : 1e6;
+	return *this;
+}
+
+// Source blocks are allocated up front for the worst case of every listener
+// at a different position, so rendering does not allocate.
+void AudioScene::resizeBlocks(){
+	unsigned num = mSources.size() * mListeners.size();
+	if(mDetail.size() < num) mDetail.resize(num);
+	if(mBlocks.size() < num * mNumFrames) mBlocks.resize(num * mNumFrames);
+	if(mDemoted.size() < mNumSlots * mListeners.size()){
+		mDemoted.resize(mNumSlots * mListeners.size(), 0);
+	}
+}
+
+bool AudioScene::listenersIndependent(){
+	std::fill(mChannelUsed.begin(), mChannelUsed.end(), 0);
+	for(unsigned il=0; il<mListeners.size(); ++il){
+		Spatializer * spatializer = mListeners[il]->mSpatializer;
+		for(unsigned j=0; j<il; ++j){
+			if(mListeners[j]->mSpatializer == spatializer) return false;
+		}
+		const Speakers& speakers = spatializer->speakers();
+		for(unsigned k=0; k<speakers.size(); ++k){
+			unsigned chan = speakers[k].deviceChannel;
+			if(chan >= mChannelUsed.size()) mChannelUsed.resize(chan+1, 0);
+			if(mChannelUsed[chan] && mChannelUsed[chan] != char(il+1)) return false;
+			mChannelUsed[chan] = il+1;
+		}
+	}
+	return true;
+}
+
+struct AudioScene::ListenerRender{
+	AudioScene& scene;
+	AudioIOData& io;
+	ListenerRender(AudioScene& s, AudioIOData& i): scene(s), io(i){}
+	void operator()(int index){ scene.renderListener(io, index); }
+};
+
 /*
 	So, for large numbers of sources it quickly gets too expensive.
 	Having one delayline per soundsource (for doppler) is itself quite taxing.
@@ -117,15 +371,155 @@ Listener * AudioScene::createListener(Spatializer* spatializer){
 	The head-size sets the effective doppler near-clip.
 */
 void AudioScene::render(AudioIOData& io){
-    const int numFrames = io.framesPerBuffer();
-    double sampleRate = io.framesPerSecond();
-	double distanceToSample = sampleRate / mSpeedOfSound;
+	AL_TRACE_ZONE_RT("AudioScene::render");
 
 	// update source history data:
 	for(Sources::iterator it = mSources.begin(); it != mSources.end(); it++) {
 		(*it)->updateHistory();
 	}
 
+	if(mPerSampleProcessing){
+		renderPerSample(io);
+		return;
+	}
+
+    const int numFrames = io.framesPerBuffer();
+    double sampleRate = io.framesPerSecond();
+	const int numListeners = mListeners.size();
+
+	// Listeners at the same position share their source blocks
+	if(mPositions.size() < unsigned(numListeners)) mPositions.resize(numListeners);
+	mNumPositions = 0;
+	for(int il=0; il<numListeners; ++il){
+		int j = 0;
+		while(j < il && mListeners[j]->pos() != mListeners[il]->pos()) ++j;
+		mPositions[il] = j < il ? mPositions[j] : mNumPositions++;
+	}
+
+	if(mIndices.size() < unsigned(numFrames)) mIndices.resize(numFrames);
+	unsigned blocksSize = mSources.size() * mNumPositions * numFrames;
+	if(mBlocks.size() < blocksSize) mBlocks.resize(blocksSize);
+	if(mDetail.size() < mSources.size() * mNumPositions){
+		mDetail.resize(mSources.size() * mNumPositions);
+	}
+	mNumCulled = mNumDemoted = 0;
+
+	// Read and attenuate each source once per listener position
+	int is = 0;
+	for(Sources::iterator it = mSources.begin(); it != mSources.end(); ++it, ++is){
+		SoundSource& src = *(*it);
+
+		// scalar factor to convert distances into delayline indices
+		double distanceToSample = src.useDoppler() ? sampleRate / mSpeedOfSound : 0;
+
+		for(int il=0, ip=0; il<numListeners; ++il){
+			if(mPositions[il] != ip) continue;
+			++ip;
+
+			Vec3d relpos = src.pose().pos() - mListeners[il]->pose().pos();
+			double distance = relpos.mag();
+			double gain = src.attenuation(distance);
+			const int ib = is*mNumPositions + mPositions[il];
+			float * block = &mBlocks[ib * numFrames];
+
+			// Cull and demote sources from the peak of the samples to be read
+			double delay = distance * distanceToSample;
+			int readIndex = delay < src.maxIndex() ? int(delay) : src.maxIndex();
+			float level = src.peak(readIndex, readIndex + numFrames + 1) * gain;
+			if(level <= mCullLevel || readIndex + numFrames > src.maxIndex()){
+				mDetail[ib] = DETAIL_CULLED;
+				++mNumCulled;
+				continue;
+			}
+
+			// Demoted sources must clear the thresholds by a margin to be
+			// promoted again. The first listener at this position decides
+			// for all listeners sharing it.
+			char * demotedBySlot = &mDemoted[src.mSlot * numListeners];
+			char demoted = demotedBySlot[il];
+			if(demoted){
+				demoted = distance > mLodDistance * (1. - mLodHysteresis)
+					|| level <= mLodLevel * (1. + mLodHysteresis);
+			}
+			else{
+				demoted = distance > mLodDistance || level < mLodLevel;
+			}
+			for(int jl=il; jl<numListeners; ++jl){
+				if(mPositions[jl] == mPositions[il]) demotedBySlot[jl] = demoted;
+			}
+
+			if(demoted){
+				// Keep the delay, but not its fraction
+				mDetail[ib] = DETAIL_LOW;
+				++mNumDemoted;
+				src.readSamples(block, readIndex, numFrames);
+			}
+			else{
+				mDetail[ib] = DETAIL_FULL;
+				for(int i = 0; i < numFrames; i++)
+				{
+					mIndices[i] = delay + (numFrames-i);
+				}
+				src.readSamples(block, &mIndices[0], numFrames);
+			}
+			for(int i = 0; i < numFrames; i++)
+			{
+				block[i] *= gain;
+			}
+		}
+	}
+
+	// Spatialize
+	if(mPool && mPool->size() && numListeners > 1 && listenersIndependent()){
+		ListenerRender func(*this, io);
+		mPool->parallelFor(0, numListeners, func);
+	}
+	else{
+		for(int il=0; il<numListeners; ++il) renderListener(io, il);
+	}
+}
+
+void AudioScene::renderListener(AudioIOData& io, int index){
+	const int numFrames = io.framesPerBuffer();
+	Listener& l = *mListeners[index];
+	Spatializer* spatializer = l.mSpatializer;
+	spatializer->prepare(io);
+
+	// update listener history data:
+	l.updateHistory(numFrames);
+
+	int is = 0;
+	for(Sources::iterator it = mSources.begin(); it != mSources.end(); ++it, ++is){
+		SoundSource& src = *(*it);
+		const int ib = is*mNumPositions + mPositions[index];
+		if(DETAIL_CULLED == mDetail[ib]){
+			// so it doesn't ramp from stale gains when it returns
+			spatializer->resetSource(src.mSlot);
+			continue;
+		}
+
+		Vec3d relpos = src.pose().pos() - l.pose().pos();
+		if(DETAIL_LOW == mDetail[ib]){
+			// Snap to a unit vector on a grid of directions; sources at the
+			// listener have no direction to snap
+			double mag = relpos.mag();
+			if(mag > 0){
+				double scale = mLodSteps / mag;
+				for(int i=0; i<3; ++i) relpos[i] = floor(relpos[i] * scale + 0.5);
+				relpos.normalize();
+			}
+		}
+		spatializer->perform(io, src, relpos, numFrames, &mBlocks[ib * numFrames]);
+	}
+
+	spatializer->finalize(io);
+}
+
+void AudioScene::renderPerSample(AudioIOData& io){
+    const int numFrames = io.framesPerBuffer();
+    double sampleRate = io.framesPerSecond();
+	double distanceToSample = sampleRate / mSpeedOfSound;
+
 	// iterate through all listeners adding contribution from all sources
 	for(unsigned il=0; il<mListeners.size(); ++il){
 		Listener& l = *mListeners[il];
@@ -137,7 +531,6 @@ void AudioScene::render(AudioIOData& io){
 		l.updateHistory(numFrames);
 
 		// iterate through all sound sources
-        //printf("audio scene has %d sound sources!!!\n", mSources.size());
 		for(Sources::iterator it = mSources.begin(); it != mSources.end(); ++it){
 			SoundSource& src = *(*it);
 
@@ -146,64 +539,47 @@ void AudioScene::render(AudioIOData& io){
 			// since each source has its own buffersize and far clip
 			// (not physically accurate of course)
             if(src.useDoppler())
-                distanceToSample = distanceToSample;//(src.maxIndex()-numFrames)/src.farClip();
+                distanceToSample = sampleRate / mSpeedOfSound;//(src.maxIndex()-numFrames)/src.farClip();
             else
                 distanceToSample = 0;
 
-            if(mPerSampleProcessing) //Original, inefficient, per sample processing
-            {
-                // iterate time samples
-                for(int i=0; i<numFrames; ++i){
-
-                    // compute interpolated source position relative to listener
-                    // TODO: this tends to warble when moving fast
-                    double alpha = double(i)/numFrames;
-
-                    // moving average:
-                    // cheaper & slightly less warbly than cubic,
-                    // less glitchy than linear
-                    Vec3d relpos = (
-                        (src.posHistory()[3]-l.posHistory()[3])*(1.-alpha) +
-                        (src.posHistory()[2]-l.posHistory()[2]) +
-                        (src.posHistory()[1]-l.posHistory()[1]) +
-                        (src.posHistory()[0]-l.posHistory()[0])*(alpha)
-                    )/3.0;
-
-					// Get distance in world-space units
-                    double dist = relpos.mag();
-
-					// Compute how many samples ago to read from buffer
-					// Start with time delay due to speed of sound
-                    double samplesAgo = dist * distanceToSample;
-
-					// Add on time delay (in samples)
-					samplesAgo += (numFrames-i);
-
-					// Is our delay line big enough?
-					if(samplesAgo <= src.maxIndex()){
-					//if(dist < src.farClip()){
-						double gain = src.attenuation(dist);
-						float s = src.readSample(samplesAgo) * gain;
-						spatializer->perform(io,src,relpos, numFrames, i, s);
-					}
-
-                } //end for each frame
-            } //end per sample processing
-        
-			else //more efficient, per buffer processing
-            {
-                Vec3d relpos = src.pose().pos() - l.pose().pos();
-                double distance = relpos.mag();
-                double gain = src.attenuation(distance);
-
-                for(int i = 0; i < numFrames; i++)
-                {
-                    double readIndex = distance * distanceToSample;
-                    readIndex += (numFrames-i);
-                    mBuffer[i] = gain * src.readSample(readIndex);
-                }
-                spatializer->perform(io, src, relpos, numFrames, &mBuffer[0]);
-            }
+			//Original, inefficient, per sample processing
+			// iterate time samples
+			for(int i=0; i<numFrames; ++i){
+
+				// compute interpolated source position relative to listener
+				// TODO: this tends to warble when moving fast
+				double alpha = double(i)/numFrames;
+
+				// moving average:
+				// cheaper & slightly less warbly than cubic,
+				// less glitchy than linear
+				Vec3d relpos = (
+					(src.posHistory()[3]-l.posHistory()[3])*(1.-alpha) +
+					(src.posHistory()[2]-l.posHistory()[2]) +
+					(src.posHistory()[1]-l.posHistory()[1]) +
+					(src.posHistory()[0]-l.posHistory()[0])*(alpha)
+				)/3.0;
+
+				// Get distance in world-space units
+				double dist = relpos.mag();
+
+				// Compute how many samples ago to read from buffer
+				// Start with time delay due to speed of sound
+				double samplesAgo = dist * distanceToSample;
+
+				// Add on time delay (in samples)
+				samplesAgo += (numFrames-i);
+
+				// Is our delay line big enough?
+				if(samplesAgo <= src.maxIndex()){
+				//if(dist < src.farClip()){
+					double gain = src.attenuation(dist);
+					float s = src.readSample(samplesAgo) * gain;
+					spatializer->perform(io,src,relpos, numFrames, i, s);
+				}
+
+			} //end for each frame
 
 		} //end for each source
 
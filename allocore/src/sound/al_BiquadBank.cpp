@@ -0,0 +1,240 @@
+#include <math.h>
+#include <string.h>
+#include "allocore/sound/al_BiquadBank.hpp"
+
+namespace al{
+
+namespace{
+
+enum{ L = BiquadBank::LANES, V = 4, NV = L/V };
+
+// Four floats operated on at once. GCC and Clang map their vector extension
+// to whatever SIMD registers the target has; elsewhere plain floats are used
+// and left to the compiler to vectorize.
+#if defined(__GNUC__)
+typedef float Vec4 __attribute__((vector_size(16)));
+#else
+struct Vec4{
+	float v[V];
+	Vec4 operator+(const Vec4& o) const { Vec4 r; for(int i=0;i<V;++i) r.v[i]=v[i]+o.v[i]; return r; }
+	Vec4 operator-(const Vec4& o) const { Vec4 r; for(int i=0;i<V;++i) r.v[i]=v[i]-o.v[i]; return r; }
+	Vec4 operator*(const Vec4& o) const { Vec4 r; for(int i=0;i<V;++i) r.v[i]=v[i]*o.v[i]; return r; }
+	Vec4& operator+=(const Vec4& o){ return *this = *this + o; }
+};
+#endif
+
+const float zeros[BiquadBank::BLOCK] = {0};
+
+inline Vec4 load(const float * p){ Vec4 r; memcpy(&r, p, sizeof r); return r; }
+inline void store(float * p, const Vec4& v){ memcpy(p, &v, sizeof v); }
+
+// Filter n interleaved frames through one section, gliding coefficients if
+// asked to. Coefficients and histories are kept in locals so that they stay
+// in registers for the whole block.
+template <bool Glide>
+void filter(float * buf, int n, float * p){
+	Vec4 b0[NV], b1[NV], b2[NV], a1[NV], a2[NV], z1[NV], z2[NV];
+	Vec4 db0[NV], db1[NV], db2[NV], da1[NV], da2[NV];
+	for(int k=0; k<NV; ++k){
+		const int o = k*V;
+		b0[k] = load(p+0*L+o); b1[k] = load(p+1*L+o); b2[k] = load(p+2*L+o);
+		a1[k] = load(p+3*L+o); a2[k] = load(p+4*L+o);
+		z1[k] = load(p+15*L+o); z2[k] = load(p+16*L+o);
+		if(Glide){
+			db0[k] = load(p+10*L+o); db1[k] = load(p+11*L+o); db2[k] = load(p+12*L+o);
+			da1[k] = load(p+13*L+o); da2[k] = load(p+14*L+o);
+		}
+	}
+	for(int i=0; i<n; ++i){
+		float * x = buf + i*L;
+		for(int k=0; k<NV; ++k){
+			if(Glide){
+				b0[k] += db0[k]; b1[k] += db1[k]; b2[k] += db2[k];
+				a1[k] += da1[k]; a2[k] += da2[k];
+			}
+			Vec4 v = load(x + k*V);
+			Vec4 y = b0[k]*v + z1[k];
+			z1[k] = (b1[k]*v + z2[k]) - a1[k]*y;
+			z2[k] = b2[k]*v - a2[k]*y;
+			store(x + k*V, y);
+		}
+	}
+	for(int k=0; k<NV; ++k){
+		const int o = k*V;
+		if(Glide){
+			store(p+0*L+o, b0[k]); store(p+1*L+o, b1[k]); store(p+2*L+o, b2[k]);
+			store(p+3*L+o, a1[k]); store(p+4*L+o, a2[k]);
+		}
+		store(p+15*L+o, z1[k]); store(p+16*L+o, z2[k]);
+	}
+}
+
+}
+
+
+BiquadBank::Coefs BiquadBank::Coefs::lowPass(double freq, double fs){
+	double l = 1./tan(M_PI * freq / fs);
+	double a0 = 1./(1. + M_SQRT2*l + l*l);
+	return Coefs(a0, 2.*a0, a0, 2.*a0*(1. - l*l), a0*(1. - M_SQRT2*l + l*l));
+}
+
+BiquadBank::Coefs BiquadBank::Coefs::highPass(double freq, double fs){
+	double l = tan(M_PI * freq / fs);
+	double a0 = 1./(1. + M_SQRT2*l + l*l);
+	return Coefs(a0, -2.*a0, a0, 2.*a0*(l*l - 1.), a0*(1. - M_SQRT2*l + l*l));
+}
+
+
+BiquadBank::BiquadBank(int channels, int sections)
+:	mChannels(0), mSections(0), mGroups(0), mSmooth(0), mRamp(0), mDirty(false)
+{
+	resize(channels, sections);
+}
+
+BiquadBank& BiquadBank::resize(int channels, int sections){
+	mChannels = channels > 0 ? channels : 0;
+	mSections = sections > 0 ? sections : 0;
+	mGroups = (mChannels + LANES-1) / LANES;
+	mData.assign(mGroups * mSections * STRIDE, 0.f);
+	for(int g=0; g<mGroups; ++g){
+		for(int s=0; s<mSections; ++s){
+			float * p = section(g,s);
+			for(int l=0; l<LANES; ++l) p[COEFS+l] = p[TARGET+l] = 1;
+		}
+	}
+	mRamp = 0;
+	mDirty = false;
+	return *this;
+}
+
+BiquadBank::Coefs BiquadBank::coefs(int sec, int chan) const {
+	const float * p = section(chan / LANES, sec) + TARGET + chan % LANES;
+	return Coefs(p[0], p[LANES], p[2*LANES], p[3*LANES], p[4*LANES]);
+}
+
+void BiquadBank::setTarget(const Coefs& c, int sec, int chan){
+	float * p = section(chan / LANES, sec) + TARGET + chan % LANES;
+	p[0] = c.b0; p[LANES] = c.b1; p[2*LANES] = c.b2;
+	p[3*LANES] = c.a1; p[4*LANES] = c.a2;
+	mDirty = true;
+}
+
+BiquadBank& BiquadBank::coefs(const Coefs& c, int sec, int chan){
+	if(sec >= 0 && sec < mSections && chan >= 0 && chan < mChannels){
+		setTarget(c, sec, chan);
+	}
+	return *this;
+}
+
+BiquadBank& BiquadBank::coefs(const Coefs& c, int sec){
+	if(sec >= 0 && sec < mSections){
+		for(int i=0; i<mChannels; ++i) setTarget(c, sec, i);
+	}
+	return *this;
+}
+
+BiquadBank& BiquadBank::smooth(int frames){
+	mSmooth = frames > 0 ? frames : 0;
+	return *this;
+}
+
+void BiquadBank::startGlide(){
+	if(0 == mSmooth){
+		endGlide();
+		return;
+	}
+	float r = 1.f / mSmooth;
+	for(int k=0; k<mGroups*mSections; ++k){
+		float * p = &mData[k*STRIDE];
+		for(int i=0; i<5*LANES; ++i) p[DELTA+i] = (p[TARGET+i] - p[COEFS+i]) * r;
+	}
+	mRamp = mSmooth;
+}
+
+void BiquadBank::endGlide(){
+	for(int k=0; k<mGroups*mSections; ++k){
+		float * p = &mData[k*STRIDE];
+		for(int i=0; i<5*LANES; ++i) p[COEFS+i] = p[TARGET+i];
+	}
+	mRamp = 0;
+}
+
+void BiquadBank::clear(){
+	endGlide();
+	mDirty = false;
+	for(int k=0; k<mGroups*mSections; ++k){
+		float * p = &mData[k*STRIDE];
+		for(int i=0; i<2*LANES; ++i) p[STATE+i] = 0;
+	}
+}
+
+void BiquadBank::process(float * const * out, const float * const * in, int frames){
+
+	// Coefficient changes since the last block start a new glide
+	if(mDirty){
+		startGlide();
+		mDirty = false;
+	}
+
+	const int ramp = mRamp < frames ? mRamp : frames;
+
+	for(int g=0; g<mGroups; ++g){
+		const int c0 = g*LANES;
+		const int nl = mChannels - c0 < LANES ? mChannels - c0 : LANES;
+
+		bool any = false;
+		for(int l=0; l<nl; ++l) any |= (out[c0+l] != 0);
+
+		if(!any){
+			// Keep coefficients on course in case outputs come back mid-glide
+			for(int s=0; s<mSections && ramp; ++s){
+				float * p = section(g,s);
+				for(int i=0; i<5*LANES; ++i) p[COEFS+i] += p[DELTA+i] * ramp;
+			}
+			continue;
+		}
+
+		for(int i0=0; i0<frames; i0+=BLOCK){
+			const int n = frames - i0 < BLOCK ? frames - i0 : BLOCK;
+
+			const float * src[LANES];
+			for(int l=0; l<LANES; ++l){
+				src[l] = l < nl && in[c0+l] ? in[c0+l] + i0 : zeros;
+			}
+			for(int i=0; i<n; ++i){
+				for(int l=0; l<LANES; ++l) mBuf[i*LANES + l] = src[l][i];
+			}
+
+			int nr = ramp - i0;
+			if(nr < 0) nr = 0;
+			else if(nr > n) nr = n;
+
+			for(int s=0; s<mSections; ++s){
+				float * p = section(g,s);
+				if(nr) filter<true>(mBuf, nr, p);
+				filter<false>(mBuf + nr*LANES, n - nr, p);
+			}
+
+			for(int l=0; l<nl; ++l){
+				float * dst = out[c0+l];
+				const float * src = mBuf + l;
+				if(dst) for(int i=0; i<n; ++i) dst[i0+i] = src[i*LANES];
+			}
+		}
+
+		// Flush histories well before they become denormal
+		for(int s=0; s<mSections; ++s){
+			float * z = section(g,s) + STATE;
+			for(int i=0; i<2*LANES; ++i){
+				if(fabsf(z[i]) < 1e-25f) z[i] = 0;
+			}
+		}
+	}
+
+	if(ramp){
+		mRamp -= ramp;
+		if(0 == mRamp) endGlide();
+	}
+}
+
+} // al::
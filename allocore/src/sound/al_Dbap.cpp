@@ -1,10 +1,14 @@
+#include <algorithm>
 #include "allocore/sound/al_Dbap.hpp"
 
 namespace al{
 
 Dbap::Dbap(const SpeakerLayout &sl, float spread)
-:	Spatializer(sl), mListener(NULL), mNumSpeakers(0), mSpread(spread)
-{}
+:	Spatializer(sl), mListener(NULL), mNumSpeakers(0), mSpread(spread),
+	mGainThreshold(0), mGeneration(0)
+{
+	mUncached.valid = false;
+}
 
 void Dbap::compile(Listener& listener){
 	mListener = &listener;
@@ -13,26 +17,151 @@ void Dbap::compile(Listener& listener){
 
 	for(int i = 0; i < mNumSpeakers; i++)
 	{
-		mSpeakerVecs[i] = mSpeakers[i].vec();
-		mSpeakerVecs[i].normalize();
+		Vec3f v = mSpeakers[i].vec();
+		v.normalize();
+		mSpeakerX[i] = v[0];
+		mSpeakerY[i] = v[1];
+		mSpeakerZ[i] = v[2];
 		mDeviceChannels[i] = mSpeakers[i].deviceChannel;
 	}
+	for(unsigned i=0; i<mCache.size(); ++i) resize(mCache[i]);
+	resize(mUncached);
+	++mGeneration;
+}
+
+void Dbap::numFrames(int v){
+	mRamped.resize(v);
+}
+
+void Dbap::numSources(int v){
+	unsigned old = mCache.size();
+	mCache.resize(v);
+	for(unsigned i=old; i<mCache.size(); ++i){
+		mCache[i].valid = false;
+		resize(mCache[i]);
+	}
+}
+
+void Dbap::resetSource(int slot){
+	if(slot >= 0 && slot < int(mCache.size())) mCache[slot].valid = false;
+}
+
+void Dbap::clearCache(){
+	for(unsigned i=0; i<mCache.size(); ++i) mCache[i].valid = false;
+}
+
+// Gains are sized up front so that rendering does not allocate
+void Dbap::resize(SourceGains& c){
+	if(c.curr.size() != unsigned(mNumSpeakers)){
+		c.curr.resize(mNumSpeakers);
+		c.prev.resize(mNumSpeakers);
+		c.active.reserve(mNumSpeakers);
+		c.valid = false;
+	}
+}
+
+void Dbap::gains(float * g, const Vec3d& relpos) const {
+	Vec3d dir = relpos.normalized();
+	const float x = dir[0], y = dir[1], z = dir[2];
+
+	// Speaker vectors are stored by component so the distance loop
+	// vectorizes; the powf loop only does with a vector math library (e.g.
+	// libmvec with -ffast-math). The distance to each speaker is
+	// |dir - speaker|/2, in [0, 1]; raising its square to spread/2 saves a
+	// square root.
+	for (int k = 0; k < mNumSpeakers; ++k)
+	{
+		float dx = x - mSpeakerX[k];
+		float dy = y - mSpeakerY[k];
+		float dz = z - mSpeakerZ[k];
+		g[k] = (dx*dx + dy*dy + dz*dz) * 0.25f;
+	}
+
+	const float e = 0.5f * mSpread;
+	for (int k = 0; k < mNumSpeakers; ++k)
+	{
+		g[k] = 1.f / (1.f + DBAP_MAX_DIST * powf(g[k], e));
+	}
+}
+
+Dbap::SourceGains& Dbap::update(const SoundSource& src, const Vec3d& relpos){
+	const int slot = src.slot();
+	SourceGains& c = slot >= 0 && slot < int(mCache.size()) ? mCache[slot] : mUncached;
+
+	if(!c.valid || &c == &mUncached){
+		// First block of the source: start at its gains without a ramp
+		if(mNumSpeakers){
+			gains(&c.curr[0], relpos);
+			std::copy(c.curr.begin(), c.curr.end(), c.prev.begin());
+		}
+		c.ramp = false;
+		c.valid = true;
+	}
+	else if(relpos != c.relpos || c.generation != mGeneration){
+		// Ramp from where the last block ended
+		c.prev.swap(c.curr);
+		gains(&c.curr[0], relpos);
+		c.ramp = true;
+	}
+	else if(c.ramp){
+		// Ramp finished last block
+		std::copy(c.curr.begin(), c.curr.end(), c.prev.begin());
+		c.ramp = false;
+	}
+	else{
+		return c;
+	}
+
+	c.relpos = relpos;
+	c.generation = mGeneration;
+
+	c.active.clear();
+	for (int k = 0; k < mNumSpeakers; ++k)
+	{
+		if(c.curr[k] >= mGainThreshold || c.prev[k] >= mGainThreshold){
+			c.active.push_back(k);
+		}
+	}
+	return c;
 }
 
 void Dbap::perform(
 	AudioIOData& io, SoundSource& src, Vec3d& relpos, const int& numFrames, float *samples
 ){
-	for (int k = 0; k < mNumSpeakers; ++k)
-	{
-		Vec3d vec = relpos.normalized();
-		vec -= mSpeakerVecs[k];
-		float dist = vec.mag() / 2.f; // [0, 1]
-		dist = powf(dist, mSpread);
-		float gain = 1.f / (1.f + DBAP_MAX_DIST*dist);
+	const SourceGains& c = update(src, relpos);
+	const int numActive = c.active.size();
 
-		float * out = io.outBuffer(mDeviceChannels[k]);
+	if(c.ramp){
+		// The ramp g0 + (g1-g0)*(i+1)/numFrames is split into two
+		// multiply-adds, the second on samples scaled by the ramp once for
+		// all speakers
+		if(int(mRamped.size()) < numFrames) mRamped.resize(numFrames);
+		float * ramped = &mRamped[0];
+		const float invFrames = 1.f / numFrames;
 		for(int i = 0; i < numFrames; ++i){
-			out[i] += gain * samples[i];
+			ramped[i] = samples[i] * float(i+1) * invFrames;
+		}
+
+		for (int j = 0; j < numActive; ++j)
+		{
+			const int k = c.active[j];
+			const float g0 = c.prev[k];
+			const float dg = c.curr[k] - g0;
+			float * out = io.outBuffer(mDeviceChannels[k]);
+			for(int i = 0; i < numFrames; ++i){
+				out[i] += g0 * samples[i] + dg * ramped[i];
+			}
+		}
+	}
+	else{
+		for (int j = 0; j < numActive; ++j)
+		{
+			const int k = c.active[j];
+			const float gain = c.curr[k];
+			float * out = io.outBuffer(mDeviceChannels[k]);
+			for(int i = 0; i < numFrames; ++i){
+				out[i] += gain * samples[i];
+			}
 		}
 	}
 }
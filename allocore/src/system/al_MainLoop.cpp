@@ -1,6 +1,7 @@
 #include "allocore/system/al_MainLoop.hpp"
 #include "allocore/system/al_Config.h"
 #include "allocore/system/al_Printing.hpp"
+#include "allocore/system/al_Trace.hpp"
 
 #include <stdlib.h>		// exit
 #include <algorithm>	// std::find
@@ -12,21 +13,141 @@ extern "C" void al_main_native_attach(al_sec interval);
 extern "C" void al_main_native_enter(al_sec interval);
 extern "C" void al_main_native_stop();
 
+// add (mode>0) or remove (mode=0) a descriptor from the native loop;
+// mode 2 also reports writability
+static void al_main_native_watch(int fd, int mode);
+
 #ifdef AL_LINUX
+	#include <errno.h>
+	#include <string.h>
+	#include <unistd.h>
+	#include <stdint.h>
+	#include <sys/epoll.h>
+	#include <sys/eventfd.h>
+	#include <sys/timerfd.h>
+
+	// The loop waits on an epoll set containing a timerfd for ticks, an
+	// eventfd to wake it up for stop() and all registered event sources.
+	static int gEpollFD = -1;
+	static int gTimerFD = -1;
+	static int gWakeFD = -1;
+
+	static void al_main_native_watch(int fd, int mode){
+		if(gEpollFD < 0) return;
+		if(mode){
+			epoll_event ev;
+			memset(&ev, 0, sizeof(ev));
+			ev.events = EPOLLIN | (mode > 1 ? (uint32_t)EPOLLOUT : 0u);
+			ev.data.fd = fd;
+			if(epoll_ctl(gEpollFD, EPOLL_CTL_ADD, fd, &ev) < 0 && errno == EEXIST){
+				epoll_ctl(gEpollFD, EPOLL_CTL_MOD, fd, &ev);
+			}
+		}
+		else{
+			epoll_ctl(gEpollFD, EPOLL_CTL_DEL, fd, NULL);
+		}
+	}
+
+	static void setTimer(const itimerspec& t){
+		timerfd_settime(gTimerFD, 0, &t, NULL);
+	}
+
+	// Start periodic ticks, the first one interval from now. A zero
+	// itimerspec would disarm the timer, so interval is at least 1 ms.
+	static void armTimer(al_sec interval){
+		if(interval < 0.001) interval = 0.001;
+		itimerspec t;
+		t.it_interval.tv_sec = (time_t)interval;
+		t.it_interval.tv_nsec = (long)((interval - (al_sec)t.it_interval.tv_sec) * 1e9);
+		t.it_value = t.it_interval;
+		setTimer(t);
+	}
+
+	static void disarmTimer(){
+		itimerspec t;
+		memset(&t, 0, sizeof(t));
+		setTimer(t);
+	}
+
 	extern "C" void al_main_native_init(){
-		AL_WARN("Linux native loop not yet implemented");
+		gEpollFD = epoll_create1(EPOLL_CLOEXEC);
+		gTimerFD = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+		gWakeFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if(gEpollFD < 0 || gTimerFD < 0 || gWakeFD < 0){
+			AL_WARN("Could not create native loop (%s)", strerror(errno));
+			return;
+		}
+		al_main_native_watch(gTimerFD, 1);
+		al_main_native_watch(gWakeFD, 1);
 	}
+
 	extern "C" void al_main_native_attach(al_sec interval){}
-	extern "C" void al_main_native_enter(al_sec interval){}
-	extern "C" void al_main_native_stop(){}
+
+	extern "C" void al_main_native_enter(al_sec interval){
+		if(gEpollFD < 0) return;
+		al::Main& M = al::Main::get();
+		// A periodic timerfd expires on a fixed schedule, so ticks don't drift
+		armTimer(interval);
+		epoll_event events[64];
+
+		while(M.isRunning()){
+			int n = epoll_wait(gEpollFD, events, 64, -1);
+			if(n < 0){
+				if(errno == EINTR) continue;
+				AL_WARN("Native loop failed (%s)", strerror(errno));
+				break;
+			}
+			for(int i=0; i<n && M.isRunning(); ++i){
+				int fd = events[i].data.fd;
+				uint64_t count;
+				if(fd == gTimerFD){
+					// count is the number of periods elapsed since the last
+					// read; missed ticks are handled as by the SLEEP driver
+					if(read(gTimerFD, &count, sizeof(count)) > 0){
+						al::DeadlineTimer::Overrun policy = M.timer().overrun();
+						bool resync = count > 1 && policy == al::DeadlineTimer::RESYNC;
+						if(policy != al::DeadlineTimer::CATCH_UP) count = 1;
+						for(uint64_t k=0; k<count && M.isRunning(); ++k) M.tick();
+						if(M.interval() != interval || resync){
+							interval = M.interval();
+							armTimer(interval);
+						}
+					}
+				}
+				else if(fd == gWakeFD){
+					if(read(gWakeFD, &count, sizeof(count))){}
+				}
+				else{
+					unsigned e = events[i].events;
+					M.dispatch(fd, e & (EPOLLIN | EPOLLHUP | EPOLLERR), e & EPOLLOUT);
+				}
+			}
+		}
+
+		disarmTimer();
+	}
+
+	extern "C" void al_main_native_stop(){
+		uint64_t one = 1;
+		if(write(gWakeFD, &one, sizeof(one))){}
+	}
 
 #elif defined AL_WINDOWS
+	static void al_main_native_watch(int fd, int mode){}
+
 	extern "C" void al_main_native_init(){
 		AL_WARN("Win32 native loop not yet implemented");
 	}
 	extern "C" void al_main_native_attach(al_sec interval){}
 	extern "C" void al_main_native_enter(al_sec interval){}
 	extern "C" void al_main_native_stop(){}
+
+#else
+	static void al_main_native_watch(int fd, int mode){}
+#endif
+
+#ifndef AL_WINDOWS
+	#include <poll.h>
 #endif
 
 
@@ -115,6 +236,10 @@ Main::Handler :: ~Handler() {
 	onExit();
 }
 
+Main::FDHandler :: ~FDHandler() {
+	Main::get().remove(*this);
+}
+
 ////////////////////////////////////////////////////////////////
 
 Main::Main()
@@ -126,6 +251,7 @@ Main::Main()
 	mDriver(Main::SLEEP),
 	mActive(false)
 {
+	mTimer.overrun(DeadlineTimer::SKIP);
 	for(unsigned i=0; i<NUM_DRIVERS; ++i){
 		mInited[i] = false;
 	}
@@ -140,7 +266,12 @@ Main& Main::driver(Driver v) {
 	if(!mInited[v]){
 		switch(v){
 			case GLUT: al_main_glut_init(); break;
-			case NATIVE: al_main_native_init(); break;
+			case NATIVE:
+				al_main_native_init();
+				for(unsigned i=0; i<mSources.size(); ++i){
+					al_main_native_watch(mSources[i].fd, mSources[i].write ? 2 : 1);
+				}
+				break;
 			default:;
 		}
 		mInited[v] = true;
@@ -151,6 +282,13 @@ Main& Main::driver(Driver v) {
 }
 
 void Main::tick() {
+	AL_TRACE_ZONE("Main::tick");
+	#ifdef AL_LINUX
+	// the native loop dispatches events as they happen
+	if(mDriver != NATIVE)
+	#endif
+	pollSources();
+
 	al_sec t1 = al_time();
 	mLogicalTime = t1 - mT0;
 
@@ -199,9 +337,10 @@ void Main::start() {
 			case Main::NATIVE: al_main_native_enter(interval()); break;
 			default:
 				// default sleep version
+				mTimer.period(interval()).start();
 				while (mActive) {
 					tick();
-					al_sleep(interval());
+					mTimer.period(interval()).wait();
 				}
 				break;
 		}
@@ -249,6 +388,81 @@ Main& Main::remove(Main::Handler& v) {
 	return *this;
 }
 
+Main& Main::add(int fd, Main::FDHandler& v, bool write) {
+	Source src = { fd, &v, write };
+	std::vector<Source>::iterator it = mSources.begin();
+	while (it != mSources.end() && it->fd != fd) ++it;
+	if (it != mSources.end()) *it = src;
+	else mSources.push_back(src);
+	if (mInited[NATIVE]) al_main_native_watch(fd, write ? 2 : 1);
+	return *this;
+}
+
+Main& Main::remove(int fd) {
+	std::vector<Source>::iterator it = mSources.begin();
+	while (it != mSources.end()) {
+		if (it->fd == fd) {
+			if (mInited[NATIVE]) al_main_native_watch(fd, 0);
+			it = mSources.erase(it);
+		}
+		else ++it;
+	}
+	return *this;
+}
+
+Main& Main::remove(Main::FDHandler& v) {
+	std::vector<Source>::iterator it = mSources.begin();
+	while (it != mSources.end()) {
+		if (it->handler == &v) {
+			if (mInited[NATIVE]) al_main_native_watch(it->fd, 0);
+			it = mSources.erase(it);
+		}
+		else ++it;
+	}
+	return *this;
+}
+
+Main::Source * Main::findSource(int fd) {
+	for (unsigned i=0; i<mSources.size(); ++i) {
+		if (mSources[i].fd == fd) return &mSources[i];
+	}
+	return NULL;
+}
+
+void Main::dispatch(int fd, bool readable, bool writable) {
+	// Look the handler up since it may have been removed by another handler
+	Source * src = findSource(fd);
+	if (!src) return;
+	FDHandler * h = src->handler;
+	if (readable) {
+		h->onReadable(fd);
+		// The handler may have removed or replaced itself
+		src = findSource(fd);
+		if (!src || src->handler != h) return;
+	}
+	if (writable && src->write) h->onWritable(fd);
+}
+
+void Main::pollSources() {
+	#ifndef AL_WINDOWS
+	if (mSources.empty()) return;
+
+	// Handlers may add and remove sources, so poll a separate list
+	std::vector<pollfd> fds(mSources.size());
+	for (unsigned i=0; i<fds.size(); ++i) {
+		fds[i].fd = mSources[i].fd;
+		fds[i].events = POLLIN | (mSources[i].write ? POLLOUT : 0);
+		fds[i].revents = 0;
+	}
+	if (poll(&fds[0], fds.size(), 0) > 0) {
+		for (unsigned i=0; i<fds.size(); ++i) {
+			short e = fds[i].revents;
+			if (e) dispatch(fds[i].fd, e & (POLLIN | POLLHUP | POLLERR), e & POLLOUT);
+		}
+	}
+	#endif
+}
+
 
 } //al::
 
@@ -4,15 +4,14 @@
 namespace al{
 
 PeriodicThread::PeriodicThread(double periodSec)
-:	mAutocorrect(0.1)
+:	mUserFunc(0), mRun(false)
 {
 	period(periodSec);
+	autocorrect(0.1);
 }
 
 PeriodicThread::PeriodicThread(const PeriodicThread& o)
-:	Thread(o), mPeriod(o.mPeriod), mTimeCurr(o.mTimeCurr),
-	mTimePrev(o.mTimePrev), mWait(o.mWait), mTimeBehind(o.mTimeBehind),
-	mAutocorrect(o.mAutocorrect),
+:	Thread(o), mTimer(o.mTimer),
 	mUserFunc(o.mUserFunc),
 	mRun(o.mRun)
 {}
@@ -25,17 +24,27 @@ void * PeriodicThread::sPeriodicFunc(void * userData){
 }
 
 PeriodicThread& PeriodicThread::autocorrect(float factor){
-	mAutocorrect=factor;
+	mTimer.catchUpRate(factor);
+	return *this;
+}
+
+PeriodicThread& PeriodicThread::overrun(DeadlineTimer::Overrun v){
+	mTimer.overrun(v);
+	return *this;
+}
+
+PeriodicThread& PeriodicThread::spin(double sec){
+	mTimer.spin(sec);
 	return *this;
 }
 
 PeriodicThread& PeriodicThread::period(double sec){
-	mPeriod=sec * 1e9;
+	mTimer.period(sec);
 	return *this;
 }
 
 double PeriodicThread::period() const {
-	return mPeriod * 1e-9;
+	return mTimer.period();
 }
 
 void PeriodicThread::start(ThreadFunction& func){
@@ -53,10 +62,7 @@ void swap(PeriodicThread& a, PeriodicThread& b){
 	using std::swap;
 	swap(static_cast<Thread&>(a), static_cast<Thread&>(b));
 	#define SWAP_(x) swap(a.x, b.x);
-	SWAP_(mPeriod);
-	SWAP_(mTimeCurr);
-	SWAP_(mTimePrev);
-	SWAP_(mWait);
+	SWAP_(mTimer);
 	SWAP_(mUserFunc);
 	SWAP_(mRun);
 	#undef SWAP_
@@ -68,45 +74,10 @@ PeriodicThread& PeriodicThread::operator= (PeriodicThread other){
 }
 
 void PeriodicThread::go(){
-	// Note: times are al_nsec (long long int)
-	mTimeCurr = al_time_nsec();
-	mWait = 0;
-	mTimeBehind = 0;
+	mTimer.start();
 	while(mRun){
 		(*mUserFunc)();
-
-		mTimePrev = mTimeCurr + mWait;
-		mTimeCurr = al_time_nsec();
-		al_nsec dt = mTimeCurr - mTimePrev;
-		// dt -> t_curr - (t_prev + wait)
-
-		// The wait amount is the ideal period minus the actual amount
-		// of time spent processing between iterations
-		if(dt<mPeriod){
-			mWait = mPeriod - dt;
-			al_sleep_nsec(mWait);
-		}
-
-		// This means we are behind, so don't wait
-		else{
-			mWait = 0;
-			mTimeBehind += dt - mPeriod;
-		}
-
-		if(mTimeBehind > 0){
-			al_nsec comp = mPeriod*mAutocorrect;
-			if(mTimeBehind < comp){
-				comp = mTimeBehind;
-				mTimeBehind = 0;
-			}
-			else{
-				mTimeBehind -= comp;
-			}
-
-			mWait -= comp;
-		}
-
-		//printf("period=%g, dt=%g, wait=%g\n", mPeriod, dt, mWait);
+		mTimer.wait();
 	}
 }
 
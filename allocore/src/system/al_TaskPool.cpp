@@ -0,0 +1,405 @@
+#include <stdlib.h>
+#include "allocore/system/al_Config.h"
+#include "allocore/system/al_Info.hpp"
+#include "allocore/system/al_TaskPool.hpp"
+#include "allocore/system/al_Thread.hpp"
+
+#ifdef AL_WINDOWS
+	#include <windows.h>
+	#define AL_THREAD_LOCAL __declspec(thread)
+#else
+	#include <pthread.h>
+	#include <sched.h>
+	#include <sys/time.h>
+	#define AL_THREAD_LOCAL __thread
+#endif
+
+namespace al{
+
+static void yieldThread(){
+	#ifdef AL_WINDOWS
+		SwitchToThread();
+	#else
+		sched_yield();
+	#endif
+}
+
+// Fixed-size queue of task pointers.
+// The owning worker pushes and pops at the bottom (LIFO) while other threads
+// steal from the top (FIFO). This is the Chase-Lev deque without resizing.
+class TaskPool::Queue{
+public:
+
+	Queue(int size)
+	:	mTop(0), mBottom(0), mSize(nextPow2(size)), mWrap(mSize-1)
+	{
+		mTasks = new Atomic<Task *>[mSize];
+	}
+
+	~Queue(){ delete[] mTasks; }
+
+	// Owner only
+	bool push(Task * t){
+		long b = mBottom.loadRelaxed();
+		long top = mTop.load();
+		if(b - top >= mSize) return false;
+		mTasks[b & mWrap].store(t);
+		mBottom.store(b+1);
+		return true;
+	}
+
+	// Owner only
+	Task * pop(){
+		long b = mBottom.loadRelaxed() - 1;
+		mBottom.exchange(b); // must be globally visible before reading top
+		long top = mTop.load();
+		if(top > b){ // empty
+			mBottom.store(b+1);
+			return 0;
+		}
+		Task * t = mTasks[b & mWrap].load();
+		if(top == b){ // last task; race against thieves
+			if(!mTop.compareExchange(top, top+1)) t = 0;
+			mBottom.store(b+1);
+		}
+		return t;
+	}
+
+	// Any thread
+	Task * steal(){
+		long top = mTop.load();
+		atomicFence();
+		long b = mBottom.load();
+		if(top >= b) return 0;
+		Task * t = mTasks[top & mWrap].load();
+		if(!mTop.compareExchange(top, top+1)) return 0;
+		return t;
+	}
+
+	bool empty() const { return mBottom.load() <= mTop.load(); }
+
+private:
+	Atomic<long> mTop, mBottom;
+	long mSize, mWrap;
+	Atomic<Task *> * mTasks;
+
+	static long nextPow2(long v){
+		long r=1;
+		while(r < v) r<<=1;
+		return r;
+	}
+};
+
+
+// Fixed-size multi-producer, multi-consumer queue of task pointers for
+// tasks submitted from outside the pool (D. Vyukov's bounded MPMC queue).
+// Each cell carries a sequence number telling whether it is ready to be
+// written or read in the current lap, so producers and consumers only
+// contend on their own position counter and never wait on each other.
+class TaskPool::SharedQueue{
+public:
+
+	SharedQueue(int size)
+	:	mHead(0), mTail(0), mSize(nextPow2(size)), mWrap(mSize-1)
+	{
+		mCells = new Cell[mSize];
+		for(long i=0; i<mSize; ++i) mCells[i].seq.store(i);
+	}
+
+	~SharedQueue(){ delete[] mCells; }
+
+	// Any thread; returns false if full
+	bool push(Task * t){
+		long pos = mTail.load();
+		Cell * c;
+		for(;;){
+			c = &mCells[pos & mWrap];
+			long dif = c->seq.load() - pos;
+			if(0 == dif){
+				if(mTail.compareExchange(pos, pos+1)) break;
+			}
+			else if(dif < 0) return false;
+			else pos = mTail.load();
+		}
+		c->task.store(t);
+		c->seq.store(pos+1);
+		return true;
+	}
+
+	// Any thread; returns 0 if empty
+	Task * pop(){
+		long pos = mHead.load();
+		Cell * c;
+		for(;;){
+			c = &mCells[pos & mWrap];
+			long dif = c->seq.load() - (pos+1);
+			if(0 == dif){
+				if(mHead.compareExchange(pos, pos+1)) break;
+			}
+			else if(dif < 0) return 0;
+			else pos = mHead.load();
+		}
+		Task * t = c->task.load();
+		c->seq.store(pos + mSize);
+		return t;
+	}
+
+	bool empty() const { return mTail.load() <= mHead.load(); }
+
+private:
+	struct Cell{
+		Atomic<long> seq;
+		Atomic<Task *> task;
+	};
+
+	Atomic<long> mHead, mTail;
+	long mSize, mWrap;
+	Cell * mCells;
+
+	static long nextPow2(long v){
+		long r=1;
+		while(r < v) r<<=1;
+		return r;
+	}
+};
+
+
+class TaskPool::Worker{
+public:
+	Worker(TaskPool& p, int i, int queueSize)
+	:	pool(p), queue(queueSize), index(i), seed(i*2654435761u + 1)
+	{}
+
+	unsigned rand(){
+		seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+		return seed;
+	}
+
+	TaskPool& pool;
+	Queue queue;
+	Thread thread;
+	int index;
+	unsigned seed;
+};
+
+
+// Used to put idle workers to sleep. Notification uses a try-lock, so it
+// never blocks; a missed notification only delays a sleeping worker until
+// its timed wait expires.
+#ifdef AL_WINDOWS
+struct TaskPool::Signal{
+	CRITICAL_SECTION mutex;
+	CONDITION_VARIABLE cond;
+	Signal(){ InitializeCriticalSection(&mutex); InitializeConditionVariable(&cond); }
+	~Signal(){ DeleteCriticalSection(&mutex); }
+	void lock(){ EnterCriticalSection(&mutex); }
+	bool tryLock(){ return TryEnterCriticalSection(&mutex) != 0; }
+	void unlock(){ LeaveCriticalSection(&mutex); }
+	void wait(int msec){ SleepConditionVariableCS(&cond, &mutex, msec); }
+	void notifyAll(){ WakeAllConditionVariable(&cond); }
+};
+#else
+struct TaskPool::Signal{
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	Signal(){ pthread_mutex_init(&mutex, NULL); pthread_cond_init(&cond, NULL); }
+	~Signal(){ pthread_cond_destroy(&cond); pthread_mutex_destroy(&mutex); }
+	void lock(){ pthread_mutex_lock(&mutex); }
+	bool tryLock(){ return pthread_mutex_trylock(&mutex) == 0; }
+	void unlock(){ pthread_mutex_unlock(&mutex); }
+	void wait(int msec){
+		timeval now;
+		gettimeofday(&now, NULL);
+		long long ns = (long long)now.tv_usec*1000 + (long long)msec*1000000;
+		timespec t;
+		t.tv_sec = now.tv_sec + ns / 1000000000;
+		t.tv_nsec = ns % 1000000000;
+		pthread_cond_timedwait(&cond, &mutex, &t);
+	}
+	void notifyAll(){ pthread_cond_broadcast(&cond); }
+};
+#endif
+
+
+static AL_THREAD_LOCAL TaskPool::Worker * tlsWorker = 0;
+
+
+TaskPool::TaskPool(int numWorkers, int firstCore, int queueSize)
+:	mShared(new SharedQueue(queueSize)), mSignal(new Signal), mSleepers(0), mRunning(1)
+{
+	int nproc = numProcessors();
+	if(nproc < 1) nproc = 1;
+	if(numWorkers < 0) numWorkers = nproc > 1 ? nproc - 1 : 1;
+
+	for(int i=0; i<numWorkers; ++i){
+		Worker * w = new Worker(*this, i, queueSize);
+		if(firstCore >= 0) w->thread.affinity((firstCore + i) % nproc);
+		mWorkers.push_back(w);
+	}
+	// Start threads only once all workers exist since they steal from each other
+	for(int i=0; i<size(); ++i){
+		mWorkers[i]->thread.start(sWorkerFunc, mWorkers[i]);
+	}
+}
+
+TaskPool::~TaskPool(){
+	mRunning.store(0);
+	mSignal->lock();
+	mSignal->notifyAll();
+	mSignal->unlock();
+	for(int i=0; i<size(); ++i) mWorkers[i]->thread.join();
+	for(int i=0; i<size(); ++i) delete mWorkers[i];
+	delete mSignal;
+	delete mShared;
+}
+
+TaskPool& TaskPool::priority(int v, Thread::Policy p){
+	for(int i=0; i<size(); ++i) mWorkers[i]->thread.priority(v, p);
+	return *this;
+}
+
+TaskPool& TaskPool::get(){
+	// Dynamically allocated so workers are never joined during static destruction
+	static TaskPool * pool = new TaskPool;
+	return *pool;
+}
+
+TaskPool::Worker * TaskPool::currentWorker(){
+	Worker * w = tlsWorker;
+	return (w && &w->pool == this) ? w : 0;
+}
+
+bool TaskPool::submit(Task& task, TaskGroup * group){
+	// Only write if changed, as the same task may be queued more than once
+	if(task.mGroup != group) task.mGroup = group;
+	if(group) ++group->mCount;
+
+	Worker * w = currentWorker();
+	if(w){
+		if(!w->queue.push(&task)){
+			execute(&task, w);
+			return true;
+		}
+	}
+	else if(!mShared->push(&task)){
+		if(group) --group->mCount;
+		return false;
+	}
+	notify();
+	return true;
+}
+
+void TaskPool::notify(){
+	if(mSleepers.load() > 0 && mSignal->tryLock()){
+		mSignal->notifyAll();
+		mSignal->unlock();
+	}
+}
+
+Task * TaskPool::findTask(Worker * w){
+	Task * t = 0;
+	if(w && (t = w->queue.pop())) return t;
+	if((t = mShared->pop())) return t;
+
+	int N = size();
+	if(N){
+		int start = w ? int(w->rand() % N) : 0;
+		for(int i=0; i<N; ++i){
+			Worker * victim = mWorkers[(start + i) % N];
+			if(victim == w) continue;
+			if((t = victim->queue.steal())) return t;
+		}
+	}
+	return 0;
+}
+
+void TaskPool::execute(Task * t, Worker * w){
+	TaskGroup * group = t->mGroup;
+	(*t)();
+
+	// Release successors that have no more pending predecessors
+	for(unsigned i=0; i<t->mSuccessors.size(); ++i){
+		Task * s = t->mSuccessors[i];
+		if(0 == --s->mPending){
+			// Reset for next submission; all predecessors have completed
+			s->mPending.store(s->mDeps);
+			s->mGroup = group;
+			if(group) ++group->mCount;
+			if(w){
+				if(!w->queue.push(s)) execute(s, w);
+				else notify();
+			}
+			else if(!mShared->push(s)) execute(s, w);
+			else notify();
+		}
+	}
+
+	// Must be last since waiting threads may destroy the task once done
+	if(group) --group->mCount;
+}
+
+bool TaskPool::runPending(){
+	Worker * w = currentWorker();
+	Task * t = findTask(w);
+	if(t){
+		execute(t, w);
+		return true;
+	}
+	return false;
+}
+
+void TaskPool::wait(TaskGroup& group){
+	Worker * w = currentWorker();
+	int idle = 0;
+	while(!group.done()){
+		Task * t = findTask(w);
+		if(t){
+			execute(t, w);
+			idle = 0;
+		}
+		else if(++idle < 64){
+			cpuRelax();
+		}
+		else{
+			// Remaining tasks are running on other threads
+			yieldThread();
+		}
+	}
+}
+
+void * TaskPool::sWorkerFunc(void * user){
+	Worker& w = *static_cast<Worker *>(user);
+	w.pool.workerLoop(w);
+	return NULL;
+}
+
+void TaskPool::workerLoop(Worker& w){
+	tlsWorker = &w;
+
+	int idle = 0;
+	while(mRunning.load()){
+		Task * t = findTask(&w);
+		if(t){
+			execute(t, &w);
+			idle = 0;
+			continue;
+		}
+
+		// Spin briefly before going to sleep to catch bursts of tasks
+		if(++idle < 256){
+			cpuRelax();
+			continue;
+		}
+
+		++mSleepers;
+		mSignal->lock();
+		if(mRunning.load() && mShared->empty()) mSignal->wait(2);
+		mSignal->unlock();
+		--mSleepers;
+		idle = 0;
+	}
+
+	tlsWorker = 0;
+}
+
+} // al::
@@ -1,6 +1,8 @@
 #include <stdio.h>
+#include <string.h>
 #include <algorithm> // for std::swap
 #include "allocore/system/al_Config.h"
+#include "allocore/system/al_Printing.hpp"
 #include "allocore/system/al_Thread.hpp"
 
 #ifdef AL_WINDOWS
@@ -9,10 +11,44 @@
 	#define USE_PTHREAD
 #endif
 
+#ifdef USE_PTHREAD
+	#include <alloca.h>
+	#include <errno.h>
+	#include <pthread.h>
+	#include <sched.h>
+	#include <sys/mman.h>
+#elif defined(USE_THREADEX)
+	#define WIN32_MEAN_AND_LEAN
+	#include <windows.h>
+	#include <process.h>
+	#include <malloc.h>
+#endif
+
 namespace al {
 
+// Thread settings applied by the thread itself when it starts
+struct ThreadSettings{
+	ThreadSettings(): priority(0), policy(Thread::NORMAL), stackLock(0){}
+	int priority;
+	Thread::Policy policy;
+	std::vector<int> cpus;
+	size_t stackLock;
+};
+
+// Stack left unlocked for the frames of the thread function
+static const size_t kStackMargin = 64*1024;
+
+// Clamp amount of stack to lock to what the thread has available
+static size_t clampStackLock(size_t bytes, size_t available){
+	size_t limit = available > kStackMargin ? available - kStackMargin : 0;
+	if(bytes > limit){
+		AL_WARN("Can only lock %lu of %lu bytes of thread stack", (unsigned long)limit, (unsigned long)bytes);
+		bytes = limit;
+	}
+	return bytes;
+}
+
 #ifdef USE_PTHREAD
-#include <pthread.h>
 
 //typedef pthread_t ThreadHandle;
 //typedef void * (*ThreadFunction)(void *);
@@ -20,7 +56,7 @@ namespace al {
 
 struct Thread::Impl{
 	Impl()
-	:	mHandle(0)
+	:	mHandle(0), mFunc(0)
 	{ //printf("Thread::Impl(): %p\n", this);
 		pthread_attr_init(&mAttr);
 
@@ -35,8 +71,9 @@ struct Thread::Impl{
 
 	bool start(ThreadFunction& func){
 		if(mHandle) return false;
+		mFunc = &func;
 		//return 0 == pthread_create(&mHandle, NULL, cThreadFunc, &func);
-		return 0 == pthread_create(&mHandle, &mAttr, cThreadFunc, &func);
+		return 0 == pthread_create(&mHandle, &mAttr, cThreadFunc, this);
 	}
 
 	bool join(){
@@ -47,43 +84,100 @@ struct Thread::Impl{
 		return false;
 	}
 
-	void priority(int v){
+	// Scheduling is set from within the thread (or on the running thread)
+	// rather than through the creation attributes, so that a lack of
+	// privileges does not prevent the thread from starting.
+	void priority(int v, Thread::Policy p){
+		mSettings.priority = v;
+		mSettings.policy = p;
+		if(mHandle) applyPriority(mHandle, mSettings);
+	}
+
+	void affinity(const std::vector<int>& cpus){
+		mSettings.cpus = cpus;
+		if(mHandle) applyAffinity(mHandle, mSettings);
+	}
+
+	static void applyPriority(pthread_t h, const ThreadSettings& s){
 		struct sched_param param;
-		if(v >= 1 && v <= 99){
-			param.sched_priority = v;
-			//pthread_setschedparam(mHandle, SCHED_FIFO, &param);
+		int policy = SCHED_OTHER;
+		param.sched_priority = 0;
+		if(s.policy != Thread::NORMAL && s.priority >= 1){
 			// FIFO and RR (round-robin) are for real-time scheduling
-			pthread_attr_setschedpolicy(&mAttr, SCHED_FIFO);
-			//pthread_attr_setschedpolicy(&mAttr, SCHED_RR);
-			pthread_attr_setschedparam(&mAttr, &param);
+			policy = s.policy == Thread::ROUND_ROBIN ? SCHED_RR : SCHED_FIFO;
+			int pmin = sched_get_priority_min(policy);
+			int pmax = sched_get_priority_max(policy);
+			param.sched_priority = s.priority < pmin ? pmin : (s.priority > pmax ? pmax : s.priority);
 		}
-		else{
-			param.sched_priority = 0;
-			//pthread_setschedparam(mHandle, SCHED_OTHER, &param);
-			pthread_attr_setschedpolicy(&mAttr, SCHED_OTHER);
-			pthread_attr_setschedparam(&mAttr, &param);
+		int err = pthread_setschedparam(h, policy, &param);
+		if(err){
+			AL_WARN("Could not set thread priority %d (%s)", s.priority, strerror(err));
 		}
 	}
 
-//	bool cancel(){
-//		return 0 == pthread_cancel(mHandle);
-//	}
-//
-//	void testCancel(){
-//		pthread_testcancel();
-//	}
+	static void applyAffinity(pthread_t h, const ThreadSettings& s){
+	#ifdef AL_LINUX
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		if(s.cpus.empty()){
+			for(int i=0; i<CPU_SETSIZE; ++i) CPU_SET(i, &set);
+		}
+		for(unsigned i=0; i<s.cpus.size(); ++i){
+			if(s.cpus[i] >= 0 && s.cpus[i] < CPU_SETSIZE) CPU_SET(s.cpus[i], &set);
+		}
+		int err = pthread_setaffinity_np(h, sizeof(set), &set);
+		if(err){
+			AL_WARN("Could not set thread affinity (%s)", strerror(err));
+		}
+	#else
+		if(!s.cpus.empty()) AL_WARN_ONCE("Thread affinity not supported on this platform");
+	#endif
+	}
+
+	static void lockStack(size_t bytes, size_t stackSize){
+		// Grow the stack by the requested amount, touch every page so it is
+		// mapped, then lock the pages. They stay locked after returning.
+		bytes = clampStackLock(bytes, stackSize);
+		if(!bytes) return;
+		char * stack = (char *)alloca(bytes);
+		memset(stack, 0, bytes);
+		if(0 != mlock(stack, bytes)){
+			AL_WARN("Could not lock %lu bytes of thread stack (%s)", (unsigned long)bytes, strerror(errno));
+		}
+	}
 
 	pthread_t mHandle;
 	pthread_attr_t mAttr;
+	ThreadFunction * mFunc;
+	ThreadSettings mSettings;
 
 	static void * cThreadFunc(void * user){
-		ThreadFunction& tfunc = *((ThreadFunction*)user);
+		Impl& impl = *((Impl*)user);
+		ThreadSettings s = impl.mSettings;
+		pthread_t self = pthread_self();
+		if(s.policy != Thread::NORMAL) applyPriority(self, s);
+		if(!s.cpus.empty()) applyAffinity(self, s);
+		if(s.stackLock){
+			size_t stackSize = 0;
+			pthread_attr_getstacksize(&impl.mAttr, &stackSize);
+			lockStack(s.stackLock, stackSize);
+		}
+		ThreadFunction& tfunc = *impl.mFunc;
 		tfunc();
 		return NULL;
 	}
 };
 
 
+bool lockProcessMemory(){
+	if(0 != mlockall(MCL_CURRENT | MCL_FUTURE)){
+		AL_WARN("Could not lock process memory (%s)", strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+
 void * Thread::current(){
 	// pthread_t pthread_self(void);
 	static pthread_t r;
@@ -94,22 +188,22 @@ void * Thread::current(){
 
 #elif defined(USE_THREADEX)
 
-#define WIN32_MEAN_AND_LEAN
-#include <windows.h>
-#include <process.h>
-
 //typedef unsigned long ThreadHandle;
 //typedef unsigned (__stdcall *ThreadFunction)(void *);
 //#define THREAD_FUNCTION(name) unsigned _stdcall * name(void * user)
 
 struct Thread::Impl{
-	Impl(): mHandle(0){}
+	Impl(): mHandle(0), mFunc(0){}
 
 	bool start(ThreadFunction& func){
 		if(mHandle) return false;
+		mFunc = &func;
 		unsigned thread_id;
-		mHandle = _beginthreadex(NULL, 0, cThreadFunc, &func, 0, &thread_id);
-		if(mHandle) return true;
+		mHandle = _beginthreadex(NULL, 0, cThreadFunc, this, 0, &thread_id);
+		if(mHandle){
+			if(!mSettings.cpus.empty()) affinity(mSettings.cpus);
+			return true;
+		}
 		return false;
 	}
 
@@ -124,7 +218,22 @@ struct Thread::Impl{
 	}
 
 	// TODO: Threadx priority
-	void priority(int v){
+	void priority(int v, Thread::Policy p){
+		mSettings.priority = v;
+		mSettings.policy = p;
+		if(p != Thread::NORMAL) AL_WARN_ONCE("Thread priority not supported on this platform");
+	}
+
+	void affinity(const std::vector<int>& cpus){
+		mSettings.cpus = cpus;
+		if(mHandle){
+			DWORD_PTR mask = 0;
+			for(unsigned i=0; i<cpus.size(); ++i){
+				if(cpus[i] >= 0 && cpus[i] < int(sizeof(mask)*8)) mask |= DWORD_PTR(1) << cpus[i];
+			}
+			if(!mask) mask = ~DWORD_PTR(0);
+			SetThreadAffinityMask((HANDLE)mHandle, mask);
+		}
 	}
 
 //	bool cancel(){
@@ -136,15 +245,34 @@ struct Thread::Impl{
 //	}
 
 	unsigned long mHandle;
-//	ThreadFunction mRoutine;
+	ThreadFunction * mFunc;
+	ThreadSettings mSettings;
 
 	static unsigned _stdcall cThreadFunc(void * user){
-		ThreadFunction& tfunc = *((ThreadFunction*)user);
+		Impl& impl = *((Impl*)user);
+		if(impl.mSettings.stackLock){
+			// The stack is reserved from its allocation base up to here
+			MEMORY_BASIC_INFORMATION mbi;
+			VirtualQuery(&mbi, &mbi, sizeof(mbi));
+			size_t available = (char *)&mbi - (char *)mbi.AllocationBase;
+			size_t bytes = clampStackLock(impl.mSettings.stackLock, available);
+			if(bytes){
+				char * stack = (char *)_alloca(bytes);
+				memset(stack, 0, bytes);
+				VirtualLock(stack, bytes);
+			}
+		}
+		ThreadFunction& tfunc = *impl.mFunc;
 		tfunc();
 		return 0;
 	}
 };
 
+bool lockProcessMemory(){
+	AL_WARN_ONCE("lockProcessMemory not supported on this platform");
+	return false;
+}
+
 #endif
 
 
@@ -168,6 +296,7 @@ Thread::Thread(void * (*cThreadFunc)(void * userData), void * userData)
 Thread::Thread(const Thread& other)
 :	mImpl(new Impl), mCFunc(other.mCFunc), mJoinOnDestroy(other.mJoinOnDestroy)
 {
+	mImpl->mSettings = other.mImpl->mSettings;
 }
 
 Thread::~Thread(){
@@ -205,7 +334,25 @@ Thread& Thread::operator= (Thread other){
 }*/
 
 Thread& Thread::priority(int v){
-	mImpl->priority(v);
+	return priority(v, v >= 1 ? FIFO : NORMAL);
+}
+
+Thread& Thread::priority(int v, Policy p){
+	mImpl->priority(v, p);
+	return *this;
+}
+
+Thread& Thread::affinity(int cpu){
+	return affinity(std::vector<int>(1, cpu));
+}
+
+Thread& Thread::affinity(const std::vector<int>& cpus){
+	mImpl->affinity(cpus);
+	return *this;
+}
+
+Thread& Thread::lockStack(size_t bytes){
+	mImpl->mSettings.stackLock = bytes;
 	return *this;
 }
 
@@ -136,6 +136,68 @@ void al_sleep_until(al_sec target) {
 }
 
 
+/* Monotonic clock */
+#if defined(AL_LINUX)
+	#include <errno.h>
+	#include <time.h>
+
+	al_nsec al_steady_time_nsec() {
+		timespec t;
+		clock_gettime(CLOCK_MONOTONIC, &t);
+		return ((al_nsec)t.tv_sec * 1000000000LL) + (al_nsec)t.tv_nsec;
+	}
+
+	void al_steady_sleep_until_nsec(al_nsec target) {
+		timespec tspec;
+		tspec.tv_sec = target / 1000000000LL;
+		tspec.tv_nsec = target % 1000000000LL;
+		// The wake time is absolute, so restarting after a signal is exact
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tspec, NULL) == EINTR)
+			continue;
+	}
+
+#elif defined(AL_OSX)
+	#include <mach/mach_time.h>
+
+	al_nsec al_steady_time_nsec() {
+		static mach_timebase_info_data_t tb = {0,0};
+		if (0 == tb.denom) mach_timebase_info(&tb);
+		return (al_nsec)(mach_absolute_time() * tb.numer / tb.denom);
+	}
+
+	void al_steady_sleep_until_nsec(al_nsec target) {
+		al_nsec dt = target - al_steady_time_nsec();
+		if (dt > 0) al_sleep_nsec(dt);
+	}
+
+#elif defined(AL_WINDOWS)
+	#include <windows.h>
+
+	al_nsec al_steady_time_nsec() {
+		LARGE_INTEGER freq, t;
+		QueryPerformanceFrequency(&freq);
+		QueryPerformanceCounter(&t);
+		return (al_nsec)((double)t.QuadPart * 1e9 / (double)freq.QuadPart);
+	}
+
+	void al_steady_sleep_until_nsec(al_nsec target) {
+		al_nsec dt = target - al_steady_time_nsec();
+		if (dt > 0) al_sleep_nsec(dt);
+	}
+
+#else
+	/* No monotonic clock known; fall back to the wall clock */
+	al_nsec al_steady_time_nsec() {
+		return al_time_nsec();
+	}
+
+	void al_steady_sleep_until_nsec(al_nsec target) {
+		al_nsec dt = target - al_steady_time_nsec();
+		if (dt > 0) al_sleep_nsec(dt);
+	}
+#endif
+
+
 
 
 
@@ -180,4 +242,98 @@ void DelayLockedLoop :: step(al_sec realtime) {
 //		printf("factor %f %f rate %f\n", factor, factor2, real_rate);
 }
 
+
+
+DeadlineTimer :: DeadlineTimer(al_sec period)
+:	mPeriod(1), mSpin(0), mDeadline(0), mPrev(0),
+	mCatchUpRate(1), mOverrun(CATCH_UP)
+{
+	this->period(period);
+	resetStats();
+}
+
+DeadlineTimer& DeadlineTimer :: period(al_sec v){
+	return periodNsec(al_sec2nsec(v));
+}
+
+DeadlineTimer& DeadlineTimer :: periodNsec(al_nsec v){
+	mPeriod = v > 0 ? v : 1;
+	return *this;
+}
+
+DeadlineTimer& DeadlineTimer :: spin(al_sec v){
+	mSpin = v > 0 ? al_sec2nsec(v) : 0;
+	return *this;
+}
+
+DeadlineTimer& DeadlineTimer :: catchUpRate(float v){
+	mCatchUpRate = v < 0.f ? 0.f : (v > 1.f ? 1.f : v);
+	return *this;
+}
+
+void DeadlineTimer :: start(){
+	mPrev = al_steady_time_nsec();
+	mDeadline = mPrev + mPeriod;
+}
+
+void DeadlineTimer :: resetStats(){
+	mTicks = mOverruns = mMissed = mWaits = 0;
+	mJitterSum = mJitterMax = 0;
+}
+
+void DeadlineTimer :: sleepUntil(al_nsec target){
+	if (mSpin > 0) {
+		// Let the OS scheduler take us most of the way, then busy-wait
+		// the remainder to avoid its wake-up latency
+		al_nsec coarse = target - mSpin;
+		if (coarse > al_steady_time_nsec()) al_steady_sleep_until_nsec(coarse);
+		while (al_steady_time_nsec() < target) {}
+	}
+	else {
+		al_steady_sleep_until_nsec(target);
+	}
+}
+
+int DeadlineTimer :: wait(){
+	al_nsec now = al_steady_time_nsec();
+	al_nsec target = mDeadline;
+	int missed = 0;
+
+	if (now > mDeadline) {
+		++mOverruns;
+		al_nsec late = now - mDeadline;
+		switch (mOverrun) {
+			case SKIP:
+				// Jump ahead to the next deadline still on the schedule
+				missed = int(late / mPeriod) + 1;
+				mDeadline += missed * mPeriod;
+				target = mDeadline;
+				break;
+			case RESYNC:
+				missed = int(late / mPeriod);
+				mDeadline = target = now;
+				break;
+			default:
+				// Stay on schedule, but don't fire events closer together
+				// than (1 - catch up rate) periods
+				target = mPrev + al_nsec(mPeriod * (1.f - mCatchUpRate));
+		}
+	}
+
+	if (target > now) {
+		sleepUntil(target);
+		now = al_steady_time_nsec();
+		al_nsec jitter = now - target;
+		mJitterSum += jitter;
+		if (jitter > mJitterMax) mJitterMax = jitter;
+		++mWaits;
+	}
+
+	mPrev = now;
+	mDeadline += mPeriod;
+	mMissed += missed;
+	++mTicks;
+	return missed;
+}
+
 } // al::
@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "allocore/system/al_Atomic.hpp"
+#include "allocore/system/al_Config.h"
+#include "allocore/system/al_Trace.hpp"
+
+#ifdef AL_WINDOWS
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+	#define AL_THREAD_LOCAL __declspec(thread)
+#else
+	#include <pthread.h>
+	#define AL_THREAD_LOCAL __thread
+#endif
+
+namespace al{
+
+namespace{
+
+struct Event{
+	const char * name;
+	al_nsec begin, end;
+};
+
+struct Buffer{
+	uint32_t mask;				// capacity - 1
+	Event * events;
+};
+
+// Ring buffer written only by the thread that claimed it
+struct Slot{
+	Atomic<Buffer *> buffer;
+	Atomic<uint32_t> written;	// total events written since clear
+	Atomic<int> inUse;			// claimed by a running thread
+	char name[32];
+
+	Buffer * allocate(uint32_t capacity){
+		Buffer * b = buffer.load();
+		if(!b){
+			Buffer * nb = new Buffer;
+			nb->mask = capacity-1;
+			nb->events = new Event[capacity];
+			if(buffer.compareExchange(b, nb)) return nb;
+			// lost race against another allocation
+			delete[] nb->events;
+			delete nb;
+		}
+		return b;
+	}
+};
+
+Slot gSlots[Trace::MAX_THREADS];
+Atomic<int> gNumSlots(0);		// number of claimed slots
+Atomic<int> gActive(0);
+Atomic<int> gDropped(0);
+Atomic<int> gCapacity(1<<16);	// capacity of newly allocated buffers
+al_nsec gT0 = 0;				// time of first start, origin of exported times
+
+// Index + 1 of calling thread's slot, 0 if none claimed yet
+AL_THREAD_LOCAL int tlsSlot = 0;
+
+// Return slot to the pool when its thread exits. Its events are kept and
+// exported under the same thread id as those of the next thread to claim it.
+#ifdef AL_WINDOWS
+VOID NTAPI releaseSlot(PVOID v){
+#else
+void releaseSlot(void * v){
+#endif
+	if(v) gSlots[(int)(intptr_t)v - 1].inUse.store(0);
+}
+
+#ifdef AL_WINDOWS
+DWORD gExitKey = FLS_OUT_OF_INDEXES;
+INIT_ONCE gExitKeyOnce = INIT_ONCE_STATIC_INIT;
+BOOL CALLBACK createExitKey(PINIT_ONCE, PVOID, PVOID *){
+	gExitKey = FlsAlloc(releaseSlot);
+	return TRUE;
+}
+void releaseAtExit(int slot){
+	InitOnceExecuteOnce(&gExitKeyOnce, createExitKey, NULL, NULL);
+	if(gExitKey != FLS_OUT_OF_INDEXES) FlsSetValue(gExitKey, (PVOID)(intptr_t)slot);
+}
+#else
+pthread_key_t gExitKey;
+pthread_once_t gExitKeyOnce = PTHREAD_ONCE_INIT;
+void createExitKey(){ pthread_key_create(&gExitKey, releaseSlot); }
+void releaseAtExit(int slot){
+	pthread_once(&gExitKeyOnce, createExitKey);
+	pthread_setspecific(gExitKey, (void *)(intptr_t)slot);
+}
+#endif
+
+Slot * threadSlot(){
+	if(tlsSlot) return &gSlots[tlsSlot-1];
+
+	// Prefer a slot released by an exited thread, then an unused one
+	int i = 0, n = gNumSlots.load();
+	for(; i<n; ++i){
+		int expected = 0;
+		if(gSlots[i].inUse.compareExchange(expected, 1)){
+			gSlots[i].name[0] = '\0';
+			break;
+		}
+	}
+	if(i == n){
+		i = gNumSlots.fetchAdd(1);
+		if(i >= Trace::MAX_THREADS){
+			gNumSlots.fetchSub(1);
+			return 0;
+		}
+		gSlots[i].inUse.store(1);
+	}
+	tlsSlot = i+1;
+	releaseAtExit(tlsSlot);
+	return &gSlots[i];
+}
+
+uint32_t nextPow2(uint32_t v){
+	uint32_t r = 1;
+	while(r < v) r <<= 1;
+	return r;
+}
+
+void writeEscaped(FILE * fp, const char * s){
+	for(; *s; ++s){
+		if(*s == '"' || *s == '\\') fputc('\\', fp);
+		if((unsigned char)(*s) >= 0x20) fputc(*s, fp);
+	}
+}
+
+} // anonymous
+
+
+void Trace::start(int eventsPerThread, int preallocThreads){
+	if(eventsPerThread < 2) eventsPerThread = 2;
+	gCapacity.store(nextPow2(eventsPerThread));
+	if(!gT0) gT0 = al_steady_time_nsec();
+
+	// Buffers of not yet claimed slots are handed out in order of claiming
+	if(preallocThreads > MAX_THREADS) preallocThreads = MAX_THREADS;
+	for(int i=0; i<preallocThreads; ++i){
+		gSlots[i].allocate(gCapacity.load());
+	}
+	gActive.store(1);
+}
+
+void Trace::stop(){ gActive.store(0); }
+
+bool Trace::active(){ return gActive.load() != 0; }
+
+void Trace::clear(){
+	int n = gNumSlots.load();
+	for(int i=0; i<n; ++i) gSlots[i].written.store(0);
+	gDropped.store(0);
+}
+
+void Trace::threadName(const std::string& name){
+	Slot * s = threadSlot();
+	if(!s) return;
+	strncpy(s->name, name.c_str(), sizeof(s->name)-1);
+	s->name[sizeof(s->name)-1] = '\0';
+}
+
+int Trace::numEvents(){
+	int n = gNumSlots.load();
+	int count = 0;
+	for(int i=0; i<n; ++i){
+		const Buffer * b = gSlots[i].buffer.load();
+		if(!b) continue;
+		uint32_t w = gSlots[i].written.load();
+		count += w > b->mask+1 ? b->mask+1 : w;
+	}
+	return count;
+}
+
+int Trace::numDropped(){ return gDropped.load(); }
+
+void Trace::record(const char * name, al_nsec begin, al_nsec end, bool realtime){
+	Slot * s = threadSlot();
+	Buffer * b = s ? s->buffer.load() : 0;
+	if(!b){
+		if(!s || realtime){
+			gDropped.fetchAdd(1);
+			return;
+		}
+		b = s->allocate(gCapacity.load());
+	}
+	uint32_t w = s->written.loadRelaxed();
+	Event& e = b->events[w & b->mask];
+	e.name = name;
+	e.begin = begin;
+	e.end = end;
+	s->written.store(w+1);
+}
+
+bool Trace::writeChrome(const std::string& path){
+	FILE * fp = fopen(path.c_str(), "w");
+	if(!fp) return false;
+
+	fprintf(fp, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+	bool first = true;
+	std::vector<Event> copy;
+
+	int n = gNumSlots.load();
+	for(int i=0; i<n; ++i){
+		const Slot& s = gSlots[i];
+		int tid = i+1;
+
+		if(s.name[0]){
+			fprintf(fp, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"", first ? "" : ",\n", tid);
+			writeEscaped(fp, s.name);
+			fprintf(fp, "\"}}");
+			first = false;
+		}
+
+		const Buffer * b = s.buffer.load();
+		if(!b) continue;
+		uint32_t capacity = b->mask+1;
+
+		// Copy the most recent events, then keep only those that were not
+		// overwritten while copying. The oldest event of a full buffer is
+		// always left out as the writer may be overwriting it.
+		uint32_t w1 = s.written.load();
+		uint32_t count = w1 < capacity ? w1 : capacity;
+		uint32_t beg = w1 - count;
+		copy.resize(count);
+		for(uint32_t k=0; k<count; ++k) copy[k] = b->events[(beg+k) & b->mask];
+		atomicFence();
+		uint32_t w2 = s.written.load();
+		uint32_t skip = w2 - beg >= capacity ? w2 - beg - capacity + 1 : 0;
+
+		for(uint32_t k=skip; k<count; ++k){
+			const Event& e = copy[k];
+			fprintf(fp, "%s{\"name\": \"", first ? "" : ",\n");
+			writeEscaped(fp, e.name);
+			fprintf(fp, "\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+				tid, (e.begin - gT0) * 1e-3, (e.end - e.begin) * 1e-3);
+			first = false;
+		}
+	}
+
+	fprintf(fp, "\n]}\n");
+	return fclose(fp) == 0;
+}
+
+} // al::
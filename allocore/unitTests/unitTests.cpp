@@ -22,18 +22,25 @@ int main (int argc, char * const argv[]) {
 
 	RUNTEST(Math);
 	RUNTEST(MathSpherical);
+	RUNTEST(MathInterpolation);
 	RUNTEST(Types);
 	RUNTEST(TypesConversion);
 	RUNTEST(Spatial);
 	RUNTEST(System);
 	RUNTEST(ProtocolOSC);
+	RUNTEST(ProtocolPointCloud);
 	RUNTEST(ProtocolSerialize);
 
 	RUNTEST(IOSocket);
+	RUNTEST(IOAudioIOOffline);
+	RUNTEST(IOAudioIOParallel);
+	RUNTEST(SoundAudioScene);
+	RUNTEST(SoundBiquadBank);
 	RUNTEST(File);
 	RUNTEST(Thread);
 
 	RUNTEST(GraphicsMesh);
+	RUNTEST(GraphicsVertexPacker);
 
 #ifndef ALLOCORE_TESTS_NO_GUI
 	// This test should always be run last since it calls exit()
@@ -17,14 +17,22 @@
 using namespace al;
 
 int utIOAudioIO();
+int utIOAudioIOOffline();
+int utIOAudioIOParallel();
 int utIOSocket();
 int utIOWindowGL();
 int utMath();
 int utMathSpherical();
+int utMathInterpolation();
 int utGraphicsDraw();
 int utGraphicsMesh();
+int utGraphicsMeshCache();
+int utGraphicsVertexPacker();
 int utProtocolOSC();
+int utProtocolPointCloud();
 int utProtocolSerialize();
+int utSoundAudioScene();
+int utSoundBiquadBank();
 int utSpatial();
 int utSystem();
 int utTypes();
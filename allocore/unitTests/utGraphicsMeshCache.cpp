@@ -0,0 +1,164 @@
+#include <vector>
+#include "utAllocore.h"
+
+// Size of region rendered and compared
+static const int W = 64, H = 64;
+
+// Render a mesh and read back the pixels
+static void render(Graphics& g, const Mesh& m, std::vector<unsigned char>& pix){
+	g.viewport(0,0, W,H);
+	g.clearColor(0,0,0,1);
+	g.clear(Graphics::COLOR_BUFFER_BIT);
+	g.draw(m);
+	pix.resize(W*H*4);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0,0, W,H, GL_RGBA, GL_UNSIGNED_BYTE, &pix[0]);
+}
+
+// Count pixels differing in any channel by more than tol
+static int differ(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b, int tol){
+	int n = 0;
+	for(unsigned i=0; i<a.size(); i+=4){
+		for(int k=0; k<4; ++k){
+			int d = int(a[i+k]) - int(b[i+k]);
+			if(d > tol || d < -tol){ ++n; break; }
+		}
+	}
+	return n;
+}
+
+// Draw a mesh from client memory and through a cache and compare
+static int compare(Graphics& g, MeshCache& c, const Mesh& m, int tol=0){
+	std::vector<unsigned char> ref, pix;
+	g.meshCache(0);
+	render(g, m, ref);
+	g.meshCache(&c);
+	render(g, m, pix);
+	g.meshCache(0);
+	return differ(ref, pix, tol);
+}
+
+// Needs a current OpenGL context
+int utGraphicsMeshCache(){
+
+	Graphics g;
+	g.matrixMode(Graphics::PROJECTION); g.pushMatrix(); g.loadIdentity();
+	g.matrixMode(Graphics::MODELVIEW); g.pushMatrix(); g.loadIdentity();
+	g.disable(Graphics::DEPTH_TEST);
+	g.disable(Graphics::LIGHTING);
+
+	// Colored fan, drawn from indices
+	Mesh m(Graphics::TRIANGLES);
+	m.vertex(0,0);				m.color(1,1,1);
+	for(int i=0; i<8; ++i){
+		float t = i * M_2PI/8;
+		m.vertex(0.9*cos(t), 0.9*sin(t));
+		m.color(0.5+0.5*cos(t), 0.5+0.5*sin(t), float(i)/8);
+	}
+	for(int i=0; i<8; ++i){
+		m.index(0); m.index(i+1); m.index((i+1)%8 + 1);
+	}
+
+	MeshCache c;
+	const int stride = 4*(3+4); // float positions and colors
+
+	// Meshes not in the cache draw from client memory
+	assert(!c.draw(m));
+	assert(0 == c.version(m));
+
+	c.add(m);
+	assert(c.contains(m));
+	assert(1 == c.size());
+
+	// First draw uploads vertices and indices
+	assert(0 == compare(g, c, m));
+	assert(2 == c.uploads());
+	assert(9*stride + 24*4 == (int)c.bytesUploaded());
+
+	// Unchanged mesh is not uploaded again
+	c.resetStats();
+	assert(0 == compare(g, c, m));
+	assert(0 == c.uploads());
+
+	// Only the modified vertices are uploaded
+	{
+		unsigned v = c.version(m);
+		m.colors()[3].set(1,0,0);
+		m.colors()[4].set(0,1,0);
+		c.modified(m, 3, 5);
+		assert(c.version(m) != v);
+		assert(0 == compare(g, c, m));
+		assert(1 == c.uploads());
+		assert(2*stride == (int)c.bytesUploaded());
+	}
+
+	// A change in size is noticed without being told
+	{
+		c.resetStats();
+		m.vertices()[0].set(0.2, 0.2, 0);
+		m.vertex(0.5, -0.9); m.color(1,1,0);
+		m.index(0); m.index(8); m.index(9);
+		assert(0 == compare(g, c, m));
+		assert(2 == c.uploads());
+		assert(10*stride + 27*4 == (int)c.bytesUploaded());
+	}
+
+	// Streaming meshes are uploaded whole
+	{
+		c.add(m, BufferObject::STREAM_DRAW);
+		assert(0 == compare(g, c, m));
+		c.resetStats();
+		for(int i=0; i<3; ++i){
+			m.vertices()[1].x -= 0.1;
+			c.modified(m, 1, 2);
+			assert(0 == compare(g, c, m));
+		}
+		assert(3 == c.uploads());
+		assert(3*10*stride == (int)c.bytesUploaded());
+	}
+
+	// Loss of context uploads everything again
+	{
+		c.destroy();
+		c.resetStats();
+		assert(0 == compare(g, c, m));
+		assert(2 == c.uploads());
+	}
+
+	// Compact layout, without indices
+	{
+		Mesh n(Graphics::TRIANGLE_STRIP);
+		for(int i=0; i<=16; ++i){
+			float t = float(i)/16;
+			n.vertex(1.8*t - 0.9, (i&1) ? 0.7 : -0.7, 0);
+			n.color(t, 1-t, 0.5);
+		}
+
+		MeshCache cc(VertexLayout::compact());
+		assert(cc.layout().format(VertexLayout::POSITION) == VertexLayout::SNORM16);
+		assert(cc.layout().format(VertexLayout::COLOR) == VertexLayout::UNORM8);
+		cc.add(n);
+		// quantized colors and positions may differ slightly along edges
+		assert(compare(g, cc, n, 2) < W*H/100);
+		assert(1 == cc.uploads());
+		assert(17*(8+4) == (int)cc.bytesUploaded());
+	}
+
+	// Formats the fixed-function pipeline cannot read are replaced
+	{
+		VertexLayout l;
+		l.format(VertexLayout::POSITION, VertexLayout::UNORM8);
+		l.format(VertexLayout::NORMAL, VertexLayout::UNORM8);
+		MeshCache cc(l);
+		assert(cc.layout().format(VertexLayout::POSITION) == VertexLayout::FLOAT32);
+		assert(cc.layout().format(VertexLayout::NORMAL) == VertexLayout::FLOAT32);
+	}
+
+	c.remove(m);
+	assert(!c.contains(m));
+	assert(!c.draw(m));
+
+	g.matrixMode(Graphics::PROJECTION); g.popMatrix();
+	g.matrixMode(Graphics::MODELVIEW); g.popMatrix();
+	return 0;
+}
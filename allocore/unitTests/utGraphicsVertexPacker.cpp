@@ -0,0 +1,157 @@
+#include "utAllocore.h"
+
+// Read a value of type T at a byte offset
+template <class T>
+static T get(const char * data, int offset){
+	T v;
+	memcpy(&v, data + offset, sizeof v);
+	return v;
+}
+
+int utGraphicsVertexPacker(){
+
+	typedef VertexLayout VL;
+
+	Mesh m;
+	m.vertex(-1, 0, 2);	m.normal(0, 0, 1);	m.color(1, 0, 0.5);	m.texCoord(0, 1);
+	m.vertex( 3, 1, 2);	m.normal(0, 1, 0);	m.color(0, 1, 0);	m.texCoord(0.5, 0.25);
+	m.vertex( 1, 2, 4);	m.normal(-1, 0, 0);	m.color(0, 0, 1);	m.texCoord(1, 0);
+
+	// 32-bit floats
+	{
+		VertexPacker p;
+		p.pack(m);
+		const VL& l = p.layout();
+		assert(l.stride() == 4*(3+3+4+2));
+		assert(l.offset(VL::POSITION) == 0);
+		assert(l.offset(VL::NORMAL) == 12);
+		assert(l.offset(VL::COLOR) == 24);
+		assert(l.offset(VL::TEXCOORD) == 40);
+		assert(l.components(VL::TEXCOORD) == 2);
+		assert(p.numVertices() == 3);
+		assert(p.size() == 3*l.stride());
+		assert(p.dirty() && p.dirtyBegin() == 0 && p.dirtyEnd() == p.size());
+
+		const char * d = p.data() + l.stride();
+		assert(0 == memcmp(d +  0, &m.vertices()[1][0], 12));
+		assert(0 == memcmp(d + 12, &m.normals()[1][0], 12));
+		assert(0 == memcmp(d + 24, m.colors()[1].components, 16));
+		assert(0 == memcmp(d + 40, &m.texCoord2s()[1][0], 8));
+	}
+
+	// Compact; positions are mapped from the bounds [-1,3] x [0,2] x [2,4],
+	// scaled by the largest extent along all axes
+	{
+		VertexPacker p(VL::compact());
+		p.pack(m);
+		const VL& l = p.layout();
+		assert(l.stride() == 8 + 4 + 4 + 4);
+		assert(l.positionOffset() == Vec3f(1,1,3));
+		assert(l.positionScale() == Vec3f(2,2,2));
+
+		const char * d = p.data();
+		assert(get<int16_t>(d, 0) == -32767);
+		assert(get<int16_t>(d, 2) == -16384);
+		assert(get<int16_t>(d, 4) == -16384);
+		assert(get<int16_t>(d, 6) == 0);				// padding
+		assert(get<int8_t>(d, 8) == 0);
+		assert(get<int8_t>(d, 10) == 127);
+		assert(get<uint8_t>(d, 11) == 0);				// padding
+		assert(get<uint8_t>(d, 12) == 255);
+		assert(get<uint8_t>(d, 13) == 0);
+		assert(get<uint8_t>(d, 14) == 128);
+		assert(get<uint8_t>(d, 15) == 255);
+		assert(get<uint16_t>(d, 16) == 0x0000);
+		assert(get<uint16_t>(d, 18) == 0x3c00);
+
+		d += l.stride();
+		assert(get<int16_t>(d, 0) == 32767);
+		assert(get<int16_t>(d, 2) == 0);
+		assert(get<int8_t>(d, 9) == 127);
+		assert(get<uint16_t>(d, 16) == 0x3800);
+		assert(get<uint16_t>(d, 18) == 0x3400);
+
+		d += l.stride();
+		assert(get<int16_t>(d, 4) == 16384);
+		assert(get<int8_t>(d, 8) == -127);
+	}
+
+	// Attributes the mesh lacks are left out; a lone color is replicated
+	{
+		Mesh s;
+		s.vertex(0,0,0); s.vertex(1,0,0);
+		s.color(Colori(10,20,30,40));
+		s.normal(0,0,1);					// too few normals
+
+		VL req;
+		req.format(VL::COLOR, VL::UNORM8);
+		VertexPacker p(req);
+		p.pack(s);
+		const VL& l = p.layout();
+		assert(!l.has(VL::NORMAL) && !l.has(VL::TEXCOORD));
+		assert(l.offset(VL::COLOR) == 12);
+		assert(l.stride() == 16);
+		for(int i=0; i<2; ++i){
+			assert(get<uint32_t>(p.data(), i*16 + 12) == s.coloris()[0].rgba);
+		}
+	}
+
+	// Repacking ranges
+	{
+		Mesh a = m;
+		VertexPacker p(VL::compact());
+		p.pack(a);
+		uint64_t key = p.key();
+		p.clean();
+		assert(!p.dirty());
+
+		// within bounds: only the one vertex changes
+		a.vertices()[1].set(3, 0.5, 3);
+		a.colors()[1].set(1, 1, 1);
+		p.repack(a, 1, 2);
+		int stride = p.layout().stride();
+		assert(p.dirtyBegin() == stride && p.dirtyEnd() == 2*stride);
+		assert(p.key() != key);
+
+		VertexPacker q(VL::compact());
+		q.pack(a);
+		assert(q.size() == p.size());
+		assert(0 == memcmp(q.data(), p.data(), p.size()));
+		assert(q.key() == p.key());
+
+		// out of bounds: everything is repacked with new bounds
+		p.clean();
+		a.vertices()[2].set(5, 2, 4);
+		p.repack(a, 2);
+		assert(p.dirtyBegin() == 0 && p.dirtyEnd() == p.size());
+		assert(p.layout().positionOffset() == Vec3f(2,1,3));
+		q.pack(a);
+		assert(0 == memcmp(q.data(), p.data(), p.size()));
+
+		// a new vertex also forces a full pack
+		a.vertex(0,0,0); a.normal(0,0,1); a.color(0,0,0); a.texCoord(0,0);
+		p.repack(a, 3);
+		assert(p.numVertices() == 4);
+	}
+
+	// Keys distinguish layouts
+	{
+		VertexPacker p, q(VL::compact());
+		p.pack(m);
+		q.pack(m);
+		assert(p.key() != q.key());
+		assert(p.layout().key() != q.layout().key());
+		VertexPacker r;
+		r.pack(m);
+		assert(r.key() == p.key());
+
+		// equal layouts have equal keys
+		VL fixed = VL::compact().bounds(Vec3f(-1), Vec3f(1));
+		VL autoB = VL::compact().bounds(Vec3f(-1), Vec3f(1)).autoBounds();
+		assert(!(fixed == autoB));
+		assert(fixed.key() != autoB.key());
+		assert(autoB.key() == VL(autoB).key());
+	}
+
+	return 0;
+}
@@ -0,0 +1,138 @@
+#include <vector>
+#include "utAllocore.h"
+
+static const double fps = 44100;
+static const int fpb = 64;
+
+// Writes a ramp per channel, scaled by a gain set through a message queue
+struct Source{
+	MsgQueue queue;
+	Clock clock;
+	float gain;
+	uint64_t frame;
+	int badClock;
+	Source(): gain(1), frame(0), badClock(0){}
+
+	static float value(uint64_t i, int c){ return float((i + 100*c) % 1000) / 1000; }
+	static void setGain(al_sec t, Source * s, float v){ s->gain = v; }
+
+	static void onAudio(AudioIOData& io){
+		Source& s = io.user<Source>();
+		if(fabs(s.clock.now() - s.frame/fps) > 1e-9) ++s.badClock;
+		while(io()){
+			for(int c=0; c<io.channelsOut(); ++c){
+				io.out(c) = value(s.frame, c) * s.gain;
+			}
+			++s.frame;
+		}
+	}
+};
+
+// Reads back inputs and counts samples differing from expectations
+struct Sink{
+	uint64_t frame;
+	uint64_t gainFrame;	// frame at which gain drops to 0.5
+	uint64_t end;		// frame at which the input ends
+	int channels;		// number of channels in the input
+	int errors;
+	Sink(uint64_t g, uint64_t e, int n): frame(0), gainFrame(g), end(e), channels(n), errors(0){}
+
+	static void onAudio(AudioIOData& io){
+		Sink& s = io.user<Sink>();
+		while(io()){
+			for(int c=0; c<io.channelsIn(); ++c){
+				float expect = c < s.channels && s.frame < s.end ? Source::value(s.frame, c) : 0;
+				if(s.frame >= s.gainFrame) expect *= 0.5;
+				if(fabs(io.in(c) - expect) > 1e-6) ++s.errors;
+			}
+			++s.frame;
+		}
+	}
+};
+
+static long fileSize(const char * path){
+	FILE * f = fopen(path, "rb");
+	if(!f) return -1;
+	fseek(f, 0, SEEK_END);
+	long n = ftell(f);
+	fclose(f);
+	return n;
+}
+
+static void roundTrip(const char * path, int chans, int headerSize){
+	// Render a bit more than a second; gain changes at the block after 0.5 s
+	const double length = 1.01;
+	const uint64_t frames = uint64_t(length * fps + 0.5);
+	const uint64_t gainFrame = (uint64_t(0.5*fps) / fpb + 1) * fpb;
+
+	{
+		Source src;
+		src.queue.send(0.5, Source::setGain, &src, 0.5f);
+
+		AudioIO io(fpb, fps, Source::onAudio, &src, chans, 0, AudioIO::OFFLINE);
+		io.timebase(&src.queue).timebase(&src.clock);
+		io.outputFile(path).renderLength(length);
+		assert(io.start());
+		io.waitForRender();
+
+		assert(0 == src.badClock);
+		assert(io.framesProcessed() >= frames);
+		assert(io.framesProcessed() < frames + fpb);
+		assert(fabs(io.time() - io.framesProcessed()/fps) < 1e-9);
+		assert(0 == src.queue.len());
+	}
+
+	// The last block is cut to the render length
+	assert(fileSize(path) == long(headerSize + frames*chans*4));
+
+	// Read back as input, into one more channel than the file has; channels
+	// past the file's and frames past its end are silent
+	{
+		Sink sink(gainFrame, frames, chans);
+		AudioIO io(fpb, fps, Sink::onAudio, &sink, 0, chans+1, AudioIO::OFFLINE);
+		io.inputFile(path);
+		assert(io.start());
+		io.waitForRender();
+
+		// Render lasts as long as the input, rounded up to a whole block
+		assert(io.framesProcessed() == (frames + fpb - 1) / fpb * fpb);
+		assert(sink.frame == io.framesProcessed());
+		assert(0 == sink.errors);
+	}
+
+	remove(path);
+}
+
+int utIOAudioIOOffline(){
+
+	roundTrip("utIOAudioIOOffline.wav", 2, 44);
+	roundTrip("utIOAudioIOOffline.au", 3, 24);
+	roundTrip("utIOAudioIOOffline6.wav", 6, 68);
+
+	// Without files or length, rendering goes on until stopped
+	{
+		Source src;
+		AudioIO io(fpb, fps, Source::onAudio, &src, 2, 0, AudioIO::OFFLINE);
+		assert(io.start());
+		while(io.framesProcessed() < fps){
+			assert(io.cpu() >= 0);
+			al_sleep(0.001);
+		}
+		assert(io.stop());
+		assert(src.frame == io.framesProcessed());
+		assert(io.cpu() > 0);
+
+		// Restarting starts over from time zero
+		src.frame = 0;
+		src.badClock = 0;
+		src.clock = Clock();
+		io.timebase(&src.clock);
+		io.renderLength(0.1);
+		assert(io.start());
+		io.waitForRender();
+		assert(0 == src.badClock);
+		assert(src.frame == io.framesProcessed());
+	}
+
+	return 0;
+}
@@ -0,0 +1,172 @@
+#include "utAllocore.h"
+
+static const int fpb = 128;
+
+// Writes a decaying sine to one output channel, filtering it through the
+// temporary buffer so that shared frame counters or buffers would show
+struct Voice : public AudioCallback{
+	int chan;
+	double phase;
+	Atomic<int> * active;
+	int maxActive;
+	Voice(int c, Atomic<int> * a): chan(c), phase(0), active(a), maxActive(0){}
+
+	void onAudioCB(AudioIOData& io){
+		int n = ++(*active);
+		if(n > maxActive) maxActive = n;
+		while(io()){
+			float s = 0;
+			for(int k=1; k<200; ++k) s += sin(phase*k)/k;
+			phase += 0.01*(chan+1);
+			io.temp(io.frame()) = s;
+		}
+		for(int i=0; i<io.framesPerBuffer(); ++i){
+			io.out(chan, i) += io.temp(i>0 ? i-1 : 0) * 0.5f + io.temp(i) * 0.5f;
+		}
+		--(*active);
+	}
+};
+
+// Sums channels [0, n) into channel n
+struct Mixer : public AudioCallback{
+	int n;
+	Mixer(int chans): n(chans){}
+	void onAudioCB(AudioIOData& io){
+		while(io()){
+			float s = 0;
+			for(int c=0; c<n; ++c) s += io.out(c);
+			io.out(n) = s;
+		}
+	}
+};
+
+// Copies input to a bus channel
+struct Tap : public AudioCallback{
+	void onAudioCB(AudioIOData& io){
+		while(io()) io.bus(0) = io.in(0) * 2;
+	}
+};
+
+static void inputCB(AudioIOData& io){
+	// main callback; must run before the handlers
+	while(io()) io.out(0) = 0.25;
+}
+
+// Render a few blocks and return the sum of the outputs
+static double render(TaskPool * pool, int& maxActive){
+	Atomic<int> active(0);
+	Voice v0(0, &active), v1(1, &active), v2(2, &active), v3(3, &active);
+	Mixer mix(4);
+	Tap tap;
+
+	AudioIO io(fpb, 44100, inputCB, 0, 5, 1, AudioIO::OFFLINE);
+	io.channelsBus(1);
+	io.append(v0, AudioAccess().write(AudioAccess::OUTPUT, 0, 1));
+	io.append(v1, AudioAccess().write(AudioAccess::OUTPUT, 1, 2));
+	io.append(v2, AudioAccess().write(AudioAccess::OUTPUT, 2, 3));
+	io.append(v3, AudioAccess().write(AudioAccess::OUTPUT, 3, 4));
+	io.append(mix, AudioAccess().read(AudioAccess::OUTPUT, 0, 4).write(AudioAccess::OUTPUT, 4, 5));
+	io.append(tap, AudioAccess().read(AudioAccess::INPUT).write(AudioAccess::BUS));
+	io.parallel(pool);
+
+	double sum = 0;
+	for(int b=0; b<20; ++b){
+		io.zeroOut();
+		io.processAudio();
+		for(int c=0; c<io.channelsOut(); ++c){
+			for(int i=0; i<fpb; ++i) sum += io.out(c,i) * (c+1);
+		}
+	}
+
+	assert(io.cpuTime(v0) > 0);
+	assert(io.cpu(mix) > 0);
+	assert(0 == io.cpuTime(Tap()));
+
+	maxActive = v0.maxActive;
+	return sum;
+}
+
+int utIOAudioIOParallel(){
+
+	// Conflicts
+	{
+		typedef AudioAccess A;
+		A none;
+		assert(!none.conflicts(A::all()));
+		assert(A::all().conflicts(A::all()));
+		assert(!A().read(A::INPUT).conflicts(A().read(A::INPUT)));
+		assert( A().read(A::INPUT, 2, 4).conflicts(A().write(A::INPUT, 3)));
+		assert(!A().read(A::INPUT, 2, 4).conflicts(A().write(A::INPUT, 4)));
+		assert(!A().write(A::OUTPUT, 0, 2).conflicts(A().write(A::OUTPUT, 2, 4)));
+		assert( A().write(A::OUTPUT, 0, 3).conflicts(A().write(A::OUTPUT, 2, 4)));
+		assert(!A().write(A::OUTPUT).conflicts(A().write(A::BUS)));
+		assert(!A().write(A::OUTPUT, 3, 3).conflicts(A::all()));
+	}
+
+	// Parallel and serial runs agree
+	{
+		TaskPool pool(3);
+		int maxActive;
+		double serial = render(0, maxActive);
+		assert(1 == maxActive);
+		double parallel = render(&pool, maxActive);
+		assert(serial == parallel);
+		assert(serial != 0);
+	}
+
+	// Undeclared handlers keep their order
+	{
+		struct Order : public AudioCallback{
+			int id, * last;
+			bool ok;
+			Order(int i, int * l): id(i), last(l), ok(true){}
+			void onAudioCB(AudioIOData& io){
+				if(*last != id-1) ok = false;
+				*last = id;
+			}
+		};
+		TaskPool pool(2);
+		int last = -1;
+		Order a(0, &last), b(1, &last), c(2, &last);
+		AudioIO io(fpb, 44100, 0, 0, 2, 0, AudioIO::OFFLINE);
+		io.append(a).append(b, AudioAccess().write(AudioAccess::BUS)).append(c);
+		io.parallel(&pool);
+		for(int i=0; i<10; ++i){
+			last = -1;
+			io.processAudio();
+		}
+		assert(a.ok && b.ok && c.ok);
+
+		io.remove(b);
+		last = 0;
+		c.id = 1;
+		io.processAudio();
+		assert(c.ok);
+		assert(0 == io.cpuTime(b));
+	}
+
+	// Handlers change while the stream is running
+	{
+		struct Counter : public AudioCallback{
+			Atomic<int> blocks;
+			void onAudioCB(AudioIOData& io){ ++blocks; }
+		};
+		TaskPool pool(2);
+		Counter a, b;
+		AudioIO io(fpb, 44100, 0, 0, 2, 0, AudioIO::OFFLINE);
+		io.append(a, AudioAccess().write(AudioAccess::BUS));
+		io.parallel(&pool);
+		io.renderLength(60);
+		assert(io.start());
+		for(int i=0; i<200; ++i){
+			io.append(b, AudioAccess().write(AudioAccess::OUTPUT));
+			io.remove(b);
+		}
+		io.append(b);
+		io.stop();
+		assert(uint64_t(a.blocks.load()) * fpb == io.framesProcessed());
+		assert(a.blocks.load() >= b.blocks.load());
+	}
+
+	return 0;
+}
@@ -70,6 +70,11 @@ struct MyWindow : Window{
 		assert(defaultDim().w == dim.w);
 		assert(defaultDim().h == dim.h);
 
+		// Tests needing a current GL context
+		printf("GraphicsMeshCache ");
+		utGraphicsMeshCache();
+		printf("pass\n");
+
 		Window::stopLoop();
 		return true;
 	}
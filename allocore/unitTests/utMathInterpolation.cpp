@@ -0,0 +1,67 @@
+#include <vector>
+#include "utAllocore.h"
+
+// Compare block reads against the scalar interpolators
+static void checkBlock(const ipl::RingView<float>& r, const std::vector<double>& delays){
+	const int N = delays.size();
+	std::vector<float> lin(N), cub(N), lag(N);
+	ipl::linear(&lin[0], r, &delays[0], N);
+	ipl::cubic(&cub[0], r, &delays[0], N);
+	ipl::lagrange3(&lag[0], r, &delays[0], N);
+
+	for(int i=0; i<N; ++i){
+		int d = int(delays[i]);
+		float f = delays[i] - d;
+		float w = r.read(d-1), x = r.read(d), y = r.read(d+1), z = r.read(d+2);
+		assert(fabs(lin[i] - ipl::linear(f, x, y)) < 1e-6);
+		assert(fabs(cub[i] - ipl::cubic(f, w, x, y, z)) < 1e-6);
+		float h[4];
+		ipl::lagrange3(h, 1.f + f);
+		assert(fabs(lag[i] - (h[0]*w + h[1]*x + h[2]*y + h[3]*z)) < 1e-6);
+	}
+}
+
+int utMathInterpolation(){
+
+	// RingView addresses elements like RingBuffer
+	{
+		RingBuffer<float> rb(16);
+		for(int i=0; i<40; ++i) rb.write(i);
+		ipl::RingView<float> r(&rb[0], rb.size(), rb.pos());
+		for(int i=0; i<rb.size(); ++i) assert(r.read(i) == rb.read(i));
+	}
+
+	// Block reads match scalar reads, with and without wrapping
+	{
+		const int S = 256, N = 64;
+		std::vector<float> buf(S);
+		for(int i=0; i<S; ++i) buf[i] = sin(i*0.37) + ((i*7)%5)*0.1;
+
+		std::vector<double> delays(N);
+
+		// sweeping delay, as from a moving source; no wrap
+		ipl::RingView<float> r(&buf[0], S, 200);
+		for(int i=0; i<N; ++i) delays[i] = 80.3 + N - i + i*0.07;
+		checkBlock(r, delays);
+
+		// same delays across the start of the ring
+		r.pos = 100;
+		checkBlock(r, delays);
+
+		// scattered delays over the full valid range
+		r.pos = 17;
+		for(int i=0; i<N; ++i) delays[i] = 1 + fmod(i*37.731, S-4.);
+		checkBlock(r, delays);
+
+		// integer delays read samples exactly
+		r.pos = 200;
+		std::vector<float> out(N);
+		for(int i=0; i<N; ++i) delays[i] = 3 + i;
+		ipl::linear(&out[0], r, &delays[0], N);
+		for(int i=0; i<N; ++i) assert(out[i] == r.read(3+i));
+		ipl::cubic(&out[0], r, &delays[0], N);
+		for(int i=0; i<N; ++i) assert(out[i] == r.read(3+i));
+	}
+
+	return 0;
+}
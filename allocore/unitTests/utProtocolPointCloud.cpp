@@ -0,0 +1,135 @@
+#include "utAllocore.h"
+
+int utProtocolPointCloud(){
+
+	const int N = 5000;
+	Mesh m;
+	for(int i=0; i<N; ++i){
+		float t = float(i)/N;
+		m.vertex(cos(t*40)*2, sin(t*40)*2, t*3 - 1);
+		m.color(Color(t, 1-t, 0.5, 1));
+	}
+
+	// resolution of quantization along each axis
+	const Vec3f tol(4.f/65535, 4.f/65535, 3.f/65535);
+
+	// Frame decodes from datagrams in any order
+	{
+		PointCloudEncoder enc;
+		PointCloudDecoder dec;
+		int np = enc.encode(m);
+		assert(np == (N + enc.pointsPerPacket(true)-1) / enc.pointsPerPacket(true));
+		for(int i=0; i<np; ++i) assert(enc.packetSize(i) <= 1400);
+
+		for(int i=np-1; i>=0; --i){
+			bool done = dec.decode(enc.packet(i), enc.packetSize(i));
+			assert(done == (i==0));
+		}
+		assert(dec.size() == N);
+		assert(dec.hasColors());
+		assert(dec.frameId() == enc.frameId());
+		for(int i=0; i<N; ++i){
+			Vec3f d = dec.positions()[i] - m.vertices()[i];
+			for(int k=0; k<3; ++k) assert(fabs(d[k]) <= tol[k]);
+			assert(dec.colors()[i].rgba == Colori(m.colors()[i]).rgba);
+		}
+
+		Mesh out;
+		dec.copyTo(out);
+		assert(out.vertices().size() == N);
+		assert(out.colors().size() == N);
+
+		Array arr;
+		dec.copyTo(arr);
+		assert(arr.components() == 3);
+		assert(arr.header.dim[0] == N);
+		assert(((Vec3f *)arr.data.ptr)[N-1] == dec.positions()[N-1]);
+	}
+
+	// Lost, stale, duplicate and malformed datagrams
+	{
+		PointCloudEncoder enc;
+		PointCloudDecoder dec;
+		enc.maxPacketSize(200).bounds(Vec3f(-2,-2,-1), Vec3f(2,2,2));
+
+		// frame 1 misses its last datagram
+		int np = enc.encode(m);
+		assert(np > 2);
+		std::vector<char> stale(enc.packet(0), enc.packet(0) + enc.packetSize(0));
+		for(int i=0; i<np-1; ++i) assert(!dec.decode(enc.packet(i), enc.packetSize(i)));
+
+		// frame 2 arrives complete; the incomplete frame 1 is dropped
+		enc.encode(&m.vertices()[0], (const Colori *)0, 100);
+		for(int i=0; i<enc.numPackets(); ++i){
+			bool done = dec.decode(enc.packet(i), enc.packetSize(i));
+			assert(done == (i == enc.numPackets()-1));
+		}
+		assert(dec.framesDropped() == 1);
+		assert(dec.framesCompleted() == 1);
+		assert(dec.size() == 100);
+		assert(!dec.hasColors());
+
+		int invalid = dec.packetsInvalid();
+		assert(!dec.decode(&stale[0], stale.size()));				// stale
+		assert(!dec.decode(enc.packet(0), enc.packetSize(0)));		// duplicate
+		assert(!dec.decode(enc.packet(0), 20));						// truncated
+		char junk[64] = {0};
+		assert(!dec.decode(junk, sizeof junk));						// not ours
+		assert(dec.packetsInvalid() == invalid + 4);
+
+		// forged sizes must not make us allocate
+		std::vector<char> forged(enc.packet(1), enc.packet(1) + enc.packetSize(1));
+		forged[8] = 100; // newer frame id
+		forged[16] = forged[17] = forged[18] = 0; forged[19] = 1;	// 1<<24 datagrams
+		forged[20] = forged[21] = forged[22] = forged[23] = char(0xFF);	// 2^32-1 points
+		assert(!dec.decode(&forged[0], forged.size()));
+		forged[16] = forged[17] = char(0xFF); forged[19] = 0;		// 65535 datagrams
+		forged[20] = 0; forged[21] = 0; forged[22] = 0x20; forged[23] = 0;	// 2M points
+		assert(!dec.decode(&forged[0], forged.size()));
+		assert(dec.packetsInvalid() == invalid + 6);
+
+		// frames larger than allowed are rejected
+		PointCloudDecoder small(N/2);
+		assert(small.maxPoints() == N/2);
+		np = enc.encode(m);
+		for(int i=0; i<np; ++i) assert(!small.decode(enc.packet(i), enc.packetSize(i)));
+		assert(small.packetsInvalid() == np && small.size() == 0);
+
+		// empty frames get through too
+		assert(enc.encode((const Vec3f *)0, (const Colori *)0, 0) == 1);
+		assert(dec.decode(enc.packet(0), enc.packetSize(0)));
+		assert(dec.size() == 0);
+	}
+
+	// Over a socket
+	{
+		unsigned port = 4112;
+		PointCloudRecv recv(port, "", 0.1);
+		PointCloudSend send(port, "localhost");
+		Mesh small;
+		for(int i=0; i<400; ++i) small.vertex(i, -i, 0.5*i);
+
+		assert(send.send(small) == send.numPackets());
+		bool done = false;
+		for(int i=0; i<10 && !done; ++i) done = recv.recv();
+		assert(done);
+		assert(recv.size() == 400);
+		assert(!recv.hasColors());
+	}
+
+	// A blocking socket returns after each datagram
+	{
+		unsigned port = 4113;
+		PointCloudRecv recv(port, "", -1);
+		PointCloudSend send(port, "localhost");
+		Mesh small;
+		for(int i=0; i<400; ++i) small.vertex(i, i, 0);
+
+		assert(send.send(small) == 2);
+		assert(!recv.recv());
+		assert(recv.recv());
+		assert(recv.size() == 400);
+	}
+
+	return 0;
+}
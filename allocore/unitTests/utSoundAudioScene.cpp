@@ -0,0 +1,346 @@
+#include <vector>
+#include "utAllocore.h"
+
+static const int fpb = 128;
+
+// A scene of sources orbiting, or standing still around, one or two listeners
+struct TestScene{
+	int listeners;		// bit mask: 1 at the origin on channels [0,4), 2 on [4,8)
+	bool samePos;		// whether listener 2 is also at the origin
+	TaskPool * pool;	// pool to render listeners on, or 0
+	int sources;		// number of sources
+	double radius;		// radius of orbits, or 0 for sources standing at pos
+	Vec3d pos;
+	double farClip;		// of the first source; each next one's is 10 further
+	bool doppler;
+	bool silent;		// whether to add a silent source
+	float cullLevel;
+	double lodDistance;
+	float lodLevel;
+	int compact;		// delay-lines: 0 = own, 1 = pooled, 2 = pooled at half precision
+	int culled, demoted;	// counts of last block rendered
+
+	TestScene()
+	:	listeners(1), samePos(false), pool(0), sources(1), radius(0), pos(0),
+		farClip(100), doppler(true), silent(false), cullLevel(0), lodDistance(HUGE_VAL), lodLevel(0),
+		compact(0), culled(0), demoted(0)
+	{}
+
+	// Render and return all output samples, by block, then channel, then frame
+	std::vector<float> render(){
+		AudioIO io(fpb, 44100, 0, 0, 8, 0, AudioIO::DUMMY);
+		AudioScene scene(fpb);
+		scene.parallel(pool);
+		scene.cullLevel(cullLevel).lodDistance(lodDistance).lodLevel(lodLevel);
+
+		SpeakerRingLayout<4> layout0(0), layout1(4, 45);
+		Dbap panner0(layout0), panner1(layout1);
+		if(listeners & 1) scene.createListener(&panner0)->pos(0,0,0);
+		if(listeners & 2) scene.createListener(&panner1)->pos(samePos ? 0 : 3, 0, 0);
+
+		std::vector<SoundSource> src(sources);
+		SoundSource quiet;
+		for(int s=0; s<sources; ++s){
+			src[s].useDoppler(doppler);
+			src[s].farClip(farClip + 10*s);
+			src[s].pos(pos.x, pos.y, pos.z);
+			scene.addSource(src[s]);
+		}
+		if(silent) scene.addSource(quiet);
+
+		std::vector<float> out;
+		for(int b=0; b<30; ++b){
+			if(b == 5 && compact){
+				scene.compactDelays(44100, compact == 2);
+				for(int s=0; s<sources; ++s){
+					int size = fpb + 2 + SoundSource::PEAK_SEGMENT
+						+ SoundSource::bufferSize(44100, 344, src[s].farClip());
+					assert(src[s].delaySize() == size);
+					assert(src[s].halfPrecision() == (compact == 2));
+				}
+			}
+			for(int s=0; s<sources; ++s){
+				for(int i=0; i<fpb; ++i) src[s].writeSample(sin(0.02*(b*fpb+i)*(s+1)));
+				if(radius > 0){
+					double a = 0.05*b*(s+1) + s;
+					src[s].pos(radius*cos(a), radius*sin(a), s*0.5);
+				}
+			}
+			for(int i=0; i<fpb; ++i) quiet.writeSample(0);
+			io.zeroOut();
+			scene.render(io);
+			for(int c=0; c<8; ++c) for(int i=0; i<fpb; ++i) out.push_back(io.out(c,i));
+		}
+		culled = scene.numCulled();
+		demoted = scene.numDemoted();
+
+		// Sources leaving the scene keep their delay-lines
+		float newest = src[0].readSample(1);
+		scene.removeSource(src[0]);
+		assert(src[0].readSample(1) == newest);
+		assert(src[0].halfPrecision() == (compact == 2));
+		return out;
+	}
+};
+
+static std::vector<float> sum(const std::vector<float>& a, const std::vector<float>& b){
+	std::vector<float> r(a);
+	for(unsigned i=0; i<r.size(); ++i) r[i] += b[i];
+	return r;
+}
+
+int utSoundAudioScene(){
+
+	// Delay-line peaks and unit delay reads
+	{
+		SoundSource src(1, 100, ATTEN_INVERSE, 0, 1000);
+		for(int i=0; i<1500; ++i) src.writeSample(i == 1200 ? -3 : (i%10)*0.01);
+		// sample 1200 is 299 samples ago; ranges are only exact to a segment
+		assert(src.peak(0, 299) == 3);
+		assert(src.peak(299, 299) == 3);
+		assert(src.peak(0, 299 - 2*SoundSource::PEAK_SEGMENT) < 0.1f);
+		assert(src.peak(299 + 2*SoundSource::PEAK_SEGMENT, 900) < 0.1f);
+		assert(src.peak(900, 999) == FLT_MAX);
+
+		std::vector<float> out(300);
+		src.readSamples(&out[0], 0, 300);
+		for(int i=0; i<300; ++i) assert(out[i] == src.readSample(300-i));
+		src.readSamples(&out[0], 650, 300);
+		for(int i=0; i<300; ++i) assert(out[i] == src.readSample(950-i));
+	}
+
+	// Silent sources are culled without changing the output
+	{
+		TestScene t;
+		t.pos.set(3,1,0);
+		std::vector<float> expect = t.render();
+		t.silent = true;
+		std::vector<float> out = t.render();
+		assert(t.culled == 1 && t.demoted == 0);
+		for(unsigned i=0; i<expect.size(); ++i) assert(out[i] == expect[i]);
+	}
+
+	// Sources beyond their delay-line are culled
+	{
+		TestScene t;
+		t.pos.set(500,0,0);
+		std::vector<float> out = t.render();
+		assert(t.culled == 1);
+		for(unsigned i=0; i<out.size(); ++i) assert(out[i] == 0);
+	}
+
+	// Far and quiet sources are read at a whole sample delay and panned
+	// from a direction on the grid
+	{
+		TestScene t;
+		t.pos.set(0,20,0);
+		t.doppler = false;
+		std::vector<float> expect = t.render();
+		t.doppler = true;
+		t.lodDistance = 10;
+		std::vector<float> out = t.render();
+		assert(t.culled == 0 && t.demoted == 1);
+		const int delay = 20 * 44100 / 344;
+		for(unsigned k=0; k<out.size(); ++k){
+			// samples are stored by block, then channel
+			int c = k / fpb % 8;
+			int n = k / (8*fpb) * fpb + k % fpb - delay;
+			assert(out[k] == (n < 0 ? 0 : expect[n / fpb * 8*fpb + c*fpb + n % fpb]));
+		}
+
+		// sources are demoted once their level falls below the LOD level
+		t.lodDistance = HUGE_VAL;
+		t.lodLevel = 0.8;
+		t.render();
+		assert(t.culled == 0 && t.demoted == 1);
+
+		t.lodLevel = 0.5;
+		t.render();
+		assert(t.culled == 0 && t.demoted == 0);
+	}
+
+	// Demoted sources at the listener are panned as if not demoted
+	{
+		TestScene t;
+		std::vector<float> expect = t.render();
+		t.lodDistance = -1;
+		std::vector<float> out = t.render();
+		assert(t.demoted == 1);
+		for(unsigned i=0; i<expect.size(); ++i) assert(out[i] == expect[i]);
+	}
+
+	// Demoted sources are only promoted once clearly within the thresholds
+	{
+		AudioIO io(fpb, 44100, 0, 0, 8, 0, AudioIO::DUMMY);
+		AudioScene scene(fpb);
+		scene.lodDistance(10).lodHysteresis(0.1);
+		SpeakerRingLayout<8> layout;
+		Dbap panner(layout);
+		scene.createListener(&panner);
+		SoundSource src;
+		scene.addSource(src);
+		for(int i=0; i<3000; ++i) src.writeSample(0.5);
+
+		const double dist[] = {12, 9.5, 12, 9.5, 8.5, 9.5, 10.5};
+		const int expect[]  = { 1,   1,  1,   1,   0,   0,    1};
+		for(int b=0; b<7; ++b){
+			for(int i=0; i<fpb; ++i) src.writeSample(0.5);
+			src.pos(dist[b], 0, 0);
+			io.zeroOut();
+			scene.render(io);
+			assert(scene.numCulled() == 0 && scene.numDemoted() == expect[b]);
+		}
+	}
+
+	// Sources culled for a block start again at their gains instead of
+	// ramping from those they were culled at
+	{
+		AudioIO io(fpb, 44100, 0, 0, 4, 0, AudioIO::DUMMY);
+		AudioScene scene(fpb);
+		scene.cullLevel(0.01);
+		SpeakerRingLayout<4> layout;
+		Dbap panner(layout);
+		scene.createListener(&panner);
+		SoundSource src;
+		src.useDoppler(false);
+		scene.addSource(src);
+
+		const float level[] = {0.5, 0, 0, 0, 0.5};
+		for(int b=0; b<5; ++b){
+			for(int i=0; i<fpb; ++i) src.writeSample(level[b]);
+			src.pos(4 == b ? -1 : 1, 0, 0);
+			io.zeroOut();
+			scene.render(io);
+			if(3 == b) assert(scene.numCulled() == 1);
+		}
+		assert(scene.numCulled() == 0);
+		// the first frame is read from before the source was heard again
+		for(int k=0; k<4; ++k) assert(io.out(k,1) == io.out(k,fpb-1));
+	}
+
+	// Demotion is tracked per listener, whatever listeners share positions
+	{
+		AudioIO io(fpb, 44100, 0, 0, 8, 0, AudioIO::DUMMY);
+		AudioScene scene(fpb);
+		scene.lodDistance(10).lodHysteresis(0.1);
+		SpeakerRingLayout<8> layout;
+		Dbap p0(layout), p1(layout), p2(layout);
+		Listener * l1;
+		scene.createListener(&p0)->pos(0,0,0);
+		l1 = scene.createListener(&p1);
+		l1->pos(30,0,0);
+		scene.createListener(&p2)->pos(60,0,0);
+		SoundSource src;
+		src.useDoppler(false);
+		src.pos(50.5,0,0);		// only near enough to the last listener
+		scene.addSource(src);
+
+		for(int b=0; b<2; ++b){
+			// the last listener's position index changes from 2 to 1, but it
+			// must not take on the demotion of the listener it replaces
+			if(1 == b) l1->pos(0,0,0);
+			for(int i=0; i<fpb; ++i) src.writeSample(0.5);
+			io.zeroOut();
+			scene.render(io);
+			assert(scene.numDemoted() == (0 == b ? 2 : 1));
+		}
+	}
+
+	// Pooled delay-lines sound the same, or nearly so at half precision
+	{
+		TestScene t;
+		t.sources = 3;
+		t.radius = 15;
+		t.farClip = 20;
+		// peaks are rebuilt when compacting, which may change when sources
+		// start to be culled
+		t.cullLevel = -1;
+		std::vector<float> expect = t.render();
+		t.compact = 1;
+		std::vector<float> out = t.render();
+		for(unsigned i=0; i<expect.size(); ++i) assert(out[i] == expect[i]);
+		t.compact = 2;
+		out = t.render();
+		for(unsigned i=0; i<expect.size(); ++i) assert(fabs(out[i] - expect[i]) < 1e-3);
+	}
+
+	// Sources may outlive the scene holding their delay-lines
+	{
+		SoundSource src;
+		{
+			AudioScene scene(fpb);
+			scene.addSource(src);
+			scene.compactDelays(44100);
+		}
+		for(int i=0; i<1000; ++i) src.writeSample(i);
+		assert(src.readSample(0) == 999);
+	}
+
+	// Copies of sources have delay-lines of their own
+	{
+		SoundSource a(1, 100, ATTEN_INVERSE, 0, 500);
+		for(int i=0; i<700; ++i) a.writeSample(i);
+		SoundSource b(a);
+		a.writeSample(-1);
+		assert(b.readSample(0) == 699 && b.readSample(499) == 200);
+		assert(b.peak(0, 100) == a.peak(1, 101));
+	}
+
+	// Slots of removed sources are reused without their cached gains
+	{
+		AudioIO io(fpb, 44100, 0, 0, 4, 0, AudioIO::DUMMY);
+		AudioScene scene(fpb);
+		SpeakerRingLayout<4> layout;
+		Dbap panner(layout);
+		scene.createListener(&panner);
+
+		SoundSource a, b, c;
+		scene.addSource(a);
+		scene.addSource(b);
+		assert(a.slot() == 0 && b.slot() == 1 && c.slot() == -1);
+
+		std::vector<float> ones(fpb, 1.f);
+		Vec3d rel(1,0,0);
+		panner.perform(io, a, rel, fpb, &ones[0]);
+		scene.removeSource(a);
+		assert(a.slot() == -1);
+		scene.addSource(c);
+		assert(c.slot() == 0);
+
+		// a new source starts at its gains instead of ramping from the old
+		io.zeroOut();
+		rel.set(0,1,0);
+		panner.perform(io, c, rel, fpb, &ones[0]);
+		for(int k=0; k<4; ++k) assert(io.out(k,0) == io.out(k,fpb-1));
+	}
+
+	TaskPool pool(2);
+
+	for(int k=0; k<2; ++k){
+		bool samePos = k;
+
+		// Listeners on their own match one scene with both listeners,
+		// whether rendered serially or in parallel
+		TestScene t;
+		t.sources = 3;
+		t.radius = 4;
+		t.samePos = samePos;
+		std::vector<float> one = t.render();
+		t.listeners = 2;
+		std::vector<float> expect = sum(one, t.render());
+		t.listeners = 3;
+		std::vector<float> serial = t.render();
+		t.pool = &pool;
+		std::vector<float> parallel = t.render();
+
+		double energy = 0;
+		for(unsigned i=0; i<expect.size(); ++i){
+			assert(serial[i] == expect[i]);
+			assert(parallel[i] == expect[i]);
+			energy += expect[i]*expect[i];
+		}
+		assert(energy > 1);
+	}
+
+	return 0;
+}
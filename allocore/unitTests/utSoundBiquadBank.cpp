@@ -0,0 +1,176 @@
+#include <vector>
+#include "utAllocore.h"
+
+// Scalar double precision biquad in transposed direct form II
+struct RefBiquad{
+	double b0,b1,b2,a1,a2, z1,z2;
+	RefBiquad(const BiquadBank::Coefs& c)
+	:	b0(c.b0), b1(c.b1), b2(c.b2), a1(c.a1), a2(c.a2), z1(0), z2(0){}
+	double operator()(double x){
+		double y = b0*x + z1;
+		z1 = b1*x - a1*y + z2;
+		z2 = b2*x - a2*y;
+		return y;
+	}
+};
+
+// Peak amplitude of the last half of a buffer
+static float peak(const std::vector<float>& v){
+	float m = 0;
+	for(unsigned i=v.size()/2; i<v.size(); ++i) if(fabs(v[i]) > m) m = fabs(v[i]);
+	return m;
+}
+
+int utSoundBiquadBank(){
+
+	typedef BiquadBank::Coefs Coefs;
+	const double fs = 44100;
+
+	// Butterworth designs have unity gain in the pass band and -3 dB at the cut-off
+	{
+		Coefs lp = Coefs::lowPass(150, fs);
+		Coefs hp = Coefs::highPass(150, fs);
+		assert(fabs((lp.b0+lp.b1+lp.b2)/(1+lp.a1+lp.a2) - 1) < 1e-3);
+		assert(fabs((hp.b0-hp.b1+hp.b2)/(1-hp.a1+hp.a2) - 1) < 1e-3);
+		assert(fabs(hp.b0+hp.b1+hp.b2) < 1e-6);
+	}
+
+	// Channels match scalar cascades, across groups and partial blocks, in place
+	{
+		const int N = 11, S = 2, F = 150;
+		BiquadBank bank(N, S);
+		assert(bank.channels() == N && bank.sections() == S);
+
+		std::vector<RefBiquad> ref;
+		for(int c=0; c<N; ++c){
+			for(int s=0; s<S; ++s){
+				double f = 100 + 300*c + 1000*s;
+				Coefs k = (c+s)&1 ? Coefs::highPass(f, fs) : Coefs::lowPass(f, fs);
+				bank.coefs(k, s, c);
+				ref.push_back(RefBiquad(k));
+			}
+		}
+		assert(bank.coefs(1, 3).b0 == Coefs::lowPass(3*300+1100, fs).b0);
+
+		std::vector<std::vector<float> > buf(N, std::vector<float>(F));
+		std::vector<float *> ptrs(N);
+		for(int c=0; c<N; ++c) ptrs[c] = &buf[c][0];
+
+		double maxErr = 0;
+		for(int b=0; b<3; ++b){
+			for(int c=0; c<N; ++c){
+				for(int i=0; i<F; ++i) buf[c][i] = sin((b*F+i) * 0.013 * (c+1)) + (i%7)*0.1;
+			}
+			std::vector<std::vector<float> > in(buf);
+			bank.process(&ptrs[0], &ptrs[0], F);
+			for(int c=0; c<N; ++c){
+				for(int i=0; i<F; ++i){
+					double y = in[c][i];
+					for(int s=0; s<S; ++s) y = ref[c*S+s](y);
+					double e = fabs(y - buf[c][i]);
+					if(e > maxErr) maxErr = e;
+				}
+			}
+		}
+		assert(maxErr < 1e-4);
+	}
+
+	// Null inputs are silent and groups without outputs keep their state
+	{
+		const int F = 64;
+		BiquadBank a(10, 1), b(10, 1);
+		a.coefs(Coefs::lowPass(500, fs), 0);
+		b.coefs(Coefs::lowPass(500, fs), 0);
+		std::vector<float> x(F, 1.f), ya(F), yb(F), silent(F, 7.f);
+		const float * in[10] = {0};
+		float * outA[10] = {0};
+		float * outB[10] = {0};
+		in[9] = &x[0];
+
+		// Channel 9, in the second group, has an input; channel 1 has none
+		outA[9] = &ya[0]; outA[1] = &silent[0];
+		a.process(outA, in, F);
+		outB[9] = &yb[0];
+		b.process(outB, in, F);
+		for(int i=0; i<F; ++i) assert(silent[i] == 0.f);
+
+		// Skip the second group of a for a block
+		float * none[10] = {0};
+		a.process(none, in, F);
+		a.process(outA, in, F);
+		b.process(outB, in, F);
+		for(int i=0; i<F; ++i) assert(ya[i] == yb[i]);
+	}
+
+	// Coefficient changes glide
+	{
+		const int F = 256;
+		BiquadBank bank(1, 1);
+		bank.smooth(100);
+		std::vector<float> x(F, 0.f);
+		float * p = &x[0];
+
+		bank.coefs(Coefs::lowPass(100, fs), 0);
+		x[0] = 1;
+		bank.process(&p, &p, F);
+		// first coefficients are still close to a pass-through
+		assert(fabs(x[0] - 1) < 0.02);
+
+		// after the glide, a DC input settles to unity
+		for(int b=0; b<40; ++b){
+			for(int i=0; i<F; ++i) x[i] = 1;
+			bank.process(&p, &p, F);
+		}
+		assert(fabs(x[F-1] - 1) < 1e-3);
+
+		// without smoothing, changes are immediate
+		bank.smooth(0).clear();
+		bank.coefs(Coefs::lowPass(100, fs), 0);
+		for(int i=0; i<F; ++i) x[i] = 0;
+		x[0] = 1;
+		bank.process(&p, &p, F);
+		assert(fabs(x[0] - Coefs::lowPass(100, fs).b0) < 1e-7);
+	}
+
+	// Linkwitz-Riley cross-over: bands are -6 dB at the cross-over
+	// frequency and sum to an allpass
+	{
+		const int N = 3, F = 8192;
+		CrossoverBank xo(N, 150, fs);
+		assert(xo.channels() == N);
+		assert(xo.freq() == 150);
+
+		std::vector<std::vector<float> > x(N, std::vector<float>(F));
+		std::vector<std::vector<float> > lo(x), hi(x);
+		const float * in[N];
+		float * plo[N], * phi[N];
+		const double freqs[N] = {150, 30, 2000};
+		for(int c=0; c<N; ++c){
+			for(int i=0; i<F; ++i) x[c][i] = sin(M_2PI * freqs[c] * i / fs);
+			in[c] = &x[c][0]; plo[c] = &lo[c][0]; phi[c] = &hi[c][0];
+		}
+		xo.process(plo, phi, in, F);
+
+		assert(fabs(peak(lo[0]) - 0.5) < 0.01);
+		assert(fabs(peak(hi[0]) - 0.5) < 0.01);
+		assert(fabs(peak(lo[1]) - 1) < 0.01);
+		assert(peak(hi[1]) < 0.01);
+		assert(peak(lo[2]) < 0.01);
+		assert(fabs(peak(hi[2]) - 1) < 0.01);
+		for(int c=0; c<N; ++c){
+			std::vector<float> sum(F);
+			for(int i=0; i<F; ++i) sum[i] = lo[c][i] + hi[c][i];
+			assert(fabs(peak(sum) - 1) < 0.01);
+		}
+
+		// high bands may replace the input
+		std::vector<std::vector<float> > hi2(x);
+		float * phi2[N];
+		for(int c=0; c<N; ++c) phi2[c] = &hi2[c][0];
+		CrossoverBank xo2(N, 150, fs);
+		xo2.process(plo, phi2, phi2, F);
+		for(int c=0; c<N; ++c) for(int i=0; i<F; ++i) assert(hi2[c][i] == hi[c][i]);
+	}
+
+	return 0;
+}
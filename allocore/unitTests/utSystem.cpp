@@ -50,5 +50,52 @@ int utSystem(){
 		assert(al_time_ns2s * tm.elapsed() == tm.elapsedSec());
 	}
 
+	// Deadline scheduling
+	// Wall-clock spacing varies too much on loaded machines to test, so
+	// these check that deadlines stay on their schedule and are never early
+	{
+		al_nsec period = 5e6;
+		int N = 20;
+
+		al_nsec t = al_steady_time_nsec();
+		al_steady_sleep_until_nsec(t + period);
+		assert(al_steady_time_nsec() - t >= period);
+
+		// Handler time should not accumulate as drift. A loaded machine may
+		// still wake up late, which CATCH_UP (the default) absorbs.
+		DeadlineTimer dl;
+		dl.periodNsec(period).start();
+		al_nsec d0 = dl.deadline();
+		for(int i=0; i<N; ++i){
+			al_sleep_nsec(period/2);
+			dl.wait();
+			assert(al_steady_time_nsec() >= d0 + i*period);
+		}
+		assert(dl.deadline() == d0 + N*period);
+		assert(dl.overruns() <= (unsigned)N);
+		assert(dl.ticks() == (unsigned)N);
+		assert(dl.jitterMax() >= dl.jitterMean());
+
+		// Overrun policies
+		unsigned long long overruns = dl.overruns();
+		dl.overrun(DeadlineTimer::SKIP).start();
+		d0 = dl.deadline();
+		al_sleep_nsec(period*2 + period/2);
+		int missed = dl.wait();
+		assert(2 <= missed);						// at least, if woken late
+		assert(dl.overruns() >= overruns + 1);
+		assert(dl.deadline() >= d0 + 3*period);
+		assert(dl.deadline() == d0 + (missed+1)*period);
+
+		dl.overrun(DeadlineTimer::CATCH_UP).catchUpRate(1).start();
+		d0 = dl.deadline();
+		al_sleep_nsec(period*2 + period/2);
+		overruns = dl.overruns();
+		assert(0 == dl.wait());						// CATCH_UP never skips
+		assert(0 == dl.wait());
+		assert(dl.overruns() >= overruns + 1);		// events ran late...
+		assert(dl.deadline() == d0 + 2*period);	// ...and kept the schedule
+	}
+
 	return 0;
 }
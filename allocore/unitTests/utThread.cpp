@@ -12,6 +12,31 @@ struct MyThreadFunc : public ThreadFunction{
 	int& x;
 };
 
+struct SquareFunc{
+	int * data;
+	void operator()(int i){ data[i] = i*i; }
+};
+
+struct NegateFunc{
+	int * data;
+	NegateFunc(int * d): data(d){}
+	void operator()(int i) const { data[i] = -i; }
+};
+
+struct OrderTask : public Task{
+	OrderTask(Atomic<int>& c): counter(c), order(-1){}
+	void operator()(){ order = counter.fetchAdd(1); }
+	Atomic<int>& counter;
+	int order;
+};
+
+void * traceThreadFunc(void * user){
+	{ TraceZone z("rt", true); }	// dropped if no buffer yet
+	{ TraceZone z("nonrt"); }		// allocates buffer if none
+	{ TraceZone z("rt", true); }
+	return NULL;
+}
+
 int utThread() {
 
 	//UT_PRINTF("system: thread\n");
@@ -54,5 +79,117 @@ int utThread() {
 		assert(1 == x);
 	}
 
+	// Scheduling settings; these should never prevent a thread from running
+	{
+		int x=0;
+		MyThreadFunc f(x);
+		Thread t;
+		t.priority(10, Thread::ROUND_ROBIN).affinity(0).lockStack(1<<16);
+		t.start(f);
+		t.join();
+		assert(1 == x);
+	}
+
+	// Task pool
+	{
+		TaskPool pool(3);
+		assert(pool.size() == 3);
+
+		// Parallel for
+		const int N = 1000;
+		int data[N];
+		SquareFunc f = { data };
+		for(int g=1; g<=N; g*=7){
+			for(int i=0; i<N; ++i) data[i] = -1;
+			pool.parallelFor(0, N, f, g);
+			for(int i=0; i<N; ++i) assert(data[i] == i*i);
+		}
+		pool.parallelFor(0, N, NegateFunc(data), 10);	// temporary
+		for(int i=0; i<N; ++i) assert(data[i] == -i);
+
+		// Task graph: a -> (b, c) -> d
+		Atomic<int> counter(0);
+		OrderTask a(counter), b(counter), c(counter), d(counter);
+		a.precede(b).precede(c);
+		b.precede(d);
+		c.precede(d);
+		assert(d.numPredecessors() == 2);
+		for(int k=0; k<3; ++k){ // graphs are reusable
+			counter.store(0);
+			TaskGroup group;
+			assert(pool.submit(a, &group));
+			pool.wait(group);
+			assert(group.done());
+			assert(a.order == 0);
+			assert(b.order > 0 && b.order < 3);
+			assert(c.order > 0 && c.order < 3);
+			assert(d.order == 3);
+		}
+	}
+
+	// Shared queue, filled from outside the pool
+	{
+		assert(TaskPool().size() >= 1);
+
+		TaskPool pool(0, -1, 4);
+		Atomic<int> counter(0);
+		OrderTask t0(counter), t1(counter), t2(counter), t3(counter), t4(counter);
+		OrderTask * t[] = {&t0, &t1, &t2, &t3, &t4};
+		for(int lap=0; lap<3; ++lap){
+			TaskGroup group;
+			for(int i=0; i<4; ++i) assert(pool.submit(*t[i], &group));
+			assert(!pool.submit(*t[4], &group));		// full
+			pool.wait(group);
+			assert(!pool.runPending());
+		}
+		assert(counter.load() == 12);
+		for(int i=0; i<4; ++i) assert(t[i]->order == 8+i);	// in order
+	}
+
+	// Tracing
+	{
+		Trace::start(16, 1);
+		Trace::threadName("main");
+		for(int i=0; i<10; ++i){ TraceZone z("zone"); }
+		assert(Trace::numEvents() == 10);
+
+		Thread t(traceThreadFunc, NULL);
+		t.join();
+		assert(Trace::numDropped() == 1);
+		assert(Trace::numEvents() == 12);
+
+		const char * path = "utThreadTrace.json";
+		assert(Trace::writeChrome(path));
+		FILE * fp = fopen(path, "r");
+		assert(fp);
+		int numZones = 0, numNames = 0;
+		char line[256];
+		while(fgets(line, sizeof(line), fp)){
+			if(strstr(line, "\"ph\": \"X\"")) ++numZones;
+			if(strstr(line, "\"name\": \"main\"")) ++numNames;
+		}
+		fclose(fp);
+		remove(path);
+		assert(numZones == 12);
+		assert(numNames == 1);
+
+		for(int i=0; i<10; ++i){ TraceZone z("zone"); }
+		assert(Trace::numEvents() == 18); // only most recent are kept
+
+		// Slot and buffer of exited thread are reused, so nothing dropped
+		Thread t2(traceThreadFunc, NULL);
+		t2.join();
+		assert(Trace::numDropped() == 1);
+		assert(Trace::numEvents() == 21);
+
+		Trace::stop();
+		{ TraceZone z("zone"); }
+		assert(Trace::numEvents() == 21);
+
+		Trace::clear();
+		assert(Trace::numEvents() == 0);
+		assert(Trace::numDropped() == 0);
+	}
+
 	return 0;
 }
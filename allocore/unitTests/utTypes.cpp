@@ -286,6 +286,29 @@ int utTypes(){
 		assert(a.read(3) == 2);
 	}
 
+	// TripleBuffer
+	{
+		TripleBuffer<Pose> b(Pose(Vec3d(1,2,3)));
+		assert(!b.fresh());
+		assert(!b.update());
+		assert(b.read().pos() == Vec3d(1,2,3));
+
+		b.write().pos(4,5,6);
+		b.publish();
+		assert(b.fresh());
+		assert(b.read().pos() == Vec3d(1,2,3));
+		assert(b.update());
+		assert(!b.fresh());
+		assert(b.read().pos() == Vec3d(4,5,6));
+
+		// Only the latest value is seen
+		for(int i=0; i<5; ++i) b.publish(Pose(Vec3d(i,0,0)));
+		assert(b.update());
+		assert(b.read().pos() == Vec3d(4,0,0));
+		assert(!b.update());
+		assert(b.read().pos() == Vec3d(4,0,0));
+	}
+
 	return 0;
 }
 
@@ -76,6 +76,33 @@ int utTypesConversion(){
 	assert(unitToUInt8(1./4) ==  64);
 	assert(unitToUInt8(1./2) == 128);
 
+	// Half precision floats
+	assert(floatToHalf(0.f) == 0x0000);
+	assert(floatToHalf(-0.f) == 0x8000);
+	assert(floatToHalf(1.f) == 0x3c00);
+	assert(floatToHalf(-2.f) == 0xc000);
+	assert(floatToHalf(0.1f) == 0x2e66);
+	assert(floatToHalf(65504.f) == 0x7bff);			// largest half
+	assert(floatToHalf(65519.f) == 0x7bff);
+	assert(floatToHalf(65520.f) == 0x7c00);			// rounds to infinity
+	assert(floatToHalf(1e10f) == 0x7c00);
+	assert(floatToHalf(-1e10f) == 0xfc00);
+	assert(floatToHalf(punUF(uint32_t(0x7fc00000))) == 0x7e00);	// NaN
+	assert(floatToHalf(1.f/16384) == 0x0400);		// smallest normal
+	assert(floatToHalf(1.f/16777216) == 0x0001);	// smallest subnormal
+	assert(floatToHalf(1.f/33554432) == 0x0000);	// halfway to zero rounds to even
+	assert(floatToHalf(1.f + 1.f/2048) == 0x3c00);	// halfway rounds to even
+	assert(floatToHalf(1.f + 3.f/2048) == 0x3c02);
+	for(int i=0; i<65536; ++i){
+		uint16_t h = i;
+		if((h & 0x7c00) == 0x7c00 && (h & 0x3ff)) continue; // skip NaNs
+		assert(floatToHalf(halfToFloat(h)) == h);
+	}
+	assert(halfToFloat(0x3555) == 0.333251953125f);
+	assert(halfToFloat(0x0001) == 1.f/16777216);
+	assert(halfToFloat(0xfc00) == -halfToFloat(0x7c00));
+	assert(halfToFloat(0x7e00) != halfToFloat(0x7e00));	// NaN
+
 	return 0;
 }
 
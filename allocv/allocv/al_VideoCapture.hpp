@@ -44,6 +44,7 @@
 
 #include "allocore/system/al_PeriodicThread.hpp"
 #include "allocv/al_OpenCV.hpp"
+#include "allocv/al_VideoFrameRing.hpp"
 
 namespace al{
 
@@ -129,6 +130,18 @@ public:
 	/// disconnected, or there are no more frames in video file).
 	bool retrieveFlip(Array& dst, int chan=0);
 
+	/// Decodes the grabbed video frame into the next frame of a ring
+
+	/// This decodes directly into the ring's preallocated memory, so
+	/// consumers can use the frame without any further copies.
+	///
+	/// @param[in] ring			the ring to write the frame into
+	/// @param[in] chan			the video channel to retrieve
+	///
+	/// \returns false if no frame has been grabbed or the ring had no frame
+	/// to write into (see VideoFrameRing::DropPolicy).
+	bool retrieve(VideoFrameRing& ring, int chan=0);
+
 	/// Grabs, decodes and returns the next video frame
 
 	/// @param[in] dst			the array to copy the frame into
@@ -249,6 +262,7 @@ public:
 		void operator()();
 		al::VideoCapture * videoCapture;
 		VideoCaptureHandler * handler;
+		VideoFrameRing * frameRing;
 		int streamIdx;
 	};
 
@@ -271,7 +285,10 @@ public:
 
 
 	/// Called whenever new video frame(s) are ready
-	virtual void onVideo(VideoCapture& vid, int streamIdx) = 0;
+
+	/// If a frame ring is attached to the stream, the frame has already been
+	/// written to it.
+	virtual void onVideo(VideoCapture& vid, int streamIdx){}
 
 	/// Called just before a grab is attempted
 
@@ -292,6 +309,15 @@ public:
 	/// @param[in] streamIdx	stream index (must be <= numStreams())
 	VideoCaptureHandler& attach(VideoCapture& vid, int streamIdx=0);
 
+	/// Attach a frame ring that grabbed frames are decoded into
+
+	/// Consumers, e.g. a render thread, then acquire frames from the ring
+	/// instead of copying them in onVideo.
+	///
+	/// @param[in] ring			frame ring or 0 to detach
+	/// @param[in] streamIdx	stream index (must be <= numStreams())
+	VideoCaptureHandler& attach(VideoFrameRing * ring, int streamIdx=0);
+
 	/// Start the video thread(s)
 	void startVideo();
 
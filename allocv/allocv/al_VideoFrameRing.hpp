@@ -0,0 +1,204 @@
+#ifndef INCLUDE_AL_VIDEO_FRAME_RING_HPP
+#define INCLUDE_AL_VIDEO_FRAME_RING_HPP
+
+/*	AlloSystem --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+
+	File description:
+	Pool of preallocated video frames passed between threads without copying
+*/
+
+#include <vector>
+#include "allocore/system/al_Atomic.hpp"
+#include "allocore/system/al_Time.hpp"
+#include "allocv/al_OpenCV.hpp"
+
+namespace al{
+
+class VideoFrameRing;
+
+
+/// Video frame held by a VideoFrameRing
+
+/// The frame's memory is owned by the ring. Its cv::Mat and Array share this
+/// memory, so no copies are made when handing frames to consumers. Rows are
+/// in OpenCV order, i.e. the top row comes first.
+class VideoFrame{
+public:
+
+	/// Get frame as OpenCV matrix sharing the frame's memory
+	const cv::Mat& mat() const { return mMat; }
+
+	/// Get frame as Array sharing the frame's memory
+	const Array& array() const { return mArray; }
+
+	/// Get sequence number of frame, starting from 1
+	uint64_t number() const { return mNumber.load(); }
+
+	/// Get time at which the frame was written, from al_steady_time_nsec
+	al_nsec captureTime() const { return mCaptureTime; }
+
+	/// Get writable matrix; only valid between beginWrite and endWrite
+	cv::Mat& writeMat(){ return mMat; }
+
+private:
+	friend class VideoFrameRing;
+
+	enum{ FREE=0, WRITING, READY, READING };
+
+	cv::Mat mMat;
+	Array mArray;
+	std::vector<char> mStorage;
+	char * mData;		// aligned start of storage
+	size_t mCapacity;	// bytes available from mData
+	Atomic<int> mState;
+	Atomic<int64_t> mNumber;
+	al_nsec mCaptureTime;
+
+	VideoFrame();
+	~VideoFrame();
+	void allocate(int width, int height, int cvType);
+	void adopt();
+};
+
+
+/// Lock-free ring of preallocated video frames
+
+/// One producer thread, typically a capture thread, writes frames into the
+/// ring and consumer threads acquire read-only views of written frames,
+/// releasing them when done. Acquired frames are never overwritten, so
+/// consumers can use them without copying, e.g. to upload a texture. To
+/// avoid the producer running out of frames, consumers should hold on to
+/// at most numFrames - 1 frames at once.
+class VideoFrameRing{
+public:
+
+	/// What to do with a new frame when no frame is free
+	enum DropPolicy{
+		DROP_OLDEST,	/**< Overwrite the oldest unread frame (lowest latency) */
+		DROP_NEWEST		/**< Discard the new frame (no gaps in sequence) */
+	};
+
+	/// Frame counts and latencies, in seconds, from writing to acquiring
+	struct Stats{
+		uint64_t written;		///< Frames written
+		uint64_t read;			///< Frames acquired
+		uint64_t overwritten;	///< Unread frames overwritten by DROP_OLDEST
+		uint64_t discarded;		///< New frames discarded for lack of a free frame
+		uint64_t skipped;		///< Unread frames skipped by acquireLatest
+		double latencyMin, latencyMean, latencyMax;
+	};
+
+
+	/// @param[in] numFrames	number of frames in pool (at least 2)
+	/// @param[in] policy		policy when no frame is free
+	VideoFrameRing(int numFrames=3, DropPolicy policy=DROP_OLDEST);
+
+	~VideoFrameRing();
+
+
+	/// Preallocate all frames
+
+	/// Frames are otherwise allocated, once, when first written. This must
+	/// not be called while frames are in use.
+	void allocate(int width, int height, int cvType=CV_8UC3);
+
+	/// Get number of frames in pool
+	int size() const { return mFrames.size(); }
+
+	/// Get drop policy
+	DropPolicy policy() const { return mPolicy; }
+
+	/// Set drop policy
+	VideoFrameRing& policy(DropPolicy v){ mPolicy=v; return *this; }
+
+
+	/// Begin writing a frame (producer)
+
+	/// \returns a frame to write into or 0 if the new frame must be discarded.
+	/// The frame's writeMat() keeps its size and type from previous writes;
+	/// if a write changes them, endWrite moves the data into the frame's own
+	/// storage.
+	VideoFrame * beginWrite();
+
+	/// Publish a frame returned by beginWrite (producer)
+	void endWrite(VideoFrame * frame);
+
+	/// Abandon a frame returned by beginWrite (producer)
+	void cancelWrite(VideoFrame * frame);
+
+	/// Copy an image into the next frame (producer)
+
+	/// \returns false if the image was discarded
+	///
+	bool write(const cv::Mat& image);
+
+
+	/// Acquire the oldest unread frame (consumer)
+
+	/// \returns a frame or 0 if there is no unread frame
+	///
+	const VideoFrame * acquire();
+
+	/// Acquire the newest unread frame, skipping older ones (consumer)
+
+	/// \returns a frame or 0 if there is no unread frame
+	///
+	const VideoFrame * acquireLatest();
+
+	/// Release an acquired frame so it can be written again (consumer)
+	void release(const VideoFrame * frame);
+
+
+	/// Get statistics
+	Stats stats() const;
+
+	/// Reset statistics
+	void resetStats();
+
+private:
+	std::vector<VideoFrame *> mFrames;
+	DropPolicy mPolicy;
+	uint64_t mNumber;			// number of last written frame
+
+	Atomic<int64_t> mWritten, mRead, mOverwritten, mDiscarded, mSkipped;
+	Atomic<al_nsec> mLatencySum, mLatencyMin, mLatencyMax;
+
+	VideoFrame * findReady(bool newest, int64_t& number);
+	void onAcquire(VideoFrame * f);
+};
+
+} // al::
+
+#endif
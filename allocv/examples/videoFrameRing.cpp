@@ -0,0 +1,78 @@
+/*
+AlloCV Example: Video Frame Ring
+
+Description:
+This plays a video file through a VideoFrameRing without a window. A capture
+thread decodes frames straight into the ring while the main thread, standing
+in for a render loop, acquires and releases them at a slower rate. Both drop
+policies are run and the frame accounting and latency statistics of each are
+printed.
+
+Frames acquired from a ring share memory with the ring; to draw one, submit
+frame->array() to a texture and flip the texture coordinates vertically
+instead of copying the rows flipped.
+*/
+
+#include <stdio.h>
+#include "allocv/al_VideoCapture.hpp"
+using namespace al;
+
+bool run(VideoFrameRing::DropPolicy policy, const char * name){
+
+	al::VideoCapture vid;
+	if(!vid.open(RUN_MAIN_SOURCE_PATH "beetle.mp4")){
+		printf("could not open video\n");
+		return false;
+	}
+	vid.rate(4); // play faster than the consumer below
+	vid.print();
+
+	VideoFrameRing ring(4, policy);
+	ring.allocate(vid.width(), vid.height(), CV_8UC3);
+
+	// No onVideo needed; the handler decodes straight into the ring
+	VideoCaptureHandler capture;
+	capture.attach(vid);
+	capture.attach(&ring);
+	capture.startVideo();
+
+	bool ok = true;
+	uint64_t last = 0;
+	for(int i=0; i<100; ++i){
+		al_sleep(1./30);
+		const VideoFrame * frame = (policy == VideoFrameRing::DROP_OLDEST)
+			? ring.acquireLatest() : ring.acquire();
+		if(!frame) continue;
+
+		// frames arrive in order and share the ring's memory
+		if(frame->number() <= last) ok = false;
+		if(frame->array().data.ptr != (char *)frame->mat().data) ok = false;
+		last = frame->number();
+
+		ring.release(frame);
+	}
+
+	capture.stopVideo();
+
+	// every written frame is read, dropped or still unread in the ring
+	VideoFrameRing::Stats s = ring.stats();
+	uint64_t accounted = s.read + s.overwritten + s.skipped;
+	if(accounted > s.written || s.written - accounted > uint64_t(ring.size())) ok = false;
+	if(policy == VideoFrameRing::DROP_NEWEST && s.overwritten) ok = false;
+
+	printf("%s: written %llu, read %llu, overwritten %llu, discarded %llu, skipped %llu\n",
+		name,
+		(unsigned long long)s.written, (unsigned long long)s.read,
+		(unsigned long long)s.overwritten, (unsigned long long)s.discarded,
+		(unsigned long long)s.skipped);
+	printf("%s: latency min %.2f ms, mean %.2f ms, max %.2f ms\n",
+		name, s.latencyMin*1e3, s.latencyMean*1e3, s.latencyMax*1e3);
+	return ok;
+}
+
+int main(){
+	bool ok = run(VideoFrameRing::DROP_OLDEST, "drop oldest");
+	ok &= run(VideoFrameRing::DROP_NEWEST, "drop newest");
+	printf(ok ? "OK\n" : "FAILED\n");
+	return ok ? 0 : 1;
+}
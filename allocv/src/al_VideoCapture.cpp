@@ -114,6 +114,17 @@ bool VideoCapture::retrieveFlip(Array& dst, int chan){
 	return retrieve(dst, chan, -1);
 }
 
+bool VideoCapture::retrieve(VideoFrameRing& ring, int chan){
+	VideoFrame * frame = ring.beginWrite();
+	if(!frame) return false;
+	if(!cvVideoCapture.retrieve(frame->writeMat(), chan)){
+		ring.cancelWrite(frame);
+		return false;
+	}
+	ring.endWrite(frame);
+	return true;
+}
+
 bool VideoCapture::read(Array& dst, int copyPolicy){
 	bool res = cvVideoCapture.read(cvFrame);
 	fromCV(dst, cvFrame, copyPolicy);
@@ -254,7 +265,7 @@ void VideoCapture::print(FILE * fp){
 
 
 VideoCaptureHandler::VideoThreadFunction::VideoThreadFunction()
-: 	videoCapture(NULL), handler(NULL), streamIdx(-1)
+: 	videoCapture(NULL), handler(NULL), frameRing(NULL), streamIdx(-1)
 {}
 
 VideoCaptureHandler::VideoThreadFunction::~VideoThreadFunction()
@@ -267,6 +278,7 @@ void VideoCaptureHandler::VideoThreadFunction::operator()(){
 	if(NULL != videoCapture && videoCapture->mValid && videoCapture->cvVideoCapture.isOpened()){
 		handler->onPregrab(*videoCapture, streamIdx);
 		if(videoCapture->grab()){
+			if(frameRing) videoCapture->retrieve(*frameRing);
 			handler->onVideo(*videoCapture, streamIdx);
 			double fps = videoCapture->fps() * videoCapture->rate();
 			handler->mWorkThreads[streamIdx].thread.period(1./fps);
@@ -316,6 +328,13 @@ VideoCaptureHandler& VideoCaptureHandler::attach(VideoCapture& vid, int streamId
 	return *this;
 }
 
+VideoCaptureHandler& VideoCaptureHandler::attach(VideoFrameRing * ring, int streamIdx){
+	if(streamIdx>=0 && streamIdx<numVideoStreams()){
+		mWorkThreads[streamIdx].func.frameRing = ring;
+	}
+	return *this;
+}
+
 void VideoCaptureHandler::startVideo(){
 	for(
 		WorkThreads::iterator it = mWorkThreads.begin();
@@ -0,0 +1,231 @@
+#include "allocv/al_VideoFrameRing.hpp"
+
+namespace al{
+
+// Byte alignment of frame memory; a cache line, which also suits SIMD loads
+static const size_t kFrameAlign = 64;
+
+
+VideoFrame::VideoFrame()
+:	mData(NULL), mCapacity(0), mState(FREE), mNumber(0), mCaptureTime(0)
+{}
+
+VideoFrame::~VideoFrame(){
+	// Memory is owned by mStorage, not the Array
+	mArray.data.ptr = NULL;
+}
+
+void VideoFrame::allocate(int width, int height, int cvType){
+	// Rows are tightly packed so that the cv::Mat is continuous
+	AlloArrayHeader hdr;
+	fromCV(hdr, cvType);
+	allo_array_setdim2d(&hdr, width, height);
+	allo_array_setstride(&hdr, 1);
+	size_t bytes = size_t(hdr.stride[1]) * height;
+
+	if(bytes > mCapacity){
+		mStorage.assign(bytes + kFrameAlign, 0);
+		size_t addr = size_t(&mStorage[0]);
+		mData = &mStorage[0] + (kFrameAlign - addr % kFrameAlign) % kFrameAlign;
+		mCapacity = bytes;
+	}
+
+	mArray.configure(hdr);
+	mArray.data.ptr = mData;
+	mMat = cv::Mat(height, width, cvType, mData, hdr.stride[1]);
+}
+
+void VideoFrame::adopt(){
+	// A write that changed the size or type made OpenCV allocate new memory
+	// for the matrix; move the frame into our storage so the Array agrees.
+	if(mMat.data != (uchar *)mData || mMat.empty()){
+		cv::Mat written = mMat;
+		allocate(written.cols, written.rows, written.type());
+		written.copyTo(mMat);
+	}
+}
+
+
+
+VideoFrameRing::VideoFrameRing(int numFrames, DropPolicy policy)
+:	mPolicy(policy), mNumber(0)
+{
+	if(numFrames < 2) numFrames = 2;
+	for(int i=0; i<numFrames; ++i) mFrames.push_back(new VideoFrame);
+	resetStats();
+}
+
+VideoFrameRing::~VideoFrameRing(){
+	for(unsigned i=0; i<mFrames.size(); ++i) delete mFrames[i];
+}
+
+void VideoFrameRing::allocate(int width, int height, int cvType){
+	for(unsigned i=0; i<mFrames.size(); ++i){
+		mFrames[i]->allocate(width, height, cvType);
+	}
+}
+
+VideoFrame * VideoFrameRing::beginWrite(){
+	for(;;){
+		VideoFrame * oldest = NULL;
+		for(unsigned i=0; i<mFrames.size(); ++i){
+			VideoFrame * f = mFrames[i];
+			int state = f->mState.load();
+			if(VideoFrame::FREE == state){
+				// only the producer takes free frames
+				f->mState.store(VideoFrame::WRITING);
+				return f;
+			}
+			if(VideoFrame::READY == state
+				&& (!oldest || f->mNumber.load() < oldest->mNumber.load())
+			){
+				oldest = f;
+			}
+		}
+
+		if(DROP_OLDEST == mPolicy && oldest){
+			int expected = VideoFrame::READY;
+			if(oldest->mState.compareExchange(expected, VideoFrame::WRITING)){
+				mOverwritten.fetchAdd(1);
+				return oldest;
+			}
+			// A consumer got to it first or skipped it; try again
+			continue;
+		}
+
+		mDiscarded.fetchAdd(1);
+		return NULL;
+	}
+}
+
+void VideoFrameRing::endWrite(VideoFrame * f){
+	f->adopt();
+	f->mNumber.store(++mNumber);
+	f->mCaptureTime = al_steady_time_nsec();
+	mWritten.fetchAdd(1);
+	f->mState.store(VideoFrame::READY);
+}
+
+void VideoFrameRing::cancelWrite(VideoFrame * f){
+	f->mState.store(VideoFrame::FREE);
+}
+
+bool VideoFrameRing::write(const cv::Mat& image){
+	VideoFrame * f = beginWrite();
+	if(!f) return false;
+	image.copyTo(f->mMat);
+	endWrite(f);
+	return true;
+}
+
+VideoFrame * VideoFrameRing::findReady(bool newest, int64_t& resNum){
+	VideoFrame * res = NULL;
+	resNum = 0;
+	for(unsigned i=0; i<mFrames.size(); ++i){
+		VideoFrame * f = mFrames[i];
+		if(VideoFrame::READY == f->mState.load()){
+			int64_t num = f->mNumber.load();
+			if(!res || (newest ? num > resNum : num < resNum)){
+				res = f;
+				resNum = num;
+			}
+		}
+	}
+	return res;
+}
+
+const VideoFrame * VideoFrameRing::acquire(){
+	for(;;){
+		int64_t num;
+		VideoFrame * f = findReady(false, num);
+		if(!f) return NULL;
+		int expected = VideoFrame::READY;
+		if(f->mState.compareExchange(expected, VideoFrame::READING)){
+			// An older frame may have been published to a slot we had already
+			// scanned, or the producer may have overwritten this frame after
+			// we found it; in either case, give it back and look again.
+			int64_t older;
+			VideoFrame * o = findReady(false, older);
+			if(f->mNumber.load() != num || (o && older < num)){
+				f->mState.store(VideoFrame::READY);
+				continue;
+			}
+			onAcquire(f);
+			return f;
+		}
+	}
+}
+
+const VideoFrame * VideoFrameRing::acquireLatest(){
+	for(;;){
+		int64_t num;
+		VideoFrame * f = findReady(true, num);
+		if(!f) return NULL;
+		int expected = VideoFrame::READY;
+		if(f->mState.compareExchange(expected, VideoFrame::READING)){
+			onAcquire(f);
+
+			// Give back the older unread frames so the producer has them.
+			// Claim each frame before checking its number, as the producer
+			// may otherwise rewrite it with a newer frame in between.
+			num = f->mNumber.load();
+			for(unsigned i=0; i<mFrames.size(); ++i){
+				VideoFrame * g = mFrames[i];
+				expected = VideoFrame::READY;
+				if(g != f && g->mState.compareExchange(expected, VideoFrame::READING)){
+					if(g->mNumber.load() < num){
+						g->mState.store(VideoFrame::FREE);
+						mSkipped.fetchAdd(1);
+					}
+					else{
+						g->mState.store(VideoFrame::READY);
+					}
+				}
+			}
+			return f;
+		}
+	}
+}
+
+void VideoFrameRing::release(const VideoFrame * frame){
+	VideoFrame * f = const_cast<VideoFrame *>(frame);
+	f->mState.store(VideoFrame::FREE);
+}
+
+void VideoFrameRing::onAcquire(VideoFrame * f){
+	al_nsec lat = al_steady_time_nsec() - f->mCaptureTime;
+	mRead.fetchAdd(1);
+	mLatencySum.fetchAdd(lat);
+
+	al_nsec cur = mLatencyMin.load();
+	while((cur < 0 || lat < cur) && !mLatencyMin.compareExchange(cur, lat)){}
+	cur = mLatencyMax.load();
+	while(lat > cur && !mLatencyMax.compareExchange(cur, lat)){}
+}
+
+VideoFrameRing::Stats VideoFrameRing::stats() const {
+	Stats s;
+	s.written = mWritten.load();
+	s.read = mRead.load();
+	s.overwritten = mOverwritten.load();
+	s.discarded = mDiscarded.load();
+	s.skipped = mSkipped.load();
+	al_nsec mn = mLatencyMin.load();
+	s.latencyMin = mn < 0 ? 0 : mn * al_time_ns2s;
+	s.latencyMax = mLatencyMax.load() * al_time_ns2s;
+	s.latencyMean = s.read ? mLatencySum.load() * al_time_ns2s / s.read : 0;
+	return s;
+}
+
+void VideoFrameRing::resetStats(){
+	mWritten.store(0);
+	mRead.store(0);
+	mOverwritten.store(0);
+	mDiscarded.store(0);
+	mSkipped.store(0);
+	mLatencySum.store(0);
+	mLatencyMin.store(-1);	// none yet
+	mLatencyMax.store(0);
+}
+
+} // al::
@@ -0,0 +1,141 @@
+#ifndef AL_DEPTHCLOUD_HPP
+#define AL_DEPTHCLOUD_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+
+	File description:
+	Batch conversion of depth frames into world-space point clouds
+
+	The eye-space position of a depth pixel is its depth in meters times a
+	per-pixel ray, so with an affine eye-to-world transform the world position
+	is simply the translation plus meters times the rotated ray. The rotated
+	rays are tabulated per (decimated) pixel whenever the transform changes
+	and raw depth values are converted to meters by table lookup, leaving one
+	multiply-add per coordinate per pixel. The inner loops work on separate
+	x, y, z arrays so that they can be vectorized by the compiler.
+
+	This does not depend on libfreenect, so recorded frames can be converted
+	without a device attached.
+*/
+
+#include <string>
+#include <vector>
+#include "allocore/math/al_Matrix4.hpp"
+#include "allocore/math/al_Vec.hpp"
+#include "allocore/system/al_Config.h"
+
+namespace al {
+
+/// Converts whole depth frames into packed world-space points
+class DepthCloud {
+public:
+
+	/// @param[in] width	width of depth frames, in pixels
+	/// @param[in] height	height of depth frames, in pixels
+	DepthCloud(int width=640, int height=480);
+
+
+	/// Set eye-to-world transform; only its affine part is used
+	DepthCloud& transform(const Matrix4f& m);
+
+	/// Only convert every n-th pixel along each axis
+	DepthCloud& decimation(int n);
+
+	/// Set range of raw depth values considered valid, [lo, hi)
+	DepthCloud& range(uint16_t lo, uint16_t hi);
+
+	/// Set per-pixel validity mask
+
+	/// The mask holds one byte per (full resolution) pixel; pixels whose
+	/// byte is zero are skipped. The mask is not copied and must stay valid
+	/// while converting. Pass 0 to disable masking.
+	DepthCloud& mask(const uint8_t * m){ mMask=m; return *this; }
+
+	/// Set camera intrinsics, in pixels
+	DepthCloud& intrinsics(double fx, double fy, double cx, double cy);
+
+
+	int width() const { return mWidth; }
+	int height() const { return mHeight; }
+	int decimation() const { return mDecimation; }
+
+	/// Maximum number of points a single conversion can produce
+	int maxPoints() const { return mCols * mRows; }
+
+	/// Convert a depth frame into packed world-space points
+
+	/// @param[in]  depth	raw depth values, width*height row-major
+	/// @param[out] points	output points; must hold at least maxPoints()
+	/// @param[out] pixels	if not 0, receives the pixel index (y*width + x)
+	///						of each point; must hold at least maxPoints()
+	/// \returns number of points written
+	int convert(const uint16_t * depth, Vec3f * points, int * pixels=0);
+
+
+	/// Convert raw Kinect disparity value into meters
+	static double rawToMeters(uint16_t raw);
+
+	/// Convert pixel and raw depth value into eye-space position, in meters
+
+	/// This uses the default intrinsics and serves as the per-pixel reference
+	/// for the batch conversion.
+	static Vec3f depthToEye(int x, int y, uint16_t raw);
+
+	/// Read raw depth frame of width*height values from file
+	static bool readFrame(const std::string& path, uint16_t * depth, int width=640, int height=480);
+
+	/// Write raw depth frame of width*height values to file
+	static bool writeFrame(const std::string& path, const uint16_t * depth, int width=640, int height=480);
+
+private:
+	int mWidth, mHeight;
+	int mDecimation, mCols, mRows;
+	uint16_t mLo, mHi;
+	double mFx, mFy, mCx, mCy;
+	Matrix4f mTransform;
+	const uint8_t * mMask;
+	bool mRaysDirty;
+
+	std::vector<float> mMeters;			// raw depth to meters; 0 if invalid
+	std::vector<float> mRayX, mRayY, mRayZ;	// world-space ray per decimated pixel
+	std::vector<float> mRowM, mRowX, mRowY, mRowZ; // scratch for a single row
+
+	void computeMeters();
+	void computeRays();
+};
+
+} // al::
+
+#endif
@@ -44,6 +44,7 @@
 
 #include "allocore/al_Allocore.hpp"
 #include "alloutil/al_FPS.hpp"
+#include "allonect/al_DepthCloud.hpp"
 #include "libfreenect.h"
 
 #include <map>
@@ -69,6 +70,7 @@ public:
 		virtual void onDepth(Texture& raw, uint32_t timestamp) {}
 
 
+		// per-pixel conversion; use DepthCloud to convert whole frames
 		static Vec3f depthToEye(int x, int y, uint16_t d);
 		static double rawDepthToMeters(uint16_t raw);
 
@@ -130,27 +132,11 @@ inline Freenect::Callback::~Callback() {
 }
 
 inline double Freenect::Callback::rawDepthToMeters(uint16_t raw) {
-	static const double k1 = 1.1863;
-	static const double k2 = 1./2842.5;
-	static const double k3 = 0.1236;
-	return k3 * tan(raw*k2 + k1);
+	return DepthCloud::rawToMeters(raw);
 }
 
-// @see http://nicolas.burrus.name/index.php/Research/KinectCalibration
 inline Vec3f Freenect::Callback::depthToEye(int x, int y, uint16_t d) {
-	// size of a pixel in meters, at zero/near plane:
-	static const double metersPerPixelX = 1./594.21434211923247;
-	static const double metersPerPixelY = 1./591.04053696870778;
-	// location of X,Y corner at zero plane, in pixels:
-	static const double edgeX = 339.30780975300314;	// x edge pixel
-	static const double edgeY = 242.73913761751615;	// y edge pixel
-	const double meters = rawDepthToMeters(d);
-	const double disparityX = (x - edgeX);	// in pixels
-	const double disparityY = (y - edgeY);	// in pixels
-	return Vec3f(meters * disparityX * metersPerPixelX,
-				 meters * disparityY * metersPerPixelY,
-				 meters
-				);
+	return DepthCloud::depthToEye(x, y, d);
 }
 
 inline void Freenect::Callback::reconfigure() {
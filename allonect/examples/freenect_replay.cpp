@@ -0,0 +1,126 @@
+/*
+
+Converts recorded depth frames into point clouds without a device attached,
+checking the batch conversion of DepthCloud against the per-pixel reference
+and timing both.
+
+Usage:
+freenect_replay [depth.raw ...]
+
+Frames are raw 640x480 arrays of 16-bit depth values as written by
+DepthCloud::writeFrame (press 'r' in freenect_send to record one). Without
+arguments a synthetic frame is used.
+
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+#include "allocore/system/al_Time.hpp"
+#include "allonect/al_DepthCloud.hpp"
+
+using namespace al;
+
+static const int W = 640;
+static const int H = 480;
+
+// A tilted wall with a few holes of invalid depth
+static void syntheticFrame(uint16_t * depth){
+	for (int y=0; y<H; y++) {
+		for (int x=0; x<W; x++) {
+			uint16_t raw = 600 + (x + y)/4;
+			if (((x/32) + (y/32)) % 7 == 0) raw = 2047;
+			depth[y*W + x] = raw;
+		}
+	}
+}
+
+// Per-pixel conversion as previously done in freenect_send
+static int reference(const uint16_t * depth, const Matrix4f& transform, int step, Vec3f * points){
+	int n = 0;
+	for (int y=0; y<H; y+=step) {
+		for (int x=0; x<W; x+=step) {
+			uint16_t raw = depth[y*W + x];
+			if (raw < 2047 && DepthCloud::rawToMeters(raw) > 0) {
+				Vec4f v = transform.transform(DepthCloud::depthToEye(x, y, raw));
+				points[n++].set(v.x, v.y, v.z);
+			}
+		}
+	}
+	return n;
+}
+
+static bool check(const uint16_t * depth, const char * name){
+	Matrix4f transform =
+		Matrix4f::translate(0.5, 0.2, 1.5) *
+		Matrix4f::rotate(0.3, 0, 1, 0) *
+		Matrix4f::scale(0.8);
+
+	std::vector<Vec3f> ref(W*H), out(W*H);
+	std::vector<uint8_t> mask(W*H);
+	for (int i=0; i<W*H; i++) mask[i] = (i % W) >= 64;
+
+	DepthCloud cloud;
+	cloud.transform(transform);
+	bool ok = true;
+
+	for (int step=1; step<=4; step*=2) {
+		cloud.decimation(step);
+		cloud.mask(0);
+
+		int nref = reference(depth, transform, step, &ref[0]);
+		int n = cloud.convert(depth, &out[0]);
+
+		float maxErr = 0;
+		if (n == nref) {
+			for (int i=0; i<n; i++) {
+				float e = (out[i] - ref[i]).mag();
+				if (e > maxErr) maxErr = e;
+			}
+		}
+		if (n != nref || maxErr > 1e-4) ok = false;
+
+		// timing:
+		const int runs = 30;
+		Timer t;
+		t.start();
+		for (int r=0; r<runs; r++) reference(depth, transform, step, &ref[0]);
+		t.stop();
+		double tref = t.elapsedSec() / runs;
+		t.start();
+		for (int r=0; r<runs; r++) cloud.convert(depth, &out[0]);
+		t.stop();
+		double tbatch = t.elapsedSec() / runs;
+
+		// masking must only ever remove points:
+		cloud.mask(&mask[0]);
+		int nmasked = cloud.convert(depth, &out[0]);
+		if (nmasked > n) ok = false;
+
+		printf("%s: decimation %d: %d points (%d masked), max error %g m, "
+			"per-pixel %.3f ms, batch %.3f ms\n",
+			name, step, n, nmasked, maxErr, tref*1000, tbatch*1000);
+	}
+	return ok;
+}
+
+int main(int argc, char * argv[]){
+	std::vector<uint16_t> depth(W*H);
+	bool ok = true;
+
+	if (argc < 2) {
+		syntheticFrame(&depth[0]);
+		ok = check(&depth[0], "synthetic");
+	}
+	for (int i=1; i<argc; i++) {
+		if (!DepthCloud::readFrame(argv[i], &depth[0], W, H)) {
+			printf("could not read %s\n", argv[i]);
+			ok = false;
+			continue;
+		}
+		ok &= check(&depth[0], argv[i]);
+	}
+
+	printf(ok ? "OK\n" : "FAILED\n");
+	return ok ? 0 : 1;
+}
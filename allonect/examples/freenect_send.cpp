@@ -24,11 +24,19 @@ struct MyWindow : public Window, public Freenect::Callback, public ThreadFunctio
 	:	Freenect::Callback(0),
 		depthTex(640, 480),
 		world_dim(dim),
-		bHideOOB(0)
+		bHideOOB(0),
+		num_points(0),
+		cloudSend(4111, "localhost")
 	{
 		pointsMesh.vertices().size(640*480);
 		pointsMesh.colors().size(640*480);
 		pointsMesh.texCoord2s().size(640*480);
+		worldPoints.resize(cloud.maxPoints());
+		worldPixels.resize(cloud.maxPoints());
+
+		for (int i=0; i<2047; i++) {
+			depthColors[i] = Colori(HSV(i/2048., 1, 0.75));
+		}
 
 		frameMesh.reset();
 		frameMesh.primitive(gl.LINES);
@@ -52,11 +60,12 @@ struct MyWindow : public Window, public Freenect::Callback, public ThreadFunctio
 		}}
 		frameMesh.scale(world_dim);
 
-		if (netSend.open(4111, "localhost")) {
+		cloudSend.bounds(Vec3f(0), Vec3f(world_dim));
+		if (cloudSend.opened()) {
 			active = true;
 			sendThread.start(*this);
 		} else {
-			printf("error creating netsend\n");
+			printf("error creating cloud sender\n");
 			exit(0);
 		}
 
@@ -73,10 +82,25 @@ struct MyWindow : public Window, public Freenect::Callback, public ThreadFunctio
 	}
 	virtual void onDepth(Texture& tex, uint32_t timestamp) {
 
+		const uint16_t * depthPtr = (const uint16_t*)tex.data();
+
+		// drawing raw data, hue-coded through a lookup table:
 		Array& outArray = depthTex.array();
-		uint16_t * depthPtr = (uint16_t*)tex.data();
+		const int comps = outArray.components();
+		for (int y=0; y<480; y++) {
+			char * row = outArray.data.ptr + y*outArray.stride(1);
+			const uint16_t * src = depthPtr + y*640;
+			for (int x=0; x<640; x++) {
+				uint16_t raw = src[x];
+				if (raw < 2047) {
+					memcpy(row + x*outArray.stride(0), depthColors[raw].components, comps);
+				}
+			}
+		}
 
-		size_t i=0;
+		// whole frame into world space at once:
+		cloud.transform(transform);
+		int n = cloud.convert(depthPtr, &worldPoints[0], &worldPixels[0]);
 
 		Buffer<Mesh::Vertex>& vertices = pointsMesh.vertices();
 		Buffer<Color>& colors = pointsMesh.colors();
@@ -90,48 +114,26 @@ struct MyWindow : public Window, public Freenect::Callback, public ThreadFunctio
 		mmmy.clear();
 		mmmz.clear();
 
-//		mmmx(0);
-//		mmmy(0);
-//		mmmz(0);
-//		mmmx(world_dim);
-//		mmmy(world_dim);
-//		mmmz(world_dim);
-
-		for (size_t y=0; y<480; y++) {
-			for (size_t x=0; x<640; x++, i++) {
-				uint16_t raw = depthPtr[i];
-
-				// ignore out-of-range points:
-				if (raw < 2047) {
-					// drawing raw data:
-					HSV hsv(raw/2048., 1, 0.75);
-					Colori c(hsv);
-					outArray.write(c.components, x, y);
-
-					// this vector is in eye-space of kinect;
-					// it must be rotated into the kinect pose.
-					Vec3f veye = depthToEye(x, y, raw);
-
-					//Vec4f vworld = veye*scale + translate;
-					Vec4f vworld = transform.transform(veye);
-
-					bool OOB = (vworld.x < 0 || vworld.x > world_dim ||
-						vworld.y < 0 || vworld.y > world_dim ||
-						vworld.z < 0 || vworld.z > world_dim);
-
-					// analysis:
-					mmmx(vworld.x);
-					mmmy(vworld.y);
-					mmmz(vworld.z);
-
-					if (!bHideOOB || !OOB) {
-						float a = 1. - OOB*0.7;
-						vertices[pts].set(vworld.x, vworld.y, vworld.z);
-						texCoord2s[pts].set(x*ix, y*iy);
-						colors[pts].set(a, a, a);
-						pts++;
-					}
-				}
+		for (int k=0; k<n; k++) {
+			const Vec3f& vworld = worldPoints[k];
+			int x = worldPixels[k] % 640;
+			int y = worldPixels[k] / 640;
+
+			bool OOB = (vworld.x < 0 || vworld.x > world_dim ||
+				vworld.y < 0 || vworld.y > world_dim ||
+				vworld.z < 0 || vworld.z > world_dim);
+
+			// analysis:
+			mmmx(vworld.x);
+			mmmy(vworld.y);
+			mmmz(vworld.z);
+
+			if (!bHideOOB || !OOB) {
+				float a = 1. - OOB*0.7;
+				vertices[pts] = vworld;
+				texCoord2s[pts].set(x*ix, y*iy);
+				colors[pts].set(a, a, a);
+				pts++;
 			}
 		}
 		num_points = pts;
@@ -144,23 +146,26 @@ struct MyWindow : public Window, public Freenect::Callback, public ThreadFunctio
 		depthTex.dirty();
 	}
 
+	virtual bool onKeyDown(const Keyboard& k){
+		// record the current depth frame, e.g. for replaying with freenect_replay:
+		if (k.key() == 'r') {
+			if (DepthCloud::writeFrame("depth.raw", (const uint16_t*)depth.data())) {
+				printf("wrote depth.raw\n");
+			}
+		}
+		return true;
+	}
+
 	// ThreadFunction:
 	virtual void operator()() {
 		Buffer<Vec3f>& vertices = pointsMesh.vertices();
 		while (active) {
-			// now send (some of) these data points:
+			// send the whole cloud, quantized into the world box:
 			int limit = num_points;
-			int step = 1 + limit/1024;
-			int offset = rng.uniform(step);
-			int count = 0;
-			for (int i=offset;i<limit; i+= step) {
-				count++;
-				// send pixel i
-				Vec3f& p = vertices[i];
-				netSend.send("/point", p.x, p.y, p.z);
-				//printf("/point %f %f %f\n", p.x, p.y, p.z);
+			if (limit > 0) {
+				cloudSend.send(&vertices[0], (const Colori *)0, limit);
 			}
-			al_sleep(0.01);
+			al_sleep(1./30);
 		}
 	}
 
@@ -227,9 +232,12 @@ struct MyWindow : public Window, public Freenect::Callback, public ThreadFunctio
 	}
 
 	Texture depthTex;
+	DepthCloud cloud;
+	std::vector<Vec3f> worldPoints;
+	std::vector<int> worldPixels;
+	Colori depthColors[2047];
 	Mesh pointsMesh;
 	Mesh frameMesh;
-	int num_points;
 	MinMeanMax<> mmmx, mmmy, mmmz;
 	Vec3f vmin, vmean, vmax, vrange;
 	Matrix4f transform;
@@ -238,12 +246,12 @@ struct MyWindow : public Window, public Freenect::Callback, public ThreadFunctio
 	double panel_width;
 	int quadrant, mx, my;
 
-	osc::Send netSend;
 	Thread sendThread;
-	rnd::Random<> rng;
 
 	bool bHideOOB;
 	bool active;
+	int num_points;
+	PointCloudSend cloudSend;
 };
 
 MyWindow win;
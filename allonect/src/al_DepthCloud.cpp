@@ -0,0 +1,189 @@
+#include <math.h>
+#include <stdio.h>
+#include "allonect/al_DepthCloud.hpp"
+
+namespace al {
+
+// @see http://nicolas.burrus.name/index.php/Research/KinectCalibration
+static const double kFx = 594.21434211923247;	// focal length, in pixels
+static const double kFy = 591.04053696870778;
+static const double kCx = 339.30780975300314;	// principal point, in pixels
+static const double kCy = 242.73913761751615;
+
+double DepthCloud::rawToMeters(uint16_t raw){
+	static const double k1 = 1.1863;
+	static const double k2 = 1./2842.5;
+	static const double k3 = 0.1236;
+	return k3 * tan(raw*k2 + k1);
+}
+
+Vec3f DepthCloud::depthToEye(int x, int y, uint16_t raw){
+	const double meters = rawToMeters(raw);
+	return Vec3f(
+		meters * (x - kCx) / kFx,
+		meters * (y - kCy) / kFy,
+		meters
+	);
+}
+
+bool DepthCloud::readFrame(const std::string& path, uint16_t * depth, int w, int h){
+	FILE * fp = fopen(path.c_str(), "rb");
+	if(!fp) return false;
+	size_t n = fread(depth, sizeof(uint16_t), size_t(w)*h, fp);
+	fclose(fp);
+	return n == size_t(w)*h;
+}
+
+bool DepthCloud::writeFrame(const std::string& path, const uint16_t * depth, int w, int h){
+	FILE * fp = fopen(path.c_str(), "wb");
+	if(!fp) return false;
+	size_t n = fwrite(depth, sizeof(uint16_t), size_t(w)*h, fp);
+	return (fclose(fp) == 0) && n == size_t(w)*h;
+}
+
+
+DepthCloud::DepthCloud(int width, int height)
+:	mWidth(width), mHeight(height), mDecimation(1),
+	mCols(width), mRows(height),
+	mLo(0), mHi(2047),
+	mFx(kFx), mFy(kFy), mCx(kCx), mCy(kCy),
+	mMask(0), mRaysDirty(true)
+{
+	computeMeters();
+}
+
+DepthCloud& DepthCloud::transform(const Matrix4f& m){
+	mTransform = m;
+	mRaysDirty = true;
+	return *this;
+}
+
+DepthCloud& DepthCloud::decimation(int n){
+	if(n < 1) n = 1;
+	if(n != mDecimation){
+		mDecimation = n;
+		mCols = (mWidth  + n-1) / n;
+		mRows = (mHeight + n-1) / n;
+		mRaysDirty = true;
+	}
+	return *this;
+}
+
+DepthCloud& DepthCloud::range(uint16_t lo, uint16_t hi){
+	mLo = lo;
+	mHi = hi;
+	computeMeters();
+	return *this;
+}
+
+DepthCloud& DepthCloud::intrinsics(double fx, double fy, double cx, double cy){
+	mFx = fx; mFy = fy;
+	mCx = cx; mCy = cy;
+	mRaysDirty = true;
+	return *this;
+}
+
+void DepthCloud::computeMeters(){
+	// Raw values past the end of the table are rejected before lookup;
+	// values whose depth is not positive (far beyond the sensor's range)
+	// are marked invalid along with those outside [lo, hi).
+	mMeters.assign(mHi, 0.f);
+	for(unsigned r=mLo; r<mHi; ++r){
+		double m = rawToMeters(r);
+		mMeters[r] = m > 0 ? m : 0;
+	}
+}
+
+void DepthCloud::computeRays(){
+	const Matrix4f& T = mTransform;
+	int n = mCols * mRows;
+	mRayX.resize(n);
+	mRayY.resize(n);
+	mRayZ.resize(n);
+
+	// Eye-space ray of a pixel is ((x-cx)/fx, (y-cy)/fy, 1); store it rotated
+	// into world space so converting a pixel needs no matrix multiply.
+	for(int j=0; j<mRows; ++j){
+		double ey = (j*mDecimation - mCy) / mFy;
+		for(int i=0; i<mCols; ++i){
+			double ex = (i*mDecimation - mCx) / mFx;
+			int k = j*mCols + i;
+			mRayX[k] = T(0,0)*ex + T(0,1)*ey + T(0,2);
+			mRayY[k] = T(1,0)*ex + T(1,1)*ey + T(1,2);
+			mRayZ[k] = T(2,0)*ex + T(2,1)*ey + T(2,2);
+		}
+	}
+
+	mRowM.resize(mCols);
+	mRowX.resize(mCols);
+	mRowY.resize(mCols);
+	mRowZ.resize(mCols);
+	mRaysDirty = false;
+}
+
+int DepthCloud::convert(const uint16_t * depth, Vec3f * points, int * pixels){
+	if(mRaysDirty) computeRays();
+
+	const float tx = mTransform(0,3);
+	const float ty = mTransform(1,3);
+	const float tz = mTransform(2,3);
+	const unsigned tableSize = mMeters.size();
+	const float * meters = &mMeters[0];
+	float * rowM = &mRowM[0];
+	float * rowX = &mRowX[0];
+	float * rowY = &mRowY[0];
+	float * rowZ = &mRowZ[0];
+	const int step = mDecimation;
+	int count = 0;
+
+	for(int j=0; j<mRows; ++j){
+		const int y = j*step;
+		const uint16_t * src = depth + y*mWidth;
+
+		// Look up depths; invalid pixels get zero meters
+		if(mMask){
+			const uint8_t * msk = mMask + y*mWidth;
+			for(int i=0; i<mCols; ++i){
+				unsigned r = src[i*step];
+				float m = r < tableSize ? meters[r] : 0.f;
+				rowM[i] = msk[i*step] ? m : 0.f;
+			}
+		}
+		else{
+			for(int i=0; i<mCols; ++i){
+				unsigned r = src[i*step];
+				rowM[i] = r < tableSize ? meters[r] : 0.f;
+			}
+		}
+
+		// World positions of the whole row; branch-free so it vectorizes
+		const float * rx = &mRayX[j*mCols];
+		const float * ry = &mRayY[j*mCols];
+		const float * rz = &mRayZ[j*mCols];
+		for(int i=0; i<mCols; ++i){
+			rowX[i] = tx + rowM[i]*rx[i];
+			rowY[i] = ty + rowM[i]*ry[i];
+			rowZ[i] = tz + rowM[i]*rz[i];
+		}
+
+		// Pack valid points. Every pixel is written at the current end and
+		// the end only advances for valid ones, avoiding a branch per pixel.
+		if(pixels){
+			for(int i=0; i<mCols; ++i){
+				points[count].set(rowX[i], rowY[i], rowZ[i]);
+				pixels[count] = y*mWidth + i*step;
+				count += rowM[i] > 0.f;
+			}
+		}
+		else{
+			for(int i=0; i<mCols; ++i){
+				points[count].set(rowX[i], rowY[i], rowZ[i]);
+				count += rowM[i] > 0.f;
+			}
+		}
+	}
+
+	return count;
+}
+
+} // al::
@@ -53,6 +53,11 @@
 
 	Sub-class FileWatcher and implement the onFileWatch() method.
 	Register for notifications of files using the watch() method(s)
+
+	When automatic polling is on, changes are reported by the OS where
+	possible (inotify on Linux) and delivered through the MainLoop; a burst
+	of writes to a file results in a single notification once the file has
+	settled. Other files are checked for modification every poll period.
 */
 
 namespace al {
@@ -90,7 +95,17 @@ public:
 
 	/// start/stop automatic background polling (using MainLoop):
 	/// use period <= 0 to stop polling
+	/// (the period does not apply to files with OS notifications)
 	static void autoPoll(al_sec period);
+
+	/// set whether to use OS change notifications when available
+	/// (default true); if false, all files are polled
+	static void notifications(bool v);
+	static bool notifications();
+
+	/// set time a file must be unchanged after a change notification
+	/// before watchers are notified (default 0.05 seconds)
+	static void settleTime(al_sec v);
 };
 
 }; // al
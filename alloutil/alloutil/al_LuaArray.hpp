@@ -0,0 +1,484 @@
+#ifndef INC_AL_LUA_ARRAY_HPP
+#define INC_AL_LUA_ARRAY_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+
+	File description:
+	Views of bulk numeric data for Lua, and calls that pass whole arrays
+*/
+
+#include <vector>
+#include "allocore/math/al_Vec.hpp"
+#include "allocore/types/al_Array.hpp"
+#include "allocore/types/al_Buffer.hpp"
+#include "alloutil/al_Lua.hpp"
+
+namespace al {
+
+/*
+	A view of numeric data that Lua can index directly
+
+	The view does not own the data. It describes a sequence of elements, each
+	made of one or more numeric components, laid out as in an al::Array (rows
+	of elements, possibly padded). In Lua a view is a userdata with:
+
+	#v					number of elements
+	v[k]				k-th scalar, counting components, from 1 (readable and writable)
+	v:get(i)			the components of element i, as multiple values
+	v:set(i, ...)		set the components of element i
+	v:size()			number of elements
+	v:components()		number of components per element
+	v:fill(...)			set every element (one value sets every component)
+	v:copy(x)			copy the elements of view x, which must have the same shape
+	v:axpy(a, x)		add a times view x to v, elementwise
+	v:pointer()			light userdata to the first element and the byte
+						stride between elements (e.g. for LuaJIT's ffi.cast)
+
+	None of these allocate or box anything per element. A loop over v:get/v:set
+	still crosses into C once per access, so whole-array methods such as axpy
+	are much faster where they fit.
+*/
+struct LuaArrayView {
+	char * data;
+	AlloTy type;
+	int components;		///< numeric values per element
+	int count;			///< number of elements
+	int width;			///< elements per row
+	int stride;			///< bytes between elements in a row
+	int rowStride;		///< bytes between rows
+
+	LuaArrayView()
+	:	data(0), type(AlloFloat32Ty), components(1), count(0),
+		width(1), stride(0), rowStride(0)
+	{}
+
+	/// View all cells of an Array (of up to three dimensions)
+	LuaArrayView(Array& a)
+	:	data(a.data.ptr), type(a.type()), components(a.components()),
+		count(a.data.ptr ? a.cells() : 0),
+		width(a.width() ? a.width() : 1), stride(a.stride(0)),
+		rowStride(a.dimcount() > 1 ? a.stride(1) : a.stride(0) * a.width())
+	{}
+
+	/// View the elements of a Buffer of vectors
+	template <int N, class T>
+	LuaArrayView(Buffer<Vec<N,T> >& b)
+	:	data(b.size() ? (char *)b.elems() : 0), type(Array::type<T>()),
+		components(N), count(b.size()),
+		width(b.size() ? b.size() : 1), stride(sizeof(Vec<N,T>)), rowStride(0)
+	{}
+
+	/// View the elements of a Buffer of numbers
+	template <class T>
+	LuaArrayView(Buffer<T>& b)
+	:	data(b.size() ? (char *)b.elems() : 0), type(Array::type<T>()),
+		components(1), count(b.size()),
+		width(b.size() ? b.size() : 1), stride(sizeof(T)), rowStride(0)
+	{}
+
+	/// View plain memory of count elements of N numbers of type T
+	template <class T>
+	LuaArrayView(T * elems, int count_, int N=1)
+	:	data((char *)elems), type(Array::type<T>()),
+		components(N), count(count_),
+		width(count_ > 0 ? count_ : 1), stride(sizeof(T)*N), rowStride(0)
+	{}
+
+	/// Whether both views have the same number of elements and components
+	bool sameShape(const LuaArrayView& v) const {
+		return count == v.count && components == v.components;
+	}
+
+	/// Pointer to element i
+	char * elem(int i) const {
+		return data + (i / width) * rowStride + (i % width) * stride;
+	}
+
+	/// Get component c of element i
+	double get(int i, int c) const { return read(type, elem(i), c); }
+
+	/// Set component c of element i
+	void set(int i, int c, double v) const { write(type, elem(i), c, v); }
+
+	static double read(AlloTy ty, const char * e, int c);
+	static void write(AlloTy ty, char * e, int c, double v);
+};
+
+
+
+/*
+	Lua binding for LuaArrayView and batch calls
+
+	A batch call hands whole arrays to a Lua function in one call, rather
+	than calling it once per element with each element boxed:
+
+	// Lua:
+	function step(pos, vel, dt)
+		pos:axpy(dt, vel)
+		for i=1,#pos do
+			local x,y,z = pos:get(i)
+			if y < 0 then pos:set(i, x, -y, z) end
+		end
+	end
+
+	// C++:
+	Buffer<Vec3f> pos, vel;
+	lua.push(dt);
+	LuaArray::call(lua, "step", pos, vel, 1);
+
+	Views passed to a batch call are emptied when it returns, so a script that
+	holds onto one afterwards sees no elements rather than stale memory.
+*/
+class LuaArray {
+public:
+
+	/// Push a view onto the Lua stack; returns the userdata's copy of it
+
+	/// The view is not emptied automatically; call invalidate when the data
+	/// it refers to goes away.
+	static LuaArrayView * push(lua_State * L, const LuaArrayView& v);
+
+	/// Returns the view at stack index idx, or NULL if not a view
+	static LuaArrayView * to(lua_State * L, int idx);
+
+	/// As to(), but raises a Lua error if not a view
+	static LuaArrayView * checkto(lua_State * L, int idx);
+
+	/// Empty a view held by Lua
+	static void invalidate(LuaArrayView * v){ *v = LuaArrayView(); }
+
+	/// Call a global Lua function once with views of whole arrays
+
+	/// The function receives the views followed by nargs extra arguments,
+	/// which must already be on the stack. Errors are caught and reported as
+	/// by Lua::pcall; returns 0 if no errors.
+	static int call(Lua& lua, const char * func, const LuaArrayView * views, int numViews, int nargs=0);
+
+	static int call(Lua& lua, const char * func, const LuaArrayView& a, int nargs=0){
+		return call(lua, func, &a, 1, nargs);
+	}
+	static int call(Lua& lua, const char * func, const LuaArrayView& a, const LuaArrayView& b, int nargs=0){
+		LuaArrayView v[] = {a, b};
+		return call(lua, func, v, 2, nargs);
+	}
+	static int call(Lua& lua, const char * func, const LuaArrayView& a, const LuaArrayView& b, const LuaArrayView& c, int nargs=0){
+		LuaArrayView v[] = {a, b, c};
+		return call(lua, func, v, 3, nargs);
+	}
+
+	/// Name of the metatable in the Lua registry
+	static const char * mt_name(){ return "meta_LuaArray"; }
+
+private:
+	static void define(lua_State * L);
+	static LuaArrayView * self(lua_State * L);
+	static int index(lua_State * L);
+	static int newindex(lua_State * L);
+	static int len(lua_State * L);
+	static int tostring(lua_State * L);
+	static int get(lua_State * L);
+	static int set(lua_State * L);
+	static int size(lua_State * L);
+	static int components(lua_State * L);
+	static int fill(lua_State * L);
+	static int copy(lua_State * L);
+	static int axpy(lua_State * L);
+	static int pointer(lua_State * L);
+};
+
+
+
+/*
+	Inline implementation
+*/
+#pragma mark Inline Implementation
+
+inline double LuaArrayView::read(AlloTy ty, const char * e, int c){
+	switch(ty){
+		case AlloFloat32Ty:	return ((const float *)e)[c];
+		case AlloFloat64Ty:	return ((const double *)e)[c];
+		case AlloSInt8Ty:	return ((const int8_t *)e)[c];
+		case AlloSInt16Ty:	return ((const int16_t *)e)[c];
+		case AlloSInt32Ty:	return ((const int32_t *)e)[c];
+		case AlloSInt64Ty:	return ((const int64_t *)e)[c];
+		case AlloUInt8Ty:	return ((const uint8_t *)e)[c];
+		case AlloUInt16Ty:	return ((const uint16_t *)e)[c];
+		case AlloUInt32Ty:	return ((const uint32_t *)e)[c];
+		case AlloUInt64Ty:	return ((const uint64_t *)e)[c];
+		default:			return 0;
+	}
+}
+
+inline void LuaArrayView::write(AlloTy ty, char * e, int c, double v){
+	switch(ty){
+		case AlloFloat32Ty:	((float *)e)[c] = v; break;
+		case AlloFloat64Ty:	((double *)e)[c] = v; break;
+		case AlloSInt8Ty:	((int8_t *)e)[c] = v; break;
+		case AlloSInt16Ty:	((int16_t *)e)[c] = v; break;
+		case AlloSInt32Ty:	((int32_t *)e)[c] = v; break;
+		case AlloSInt64Ty:	((int64_t *)e)[c] = v; break;
+		case AlloUInt8Ty:	((uint8_t *)e)[c] = v; break;
+		case AlloUInt16Ty:	((uint16_t *)e)[c] = v; break;
+		case AlloUInt32Ty:	((uint32_t *)e)[c] = v; break;
+		case AlloUInt64Ty:	((uint64_t *)e)[c] = v; break;
+		default:;
+	}
+}
+
+
+inline void LuaArray::define(lua_State * L) {
+	// leaves the metatable on the stack
+	if (luaL_newmetatable(L, mt_name())) {
+		static const luaL_Reg meta[] = {
+			{"__newindex", newindex}, {"__len", len},
+			{"__tostring", tostring}, {NULL, NULL}
+		};
+		static const luaL_Reg methods[] = {
+			{"get", get}, {"set", set}, {"size", size},
+			{"components", components}, {"fill", fill}, {"copy", copy},
+			{"axpy", axpy}, {"pointer", pointer}, {NULL, NULL}
+		};
+		// Every function gets the metatable as upvalue, so that it can check
+		// its argument with a pointer compare instead of a registry lookup
+		for (const luaL_Reg * r = meta; r->name; ++r) {
+			lua_pushvalue(L, -1);
+			lua_pushcclosure(L, r->func, 1);
+			lua_setfield(L, -2, r->name);
+		}
+		lua_newtable(L);
+		for (const luaL_Reg * r = methods; r->name; ++r) {
+			lua_pushvalue(L, -2);
+			lua_pushcclosure(L, r->func, 1);
+			lua_setfield(L, -2, r->name);
+		}
+		// __index looks up methods in its second upvalue
+		lua_pushvalue(L, -2);
+		lua_insert(L, -2);
+		lua_pushcclosure(L, index, 2);
+		lua_setfield(L, -2, "__index");
+	}
+}
+
+inline LuaArrayView * LuaArray::push(lua_State * L, const LuaArrayView& v) {
+	LuaArrayView * u = (LuaArrayView *)lua_newuserdata(L, sizeof(LuaArrayView));
+	*u = v;
+	define(L);
+	lua_setmetatable(L, -2);
+	return u;
+}
+
+inline LuaArrayView * LuaArray::to(lua_State * L, int idx) {
+	LuaArrayView * u = (LuaArrayView *)lua_touserdata(L, idx);
+	if (u && lua_getmetatable(L, idx)) {
+		luaL_getmetatable(L, mt_name());
+		if (!lua_rawequal(L, -1, -2)) u = NULL;
+		lua_pop(L, 2);
+		return u;
+	}
+	return NULL;
+}
+
+inline LuaArrayView * LuaArray::checkto(lua_State * L, int idx) {
+	LuaArrayView * u = to(L, idx);
+	if (u == 0) luaL_error(L, "LuaArray not found (index %d)", idx);
+	return u;
+}
+
+inline int LuaArray::call(Lua& lua, const char * func, const LuaArrayView * views, int numViews, int nargs) {
+	lua_State * L = lua;
+	int base = lua_gettop(L) - nargs;
+	lua_getglobal(L, func);
+	lua_insert(L, base + 1);
+	std::vector<LuaArrayView *> pushed(numViews);
+	for (int i=0; i<numViews; ++i) {
+		pushed[i] = push(L, views[i]);
+		lua_insert(L, base + 2 + i);
+	}
+	int err = lua.pcall(numViews + nargs, func);
+	lua_settop(L, base);
+	for (int i=0; i<numViews; ++i) invalidate(pushed[i]);
+	return err;
+}
+
+inline LuaArrayView * LuaArray::self(lua_State * L) {
+	if (lua_getmetatable(L, 1)) {
+		bool ok = lua_rawequal(L, -1, lua_upvalueindex(1));
+		lua_pop(L, 1);
+		if (ok) return (LuaArrayView *)lua_touserdata(L, 1);
+	}
+	luaL_error(L, "LuaArray expected");
+	return NULL;
+}
+
+inline int LuaArray::index(lua_State * L) {
+	LuaArrayView * v = self(L);
+	if (lua_type(L, 2) == LUA_TNUMBER) {
+		lua_Integer k = lua_tointeger(L, 2) - 1;
+		if (k >= 0 && k < v->count * v->components) {
+			lua_pushnumber(L, v->get(k / v->components, k % v->components));
+		}
+		else {
+			lua_pushnil(L);
+		}
+	}
+	else {
+		lua_pushvalue(L, 2);
+		lua_rawget(L, lua_upvalueindex(2));
+	}
+	return 1;
+}
+
+inline int LuaArray::newindex(lua_State * L) {
+	LuaArrayView * v = self(L);
+	lua_Integer k = luaL_checkinteger(L, 2) - 1;
+	if (k < 0 || k >= v->count * v->components)
+		return luaL_error(L, "LuaArray index %d out of range", int(k+1));
+	v->set(k / v->components, k % v->components, luaL_checknumber(L, 3));
+	return 0;
+}
+
+inline int LuaArray::len(lua_State * L) {
+	lua_pushinteger(L, self(L)->count);
+	return 1;
+}
+
+inline int LuaArray::tostring(lua_State * L) {
+	LuaArrayView * v = self(L);
+	lua_pushfstring(L, "LuaArray: %s x %d [%d]",
+		allo_type_name(v->type), v->components, v->count);
+	return 1;
+}
+
+inline int LuaArray::get(lua_State * L) {
+	LuaArrayView * v = self(L);
+	lua_Integer i = luaL_checkinteger(L, 2) - 1;
+	if (i < 0 || i >= v->count) return 0;
+	const char * e = v->elem(i);
+	for (int c=0; c<v->components; ++c) {
+		lua_pushnumber(L, LuaArrayView::read(v->type, e, c));
+	}
+	return v->components;
+}
+
+inline int LuaArray::set(lua_State * L) {
+	LuaArrayView * v = self(L);
+	lua_Integer i = luaL_checkinteger(L, 2) - 1;
+	if (i < 0 || i >= v->count)
+		return luaL_error(L, "LuaArray index %d out of range", int(i+1));
+	char * e = v->elem(i);
+	int n = MIN(v->components, lua_gettop(L) - 2);
+	for (int c=0; c<n; ++c) {
+		LuaArrayView::write(v->type, e, c, luaL_checknumber(L, c+3));
+	}
+	return 0;
+}
+
+inline int LuaArray::size(lua_State * L) {
+	lua_pushinteger(L, self(L)->count);
+	return 1;
+}
+
+inline int LuaArray::components(lua_State * L) {
+	lua_pushinteger(L, self(L)->components);
+	return 1;
+}
+
+inline int LuaArray::fill(lua_State * L) {
+	LuaArrayView * v = self(L);
+	int nargs = lua_gettop(L) - 1;
+	double vals[16];
+	int nc = MIN(v->components, 16);
+	for (int c=0; c<nc; ++c) {
+		vals[c] = luaL_checknumber(L, 2 + (nargs > 1 ? MIN(c, nargs-1) : 0));
+	}
+	for (int i=0; i<v->count; ++i) {
+		char * e = v->elem(i);
+		for (int c=0; c<v->components; ++c) {
+			LuaArrayView::write(v->type, e, c, vals[MIN(c, nc-1)]);
+		}
+	}
+	return 0;
+}
+
+inline int LuaArray::copy(lua_State * L) {
+	LuaArrayView * v = self(L);
+	LuaArrayView * x = checkto(L, 2);
+	if (!v->sameShape(*x)) return luaL_error(L, "LuaArray shapes differ");
+	for (int i=0; i<v->count; ++i) {
+		char * e = v->elem(i);
+		const char * ex = x->elem(i);
+		for (int c=0; c<v->components; ++c) {
+			LuaArrayView::write(v->type, e, c, LuaArrayView::read(x->type, ex, c));
+		}
+	}
+	return 0;
+}
+
+inline int LuaArray::axpy(lua_State * L) {
+	LuaArrayView * v = self(L);
+	double a = luaL_checknumber(L, 2);
+	LuaArrayView * x = checkto(L, 3);
+	if (!v->sameShape(*x)) return luaL_error(L, "LuaArray shapes differ");
+	if (v->type == AlloFloat32Ty && x->type == AlloFloat32Ty) {
+		// the common case of float vectors, without per-value dispatch
+		float af = a;
+		for (int i=0; i<v->count; ++i) {
+			float * e = (float *)v->elem(i);
+			const float * ex = (const float *)x->elem(i);
+			for (int c=0; c<v->components; ++c) e[c] += af * ex[c];
+		}
+		return 0;
+	}
+	for (int i=0; i<v->count; ++i) {
+		char * e = v->elem(i);
+		const char * ex = x->elem(i);
+		for (int c=0; c<v->components; ++c) {
+			double y = LuaArrayView::read(v->type, e, c);
+			LuaArrayView::write(v->type, e, c, y + a * LuaArrayView::read(x->type, ex, c));
+		}
+	}
+	return 0;
+}
+
+inline int LuaArray::pointer(lua_State * L) {
+	LuaArrayView * v = self(L);
+	lua_pushlightuserdata(L, v->data);
+	lua_pushinteger(L, v->stride);
+	return 2;
+}
+
+} // al::
+
+#endif
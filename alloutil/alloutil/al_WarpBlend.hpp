@@ -1,6 +1,8 @@
 #ifndef AL_WARPBLEND_H
 #define AL_WARPBLEND_H
 
+#include <string>
+#include <vector>
 #include "allocore/graphics/al_Texture.hpp"
 #include "allocore/graphics/al_Shader.hpp"
 #include "allocore/spatial/al_Pose.hpp"
@@ -34,7 +36,32 @@ public:
 
 	void readBlend(std::string path);
 	void readWarp(std::string path);
-	void read3D(std::string path);
+
+	/// Read a map3D file
+
+	/// If a cache written by writeCache3D() exists at path + ".cache" and is
+	/// up to date, it is read instead.
+	/// \returns false if the map could not be read
+	bool read3D(std::string path);
+
+	/// Read map3D files of several projectors in parallel
+
+	/// @param[in] warps		objects to read maps into
+	/// @param[in] paths		map3D file for each object
+	/// @param[in] numThreads	number of threads to use; if not positive, one
+	///							per processor
+	/// \returns number of maps successfully read
+	static int read3D(const std::vector<WarpnBlend *>& warps, const std::vector<std::string>& paths, int numThreads=-1);
+
+	/// Convert a map3D file to the binary cache format
+
+	/// The cache stores the map already flipped and interleaved as texture
+	/// data following a page-sized header, so it can be loaded with a single
+	/// bulk copy.
+	/// @param[in] srcPath		path of map3D file
+	/// @param[in] cachePath	path of cache to write; if empty, srcPath + ".cache"
+	/// \returns whether the cache was written
+	static bool writeCache3D(const std::string& srcPath, std::string cachePath="");
 	void readModelView(std::string path);
 	void readPerspective(std::string path, double near = 0.1, double far = 100);
 	void readProj(std::string path);
@@ -0,0 +1,149 @@
+/*
+Alloutil Example: Lua Arrays
+
+Description:
+Moves a few thousand agents by velocity from a Lua script in several ways and
+times each one:
+
+glue		the step function is called once per agent with both vectors
+			boxed by Glue<Vec3f>
+table		positions and velocities are sent as one flat table and read back
+			with Lua::to_vec_t
+view		the step function is called once with LuaArray views and loops
+			over v:get/v:set
+flat		as view, but with flat scalar indexing v[k]
+kernel		as view, but the script calls the whole-array method axpy
+
+All paths must agree on the final positions.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include "allocore/system/al_Time.hpp"
+#include "alloutil/al_LuaArray.hpp"
+
+using namespace al;
+
+// Glue binding of Vec3f with fields x, y, z
+template<> const char * Glue<Vec3f>::usr_name() { return "Vec3f"; }
+template<> bool Glue<Vec3f>::usr_has_index() { return true; }
+template<> void Glue<Vec3f>::usr_index(lua_State * L, Vec3f * u) {
+	const char * k = lua_tostring(L, 2);
+	if (k && k[0] >= 'x' && k[0] <= 'z' && !k[1]) lua_pushnumber(L, (*u)[k[0]-'x']);
+	else lua_pushnil(L);
+}
+template<> void Glue<Vec3f>::usr_newindex(lua_State * L, Vec3f * u) {
+	const char * k = lua_tostring(L, 2);
+	if (k && k[0] >= 'x' && k[0] <= 'z' && !k[1]) (*u)[k[0]-'x'] = luaL_checknumber(L, 3);
+}
+
+static const char * script =
+"function stepGlue(p, v, dt) \n"
+"	p.x = p.x + v.x*dt \n"
+"	p.y = p.y + v.y*dt \n"
+"	p.z = p.z + v.z*dt \n"
+"end \n"
+"function stepTable(p, v, dt) \n"
+"	for k=1,#p do p[k] = p[k] + v[k]*dt end \n"
+"	return p \n"
+"end \n"
+"function stepView(p, v, dt) \n"
+"	local get, set = p.get, p.set \n"
+"	for i=1,#p do \n"
+"		local x,y,z = get(p, i) \n"
+"		local vx,vy,vz = get(v, i) \n"
+"		set(p, i, x + vx*dt, y + vy*dt, z + vz*dt) \n"
+"	end \n"
+"end \n"
+"function stepFlat(p, v, dt) \n"
+"	for k=1,#p*3 do p[k] = p[k] + v[k]*dt end \n"
+"end \n"
+"function stepKernel(p, v, dt) \n"
+"	p:axpy(dt, v) \n"
+"end \n";
+
+static const int N = 5000;
+static const int steps = 20;
+static const double dt = 1./60;
+
+static void init(Buffer<Vec3f>& pos, Buffer<Vec3f>& vel){
+	pos.size(N);
+	vel.size(N);
+	for (int i=0; i<N; i++) {
+		pos[i].set(cos(i*0.1), sin(i*0.1), i*0.001);
+		vel[i].set(sin(i*0.7), 1, -cos(i*0.3));
+	}
+}
+
+static void stepGlue(Lua& lua, Buffer<Vec3f>& pos, Buffer<Vec3f>& vel){
+	for (int i=0; i<pos.size(); i++) {
+		lua.getglobal("stepGlue");
+		Glue<Vec3f>::push(lua, &pos[i]);
+		Glue<Vec3f>::push(lua, &vel[i]);
+		lua.push(dt);
+		lua.pcall(3);
+	}
+}
+
+static void stepTable(Lua& lua, Buffer<Vec3f>& pos, Buffer<Vec3f>& vel){
+	int n = pos.size()*3;
+	lua.getglobal("stepTable");
+	for (int t=0; t<2; t++) {
+		const float * src = (t ? vel : pos).elems()[0].elems();
+		lua_createtable(lua, n, 0);
+		for (int k=0; k<n; k++) {
+			lua.push(src[k]);
+			lua_rawseti(lua, -2, k+1);
+		}
+	}
+	lua.push(dt);
+	lua.pcall(3);
+	lua.to_vec_t(pos.elems()[0].elems(), n);
+	lua.pop();
+}
+
+static bool run(Lua& lua, const char * name, int path, const Buffer<Vec3f>& ref, Buffer<Vec3f>& out){
+	Buffer<Vec3f> pos, vel;
+	init(pos, vel);
+
+	Timer t;
+	t.start();
+	for (int s=0; s<steps; s++) {
+		switch (path) {
+		case 0: stepGlue(lua, pos, vel); break;
+		case 1: stepTable(lua, pos, vel); break;
+		default:
+			lua.push(dt);
+			LuaArray::call(lua, name, pos, vel, 1);
+		}
+	}
+	t.stop();
+
+	float maxErr = 0;
+	for (int i=0; i<N && ref.size(); i++) {
+		float e = (pos[i] - ref[i]).mag();
+		if (e > maxErr) maxErr = e;
+	}
+	printf("%-10s %8.3f ms per step, max difference %g\n",
+		name, t.elapsedSec()*1000/steps, maxErr);
+	out = pos;
+	return maxErr < 1e-4;
+}
+
+int main(){
+	Lua lua;
+	Glue<Vec3f>::define(lua);
+	if (lua.dostring(script)) return 1;
+
+	Buffer<Vec3f> ref, out;
+	printf("%d agents, %d steps\n", N, steps);
+	bool ok = run(lua, "stepGlue", 0, ref, ref);
+	ok &= run(lua, "stepTable", 1, ref, out);
+	ok &= run(lua, "stepView", 2, ref, out);
+	ok &= run(lua, "stepFlat", 2, ref, out);
+	ok &= run(lua, "stepKernel", 2, ref, out);
+	ok &= lua.top() == 0;
+
+	printf(ok ? "OK\n" : "FAILED\n");
+	return ok ? 0 : 1;
+}
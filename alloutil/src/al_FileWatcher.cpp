@@ -4,13 +4,27 @@
 #include <map>
 #include <limits>
 
+#ifdef AL_LINUX
+	#include <errno.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/inotify.h>
+	#define AL_FILEWATCHER_INOTIFY
+#endif
+
 using namespace al;
 
 typedef std::vector<FileWatcher *> WatcherList;
 
 struct WatchedFile {
-	WatchedFile() : mModified(-std::numeric_limits<double>::max()) {}
-	WatchedFile(const WatchedFile& cpy) : mModified(cpy.mModified) {}
+	WatchedFile()
+	:	mModified(-std::numeric_limits<double>::max()),
+		mLastEvent(0), mNotified(false), mPending(false)
+	{}
+	WatchedFile(const WatchedFile& cpy)
+	:	mModified(cpy.mModified),
+		mLastEvent(0), mNotified(false), mPending(false)
+	{}
 
 	void add(FileWatcher * watcher) {
 		mWatchers.push_back(watcher);
@@ -68,12 +82,170 @@ struct WatchedFile {
 	std::string mPath;
 	al_sec mModified;
 	WatcherList mWatchers;
+
+	al_sec mLastEvent;	// main loop time of last change notification
+	bool mNotified;		// whether changes are reported by the OS
+	bool mPending;		// whether a notification is waiting to settle
 };
 
 typedef std::map<std::string, WatchedFile > WatcherMap;
 
 WatcherMap gWatchedFiles;
 al_sec gPollPeriod;
+al_sec gSettleTime = 0.05;
+bool gUseNotifications = true;
+
+
+// Notify watchers once a file has had no change events for the settle time,
+// so that a burst of writes results in a single notification
+static void settle(al_sec t, WatchedFile * wf) {
+	al_sec due = wf->mLastEvent + gSettleTime;
+	if (t < due) {
+		MainLoop::queue().send(due, settle, wf);
+		return;
+	}
+	wf->mPending = false;
+	if (File::exists(wf->mPath)) {
+		File f(wf->mPath, "r", false);
+		wf->notify(f);
+	}
+}
+
+static void changed(WatchedFile& wf) {
+	wf.mLastEvent = MainLoop::now();
+	if (!wf.mPending) {
+		wf.mPending = true;
+		MainLoop::queue().send(wf.mLastEvent + gSettleTime, settle, &wf);
+	}
+}
+
+
+#ifdef AL_FILEWATCHER_INOTIFY
+
+// Watches the directories of files, rather than the files themselves, so
+// that files replaced by rename (as many editors save) or created after
+// being watched are still reported.
+class Inotify : public Main::FDHandler {
+public:
+
+	Inotify(): mFD(-1), mAttached(false) {}
+
+	virtual ~Inotify() {
+		if (mFD >= 0) close(mFD);
+	}
+
+	// Returns whether file changes will be reported
+	bool add(WatchedFile& wf) {
+		if (wf.mNotified) return true;
+		if (mFD < 0) {
+			mFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			if (mFD < 0) return false;
+		}
+
+		std::string path = wf.mPath;
+		size_t slash = path.find_last_of('/');
+		std::string dir = slash == std::string::npos ? "." : (slash ? path.substr(0, slash) : "/");
+		std::string name = slash == std::string::npos ? path : path.substr(slash+1);
+
+		int wd = inotify_add_watch(mFD, dir.c_str(),
+			IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_MOVED_TO | IN_CREATE);
+		if (wd < 0) return false; // e.g., no such directory or watch limit reached
+
+		Files& files = mDirs[wd];
+		std::pair<Files::iterator, Files::iterator> r = files.equal_range(name);
+		while (r.first != r.second && r.first->second != &wf) ++r.first;
+		if (r.first == r.second) files.insert(std::make_pair(name, &wf));
+		wf.mNotified = true;
+		return true;
+	}
+
+	void attach() {
+		if (mFD >= 0 && !mAttached) {
+			Main::get().add(mFD, *this);
+			mAttached = true;
+		}
+	}
+
+	void detach() {
+		if (mAttached) {
+			Main::get().remove(mFD);
+			mAttached = false;
+		}
+	}
+
+	virtual void onReadable(int fd) {
+		char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+		for (;;) {
+			ssize_t len = read(fd, buf, sizeof buf);
+			if (len <= 0) break; // EAGAIN: drained
+
+			for (char * p = buf; p < buf + len; ) {
+				const inotify_event * e = (const inotify_event *)p;
+				p += sizeof(inotify_event) + e->len;
+
+				if (e->mask & IN_Q_OVERFLOW) {
+					// Events were lost, so any file may have changed
+					for (DirMap::iterator d = mDirs.begin(); d != mDirs.end(); ++d) {
+						Files& files = d->second;
+						for (Files::iterator it = files.begin(); it != files.end(); ++it) {
+							changed(*it->second);
+						}
+					}
+					continue;
+				}
+
+				DirMap::iterator dit = mDirs.find(e->wd);
+				if (dit == mDirs.end()) continue;
+
+				if (e->mask & IN_IGNORED) {
+					// Directory was removed; fall back to polling its files
+					Files& files = dit->second;
+					for (Files::iterator it = files.begin(); it != files.end(); ++it) {
+						it->second->mNotified = false;
+					}
+					mDirs.erase(dit);
+					continue;
+				}
+
+				if (e->len) {
+					std::pair<Files::iterator, Files::iterator> r = dit->second.equal_range(e->name);
+					for (; r.first != r.second; ++r.first) changed(*r.first->second);
+				}
+			}
+		}
+	}
+
+private:
+	typedef std::multimap<std::string, WatchedFile *> Files;	// file name -> files
+	typedef std::map<int, Files> DirMap;				// watch descriptor -> files
+	DirMap mDirs;
+	int mFD;
+	bool mAttached;
+};
+
+static Inotify& inotify() {
+	static Inotify * v = new Inotify;
+	return *v;
+}
+
+static bool addNotification(WatchedFile& wf) {
+	if (!gUseNotifications || !inotify().add(wf)) return false;
+	if (gPollPeriod > 0.) inotify().attach();
+	return true;
+}
+
+static void attachNotifications(bool v) {
+	if (v) inotify().attach();
+	else inotify().detach();
+}
+
+#else
+
+static bool addNotification(WatchedFile& wf) { return false; }
+static void attachNotifications(bool v) {}
+
+#endif
+
 
 void FileWatcher::poll() {
 	// check each file:
@@ -94,7 +266,15 @@ void FileWatcher::pollAll() {
 }
 
 static void autopoll(al_sec t) {
-	FileWatcher::pollAll();
+	// only files without OS notifications need to be checked
+	WatcherMap::iterator it = gWatchedFiles.begin();
+	while (it != gWatchedFiles.end()) {
+		WatchedFile& wf = it->second;
+		if (!wf.mNotified && !addNotification(wf)) {
+			wf.test();
+		}
+		it++;
+	}
 	if (gPollPeriod > 0.) MainLoop::queue().send(t+gPollPeriod, autopoll);
 }
 
@@ -103,6 +283,7 @@ void FileWatcher::autoPoll(al_sec t) {
 	if (t > 0.) {
 		if (gPollPeriod == 0.) {
 			gPollPeriod = t;
+			attachNotifications(true);
 			// start the task:
 			autopoll(Main::get().now());
 		} else {
@@ -111,9 +292,31 @@ void FileWatcher::autoPoll(al_sec t) {
 	} else {
 		// turn it off:
 		gPollPeriod = 0.;
+		attachNotifications(false);
 	}
 }
 
+void FileWatcher::notifications(bool v) {
+	gUseNotifications = v;
+	if (!v) {
+		// everything goes back to polling
+		attachNotifications(false);
+		WatcherMap::iterator it = gWatchedFiles.begin();
+		while (it != gWatchedFiles.end()) {
+			it->second.mNotified = false;
+			it++;
+		}
+	}
+}
+
+bool FileWatcher::notifications() {
+	return gUseNotifications;
+}
+
+void FileWatcher::settleTime(al_sec v) {
+	gSettleTime = v > 0. ? v : 0.;
+}
+
 
 
 FileWatcher::~FileWatcher(){
@@ -130,6 +333,7 @@ void FileWatcher::watch(std::string filepath, bool immediate) {
 	WatchedFile& wf = gWatchedFiles[filepath];
 	wf.mPath = filepath;
 	wf.add(this);
+	addNotification(wf);
 	if (immediate) wf.test();
 }
 
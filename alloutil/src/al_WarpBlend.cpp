@@ -1,10 +1,19 @@
+#include <string.h>
 #include "alloutil/al_WarpBlend.hpp"
 #include "allocore/graphics/al_Image.hpp"
 #include "allocore/graphics/al_Shader.hpp"
 #include "allocore/io/al_File.hpp"
 #include "allocore/math/al_Functions.hpp"
+#include "allocore/system/al_TaskPool.hpp"
 #include "allocore/system/al_Time.hpp"
 
+#ifndef AL_WINDOWS
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
 using namespace al;
 
 Graphics gl;
@@ -853,7 +862,7 @@ void WarpnBlend::readNone() {
 void WarpnBlend::readID(std::string id) {
 	printf("%s %s\n", imgpath.c_str(), id.c_str());
 	//readWarp(imgpath + "uv" + id + ".bin");
-	read3D(imgpath + "map3D" + id + ".bin");
+	if (!read3D(imgpath + "map3D" + id + ".bin")) return;
 	readBlend(imgpath + "alpha" + id + ".png");
 	readModelView(imgpath + "ModelViewMatrix" + id + ".txt");
 	readPerspective(imgpath + "PerspectiveMatrix" + id+ ".txt");
@@ -870,37 +879,164 @@ void WarpnBlend::readBlend(std::string path) {
 	alphaMap.print();
 }
 
-void WarpnBlend::read3D(std::string path) {
+// Header of binary map3D cache. Texture data (rows of interleaved RGB
+// floats, bottom row first) starts at the next page boundary.
+struct Map3DCacheHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t width, height;
+	uint32_t components;
+	double sourceModified;	// modification time of source map3D file
+	float averageRadius;
+};
+
+static const char map3DCacheMagic[8] = {'A','L','M','A','P','3','D','\0'};
+static const uint32_t map3DCacheVersion = 1;
+static const long map3DCacheDataOffset = 4096;
+
+// Read map3D file as three planes of floats
+static bool readMap3DRaw(const std::string& path, std::vector<float>& planes, int32_t& w, int32_t& h) {
 	File f(path, "rb");
-	if (!f.open()) {
-		printf("failed to open file %s\n", path.c_str());
-		exit(-1);
-	}
+	if (!f.open()) return false;
 
 	int32_t dim[2];
-	f.read((void *)dim, sizeof(int32_t), 2);
-	printf("reading map %s: %dx%d; ", path.c_str(), dim[0], dim[1]);
+	if (f.read((void *)dim, sizeof(int32_t), 2) != 2) return false;
+	w = dim[1];
+	h = dim[0]/3;
+	if (w <= 0 || h <= 0) return false;
 
-	int32_t w = dim[1];
-	int32_t h = dim[0]/3;
 	int32_t elems = w*h;
-	//printf("array %dx%d = %d\n", w, h, elems);
+	planes.resize(elems*3);
+	return f.read((void *)&planes[0], sizeof(float), elems*3) == elems*3;
+}
 
-	int r = 0;
+// Interleave planes into texture rows, flipping y; returns average radius
+static float interleaveMap3D(const std::vector<float>& planes, int32_t w, int32_t h, char * dst, size_t rowStride) {
+	const float * t = &planes[0];
+	const float * u = t + w*h;
+	const float * v = u + w*h;
+	double sum = 0;
 
-	float * t = (float *)malloc(sizeof(float) * elems);
-	r = f.read((void *)t, sizeof(float), elems);
-	//printf("read %d elements (array size %d)\n", r, elems);
+	for (int y=0; y<h; y++) {
+		// Y axis appears to be inverted
+		int32_t y1 = (h-y-1);
+		float * row = (float *)(dst + y*rowStride);
+		for (int x=0; x<w; x++) {
+			// input data is row-major format
+			int32_t idx = y1*w+x;
+			float * cell = row + x*3;
+			// coordinate system change:
+			cell[0] = t[idx];//*0.5+0.5;
+			cell[1] = u[idx];//*0.5+0.5;
+			cell[2] = v[idx];//*0.5+0.5;
+			sum += Vec3f(cell).mag();
+		}
+	}
+	return sum / (w*h);
+}
 
-	float * u = (float *)malloc(sizeof(float) * elems);
-	r = f.read((void *)u, sizeof(float), elems);
-	//printf("read %d elements (array size %d)\n", r, elems);
+static bool readMap3DCacheHeader(const std::string& path, Map3DCacheHeader& hdr) {
+	File f(path, "rb");
+	if (!f.open()) return false;
+	return f.read(&hdr, sizeof(hdr), 1) == 1
+		&& !memcmp(hdr.magic, map3DCacheMagic, sizeof(map3DCacheMagic))
+		&& hdr.version == map3DCacheVersion
+		&& hdr.components == 3;
+}
 
-	float * v = (float *)malloc(sizeof(float) * elems);
-	r = f.read((void *)v, sizeof(float), elems);
-	//printf("read %d elements (array size %d)\n", r, elems);
+// Copy texture data of cache into rows of dst
+static bool readMap3DCacheData(const std::string& path, const Map3DCacheHeader& hdr, char * dst, size_t rowStride) {
+	size_t rowBytes = size_t(hdr.width) * 3 * sizeof(float);
+	size_t dataBytes = rowBytes * hdr.height;
+
+#ifndef AL_WINDOWS
+	// Map the file so the data goes from the page cache straight into dst
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	size_t len = map3DCacheDataOffset + dataBytes;
+	if (fstat(fd, &st) != 0 || size_t(st.st_size) < len) {
+		::close(fd);
+		return false;
+	}
+	void * mem = mmap(0, len, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (mem == MAP_FAILED) return false;
+	madvise(mem, len, MADV_SEQUENTIAL);
+	const char * src = (const char *)mem + map3DCacheDataOffset;
+	if (rowStride == rowBytes) {
+		memcpy(dst, src, dataBytes);
+	} else {
+		for (uint32_t y=0; y<hdr.height; ++y) memcpy(dst + y*rowStride, src + y*rowBytes, rowBytes);
+	}
+	munmap(mem, len);
+	return true;
+#else
+	File f(path, "rb");
+	if (!f.open() || fseek(f.filePointer(), map3DCacheDataOffset, SEEK_SET) != 0) return false;
+	for (uint32_t y=0; y<hdr.height; ++y) {
+		if (f.read(dst + y*rowStride, rowBytes, 1) != 1) return false;
+	}
+	return true;
+#endif
+}
 
-	f.close();
+bool WarpnBlend::writeCache3D(const std::string& srcPath, std::string cachePath) {
+	if (cachePath.empty()) cachePath = srcPath + ".cache";
+
+	std::vector<float> planes;
+	int32_t w, h;
+	if (!readMap3DRaw(srcPath, planes, w, h)) {
+		printf("failed to read map %s\n", srcPath.c_str());
+		return false;
+	}
+
+	size_t rowBytes = size_t(w) * 3 * sizeof(float);
+	std::vector<char> data(rowBytes * h);
+
+	Map3DCacheHeader hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, map3DCacheMagic, sizeof(map3DCacheMagic));
+	hdr.version = map3DCacheVersion;
+	hdr.width = w;
+	hdr.height = h;
+	hdr.components = 3;
+	hdr.sourceModified = File::modified(srcPath);
+	hdr.averageRadius = interleaveMap3D(planes, w, h, &data[0], rowBytes);
+
+	std::vector<char> page(map3DCacheDataOffset, 0);
+	memcpy(&page[0], &hdr, sizeof(hdr));
+
+	File f(cachePath, "wb");
+	if (!f.open()
+		|| f.write(&page[0], page.size(), 1) != 1
+		|| f.write(&data[0], data.size(), 1) != 1
+	) {
+		printf("failed to write map cache %s\n", cachePath.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool WarpnBlend::read3D(std::string path) {
+	std::string cachePath = path + ".cache";
+
+	// Use cache if it was made from the current map file
+	Map3DCacheHeader hdr;
+	bool cached = readMap3DCacheHeader(cachePath, hdr)
+		&& (!File::exists(path) || hdr.sourceModified == File::modified(path));
+
+	std::vector<float> planes;
+	int32_t w, h;
+	if (cached) {
+		w = hdr.width;
+		h = hdr.height;
+	}
+	else if (!readMap3DRaw(path, planes, w, h)) {
+		printf("failed to read map %s\n", path.c_str());
+		return false;
+	}
+	printf("reading map %s%s: %dx%d; ", path.c_str(), cached ? " (cached)" : "", w, h);
 
 	pixelMap.resize(w, h);
 	pixelMap.target(Texture::TEXTURE_2D);
@@ -909,79 +1045,22 @@ void WarpnBlend::read3D(std::string path) {
 	pixelMap.filterMin(Texture::LINEAR);
 	pixelMap.allocate(4);
 	pixelMap.print();
-	//pixelMap.array().print();
 	Array& arr = pixelMap.array();
 
-//	inversePixelMap.resize(w, h);
-//	inversePixelMap.target(Texture::TEXTURE_2D);
-//	inversePixelMap.format(Graphics::RGBA);
-//	inversePixelMap.type(Graphics::FLOAT);
-//	inversePixelMap.filterMin(Texture::LINEAR);
-//	inversePixelMap.allocate(4);
-//	inversePixelMap.print();
-//	inversePixelMap.array().print();
-//	Array& arrinv = inversePixelMap.array();
-//	arrinv.setall(0);
-
-	int total = 0;
-	float sum = 0;
-
-	for (int y=0; y<h; y++) {
-		for (int x=0; x<w; x++) {
-			// Y axis appears to be inverted
-			int32_t y1 = (h-y-1);
-			// input data is row-major format
-			int32_t idx = y1*w+x;
-
-			float * cell = arr.cell<float>(x, y);
-			// coordinate system change:
-			cell[0] = t[idx];//*0.5+0.5;
-			cell[1] = u[idx];//*0.5+0.5;
-			cell[2] = v[idx];//*0.5+0.5;
-
-			Vec3f n(cell[0], cell[1], cell[2]);
-			float mag = n.mag();
-			sum += mag;
-			total++;
-
-			/*
-			Vec3f n(cell[0], cell[1], cell[2]);
-			// TODO: subtract from center & rotate first...
-			n = n.normalize();
-
-			// convert to polar:
-			float d = sqrt(n.x*n.x + n.y*n.y + n.z*n.z);
-			float a = atan2(n.z, n.x);	// -pi..pi
-			float e = acos(n.y/d);	// 0..pi
-
-			if (d >= 0.) {
-
-				// normalize azimuth/elevation to texture dimensions:
-				int x1 = w * fmod(a + M_2PI, M_2PI) / M_2PI; //((a/M_PI)+0.5) * w;
-				int y1 = (e/M_PI) * h;
-
-				if (x == w/2) {
-					//printf("%d, %d: ", x, y); n.print(); printf("-> %d %d (%f %f %f)\n", x1, y1, a, e, d);
-				}
-
-				if (x1 >= 0 && x1 < w && y1 >= 0 && y1 < h) {
-					// TODO: use a blending splat instead:
-					float * cellinv = arrinv.cell<float>(x1, y1);
-					cellinv[0] = n.x;
-					cellinv[1] = n.y;
-					cellinv[2] = n.z;
-					cellinv[3] = 1.;
-				}
-			}
-			*/
+	float avg;
+	if (cached) {
+		if (!readMap3DCacheData(cachePath, hdr, arr.data.ptr, arr.header.stride[1])) {
+			printf("failed to read map cache %s\n", cachePath.c_str());
+			return false;
 		}
+		avg = hdr.averageRadius;
+	} else {
+		avg = interleaveMap3D(planes, w, h, arr.data.ptr, arr.header.stride[1]);
 	}
-
-	float avg = sum / total;
 	printf("average radius %f\n", avg);
 
 	// also write this data into a mesh:
-	arr = pixelMap.array();
+	pixelMesh.reset();
 	for (unsigned y=0; y<arr.height(); y++) {
 	for (unsigned x=0; x<arr.width(); x++) {
 		Vec3f v(arr.cell<float>(x, y));
@@ -990,9 +1069,31 @@ void WarpnBlend::read3D(std::string path) {
 		pixelMesh.texCoord(x/float(arr.width()), y/float(arr.height()));
 	}}
 
-	free(t);
-	free(u);
-	free(v);
+	return true;
+}
+
+namespace {
+	struct Read3DFunc {
+		const std::vector<WarpnBlend *>& warps;
+		const std::vector<std::string>& paths;
+		std::vector<char> ok;
+		Read3DFunc(const std::vector<WarpnBlend *>& w, const std::vector<std::string>& p)
+		:	warps(w), paths(p), ok(w.size(), 0) {}
+		void operator()(int i) { ok[i] = warps[i]->read3D(paths[i]); }
+	};
+}
+
+int WarpnBlend::read3D(const std::vector<WarpnBlend *>& warps, const std::vector<std::string>& paths, int numThreads) {
+	int n = warps.size() < paths.size() ? warps.size() : paths.size();
+	Read3DFunc func(warps, paths);
+	{
+		// the calling thread also reads maps
+		TaskPool pool(numThreads > 0 ? numThreads-1 : -1);
+		pool.parallelFor(0, n, func);
+	}
+	int numRead = 0;
+	for (int i=0; i<n; ++i) numRead += func.ok[i];
+	return numRead;
 }
 
 void WarpnBlend::readProj(std::string path) {